@@ -189,6 +189,8 @@ enum {
 	ESLURM_PARTITION_IN_USE,
 	ESLURM_EXPAND_GRES,
 	ESLURM_STEP_LIMIT,
+	ESLURM_RPC_BUSY,
+	ESLURM_RPC_RATE_LIMIT,
 
 	/* switch specific error codes, specific values defined in plugin module */
 	ESLURM_SWITCH_MIN = 3000,
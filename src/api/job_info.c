@@ -828,6 +828,23 @@ line15:
 extern int
 slurm_load_jobs (time_t update_time, job_info_msg_t **resp,
 		 uint16_t show_flags)
+{
+	return slurm_load_jobs_filtered(update_time, resp, show_flags, NULL);
+}
+
+/*
+ * slurm_load_jobs_filtered - issue RPC to get the configuration of jobs
+ *	matching a filter if any job changed since update_time
+ * IN update_time - time of current configuration data
+ * IN job_info_msg_pptr - place to store a job configuration pointer
+ * IN show_flags -  job filtering option: 0, SHOW_ALL or SHOW_DETAIL
+ * IN filter - jobs to return, NULL for all jobs
+ * RET 0 or -1 on error
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int
+slurm_load_jobs_filtered (time_t update_time, job_info_msg_t **resp,
+			  uint16_t show_flags, job_info_filter_t *filter)
 {
 	int rc;
 	slurm_msg_t resp_msg;
@@ -839,6 +856,7 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **resp,
 
 	req.last_update  = update_time;
 	req.show_flags = show_flags;
+	req.filter     = filter;
 	req_msg.msg_type = REQUEST_JOB_INFO;
 	req_msg.data     = &req;
 
@@ -908,6 +926,130 @@ slurm_load_job (job_info_msg_t **resp, uint32_t job_id, uint16_t show_flags)
 	return SLURM_PROTOCOL_SUCCESS ;
 }
 
+static int _cmp_uint32(const void *a, const void *b)
+{
+	uint32_t x = *(uint32_t *) a, y = *(uint32_t *) b;
+
+	if (x < y)
+		return -1;
+	return (x > y);
+}
+
+/* Merge the changed and purged jobs of a delta into job information
+ * loaded earlier. Records of the delta are moved into old_msg. */
+static void _merge_job_delta(job_info_msg_t *old_msg,
+			     job_info_delta_msg_t *delta)
+{
+	job_info_msg_t *new_msg = delta->job_info;
+	job_info_t *job_array;
+	uint32_t *changed_id;
+	uint32_t i, j = 0, id;
+
+	changed_id = xmalloc(sizeof(uint32_t) * (new_msg->record_count + 1));
+	for (i = 0; i < new_msg->record_count; i++)
+		changed_id[i] = new_msg->job_array[i].job_id;
+	qsort(changed_id, new_msg->record_count, sizeof(uint32_t),
+	      _cmp_uint32);
+	qsort(delta->purged_job_id, delta->purged_cnt, sizeof(uint32_t),
+	      _cmp_uint32);
+
+	job_array = xmalloc(sizeof(job_info_t) *
+			    (old_msg->record_count + new_msg->record_count));
+	for (i = 0; i < old_msg->record_count; i++) {
+		id = old_msg->job_array[i].job_id;
+		if (bsearch(&id, changed_id, new_msg->record_count,
+			    sizeof(uint32_t), _cmp_uint32) ||
+		    bsearch(&id, delta->purged_job_id, delta->purged_cnt,
+			    sizeof(uint32_t), _cmp_uint32)) {
+			slurm_free_job_info_members(&old_msg->job_array[i]);
+			continue;
+		}
+		memcpy(&job_array[j++], &old_msg->job_array[i],
+		       sizeof(job_info_t));
+	}
+	memcpy(&job_array[j], new_msg->job_array,
+	       sizeof(job_info_t) * new_msg->record_count);
+	j += new_msg->record_count;
+	xfree(changed_id);
+
+	xfree(old_msg->job_array);
+	old_msg->job_array    = job_array;
+	old_msg->record_count = j;
+	old_msg->last_update  = new_msg->last_update;
+	old_msg->delta_id     = delta->delta_id;
+	old_msg->delta_seq    = delta->delta_seq;
+
+	/* The records now belong to old_msg */
+	xfree(new_msg->job_array);
+	new_msg->record_count = 0;
+}
+
+/*
+ * slurm_load_jobs_delta - issue RPC to get the jobs changed or removed
+ *	since job information was loaded and merge them into it
+ * IN/OUT job_info_msg_pptr - job information previously loaded by this
+ *	function, which is updated in place. If *job_info_msg_pptr is NULL,
+ *	all jobs are loaded into a new message.
+ * IN show_flags - job filtering options, must match those used to load
+ *	*job_info_msg_pptr
+ * RET 0 or -1 on error, with errno of SLURM_NO_CHANGE_IN_DATA if no job
+ *	changed
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int
+slurm_load_jobs_delta (job_info_msg_t **job_info_msg_pptr,
+		       uint16_t show_flags)
+{
+	int rc;
+	slurm_msg_t resp_msg;
+	slurm_msg_t req_msg;
+	job_info_delta_request_msg_t req;
+	job_info_delta_msg_t *delta;
+	job_info_msg_t *old_msg = *job_info_msg_pptr;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+
+	memset(&req, 0, sizeof(job_info_delta_request_msg_t));
+	if (old_msg) {
+		req.delta_id  = old_msg->delta_id;
+		req.delta_seq = old_msg->delta_seq;
+	}
+	req.show_flags   = show_flags;
+	req_msg.msg_type = REQUEST_JOB_INFO_DELTA;
+	req_msg.data     = &req;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_INFO_DELTA:
+		delta = (job_info_delta_msg_t *) resp_msg.data;
+		if (old_msg && !delta->full) {
+			_merge_job_delta(old_msg, delta);
+		} else {
+			slurm_free_job_info_msg(old_msg);
+			*job_info_msg_pptr = delta->job_info;
+			delta->job_info = NULL;
+			(*job_info_msg_pptr)->delta_id  = delta->delta_id;
+			(*job_info_msg_pptr)->delta_seq = delta->delta_seq;
+		}
+		slurm_free_job_info_delta_msg(delta);
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		if (rc)
+			slurm_seterrno_ret(rc);
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		break;
+	}
+
+	return SLURM_PROTOCOL_SUCCESS;
+}
+
 /*
  * slurm_pid2jobid - issue RPC to get the slurm job_id given a process_id
  *	on this machine
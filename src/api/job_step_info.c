@@ -205,6 +205,30 @@ slurm_sprint_job_step_info ( job_step_info_t * job_step_ptr,
 int
 slurm_get_job_steps (time_t update_time, uint32_t job_id, uint32_t step_id,
 		     job_step_info_response_msg_t **resp, uint16_t show_flags)
+{
+	return slurm_get_job_steps_filtered(update_time, job_id, step_id,
+					    resp, show_flags, NULL);
+}
+
+/*
+ * slurm_get_job_steps_filtered - issue RPC to get the configuration of
+ *	job steps belonging to jobs matching a filter, if changed since
+ *	update_time
+ * IN update_time - time of current configuration data
+ * IN job_id - get information for specific job id, NO_VAL for all jobs
+ * IN step_id - get information for specific job step id, NO_VAL for all
+ *	job steps
+ * IN job_info_msg_pptr - place to store a job configuration pointer
+ * IN show_flags - job step filtering options
+ * IN filter - jobs whose steps are returned, NULL for all jobs
+ * RET 0 on success, otherwise return -1 and set errno to indicate the error
+ * NOTE: free the response using slurm_free_job_step_info_response_msg
+ */
+int
+slurm_get_job_steps_filtered (time_t update_time, uint32_t job_id,
+			      uint32_t step_id,
+			      job_step_info_response_msg_t **resp,
+			      uint16_t show_flags, job_info_filter_t *filter)
 {
 	int rc;
 	slurm_msg_t req_msg;
@@ -218,6 +242,7 @@ slurm_get_job_steps (time_t update_time, uint32_t job_id, uint32_t step_id,
 	req.job_id	= job_id;
 	req.step_id	= step_id;
 	req.show_flags	= show_flags;
+	req.filter	= filter;
 	req_msg.msg_type = REQUEST_JOB_STEP_INFO;
 	req_msg.data	= &req;
 
@@ -55,12 +55,14 @@
 #include "src/common/slurm_auth.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/timers.h"
 
 #ifdef WITH_PTHREADS
 #  include <pthread.h>
 #endif /* WITH_PTHREADS */
 
 #define MAX_RETRIES 3
+#define FWD_STAT_HASH_SIZE 1024
 
 typedef struct {
 	pthread_cond_t *notify;
@@ -71,6 +73,139 @@ typedef struct {
 	pthread_mutex_t *tree_mutex;
 } fwd_tree_t;
 
+/* RPC statistics of a node, used to lay out the forwarding tree */
+typedef struct fwd_stat {
+	char *name;
+	uint32_t latency;	/* average msec per tree level, 0 if unknown */
+	uint16_t fail_cnt;	/* consecutive failures */
+	struct fwd_stat *next;
+} fwd_stat_t;
+
+/* A node of a hostlist being laid out by forward_tree_order() */
+typedef struct {
+	char *name;
+	int inx;		/* position in original hostlist */
+	uint32_t latency;
+	uint16_t fail_cnt;
+} fwd_rank_t;
+
+/* A position of a hostlist being laid out by forward_tree_order() */
+typedef struct {
+	int inx;		/* position in hostlist */
+	int desc;		/* count of nodes it forwards to */
+} fwd_slot_t;
+
+static bool fwd_adaptive = false;
+static fwd_stat_t *fwd_stat_hash[FWD_STAT_HASH_SIZE];
+static pthread_mutex_t fwd_stat_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void _start_fwd_tree(fwd_tree_t *fwd_tree);
+
+static uint32_t _fwd_stat_hash(char *name)
+{
+	uint32_t hash = 0;
+
+	while (*name)
+		hash = (hash * 31) + (unsigned char) *name++;
+	return hash % FWD_STAT_HASH_SIZE;
+}
+
+/* Find the statistics of a node, create them if requested.
+ * fwd_stat_mutex must be locked. */
+static fwd_stat_t *_fwd_stat_find(char *name, bool create)
+{
+	fwd_stat_t *stat;
+	uint32_t inx = _fwd_stat_hash(name);
+
+	for (stat = fwd_stat_hash[inx]; stat; stat = stat->next) {
+		if (!strcmp(stat->name, name))
+			return stat;
+	}
+	if (!create)
+		return NULL;
+	stat = xmalloc(sizeof(fwd_stat_t));
+	stat->name = xstrdup(name);
+	stat->next = fwd_stat_hash[inx];
+	fwd_stat_hash[inx] = stat;
+	return stat;
+}
+
+/* Order nodes by health: nodes which failed last come after the others,
+ * then by latency, then by original position */
+static int _fwd_rank_cmp(const void *a, const void *b)
+{
+	const fwd_rank_t *rank_a = a, *rank_b = b;
+
+	if ((rank_a->fail_cnt != 0) != (rank_b->fail_cnt != 0))
+		return (rank_a->fail_cnt != 0) ? 1 : -1;
+	if (rank_a->latency != rank_b->latency)
+		return (rank_a->latency < rank_b->latency) ? -1 : 1;
+	return rank_a->inx - rank_b->inx;
+}
+
+/* Order positions by the count of nodes they forward to, highest first */
+static int _fwd_slot_cmp(const void *a, const void *b)
+{
+	const fwd_slot_t *slot_a = a, *slot_b = b;
+
+	if (slot_a->desc != slot_b->desc)
+		return slot_b->desc - slot_a->desc;
+	return slot_a->inx - slot_b->inx;
+}
+
+/* Set the count of nodes each position of a list of cnt nodes forwards
+ * to, splitting the list into branches as start_msg_tree() and
+ * forward_msg() do at every level of the tree */
+static void _fwd_slot_desc(fwd_slot_t *slot, int cnt)
+{
+	int *span = set_span(cnt, 0);
+	int branch = 0, i = 0, desc;
+
+	while (i < cnt) {
+		desc = MIN(span[branch], cnt - i - 1);
+		slot[i].desc = desc;
+		_fwd_slot_desc(slot + i + 1, desc);
+		i += desc + 1;
+		branch++;
+	}
+	xfree(span);
+}
+
+/* Split the nodes left to contact in a branch whose head failed into the
+ * branches the head would have forwarded to. The first one remains in
+ * fwd_tree, the others are sent from new threads. */
+static void _split_fwd_tree(fwd_tree_t *fwd_tree)
+{
+	int *span, branch = 0, i;
+	int host_count = hostlist_count(fwd_tree->tree_hl);
+	hostlist_t hl = fwd_tree->tree_hl;
+	fwd_tree_t *new_tree;
+	char *name;
+
+	if (host_count <= 1)
+		return;
+	span = set_span(host_count, 0);
+	while ((name = hostlist_shift(hl))) {
+		new_tree = xmalloc(sizeof(fwd_tree_t));
+		memcpy(new_tree, fwd_tree, sizeof(fwd_tree_t));
+		new_tree->tree_hl = hostlist_create(name);
+		free(name);
+		for (i = 0; i < span[branch]; i++) {
+			if (!(name = hostlist_shift(hl)))
+				break;
+			hostlist_push_host(new_tree->tree_hl, name);
+			free(name);
+		}
+		if (branch++ == 0) {
+			fwd_tree->tree_hl = new_tree->tree_hl;
+			xfree(new_tree);
+		} else
+			_start_fwd_tree(new_tree);
+	}
+	hostlist_destroy(hl);
+	xfree(span);
+}
+
 void _destroy_tree_fwd(fwd_tree_t *fwd_tree)
 {
 	if(fwd_tree) {
@@ -309,6 +444,7 @@ void *_fwd_tree_thread(void *arg)
 	char *name = NULL;
 	char *buf = NULL;
 	slurm_msg_t send_msg;
+	DEF_TIMERS;
 
 	slurm_msg_t_init(&send_msg);
 	send_msg.msg_type = fwd_tree->orig_msg->msg_type;
@@ -344,12 +480,17 @@ void *_fwd_tree_thread(void *arg)
 		} else
 			debug3("Tree sending to %s", name);
 
+		START_TIMER;
 		ret_list = slurm_send_addr_recv_msgs(&send_msg, name,
 						     fwd_tree->timeout);
+		END_TIMER;
 
 		xfree(send_msg.forward.nodelist);
 
 		if(ret_list) {
+			forward_record_stats(name, ret_list,
+					     DELTA_TIMER / 1000,
+					     send_msg.forward.cnt);
 			slurm_mutex_lock(fwd_tree->tree_mutex);
 			list_transfer(fwd_tree->ret_list, ret_list);
 			pthread_cond_signal(fwd_tree->notify);
@@ -376,8 +517,13 @@ void *_fwd_tree_thread(void *arg)
 		free(name);
 
 		/* check for error and try again */
-		if(errno == SLURM_COMMUNICATIONS_CONNECTION_ERROR)
+		if(errno == SLURM_COMMUNICATIONS_CONNECTION_ERROR) {
+			/* rather than wait on one new head for the whole
+			 * branch, send its subtrees in parallel */
+			if (fwd_adaptive)
+				_split_fwd_tree(fwd_tree);
  			continue;
+		}
 
 		break;
 	}
@@ -387,6 +533,26 @@ void *_fwd_tree_thread(void *arg)
 	return NULL;
 }
 
+static void _start_fwd_tree(fwd_tree_t *fwd_tree)
+{
+	pthread_attr_t attr_agent;
+	pthread_t thread_agent;
+	int retries = 0;
+
+	slurm_attr_init(&attr_agent);
+	if (pthread_attr_setdetachstate
+	    (&attr_agent, PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate error %m");
+	while(pthread_create(&thread_agent, &attr_agent,
+			     _fwd_tree_thread, (void *)fwd_tree)) {
+		error("pthread_create error %m");
+		if (++retries > MAX_RETRIES)
+			fatal("Can't create pthread");
+		sleep(1);	/* sleep and try again */
+	}
+	slurm_attr_destroy(&attr_agent);
+}
+
 /*
  * forward_init    - initilize forward structure
  * IN: forward     - forward_t *   - struct to store forward info
@@ -431,6 +597,7 @@ extern int forward_msg(forward_struct_t *forward_struct,
 	int *span = set_span(header->forward.cnt, 0);
 	hostlist_t hl = NULL;
 	hostlist_t forward_hl = NULL;
+	hostlist_t uniq_hl = NULL;
 	char *name = NULL;
 
 	if(!forward_struct->ret_list) {
@@ -439,7 +606,15 @@ extern int forward_msg(forward_struct_t *forward_struct,
 		return SLURM_ERROR;
 	}
 	hl = hostlist_create(header->forward.nodelist);
-	hostlist_uniq(hl);
+	/* Keep the order of the nodes unless there are duplicates, the
+	 * sender may have picked the forwarders (see forward_tree_order) */
+	uniq_hl = hostlist_copy(hl);
+	hostlist_uniq(uniq_hl);
+	if (hostlist_count(uniq_hl) != hostlist_count(hl)) {
+		hostlist_destroy(hl);
+		hl = uniq_hl;
+	} else
+		hostlist_destroy(uniq_hl);
 
 	while((name = hostlist_shift(hl))) {
 		pthread_attr_t attr_agent;
@@ -535,6 +710,7 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 	xassert(msg);
 
 	hostlist_uniq(hl);
+	forward_tree_order(hl);
 	host_count = hostlist_count(hl);
 
 	span = set_span(host_count, 0);
@@ -545,15 +721,6 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 	ret_list = list_create(destroy_data_info);
 
 	while((name = hostlist_shift(hl))) {
-		pthread_attr_t attr_agent;
-		pthread_t thread_agent;
-		int retries = 0;
-
-		slurm_attr_init(&attr_agent);
-		if (pthread_attr_setdetachstate
-		    (&attr_agent, PTHREAD_CREATE_DETACHED))
-			error("pthread_attr_setdetachstate error %m");
-
 		fwd_tree = xmalloc(sizeof(fwd_tree_t));
 		fwd_tree->orig_msg = msg;
 		fwd_tree->ret_list = ret_list;
@@ -576,14 +743,7 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 			free(name);
 		}
 
-		while(pthread_create(&thread_agent, &attr_agent,
-				     _fwd_tree_thread, (void *)fwd_tree)) {
-			error("pthread_create error %m");
-			if (++retries > MAX_RETRIES)
-				fatal("Can't create pthread");
-			sleep(1);	/* sleep and try again */
-		}
-		slurm_attr_destroy(&attr_agent);
+		_start_fwd_tree(fwd_tree);
 		thr_count++;
 	}
 	xfree(span);
@@ -606,6 +766,167 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 	return ret_list;
 }
 
+/*
+ * forward_set_adaptive - enable or disable the use of RPC statistics to lay
+ *	out the forwarding tree. Statistics are discarded when disabled.
+ */
+extern void forward_set_adaptive(bool adaptive)
+{
+	fwd_stat_t *stat;
+	int i;
+
+	slurm_mutex_lock(&fwd_stat_mutex);
+	fwd_adaptive = adaptive;
+	if (!adaptive) {
+		for (i = 0; i < FWD_STAT_HASH_SIZE; i++) {
+			while ((stat = fwd_stat_hash[i])) {
+				fwd_stat_hash[i] = stat->next;
+				xfree(stat->name);
+				xfree(stat);
+			}
+		}
+	}
+	slurm_mutex_unlock(&fwd_stat_mutex);
+}
+
+extern bool forward_get_adaptive(void)
+{
+	return fwd_adaptive;
+}
+
+/*
+ * forward_record_stats - record the outcome of an RPC sent to the head of a
+ *	branch of the forwarding tree, if adaptive. The time of the RPC is
+ *	a latency sample of the head only if every node of the branch replied.
+ * IN head - node the RPC was sent to
+ * IN ret_list - responses of the branch, NULL if the head failed
+ * IN msec - time taken by the RPC
+ * IN fwd_cnt - count of nodes the head forwarded the RPC to
+ */
+extern void forward_record_stats(char *head, List ret_list, int msec,
+				 int fwd_cnt)
+{
+	ListIterator itr;
+	ret_data_info_t *ret_data_info;
+	fwd_stat_t *stat;
+	uint32_t sample;
+	bool fwd_failed = false;
+
+	if (!fwd_adaptive || !head)
+		return;
+
+	slurm_mutex_lock(&fwd_stat_mutex);
+	if (!ret_list) {
+		stat = _fwd_stat_find(head, true);
+		if (stat->fail_cnt < 0xffff)
+			stat->fail_cnt++;
+		slurm_mutex_unlock(&fwd_stat_mutex);
+		return;
+	}
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (!ret_data_info->node_name)
+			continue;
+		stat = _fwd_stat_find(ret_data_info->node_name, true);
+		if (ret_data_info->type != RESPONSE_FORWARD_FAILED) {
+			stat->fail_cnt = 0;
+			continue;
+		}
+		if (stat->fail_cnt < 0xffff)
+			stat->fail_cnt++;
+		fwd_failed = true;
+	}
+	list_iterator_destroy(itr);
+
+	/* The head replies once its whole branch did, count the time
+	 * per level of the branch as _send_and_recv_msgs() does. If a node
+	 * of the branch failed, the time is mostly the head waiting for it
+	 * to time out, so it says nothing of the head. */
+	stat = _fwd_stat_find(head, true);
+	if ((stat->fail_cnt == 0) && !fwd_failed) {
+		sample = msec / (((fwd_cnt + 1) / slurm_get_tree_width()) + 1);
+		sample = MAX(sample, 1);
+		if (stat->latency)
+			stat->latency = ((stat->latency * 3) + sample) / 4;
+		else
+			stat->latency = sample;
+	}
+	slurm_mutex_unlock(&fwd_stat_mutex);
+}
+
+/*
+ * forward_tree_order - if adaptive, reorder a list of unique nodes so that
+ *	the nodes forwarding the most messages when split by start_msg_tree()
+ *	and forward_msg() are those with the lowest latency, and the nodes
+ *	which failed last receive messages without forwarding them.
+ * IN/OUT hl - nodes to send a message to
+ */
+extern void forward_tree_order(hostlist_t hl)
+{
+	int host_count, i, known_cnt = 0;
+	uint64_t known_sum = 0;
+	fwd_rank_t *rank;
+	fwd_slot_t *slot;
+	fwd_stat_t *stat;
+	char **layout;
+	bool have_stats = false;
+
+	if (!fwd_adaptive || ((host_count = hostlist_count(hl)) <= 1))
+		return;
+
+	rank = xmalloc(sizeof(fwd_rank_t) * host_count);
+	slurm_mutex_lock(&fwd_stat_mutex);
+	for (i = 0; i < host_count; i++) {
+		rank[i].name = hostlist_shift(hl);
+		rank[i].inx = i;
+		if ((stat = _fwd_stat_find(rank[i].name, false))) {
+			rank[i].latency  = stat->latency;
+			rank[i].fail_cnt = stat->fail_cnt;
+			have_stats = true;
+		}
+		if (rank[i].latency) {
+			known_sum += rank[i].latency;
+			known_cnt++;
+		}
+	}
+	slurm_mutex_unlock(&fwd_stat_mutex);
+
+	if (!have_stats) {
+		/* Keep the node ranges for a compact message header */
+		for (i = 0; i < host_count; i++) {
+			hostlist_push_host(hl, rank[i].name);
+			free(rank[i].name);
+		}
+		xfree(rank);
+		return;
+	}
+
+	/* Nodes never measured rank as the average of those measured, so
+	 * that they get measured when faster nodes are not known */
+	for (i = 0; known_cnt && (i < host_count); i++) {
+		if (!rank[i].latency)
+			rank[i].latency = known_sum / known_cnt;
+	}
+
+	slot = xmalloc(sizeof(fwd_slot_t) * host_count);
+	for (i = 0; i < host_count; i++)
+		slot[i].inx = i;
+	_fwd_slot_desc(slot, host_count);
+	qsort(rank, host_count, sizeof(fwd_rank_t), _fwd_rank_cmp);
+	qsort(slot, host_count, sizeof(fwd_slot_t), _fwd_slot_cmp);
+
+	layout = xmalloc(sizeof(char *) * host_count);
+	for (i = 0; i < host_count; i++)
+		layout[slot[i].inx] = rank[i].name;
+	for (i = 0; i < host_count; i++) {
+		hostlist_push_host(hl, layout[i]);
+		free(layout[i]);
+	}
+	xfree(layout);
+	xfree(slot);
+	xfree(rank);
+}
+
 /*
  * mark_as_failed_forward- mark a node as failed and add it to "ret_list"
  *
@@ -103,6 +103,34 @@ extern int forward_msg(forward_struct_t *forward_struct,
  */
 extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout);
 
+/*
+ * forward_set_adaptive - enable or disable the use of RPC statistics to lay
+ *	out the forwarding tree. Statistics are discarded when disabled.
+ */
+extern void forward_set_adaptive(bool adaptive);
+extern bool forward_get_adaptive(void);
+
+/*
+ * forward_record_stats - record the outcome of an RPC sent to the head of a
+ *	branch of the forwarding tree, if adaptive. The time of the RPC is
+ *	a latency sample of the head only if every node of the branch replied.
+ * IN head - node the RPC was sent to
+ * IN ret_list - responses of the branch, NULL if the head failed
+ * IN msec - time taken by the RPC
+ * IN fwd_cnt - count of nodes the head forwarded the RPC to
+ */
+extern void forward_record_stats(char *head, List ret_list, int msec,
+				 int fwd_cnt);
+
+/*
+ * forward_tree_order - if adaptive, reorder a list of unique nodes so that
+ *	the nodes forwarding the most messages when split by start_msg_tree()
+ *	and forward_msg() are those with the lowest latency, and the nodes
+ *	which failed last receive messages without forwarding them.
+ * IN/OUT hl - nodes to send a message to
+ */
+extern void forward_tree_order(hostlist_t hl);
+
 /*
  * mark_as_failed_forward- mark a node as failed and add it to "ret_list"
  *
@@ -117,6 +117,8 @@ struct node_record {
 					 * associated with this node*/
 	char *comm_name;		/* communications path name to node */
 	uint16_t port;			/* TCP port number of the slurmd */
+	uint16_t protocol_version;	/* of the slurmd when it registered,
+					 * zero if unknown */
 	slurm_addr_t slurm_addr;	/* network address */
 	uint16_t comp_job_cnt;		/* count of jobs completing on node */
 	uint16_t run_job_cnt;		/* count of jobs running on node */
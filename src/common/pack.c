@@ -86,6 +86,8 @@ strong_alias(pack16_array,      slurm_pack16_array);
 strong_alias(unpack16_array,    slurm_unpack16_array);
 strong_alias(pack32_array,	slurm_pack32_array);
 strong_alias(unpack32_array,	slurm_unpack32_array);
+strong_alias(pack64_array,	slurm_pack64_array);
+strong_alias(unpack64_array,	slurm_unpack64_array);
 strong_alias(packmem,		slurm_packmem);
 strong_alias(unpackmem,		slurm_unpackmem);
 strong_alias(unpackmem_ptr,	slurm_unpackmem_ptr);
@@ -391,6 +393,35 @@ int unpack32_array(uint32_t ** valp, uint32_t * size_val, Buf buffer)
 	return SLURM_SUCCESS;
 }
 
+/* Given a *uint64_t, it will pack an array of size_val */
+void pack64_array(uint64_t * valp, uint32_t size_val, Buf buffer)
+{
+	uint32_t i = 0;
+
+	pack32(size_val, buffer);
+
+	for (i = 0; i < size_val; i++) {
+		pack64(*(valp + i), buffer);
+	}
+}
+
+/* Given a uint64_t ptr, it will unpack an array of size_val
+ */
+int unpack64_array(uint64_t ** valp, uint32_t * size_val, Buf buffer)
+{
+	uint32_t i = 0;
+
+	if (unpack32(size_val, buffer))
+		return SLURM_ERROR;
+
+	*valp = xmalloc((*size_val) * sizeof(uint64_t));
+	for (i = 0; i < *size_val; i++) {
+		if (unpack64((*valp) + i, buffer))
+			return SLURM_ERROR;
+	}
+	return SLURM_SUCCESS;
+}
+
 /*
  * Given a 16-bit integer in host byte order, convert to network byte order,
  * store in buffer and adjust buffer counters.
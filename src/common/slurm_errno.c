@@ -280,6 +280,10 @@ static slurm_errtab_t slurm_errtab[] = {
 	  "Job expansion with generic resource (gres) not supported"	},
 	{ ESLURM_STEP_LIMIT,
 	  "Step limit reached for this job"			},
+	{ ESLURM_RPC_BUSY,
+	  "Controller too busy for this request, retry later"	},
+	{ ESLURM_RPC_RATE_LIMIT,
+	  "Request rate limit exceeded, retry later"		},
 
 	/* slurmd error codes */
 
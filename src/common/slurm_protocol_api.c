@@ -1627,6 +1627,22 @@ extern char *slurm_get_sched_params(void)
 	return params;
 }
 
+/* slurm_get_slurmctld_params
+ * RET char * - Value of SlurmctldParameters, MUST be xfreed by caller */
+extern char *slurm_get_slurmctld_params(void)
+{
+	char *params = 0;
+	slurm_ctl_conf_t *conf;
+
+ 	if (slurmdbd_conf) {
+	} else {
+		conf = slurm_conf_lock();
+		params = xstrdup(conf->slurmctld_params);
+		slurm_conf_unlock();
+	}
+	return params;
+}
+
 /* slurm_get_sched_port
  * RET uint16_t  - Value of SchedulerPort */
 extern uint16_t slurm_get_sched_port(void)
@@ -2235,20 +2251,11 @@ List slurm_receive_msgs(slurm_fd_t fd, int steps, int timeout)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
-	header_t header;
 	int rc;
-	void *auth_cred = NULL;
-	slurm_msg_t msg;
-	Buf buffer;
-	ret_data_info_t *ret_data_info = NULL;
-	List ret_list = NULL;
 	int orig_timeout = timeout;
 
 	xassert(fd >= 0);
 
-	slurm_msg_t_init(&msg);
-	msg.conn_fd = fd;
-
 	if (timeout <= 0) {
 		/* convert secs to msec */
 		timeout  = slurm_get_msg_timeout() * 1000;
@@ -2287,11 +2294,39 @@ List slurm_receive_msgs(slurm_fd_t fd, int steps, int timeout)
 	 *  the message.
 	 */
 	if (_slurm_msg_recvfrom_timeout(fd, &buf, &buflen, 0, timeout) < 0) {
-		forward_init(&header.forward, NULL);
 		rc = errno;
-		goto total_return;
+		error("slurm_receive_msgs: %s", slurm_strerror(rc));
+		errno = rc;
+		return NULL;
 	}
 
+	return slurm_unpack_msgs(buf, buflen, fd);
+}
+
+/*
+ *  Unpack a message received from a slurmd, along with the responses of
+ *    the nodes it forwarded the message to.
+ *
+ * IN buf	- message data without its length, xfree'd by this function
+ * IN buflen	- length of buf
+ * IN fd	- connection the data was read from, only used to report its
+ *		  peer on error, or -1
+ * RET List	- List containing type (ret_data_info_t). NULL is returned
+ *		  on failure and errno set.
+ */
+List slurm_unpack_msgs(char *buf, size_t buflen, slurm_fd_t fd)
+{
+	header_t header;
+	int rc;
+	void *auth_cred = NULL;
+	slurm_msg_t msg;
+	Buf buffer;
+	ret_data_info_t *ret_data_info = NULL;
+	List ret_list = NULL;
+
+	slurm_msg_t_init(&msg);
+	msg.conn_fd = fd;
+
 #if	_DEBUG
 	_print_data (buf, buflen);
 #endif
@@ -2299,16 +2334,20 @@ List slurm_receive_msgs(slurm_fd_t fd, int steps, int timeout)
 
 	if (unpack_header(&header, buffer) == SLURM_ERROR) {
 		free_buf(buffer);
+		forward_init(&header.forward, NULL);
 		rc = SLURM_COMMUNICATIONS_RECEIVE_ERROR;
 		goto total_return;
 	}
 
 	if (check_header_version(&header) < 0) {
 		slurm_addr_t resp_addr;
-		char addr_str[32];
+		char addr_str[32] = "unknown";
 		int uid = _unpack_msg_uid(buffer);
-		slurm_get_peer_addr(fd, &resp_addr);
-		slurm_print_slurm_addr(&resp_addr, addr_str, sizeof(addr_str));
+		if (fd >= 0) {
+			slurm_get_peer_addr(fd, &resp_addr);
+			slurm_print_slurm_addr(&resp_addr, addr_str,
+					       sizeof(addr_str));
+		}
 		error("Invalid Protocol Version %u from uid=%d at %s",
 		      header.version, uid, addr_str);
 		free_buf(buffer);
@@ -2651,32 +2690,78 @@ _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
  *    Returns the size of the message sent in bytes, or -1 on failure.
  */
 int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
+{
+	Buf      buffer;
+	int      rc;
+
+	if (msg->forward.init != FORWARD_INIT) {
+		forward_init(&msg->forward, NULL);
+		msg->ret_list = NULL;
+	}
+	forward_wait(msg);
+
+	if (!(buffer = slurm_pack_node_msg(msg)))
+		return SLURM_ERROR;
+
+#if	_DEBUG
+	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
+#endif
+	/*
+	 * Send message
+	 */
+	rc = _slurm_msg_sendto( fd, get_buf_data(buffer),
+				get_buf_offset(buffer),
+				SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
+
+	if ((rc < 0) && (errno == ENOTCONN)) {
+		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
+		       msg->msg_type);
+	} else if (rc < 0) {
+		slurm_addr_t peer_addr;
+		char addr_str[32];
+
+		slurm_get_peer_addr(fd, &peer_addr);
+		slurm_print_slurm_addr(&peer_addr, addr_str, sizeof(addr_str));
+		error("slurm_msg_sendto: address:port=%s msg_type=%u: %m",
+		      addr_str, msg->msg_type);
+	}
+
+	free_buf(buffer);
+	return rc;
+}
+
+/* pack a message with its header and an auth credential, as sent by
+ *	slurm_send_node_msg() after the message length
+ *
+ * IN msg		- a slurm msg struct to be packed
+ * RET Buf		- the packed message, free with free_buf(), or NULL
+ *			  on failure with errno set
+ */
+Buf slurm_pack_node_msg(slurm_msg_t *msg)
 {
 	header_t header;
 	Buf      buffer;
 	int      rc;
 	void *   auth_cred;
-	uint16_t auth_flags = SLURM_PROTOCOL_NO_FLAGS;
 
 	/*
 	 * Initialize header with Auth credential and message type.
 	 */
-	if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
-		auth_flags = SLURM_GLOBAL_AUTH_KEY;
+	if (msg->flags & SLURM_GLOBAL_AUTH_KEY)
 		auth_cred = g_slurm_auth_create(NULL, 2, _global_auth_key());
-	} else
+	else
 		auth_cred = g_slurm_auth_create(NULL, 2, NULL);
 	if (auth_cred == NULL) {
 		error("authentication: %s",
 		      g_slurm_auth_errstr(g_slurm_auth_errno(NULL)) );
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
 	}
 
 	if (msg->forward.init != FORWARD_INIT) {
 		forward_init(&msg->forward, NULL);
 		msg->ret_list = NULL;
 	}
-	forward_wait(msg);
 
 	init_header(&header, msg, msg->flags);
 
@@ -2690,44 +2775,22 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	 * Pack auth credential
 	 */
 	rc = g_slurm_auth_pack(auth_cred, buffer);
-	(void) g_slurm_auth_destroy(auth_cred);
 	if (rc) {
 		error("authentication: %s",
 		      g_slurm_auth_errstr(g_slurm_auth_errno(auth_cred)));
+		(void) g_slurm_auth_destroy(auth_cred);
 		free_buf(buffer);
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
 	}
+	(void) g_slurm_auth_destroy(auth_cred);
 
 	/*
 	 * Pack message into buffer
 	 */
 	_pack_msg(msg, &header, buffer);
 
-#if	_DEBUG
-	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
-#endif
-	/*
-	 * Send message
-	 */
-	rc = _slurm_msg_sendto( fd, get_buf_data(buffer),
-				get_buf_offset(buffer),
-				SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
-
-	if ((rc < 0) && (errno == ENOTCONN)) {
-		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
-		       msg->msg_type);
-	} else if (rc < 0) {
-		slurm_addr_t peer_addr;
-		char addr_str[32];
-
-		slurm_get_peer_addr(fd, &peer_addr);
-		slurm_print_slurm_addr(&peer_addr, addr_str, sizeof(addr_str));
-		error("slurm_msg_sendto: address:port=%s msg_type=%u: %m",
-		      addr_str, msg->msg_type);
-	}
-
-	free_buf(buffer);
-	return rc;
+	return buffer;
 }
 
 /**********************************************************************\
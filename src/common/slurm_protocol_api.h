@@ -527,6 +527,10 @@ extern uint16_t slurm_get_root_filter(void);
  * RET char * - Value of SchedulerParameters, MUST be xfreed by caller */
 extern char *slurm_get_sched_params(void);
 
+/* slurm_get_slurmctld_params
+ * RET char * - Value of SlurmctldParameters, MUST be xfreed by caller */
+extern char *slurm_get_slurmctld_params(void);
+
 /* slurm_get_sched_port
  * RET uint16_t  - Value of SchedulerPort */
 extern uint16_t slurm_get_sched_port(void);
@@ -690,6 +694,19 @@ int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout);
  */
 List slurm_receive_msgs(slurm_fd_t fd, int steps, int timeout);
 
+/*
+ *  Unpack a message received from a slurmd, along with the responses of
+ *    the nodes it forwarded the message to.
+ *
+ * IN buf	- message data without its length, xfree'd by this function
+ * IN buflen	- length of buf
+ * IN fd	- connection the data was read from, only used to report its
+ *		  peer on error, or -1
+ * RET List	- List containing type (ret_data_info_t). NULL is returned
+ *		  on failure and errno set.
+ */
+List slurm_unpack_msgs(char *buf, size_t buflen, slurm_fd_t fd);
+
 /*
  *  Receive a slurm message on the open slurm descriptor "fd" waiting
  *    at most "timeout" seconds for the message data. This will also
@@ -722,6 +739,15 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(slurm_fd_t open_fd, slurm_msg_t *msg);
 
+/* pack a message with its header and an auth credential, as sent by
+ *	slurm_send_node_msg() after the message length
+ *
+ * IN msg		- a slurm msg struct to be packed
+ * RET Buf		- the packed message, free with free_buf(), or NULL
+ *			  on failure with errno set
+ */
+Buf slurm_pack_node_msg(slurm_msg_t *msg);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
@@ -325,14 +325,47 @@ void slurm_free_job_step_kill_msg(job_step_kill_msg_t * msg)
 	xfree(msg);
 }
 
+inline void slurm_free_job_info_filter(job_info_filter_t *filter)
+{
+	int i;
+
+	if (filter) {
+		for (i = 0; filter->accounts && (i < filter->account_cnt); i++)
+			xfree(filter->accounts[i]);
+		xfree(filter->accounts);
+		xfree(filter->job_ids);
+		for (i = 0; filter->names && (i < filter->name_cnt); i++)
+			xfree(filter->names[i]);
+		xfree(filter->names);
+		for (i = 0; filter->partitions && (i < filter->partition_cnt); i++)
+			xfree(filter->partitions[i]);
+		xfree(filter->partitions);
+		xfree(filter->states);
+		xfree(filter->user_ids);
+		xfree(filter);
+	}
+}
+
 void slurm_free_job_info_request_msg(job_info_request_msg_t *msg)
+{
+	if (msg) {
+		slurm_free_job_info_filter(msg->filter);
+		xfree(msg);
+	}
+}
+
+inline void slurm_free_job_info_delta_request_msg(
+		job_info_delta_request_msg_t *msg)
 {
 	xfree(msg);
 }
 
 void slurm_free_job_step_info_request_msg(job_step_info_request_msg_t *msg)
 {
-	xfree(msg);
+	if (msg) {
+		slurm_free_job_info_filter(msg->filter);
+		xfree(msg);
+	}
 }
 
 inline void slurm_free_front_end_info_request_msg
@@ -341,6 +374,11 @@ inline void slurm_free_front_end_info_request_msg
 	xfree(msg);
 }
 
+inline void slurm_free_stats_info_request_msg(stats_info_request_msg_t *msg)
+{
+	xfree(msg);
+}
+
 inline void slurm_free_node_info_request_msg(node_info_request_msg_t *msg)
 {
 	xfree(msg);
@@ -616,6 +654,43 @@ void slurm_free_kill_job_msg(kill_job_msg_t * msg)
 	}
 }
 
+/* List destructor for the msg_list of multi_msg_t */
+extern void slurm_destroy_multi_msg_entry(void *object)
+{
+	slurm_msg_t *msg = (slurm_msg_t *) object;
+
+	if (msg) {
+		if (msg->data)
+			slurm_free_msg_data(msg->msg_type, msg->data);
+		xfree(msg);
+	}
+}
+
+void slurm_free_multi_msg(multi_msg_t * msg)
+{
+	if (msg) {
+		if (msg->msg_list)
+			list_destroy(msg->msg_list);
+		xfree(msg);
+	}
+}
+
+void slurm_free_multi_rc_msg(multi_rc_msg_t * msg)
+{
+	if (msg) {
+		xfree(msg->rc_array);
+		xfree(msg);
+	}
+}
+
+void slurm_free_node_heartbeat_msg(node_heartbeat_msg_t * msg)
+{
+	if (msg) {
+		xfree(msg->node_list);
+		xfree(msg);
+	}
+}
+
 void slurm_free_signal_job_msg(signal_job_msg_t * msg)
 {
 	xfree(msg);
@@ -1660,6 +1735,319 @@ extern char *bg_block_state_string(uint16_t state)
 	return tmp;
 }
 
+/* Given a message type, return its name. Unknown types return the number
+ * in a static buffer which is not thread safe. */
+extern char *rpc_num2string(uint16_t opcode)
+{
+	static char buf[16];
+
+	switch (opcode) {
+	case REQUEST_NODE_REGISTRATION_STATUS:
+		return "REQUEST_NODE_REGISTRATION_STATUS";
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+		return "MESSAGE_NODE_REGISTRATION_STATUS";
+	case REQUEST_RECONFIGURE:
+		return "REQUEST_RECONFIGURE";
+	case RESPONSE_RECONFIGURE:
+		return "RESPONSE_RECONFIGURE";
+	case REQUEST_SHUTDOWN:
+		return "REQUEST_SHUTDOWN";
+	case REQUEST_SHUTDOWN_IMMEDIATE:
+		return "REQUEST_SHUTDOWN_IMMEDIATE";
+	case RESPONSE_SHUTDOWN:
+		return "RESPONSE_SHUTDOWN";
+	case REQUEST_PING:
+		return "REQUEST_PING";
+	case REQUEST_CONTROL:
+		return "REQUEST_CONTROL";
+	case REQUEST_SET_DEBUG_LEVEL:
+		return "REQUEST_SET_DEBUG_LEVEL";
+	case REQUEST_HEALTH_CHECK:
+		return "REQUEST_HEALTH_CHECK";
+	case REQUEST_TAKEOVER:
+		return "REQUEST_TAKEOVER";
+	case REQUEST_SET_SCHEDLOG_LEVEL:
+		return "REQUEST_SET_SCHEDLOG_LEVEL";
+	case REQUEST_SET_DEBUG_FLAGS:
+		return "REQUEST_SET_DEBUG_FLAGS";
+	case REQUEST_BUILD_INFO:
+		return "REQUEST_BUILD_INFO";
+	case RESPONSE_BUILD_INFO:
+		return "RESPONSE_BUILD_INFO";
+	case REQUEST_JOB_INFO:
+		return "REQUEST_JOB_INFO";
+	case RESPONSE_JOB_INFO:
+		return "RESPONSE_JOB_INFO";
+	case REQUEST_JOB_STEP_INFO:
+		return "REQUEST_JOB_STEP_INFO";
+	case RESPONSE_JOB_STEP_INFO:
+		return "RESPONSE_JOB_STEP_INFO";
+	case REQUEST_NODE_INFO:
+		return "REQUEST_NODE_INFO";
+	case RESPONSE_NODE_INFO:
+		return "RESPONSE_NODE_INFO";
+	case REQUEST_PARTITION_INFO:
+		return "REQUEST_PARTITION_INFO";
+	case RESPONSE_PARTITION_INFO:
+		return "RESPONSE_PARTITION_INFO";
+	case REQUEST_ACCTING_INFO:
+		return "REQUEST_ACCTING_INFO";
+	case RESPONSE_ACCOUNTING_INFO:
+		return "RESPONSE_ACCOUNTING_INFO";
+	case REQUEST_JOB_ID:
+		return "REQUEST_JOB_ID";
+	case RESPONSE_JOB_ID:
+		return "RESPONSE_JOB_ID";
+	case REQUEST_BLOCK_INFO:
+		return "REQUEST_BLOCK_INFO";
+	case RESPONSE_BLOCK_INFO:
+		return "RESPONSE_BLOCK_INFO";
+	case REQUEST_TRIGGER_SET:
+		return "REQUEST_TRIGGER_SET";
+	case REQUEST_TRIGGER_GET:
+		return "REQUEST_TRIGGER_GET";
+	case REQUEST_TRIGGER_CLEAR:
+		return "REQUEST_TRIGGER_CLEAR";
+	case RESPONSE_TRIGGER_GET:
+		return "RESPONSE_TRIGGER_GET";
+	case REQUEST_JOB_INFO_SINGLE:
+		return "REQUEST_JOB_INFO_SINGLE";
+	case REQUEST_SHARE_INFO:
+		return "REQUEST_SHARE_INFO";
+	case RESPONSE_SHARE_INFO:
+		return "RESPONSE_SHARE_INFO";
+	case REQUEST_RESERVATION_INFO:
+		return "REQUEST_RESERVATION_INFO";
+	case RESPONSE_RESERVATION_INFO:
+		return "RESPONSE_RESERVATION_INFO";
+	case REQUEST_PRIORITY_FACTORS:
+		return "REQUEST_PRIORITY_FACTORS";
+	case RESPONSE_PRIORITY_FACTORS:
+		return "RESPONSE_PRIORITY_FACTORS";
+	case REQUEST_TOPO_INFO:
+		return "REQUEST_TOPO_INFO";
+	case RESPONSE_TOPO_INFO:
+		return "RESPONSE_TOPO_INFO";
+	case REQUEST_TRIGGER_PULL:
+		return "REQUEST_TRIGGER_PULL";
+	case REQUEST_FRONT_END_INFO:
+		return "REQUEST_FRONT_END_INFO";
+	case RESPONSE_FRONT_END_INFO:
+		return "RESPONSE_FRONT_END_INFO";
+	case REQUEST_SPANK_ENVIRONMENT:
+		return "REQUEST_SPANK_ENVIRONMENT";
+	case RESPONCE_SPANK_ENVIRONMENT:
+		return "RESPONCE_SPANK_ENVIRONMENT";
+	case REQUEST_STATS_INFO:
+		return "REQUEST_STATS_INFO";
+	case RESPONSE_STATS_INFO:
+		return "RESPONSE_STATS_INFO";
+	case REQUEST_JOB_INFO_DELTA:
+		return "REQUEST_JOB_INFO_DELTA";
+	case RESPONSE_JOB_INFO_DELTA:
+		return "RESPONSE_JOB_INFO_DELTA";
+	case REQUEST_UPDATE_JOB:
+		return "REQUEST_UPDATE_JOB";
+	case REQUEST_UPDATE_NODE:
+		return "REQUEST_UPDATE_NODE";
+	case REQUEST_CREATE_PARTITION:
+		return "REQUEST_CREATE_PARTITION";
+	case REQUEST_DELETE_PARTITION:
+		return "REQUEST_DELETE_PARTITION";
+	case REQUEST_UPDATE_PARTITION:
+		return "REQUEST_UPDATE_PARTITION";
+	case REQUEST_CREATE_RESERVATION:
+		return "REQUEST_CREATE_RESERVATION";
+	case RESPONSE_CREATE_RESERVATION:
+		return "RESPONSE_CREATE_RESERVATION";
+	case REQUEST_DELETE_RESERVATION:
+		return "REQUEST_DELETE_RESERVATION";
+	case REQUEST_UPDATE_RESERVATION:
+		return "REQUEST_UPDATE_RESERVATION";
+	case REQUEST_UPDATE_BLOCK:
+		return "REQUEST_UPDATE_BLOCK";
+	case REQUEST_UPDATE_FRONT_END:
+		return "REQUEST_UPDATE_FRONT_END";
+	case REQUEST_RESOURCE_ALLOCATION:
+		return "REQUEST_RESOURCE_ALLOCATION";
+	case RESPONSE_RESOURCE_ALLOCATION:
+		return "RESPONSE_RESOURCE_ALLOCATION";
+	case REQUEST_SUBMIT_BATCH_JOB:
+		return "REQUEST_SUBMIT_BATCH_JOB";
+	case RESPONSE_SUBMIT_BATCH_JOB:
+		return "RESPONSE_SUBMIT_BATCH_JOB";
+	case REQUEST_BATCH_JOB_LAUNCH:
+		return "REQUEST_BATCH_JOB_LAUNCH";
+	case REQUEST_CANCEL_JOB:
+		return "REQUEST_CANCEL_JOB";
+	case RESPONSE_CANCEL_JOB:
+		return "RESPONSE_CANCEL_JOB";
+	case REQUEST_JOB_RESOURCE:
+		return "REQUEST_JOB_RESOURCE";
+	case RESPONSE_JOB_RESOURCE:
+		return "RESPONSE_JOB_RESOURCE";
+	case REQUEST_JOB_ATTACH:
+		return "REQUEST_JOB_ATTACH";
+	case RESPONSE_JOB_ATTACH:
+		return "RESPONSE_JOB_ATTACH";
+	case REQUEST_JOB_WILL_RUN:
+		return "REQUEST_JOB_WILL_RUN";
+	case RESPONSE_JOB_WILL_RUN:
+		return "RESPONSE_JOB_WILL_RUN";
+	case REQUEST_JOB_ALLOCATION_INFO:
+		return "REQUEST_JOB_ALLOCATION_INFO";
+	case RESPONSE_JOB_ALLOCATION_INFO:
+		return "RESPONSE_JOB_ALLOCATION_INFO";
+	case REQUEST_JOB_ALLOCATION_INFO_LITE:
+		return "REQUEST_JOB_ALLOCATION_INFO_LITE";
+	case RESPONSE_JOB_ALLOCATION_INFO_LITE:
+		return "RESPONSE_JOB_ALLOCATION_INFO_LITE";
+	case REQUEST_UPDATE_JOB_TIME:
+		return "REQUEST_UPDATE_JOB_TIME";
+	case REQUEST_JOB_READY:
+		return "REQUEST_JOB_READY";
+	case RESPONSE_JOB_READY:
+		return "RESPONSE_JOB_READY";
+	case REQUEST_JOB_END_TIME:
+		return "REQUEST_JOB_END_TIME";
+	case REQUEST_JOB_NOTIFY:
+		return "REQUEST_JOB_NOTIFY";
+	case REQUEST_JOB_SBCAST_CRED:
+		return "REQUEST_JOB_SBCAST_CRED";
+	case RESPONSE_JOB_SBCAST_CRED:
+		return "RESPONSE_JOB_SBCAST_CRED";
+	case REQUEST_JOB_STEP_CREATE:
+		return "REQUEST_JOB_STEP_CREATE";
+	case RESPONSE_JOB_STEP_CREATE:
+		return "RESPONSE_JOB_STEP_CREATE";
+	case REQUEST_RUN_JOB_STEP:
+		return "REQUEST_RUN_JOB_STEP";
+	case RESPONSE_RUN_JOB_STEP:
+		return "RESPONSE_RUN_JOB_STEP";
+	case REQUEST_CANCEL_JOB_STEP:
+		return "REQUEST_CANCEL_JOB_STEP";
+	case RESPONSE_CANCEL_JOB_STEP:
+		return "RESPONSE_CANCEL_JOB_STEP";
+	case REQUEST_UPDATE_JOB_STEP:
+		return "REQUEST_UPDATE_JOB_STEP";
+	case DEFUNCT_RESPONSE_COMPLETE_JOB_STEP:
+		return "DEFUNCT_RESPONSE_COMPLETE_JOB_STEP";
+	case REQUEST_CHECKPOINT:
+		return "REQUEST_CHECKPOINT";
+	case RESPONSE_CHECKPOINT:
+		return "RESPONSE_CHECKPOINT";
+	case REQUEST_CHECKPOINT_COMP:
+		return "REQUEST_CHECKPOINT_COMP";
+	case REQUEST_CHECKPOINT_TASK_COMP:
+		return "REQUEST_CHECKPOINT_TASK_COMP";
+	case RESPONSE_CHECKPOINT_COMP:
+		return "RESPONSE_CHECKPOINT_COMP";
+	case REQUEST_SUSPEND:
+		return "REQUEST_SUSPEND";
+	case RESPONSE_SUSPEND:
+		return "RESPONSE_SUSPEND";
+	case REQUEST_STEP_COMPLETE:
+		return "REQUEST_STEP_COMPLETE";
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+		return "REQUEST_COMPLETE_JOB_ALLOCATION";
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+		return "REQUEST_COMPLETE_BATCH_SCRIPT";
+	case REQUEST_JOB_STEP_STAT:
+		return "REQUEST_JOB_STEP_STAT";
+	case RESPONSE_JOB_STEP_STAT:
+		return "RESPONSE_JOB_STEP_STAT";
+	case REQUEST_STEP_LAYOUT:
+		return "REQUEST_STEP_LAYOUT";
+	case RESPONSE_STEP_LAYOUT:
+		return "RESPONSE_STEP_LAYOUT";
+	case REQUEST_JOB_REQUEUE:
+		return "REQUEST_JOB_REQUEUE";
+	case REQUEST_DAEMON_STATUS:
+		return "REQUEST_DAEMON_STATUS";
+	case RESPONSE_SLURMD_STATUS:
+		return "RESPONSE_SLURMD_STATUS";
+	case RESPONSE_SLURMCTLD_STATUS:
+		return "RESPONSE_SLURMCTLD_STATUS";
+	case REQUEST_JOB_STEP_PIDS:
+		return "REQUEST_JOB_STEP_PIDS";
+	case RESPONSE_JOB_STEP_PIDS:
+		return "RESPONSE_JOB_STEP_PIDS";
+	case REQUEST_LAUNCH_TASKS:
+		return "REQUEST_LAUNCH_TASKS";
+	case RESPONSE_LAUNCH_TASKS:
+		return "RESPONSE_LAUNCH_TASKS";
+	case MESSAGE_TASK_EXIT:
+		return "MESSAGE_TASK_EXIT";
+	case REQUEST_SIGNAL_TASKS:
+		return "REQUEST_SIGNAL_TASKS";
+	case REQUEST_CHECKPOINT_TASKS:
+		return "REQUEST_CHECKPOINT_TASKS";
+	case REQUEST_TERMINATE_TASKS:
+		return "REQUEST_TERMINATE_TASKS";
+	case REQUEST_REATTACH_TASKS:
+		return "REQUEST_REATTACH_TASKS";
+	case RESPONSE_REATTACH_TASKS:
+		return "RESPONSE_REATTACH_TASKS";
+	case REQUEST_KILL_TIMELIMIT:
+		return "REQUEST_KILL_TIMELIMIT";
+	case REQUEST_SIGNAL_JOB:
+		return "REQUEST_SIGNAL_JOB";
+	case REQUEST_TERMINATE_JOB:
+		return "REQUEST_TERMINATE_JOB";
+	case MESSAGE_EPILOG_COMPLETE:
+		return "MESSAGE_EPILOG_COMPLETE";
+	case REQUEST_ABORT_JOB:
+		return "REQUEST_ABORT_JOB";
+	case REQUEST_FILE_BCAST:
+		return "REQUEST_FILE_BCAST";
+	case TASK_USER_MANAGED_IO_STREAM:
+		return "TASK_USER_MANAGED_IO_STREAM";
+	case REQUEST_KILL_PREEMPTED:
+		return "REQUEST_KILL_PREEMPTED";
+	case REQUEST_MULTI_MSG:
+		return "REQUEST_MULTI_MSG";
+	case RESPONSE_MULTI_MSG:
+		return "RESPONSE_MULTI_MSG";
+	case MESSAGE_NODE_HEARTBEAT:
+		return "MESSAGE_NODE_HEARTBEAT";
+	case SRUN_PING:
+		return "SRUN_PING";
+	case SRUN_TIMEOUT:
+		return "SRUN_TIMEOUT";
+	case SRUN_NODE_FAIL:
+		return "SRUN_NODE_FAIL";
+	case SRUN_JOB_COMPLETE:
+		return "SRUN_JOB_COMPLETE";
+	case SRUN_USER_MSG:
+		return "SRUN_USER_MSG";
+	case SRUN_EXEC:
+		return "SRUN_EXEC";
+	case SRUN_STEP_MISSING:
+		return "SRUN_STEP_MISSING";
+	case PMI_KVS_PUT_REQ:
+		return "PMI_KVS_PUT_REQ";
+	case PMI_KVS_PUT_RESP:
+		return "PMI_KVS_PUT_RESP";
+	case PMI_KVS_GET_REQ:
+		return "PMI_KVS_GET_REQ";
+	case PMI_KVS_GET_RESP:
+		return "PMI_KVS_GET_RESP";
+	case RESPONSE_SLURM_RC:
+		return "RESPONSE_SLURM_RC";
+	case RESPONSE_FORWARD_FAILED:
+		return "RESPONSE_FORWARD_FAILED";
+	case ACCOUNTING_UPDATE_MSG:
+		return "ACCOUNTING_UPDATE_MSG";
+	case ACCOUNTING_FIRST_REG:
+		return "ACCOUNTING_FIRST_REG";
+	case ACCOUNTING_REGISTER_CTLD:
+		return "ACCOUNTING_REGISTER_CTLD";
+	}
+
+	snprintf(buf, sizeof(buf), "%u", opcode);
+	return buf;
+}
+
 /*
  * slurm_free_resource_allocation_response_msg - free slurm resource
  *	allocation response message
@@ -1795,6 +2183,19 @@ void slurm_free_job_info_msg(job_info_msg_t * job_buffer_ptr)
 	}
 }
 
+/*
+ * slurm_free_job_info_delta_msg - free a job information delta message
+ * IN msg - pointer to job information delta message
+ */
+void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg)
+{
+	if (msg) {
+		slurm_free_job_info_msg(msg->job_info);
+		xfree(msg->purged_job_id);
+		xfree(msg);
+	}
+}
+
 static void _free_all_job_info(job_info_msg_t *msg)
 {
 	int i;
@@ -1868,6 +2269,63 @@ void slurm_free_front_end_info_msg(front_end_info_msg_t * msg)
 	}
 }
 
+/*
+ * slurm_free_stats_response_msg - free the slurmctld statistics message
+ * IN msg - pointer to statistics response message
+ * NOTE: buffer is loaded by slurm_get_statistics.
+ */
+void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
+{
+	if (msg) {
+		slurm_free_stats_response_members(msg);
+		xfree(msg);
+	}
+}
+
+/*
+ * slurm_free_stats_response_members - free the arrays of a slurmctld
+ *	statistics message, but not the message itself
+ */
+void slurm_free_stats_response_members(stats_info_response_msg_t *msg)
+{
+	int i;
+
+	if (msg->rpc_class_name) {
+		for (i = 0; i < msg->rpc_class_cnt; i++)
+			xfree(msg->rpc_class_name[i]);
+		xfree(msg->rpc_class_name);
+	}
+	xfree(msg->rpc_class_active);
+	xfree(msg->rpc_class_waiting);
+	xfree(msg->rpc_class_admit_cnt);
+	xfree(msg->rpc_class_delay_cnt);
+	xfree(msg->rpc_class_busy_cnt);
+	xfree(msg->rpc_class_rate_cnt);
+	xfree(msg->rpc_class_wait_total);
+
+	xfree(msg->rpc_type_id);
+	xfree(msg->rpc_type_count);
+	xfree(msg->rpc_type_time_max);
+	xfree(msg->rpc_type_time_total);
+	xfree(msg->rpc_type_hist);
+
+	xfree(msg->rpc_user_id);
+	xfree(msg->rpc_user_count);
+	xfree(msg->rpc_user_time_total);
+
+	if (msg->lock_name) {
+		for (i = 0; i < msg->lock_cnt; i++)
+			xfree(msg->lock_name[i]);
+		xfree(msg->lock_name);
+	}
+	xfree(msg->lock_count);
+	xfree(msg->lock_wait_cnt);
+	xfree(msg->lock_wait_max);
+	xfree(msg->lock_wait_total);
+	xfree(msg->lock_hold_max);
+	xfree(msg->lock_hold_total);
+}
+
 static void _free_all_front_end_info(front_end_info_msg_t *msg)
 {
 	int i;
@@ -2236,6 +2694,9 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_JOB_INFO:
 		slurm_free_job_info_request_msg(data);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		slurm_free_job_info_delta_request_msg(data);
+		break;
 	case REQUEST_NODE_INFO:
 		slurm_free_node_info_request_msg(data);
 		break;
@@ -2318,6 +2779,9 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_FRONT_END_INFO:
 		slurm_free_front_end_info_request_msg(data);
 		break;
+	case REQUEST_STATS_INFO:
+		slurm_free_stats_info_request_msg(data);
+		break;
 	case REQUEST_SUSPEND:
 		slurm_free_suspend_msg(data);
 		break;
@@ -2380,6 +2844,15 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_TERMINATE_JOB:
 		slurm_free_kill_job_msg(data);
 		break;
+	case REQUEST_MULTI_MSG:
+		slurm_free_multi_msg(data);
+		break;
+	case RESPONSE_MULTI_MSG:
+		slurm_free_multi_rc_msg(data);
+		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		slurm_free_node_heartbeat_msg(data);
+		break;
 	case REQUEST_UPDATE_JOB_TIME:
 		slurm_free_update_job_time_msg(data);
 		break;
@@ -2454,6 +2927,17 @@ extern uint32_t slurm_get_return_code(slurm_msg_type_t type, void *data)
 	case RESPONSE_SLURM_RC:
 		rc = ((return_code_msg_t *)data)->return_code;
 		break;
+	case RESPONSE_MULTI_MSG:
+	{
+		/* first failure of the RPCs, if any */
+		multi_rc_msg_t *multi_rc = (multi_rc_msg_t *)data;
+		uint32_t i;
+		for (i = 0; i < multi_rc->rc_cnt; i++) {
+			if ((rc = multi_rc->rc_array[i]))
+				break;
+		}
+		break;
+	}
 	case RESPONSE_FORWARD_FAILED:
 		/* There may be other reasons for the failure, but
 		 * this may be a slurm_msg_t data type lacking the
@@ -215,6 +215,10 @@ typedef enum {
 	RESPONSE_FRONT_END_INFO,
 	REQUEST_SPANK_ENVIRONMENT,
 	RESPONCE_SPANK_ENVIRONMENT,
+	REQUEST_STATS_INFO,
+	RESPONSE_STATS_INFO,
+	REQUEST_JOB_INFO_DELTA,
+	RESPONSE_JOB_INFO_DELTA,
 
 	REQUEST_UPDATE_JOB = 3001,
 	REQUEST_UPDATE_NODE,
@@ -299,6 +303,9 @@ typedef enum {
 	REQUEST_FILE_BCAST,
 	TASK_USER_MANAGED_IO_STREAM,
 	REQUEST_KILL_PREEMPTED,
+	REQUEST_MULTI_MSG,
+	RESPONSE_MULTI_MSG,
+	MESSAGE_NODE_HEARTBEAT,
 
 	SRUN_PING = 7001,
 	SRUN_TIMEOUT,
@@ -485,13 +492,33 @@ typedef struct job_step_id_msg {
 typedef struct job_info_request_msg {
 	time_t last_update;
 	uint16_t show_flags;
+	job_info_filter_t *filter;	/* NULL for all jobs */
 } job_info_request_msg_t;
 
+typedef struct job_info_delta_request_msg {
+	uint32_t delta_id;	/* slurmctld instance which assigned
+				 * delta_seq, zero to request all jobs */
+	uint32_t delta_seq;	/* return jobs changed after this */
+	uint16_t show_flags;
+} job_info_delta_request_msg_t;
+
+typedef struct job_info_delta_msg {
+	uint32_t delta_id;	/* slurmctld instance, zero if the data can
+				 * not be the base of a later delta */
+	uint32_t delta_seq;	/* job modification sequence of the data */
+	uint16_t full;		/* set if job_info holds all jobs rather
+				 * than only those changed */
+	job_info_msg_t *job_info;	/* new and changed jobs */
+	uint32_t purged_cnt;		/* elements in purged_job_id */
+	uint32_t *purged_job_id;	/* jobs removed since delta_seq */
+} job_info_delta_msg_t;
+
 typedef struct job_step_info_request_msg {
 	time_t last_update;
 	uint32_t job_id;
 	uint32_t step_id;
 	uint16_t show_flags;
+	job_info_filter_t *filter;	/* NULL for steps of all jobs */
 } job_step_info_request_msg_t;
 
 typedef struct node_info_request_msg {
@@ -723,6 +750,23 @@ typedef struct kill_job_msg {
 	uint32_t spank_job_env_size;
 } kill_job_msg_t;
 
+/* Several RPCs for the same nodes sent in one message, see
+ * slurm_destroy_multi_msg_entry() */
+#define MAX_MULTI_MSG_CNT 32
+typedef struct multi_msg {
+	List msg_list;		/* slurm_msg_t with msg_type and data set */
+} multi_msg_t;
+
+typedef struct multi_rc_msg {
+	uint32_t rc_cnt;
+	uint32_t *rc_array;	/* return code of each RPC of multi_msg_t */
+} multi_rc_msg_t;
+
+/* Liveness of a node and of the nodes below it in the heartbeat tree */
+typedef struct node_heartbeat_msg {
+	char *node_list;	/* nodes alive */
+} node_heartbeat_msg_t;
+
 typedef struct signal_job_msg {
 	uint32_t job_id;
 	uint32_t signal;
@@ -968,7 +1012,10 @@ inline void slurm_free_checkpoint_tasks_msg(checkpoint_tasks_msg_t * msg);
 inline void slurm_free_last_update_msg(last_update_msg_t * msg);
 inline void slurm_free_return_code_msg(return_code_msg_t * msg);
 inline void slurm_free_job_alloc_info_msg(job_alloc_info_msg_t * msg);
+inline void slurm_free_job_info_filter(job_info_filter_t *filter);
 inline void slurm_free_job_info_request_msg(job_info_request_msg_t *msg);
+inline void slurm_free_job_info_delta_request_msg(
+		job_info_delta_request_msg_t *msg);
 inline void slurm_free_job_step_info_request_msg(
 		job_step_info_request_msg_t *msg);
 inline void slurm_free_front_end_info_request_msg(
@@ -978,6 +1025,7 @@ inline void slurm_free_part_info_request_msg(part_info_request_msg_t *msg);
 inline void slurm_free_resv_info_request_msg(resv_info_request_msg_t *msg);
 inline void slurm_free_set_debug_flags_msg(set_debug_flags_msg_t *msg);
 inline void slurm_free_set_debug_level_msg(set_debug_level_msg_t *msg);
+inline void slurm_free_stats_info_request_msg(stats_info_request_msg_t *msg);
 inline void slurm_destroy_association_shares_object(void *object);
 inline void slurm_free_shares_request_msg(shares_request_msg_t *msg);
 inline void slurm_free_shares_response_msg(shares_response_msg_t *msg);
@@ -1037,6 +1085,10 @@ slurm_free_reattach_tasks_request_msg(reattach_tasks_request_msg_t * msg);
 inline void
 slurm_free_reattach_tasks_response_msg(reattach_tasks_response_msg_t * msg);
 inline void slurm_free_kill_job_msg(kill_job_msg_t * msg);
+extern void slurm_destroy_multi_msg_entry(void *object);
+inline void slurm_free_multi_msg(multi_msg_t * msg);
+inline void slurm_free_multi_rc_msg(multi_rc_msg_t * msg);
+inline void slurm_free_node_heartbeat_msg(node_heartbeat_msg_t * msg);
 inline void slurm_free_signal_job_msg(signal_job_msg_t * msg);
 inline void slurm_free_update_job_time_msg(job_time_msg_t * msg);
 inline void slurm_free_job_step_kill_msg(job_step_kill_msg_t * msg);
@@ -1063,10 +1115,13 @@ void slurm_free_job_step_create_response_msg(
 void slurm_free_submit_response_response_msg(submit_response_msg_t * msg);
 void slurm_free_ctl_conf(slurm_ctl_conf_info_msg_t * config_ptr);
 void slurm_free_job_info_msg(job_info_msg_t * job_buffer_ptr);
+void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg);
 void slurm_free_job_step_info_response_msg(
 		job_step_info_response_msg_t * msg);
 void slurm_free_job_step_info_members (job_step_info_t * msg);
 void slurm_free_front_end_info_msg (front_end_info_msg_t * msg);
+void slurm_free_stats_response_msg(stats_info_response_msg_t *msg);
+void slurm_free_stats_response_members(stats_info_response_msg_t *msg);
 void slurm_free_front_end_info_members(front_end_info_t * front_end);
 void slurm_free_node_info_msg(node_info_msg_t * msg);
 void slurm_free_node_info_members(node_info_t * node);
@@ -1113,6 +1168,8 @@ extern char *conn_type_string(enum connection_type conn_type);
 extern char *node_use_string(enum node_use_type node_use);
 /* Translate a state enum to a readable string */
 extern char *bg_block_state_string(uint16_t state);
+/* Translate a slurm_msg_type_t to its name */
+extern char *rpc_num2string(uint16_t opcode);
 
 
 /* Validate SPANK specified job environment does not contain any invalid
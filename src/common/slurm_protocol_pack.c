@@ -68,6 +68,7 @@
 #include "src/common/slurmdbd_defs.h"
 
 #define _pack_job_info_msg(msg,buf)		_pack_buffer_msg(msg,buf)
+#define _pack_job_info_delta_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_job_step_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_block_info_resp_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_front_end_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
@@ -200,6 +201,21 @@ static void _pack_kill_job_msg(kill_job_msg_t * msg, Buf buffer,
 static int _unpack_kill_job_msg(kill_job_msg_t ** msg, Buf buffer,
 				uint16_t protocol_version);
 
+static void _pack_multi_msg(multi_msg_t * msg, Buf buffer,
+			    uint16_t protocol_version);
+static int _unpack_multi_msg(multi_msg_t ** msg, Buf buffer,
+			     uint16_t protocol_version);
+
+static void _pack_multi_rc_msg(multi_rc_msg_t * msg, Buf buffer,
+			       uint16_t protocol_version);
+static int _unpack_multi_rc_msg(multi_rc_msg_t ** msg, Buf buffer,
+				uint16_t protocol_version);
+
+static void _pack_node_heartbeat_msg(node_heartbeat_msg_t * msg, Buf buffer,
+				     uint16_t protocol_version);
+static int _unpack_node_heartbeat_msg(node_heartbeat_msg_t ** msg,
+				      Buf buffer, uint16_t protocol_version);
+
 static void _pack_signal_job_msg(signal_job_msg_t * msg, Buf buffer,
 				 uint16_t protocol_version);
 static int _unpack_signal_job_msg(signal_job_msg_t ** msg, Buf buffer,
@@ -599,6 +615,24 @@ static void _pack_spank_env_responce_msg(spank_env_responce_msg_t * msg,
 static int _unpack_spank_env_responce_msg(spank_env_responce_msg_t ** msg_ptr,
 					  Buf buffer, uint16_t protocol_version);
 
+static void _pack_stats_request_msg(stats_info_request_msg_t *msg,
+				    Buf buffer, uint16_t protocol_version);
+static int  _unpack_stats_request_msg(stats_info_request_msg_t **msg_ptr,
+				      Buf buffer, uint16_t protocol_version);
+static void _pack_stats_response_msg(stats_info_response_msg_t *msg,
+				     Buf buffer, uint16_t protocol_version);
+static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
+				       Buf buffer, uint16_t protocol_version);
+
+static void _pack_job_info_delta_request_msg(
+		job_info_delta_request_msg_t *msg, Buf buffer,
+		uint16_t protocol_version);
+static int  _unpack_job_info_delta_request_msg(
+		job_info_delta_request_msg_t **msg_ptr, Buf buffer,
+		uint16_t protocol_version);
+static int  _unpack_job_info_delta_msg(job_info_delta_msg_t **msg_ptr,
+				       Buf buffer, uint16_t protocol_version);
+
 /* pack_header
  * packs a slurm protocol header that precedes every slurm message
  * IN header - the header structure to pack
@@ -923,6 +957,18 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 		_pack_kill_job_msg((kill_job_msg_t *) msg->data, buffer,
 				   msg->protocol_version);
 		break;
+	case REQUEST_MULTI_MSG:
+		_pack_multi_msg((multi_msg_t *) msg->data, buffer,
+				msg->protocol_version);
+		break;
+	case RESPONSE_MULTI_MSG:
+		_pack_multi_rc_msg((multi_rc_msg_t *) msg->data, buffer,
+				   msg->protocol_version);
+		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		_pack_node_heartbeat_msg((node_heartbeat_msg_t *) msg->data,
+					 buffer, msg->protocol_version);
+		break;
 	case MESSAGE_EPILOG_COMPLETE:
 		_pack_epilog_comp_msg((epilog_complete_msg_t *) msg->data,
 				      buffer,
@@ -1159,6 +1205,24 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 			(spank_env_responce_msg_t *)msg->data, buffer,
 			msg->protocol_version);
 		break;
+	case REQUEST_STATS_INFO:
+		_pack_stats_request_msg(
+			(stats_info_request_msg_t *)msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case RESPONSE_STATS_INFO:
+		_pack_stats_response_msg(
+			(stats_info_response_msg_t *)msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case REQUEST_JOB_INFO_DELTA:
+		_pack_job_info_delta_request_msg(
+			(job_info_delta_request_msg_t *)msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		_pack_job_info_delta_msg((slurm_msg_t *) msg, buffer);
+		break;
 	default:
 		debug("No pack method for msg type %u", msg->msg_type);
 		return EINVAL;
@@ -1443,6 +1507,19 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					  buffer,
 					  msg->protocol_version);
 		break;
+	case REQUEST_MULTI_MSG:
+		rc = _unpack_multi_msg((multi_msg_t **) & (msg->data),
+				       buffer, msg->protocol_version);
+		break;
+	case RESPONSE_MULTI_MSG:
+		rc = _unpack_multi_rc_msg((multi_rc_msg_t **) & (msg->data),
+					  buffer, msg->protocol_version);
+		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		rc = _unpack_node_heartbeat_msg(
+			(node_heartbeat_msg_t **) & (msg->data),
+			buffer, msg->protocol_version);
+		break;
 	case MESSAGE_EPILOG_COMPLETE:
 		rc = _unpack_epilog_comp_msg((epilog_complete_msg_t **)
 					     & (msg->data), buffer,
@@ -1702,6 +1779,26 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 			(spank_env_responce_msg_t **)&msg->data, buffer,
 			msg->protocol_version);
 		break;
+	case REQUEST_STATS_INFO:
+		rc = _unpack_stats_request_msg(
+			(stats_info_request_msg_t **)&msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case RESPONSE_STATS_INFO:
+		rc = _unpack_stats_response_msg(
+			(stats_info_response_msg_t **)&msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case REQUEST_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_request_msg(
+			(job_info_delta_request_msg_t **)&msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_msg(
+			(job_info_delta_msg_t **)&msg->data, buffer,
+			msg->protocol_version);
+		break;
 	default:
 		debug("No unpack method for msg type %u", msg->msg_type);
 		return EINVAL;
@@ -3323,6 +3420,128 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Each RPC is packed as its message type followed by its body */
+static void
+_pack_multi_msg(multi_msg_t * msg, Buf buffer, uint16_t protocol_version)
+{
+	ListIterator itr;
+	slurm_msg_t *sub_msg;
+
+	xassert(msg != NULL);
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		pack32(list_count(msg->msg_list), buffer);
+		itr = list_iterator_create(msg->msg_list);
+		while ((sub_msg = list_next(itr))) {
+			pack16(sub_msg->msg_type, buffer);
+			sub_msg->protocol_version = protocol_version;
+			pack_msg(sub_msg, buffer);
+		}
+		list_iterator_destroy(itr);
+	}
+}
+
+static int
+_unpack_multi_msg(multi_msg_t ** msg, Buf buffer, uint16_t protocol_version)
+{
+	uint32_t i, msg_cnt;
+	multi_msg_t *tmp_ptr;
+	slurm_msg_t *sub_msg;
+
+	xassert(msg);
+	tmp_ptr = xmalloc(sizeof(multi_msg_t));
+	tmp_ptr->msg_list = list_create(slurm_destroy_multi_msg_entry);
+	*msg = tmp_ptr;
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		safe_unpack32(&msg_cnt, buffer);
+		if (msg_cnt > MAX_MULTI_MSG_CNT)
+			goto unpack_error;
+		for (i = 0; i < msg_cnt; i++) {
+			sub_msg = xmalloc(sizeof(slurm_msg_t));
+			slurm_msg_t_init(sub_msg);
+			list_append(tmp_ptr->msg_list, sub_msg);
+			safe_unpack16(&sub_msg->msg_type, buffer);
+			if (sub_msg->msg_type == REQUEST_MULTI_MSG)
+				goto unpack_error;
+			sub_msg->protocol_version = protocol_version;
+			if (unpack_msg(sub_msg, buffer))
+				goto unpack_error;
+		}
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_multi_msg(tmp_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
+static void
+_pack_multi_rc_msg(multi_rc_msg_t * msg, Buf buffer,
+		   uint16_t protocol_version)
+{
+	xassert(msg != NULL);
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		pack32_array(msg->rc_array, msg->rc_cnt, buffer);
+}
+
+static int
+_unpack_multi_rc_msg(multi_rc_msg_t ** msg, Buf buffer,
+		     uint16_t protocol_version)
+{
+	multi_rc_msg_t *tmp_ptr;
+
+	xassert(msg);
+	tmp_ptr = xmalloc(sizeof(multi_rc_msg_t));
+	*msg = tmp_ptr;
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		safe_unpack32_array(&tmp_ptr->rc_array, &tmp_ptr->rc_cnt,
+				    buffer);
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_multi_rc_msg(tmp_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
+static void
+_pack_node_heartbeat_msg(node_heartbeat_msg_t * msg, Buf buffer,
+			 uint16_t protocol_version)
+{
+	xassert(msg != NULL);
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		packstr(msg->node_list, buffer);
+}
+
+static int
+_unpack_node_heartbeat_msg(node_heartbeat_msg_t ** msg, Buf buffer,
+			   uint16_t protocol_version)
+{
+	uint32_t uint32_tmp;
+	node_heartbeat_msg_t *tmp_ptr;
+
+	xassert(msg);
+	tmp_ptr = xmalloc(sizeof(node_heartbeat_msg_t));
+	*msg = tmp_ptr;
+
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION) {
+		safe_unpackstr_xmalloc(&tmp_ptr->node_list, &uint32_tmp,
+				       buffer);
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_node_heartbeat_msg(tmp_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_signal_job_msg(signal_job_msg_t * msg, Buf buffer,
 		     uint16_t protocol_version)
@@ -4301,6 +4520,7 @@ _pack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t * build_ptr, Buf buffer,
 		packstr(build_ptr->job_credential_public_certificate, buffer);
 		pack16(build_ptr->job_file_append, buffer);
 		pack16(build_ptr->job_requeue, buffer);
+		pack16(build_ptr->job_state_journal, buffer);
 		packstr(build_ptr->job_submit_plugins, buffer);
 
 		pack16(build_ptr->kill_on_bad_exit, buffer);
@@ -4390,6 +4610,7 @@ _pack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t * build_ptr, Buf buffer,
 
 		pack16(build_ptr->slurmctld_debug, buffer);
 		packstr(build_ptr->slurmctld_logfile, buffer);
+		packstr(build_ptr->slurmctld_params, buffer);
 		packstr(build_ptr->slurmctld_pidfile, buffer);
 		pack32(build_ptr->slurmctld_port, buffer);
 		pack16(build_ptr->slurmctld_port_count, buffer);
@@ -4932,6 +5153,7 @@ _unpack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t **build_buffer_ptr,
 				       &uint32_tmp, buffer);
 		safe_unpack16(&build_ptr->job_file_append, buffer);
 		safe_unpack16(&build_ptr->job_requeue, buffer);
+		safe_unpack16(&build_ptr->job_state_journal, buffer);
 		safe_unpackstr_xmalloc(&build_ptr->job_submit_plugins,
 				       &uint32_tmp, buffer);
 
@@ -5046,6 +5268,8 @@ _unpack_slurm_ctl_conf_msg(slurm_ctl_conf_info_msg_t **build_buffer_ptr,
 		safe_unpack16(&build_ptr->slurmctld_debug, buffer);
 		safe_unpackstr_xmalloc(&build_ptr->slurmctld_logfile,
 				       &uint32_tmp, buffer);
+		safe_unpackstr_xmalloc(&build_ptr->slurmctld_params,
+				       &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&build_ptr->slurmctld_pidfile,
 				       &uint32_tmp, buffer);
 		safe_unpack32(&build_ptr->slurmctld_port, buffer);
@@ -7521,12 +7745,59 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void
+_pack_job_info_filter(job_info_filter_t *filter, Buf buffer,
+		      uint16_t protocol_version)
+{
+	if (filter == NULL) {
+		pack16((uint16_t) 0, buffer);
+		return;
+	}
+	pack16((uint16_t) 1, buffer);
+	packstr_array(filter->accounts, filter->account_cnt, buffer);
+	pack32_array(filter->job_ids, filter->job_id_cnt, buffer);
+	packstr_array(filter->names, filter->name_cnt, buffer);
+	packstr_array(filter->partitions, filter->partition_cnt, buffer);
+	pack16_array(filter->states, filter->state_cnt, buffer);
+	pack32_array(filter->user_ids, filter->user_cnt, buffer);
+}
+
+static int
+_unpack_job_info_filter(job_info_filter_t **filter_pptr, Buf buffer,
+			uint16_t protocol_version)
+{
+	uint16_t have_filter;
+	job_info_filter_t *filter;
+
+	*filter_pptr = NULL;
+	safe_unpack16(&have_filter, buffer);
+	if (have_filter == 0)
+		return SLURM_SUCCESS;
+
+	filter = xmalloc(sizeof(job_info_filter_t));
+	*filter_pptr = filter;
+	safe_unpackstr_array(&filter->accounts, &filter->account_cnt, buffer);
+	safe_unpack32_array(&filter->job_ids, &filter->job_id_cnt, buffer);
+	safe_unpackstr_array(&filter->names, &filter->name_cnt, buffer);
+	safe_unpackstr_array(&filter->partitions, &filter->partition_cnt,
+			     buffer);
+	safe_unpack16_array(&filter->states, &filter->state_cnt, buffer);
+	safe_unpack32_array(&filter->user_ids, &filter->user_cnt, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	/* The caller frees any partially unpacked filter */
+	return SLURM_ERROR;
+}
+
 static void
 _pack_job_info_request_msg(job_info_request_msg_t * msg, Buf buffer,
 			   uint16_t protocol_version)
 {
 	pack_time(msg->last_update, buffer);
 	pack16((uint16_t)msg->show_flags, buffer);
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		_pack_job_info_filter(msg->filter, buffer, protocol_version);
 }
 
 static int
@@ -7536,11 +7807,15 @@ _unpack_job_info_request_msg(job_info_request_msg_t** msg,
 {
 	job_info_request_msg_t*job_info;
 
-	job_info = xmalloc(sizeof(job_step_info_request_msg_t));
+	job_info = xmalloc(sizeof(job_info_request_msg_t));
 	*msg = job_info;
 
 	safe_unpack_time(&job_info->last_update, buffer);
 	safe_unpack16(&job_info->show_flags, buffer);
+	if ((protocol_version >= SLURM_2_3_PROTOCOL_VERSION) &&
+	    _unpack_job_info_filter(&job_info->filter, buffer,
+				    protocol_version))
+		goto unpack_error;
 	return SLURM_SUCCESS;
 
 unpack_error:
@@ -8059,6 +8334,8 @@ _pack_job_step_info_req_msg(job_step_info_request_msg_t * msg, Buf buffer,
 	pack32((uint32_t)msg->job_id, buffer);
 	pack32((uint32_t)msg->step_id, buffer);
 	pack16((uint16_t)msg->show_flags, buffer);
+	if (protocol_version >= SLURM_2_3_PROTOCOL_VERSION)
+		_pack_job_info_filter(msg->filter, buffer, protocol_version);
 }
 
 static int
@@ -8074,6 +8351,10 @@ _unpack_job_step_info_req_msg(job_step_info_request_msg_t ** msg, Buf buffer,
 	safe_unpack32(&job_step_info->job_id, buffer);
 	safe_unpack32(&job_step_info->step_id, buffer);
 	safe_unpack16(&job_step_info->show_flags, buffer);
+	if ((protocol_version >= SLURM_2_3_PROTOCOL_VERSION) &&
+	    _unpack_job_info_filter(&job_step_info->filter, buffer,
+				    protocol_version))
+		goto unpack_error;
 	return SLURM_SUCCESS;
 
 unpack_error:
@@ -9704,6 +9985,317 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_stats_request_msg(stats_info_request_msg_t *msg,
+				    Buf buffer, uint16_t protocol_version)
+{
+	xassert(msg != NULL);
+
+	pack16(msg->command_id, buffer);
+}
+
+static int  _unpack_stats_request_msg(stats_info_request_msg_t **msg_ptr,
+				      Buf buffer, uint16_t protocol_version)
+{
+	stats_info_request_msg_t *msg;
+
+	xassert(msg_ptr != NULL);
+
+	msg = xmalloc(sizeof(stats_info_request_msg_t));
+	*msg_ptr = msg;
+
+	safe_unpack16(&msg->command_id, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_stats_info_request_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
+static void _pack_stats_response_msg(stats_info_response_msg_t *msg,
+				     Buf buffer, uint16_t protocol_version)
+{
+	xassert(msg != NULL);
+
+	pack_time(msg->req_time, buffer);
+	pack_time(msg->req_time_start, buffer);
+	pack32(msg->server_thread_count, buffer);
+
+	pack16(msg->rpc_pool, buffer);
+	pack32(msg->rpc_pool_threads, buffer);
+	pack32(msg->rpc_pool_busy, buffer);
+	pack32(msg->rpc_queue_size, buffer);
+	pack32(msg->rpc_queue_depth, buffer);
+	pack32(msg->rpc_queue_depth_max, buffer);
+	pack32(msg->rpc_queue_cnt, buffer);
+	pack32(msg->rpc_queue_full_cnt, buffer);
+	pack64(msg->rpc_queue_wait_total, buffer);
+	pack32(msg->rpc_queue_wait_max, buffer);
+
+	packstr_array(msg->rpc_class_name, msg->rpc_class_cnt, buffer);
+	pack32_array(msg->rpc_class_active, msg->rpc_class_cnt, buffer);
+	pack32_array(msg->rpc_class_waiting, msg->rpc_class_cnt, buffer);
+	pack32_array(msg->rpc_class_admit_cnt, msg->rpc_class_cnt, buffer);
+	pack32_array(msg->rpc_class_delay_cnt, msg->rpc_class_cnt, buffer);
+	pack32_array(msg->rpc_class_busy_cnt, msg->rpc_class_cnt, buffer);
+	pack32_array(msg->rpc_class_rate_cnt, msg->rpc_class_cnt, buffer);
+	pack64_array(msg->rpc_class_wait_total, msg->rpc_class_cnt, buffer);
+
+	pack16_array(msg->rpc_type_id, msg->rpc_type_cnt, buffer);
+	pack32_array(msg->rpc_type_count, msg->rpc_type_cnt, buffer);
+	pack32_array(msg->rpc_type_time_max, msg->rpc_type_cnt, buffer);
+	pack64_array(msg->rpc_type_time_total, msg->rpc_type_cnt, buffer);
+	pack32_array(msg->rpc_type_hist,
+		     msg->rpc_type_cnt * STATS_RPC_HIST_CNT, buffer);
+
+	pack32_array(msg->rpc_user_id, msg->rpc_user_cnt, buffer);
+	pack32_array(msg->rpc_user_count, msg->rpc_user_cnt, buffer);
+	pack64_array(msg->rpc_user_time_total, msg->rpc_user_cnt, buffer);
+
+	packstr_array(msg->lock_name, msg->lock_cnt, buffer);
+	pack32_array(msg->lock_count, msg->lock_cnt, buffer);
+	pack32_array(msg->lock_wait_cnt, msg->lock_cnt, buffer);
+	pack32_array(msg->lock_wait_max, msg->lock_cnt, buffer);
+	pack64_array(msg->lock_wait_total, msg->lock_cnt, buffer);
+	pack32_array(msg->lock_hold_max, msg->lock_cnt, buffer);
+	pack64_array(msg->lock_hold_total, msg->lock_cnt, buffer);
+
+	pack32(msg->schedule_cycle_cnt, buffer);
+	pack32(msg->schedule_cycle_last, buffer);
+	pack32(msg->schedule_cycle_max, buffer);
+	pack64(msg->schedule_cycle_sum, buffer);
+	pack32(msg->schedule_depth_last, buffer);
+	pack64(msg->schedule_depth_sum, buffer);
+	pack32(msg->schedule_queue_len, buffer);
+	pack32(msg->schedule_exit_timeout, buffer);
+	pack32(msg->schedule_exit_depth, buffer);
+	pack32(msg->jobs_started, buffer);
+
+	pack32(msg->bf_cycle_cnt, buffer);
+	pack32(msg->bf_cycle_last, buffer);
+	pack32(msg->bf_cycle_max, buffer);
+	pack64(msg->bf_cycle_sum, buffer);
+	pack_time(msg->bf_when_last_cycle, buffer);
+	pack32(msg->bf_depth_last, buffer);
+	pack64(msg->bf_depth_sum, buffer);
+	pack32(msg->bf_depth_try_last, buffer);
+	pack64(msg->bf_depth_try_sum, buffer);
+	pack32(msg->bf_queue_len, buffer);
+	pack32(msg->bf_jobs_started, buffer);
+	pack32(msg->bf_start_dropped, buffer);
+	pack32(msg->bf_exit_table_full, buffer);
+	pack32(msg->bf_skip_busy, buffer);
+	pack32(msg->bf_class_hits, buffer);
+	pack32(msg->bf_class_tests, buffer);
+	pack32(msg->bf_spec_tests, buffer);
+	pack32(msg->bf_spec_discarded, buffer);
+
+	pack32(msg->job_cache_hits, buffer);
+	pack32(msg->job_cache_misses, buffer);
+	pack32(msg->node_cache_hits, buffer);
+	pack32(msg->node_cache_misses, buffer);
+	pack32(msg->part_cache_hits, buffer);
+	pack32(msg->part_cache_misses, buffer);
+	pack32(msg->cache_entries, buffer);
+}
+
+static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
+				       Buf buffer, uint16_t protocol_version)
+{
+	stats_info_response_msg_t *msg;
+	uint32_t uint32_tmp;
+
+	xassert(msg_ptr != NULL);
+
+	msg = xmalloc(sizeof(stats_info_response_msg_t));
+	*msg_ptr = msg;
+
+	safe_unpack_time(&msg->req_time, buffer);
+	safe_unpack_time(&msg->req_time_start, buffer);
+	safe_unpack32(&msg->server_thread_count, buffer);
+
+	safe_unpack16(&msg->rpc_pool, buffer);
+	safe_unpack32(&msg->rpc_pool_threads, buffer);
+	safe_unpack32(&msg->rpc_pool_busy, buffer);
+	safe_unpack32(&msg->rpc_queue_size, buffer);
+	safe_unpack32(&msg->rpc_queue_depth, buffer);
+	safe_unpack32(&msg->rpc_queue_depth_max, buffer);
+	safe_unpack32(&msg->rpc_queue_cnt, buffer);
+	safe_unpack32(&msg->rpc_queue_full_cnt, buffer);
+	safe_unpack64(&msg->rpc_queue_wait_total, buffer);
+	safe_unpack32(&msg->rpc_queue_wait_max, buffer);
+
+	safe_unpackstr_array(&msg->rpc_class_name, &msg->rpc_class_cnt,
+			     buffer);
+	safe_unpack32_array(&msg->rpc_class_active, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_class_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->rpc_class_waiting, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_class_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->rpc_class_admit_cnt, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_class_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->rpc_class_delay_cnt, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_class_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->rpc_class_busy_cnt, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_class_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->rpc_class_rate_cnt, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_class_cnt)
+		goto unpack_error;
+	safe_unpack64_array(&msg->rpc_class_wait_total, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_class_cnt)
+		goto unpack_error;
+
+	safe_unpack16_array(&msg->rpc_type_id, &msg->rpc_type_cnt, buffer);
+	safe_unpack32_array(&msg->rpc_type_count, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_type_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->rpc_type_time_max, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_type_cnt)
+		goto unpack_error;
+	safe_unpack64_array(&msg->rpc_type_time_total, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_type_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->rpc_type_hist, &uint32_tmp, buffer);
+	if (uint32_tmp != (msg->rpc_type_cnt * STATS_RPC_HIST_CNT))
+		goto unpack_error;
+
+	safe_unpack32_array(&msg->rpc_user_id, &msg->rpc_user_cnt, buffer);
+	safe_unpack32_array(&msg->rpc_user_count, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_user_cnt)
+		goto unpack_error;
+	safe_unpack64_array(&msg->rpc_user_time_total, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->rpc_user_cnt)
+		goto unpack_error;
+
+	safe_unpackstr_array(&msg->lock_name, &msg->lock_cnt, buffer);
+	safe_unpack32_array(&msg->lock_count, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->lock_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->lock_wait_cnt, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->lock_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->lock_wait_max, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->lock_cnt)
+		goto unpack_error;
+	safe_unpack64_array(&msg->lock_wait_total, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->lock_cnt)
+		goto unpack_error;
+	safe_unpack32_array(&msg->lock_hold_max, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->lock_cnt)
+		goto unpack_error;
+	safe_unpack64_array(&msg->lock_hold_total, &uint32_tmp, buffer);
+	if (uint32_tmp != msg->lock_cnt)
+		goto unpack_error;
+
+	safe_unpack32(&msg->schedule_cycle_cnt, buffer);
+	safe_unpack32(&msg->schedule_cycle_last, buffer);
+	safe_unpack32(&msg->schedule_cycle_max, buffer);
+	safe_unpack64(&msg->schedule_cycle_sum, buffer);
+	safe_unpack32(&msg->schedule_depth_last, buffer);
+	safe_unpack64(&msg->schedule_depth_sum, buffer);
+	safe_unpack32(&msg->schedule_queue_len, buffer);
+	safe_unpack32(&msg->schedule_exit_timeout, buffer);
+	safe_unpack32(&msg->schedule_exit_depth, buffer);
+	safe_unpack32(&msg->jobs_started, buffer);
+
+	safe_unpack32(&msg->bf_cycle_cnt, buffer);
+	safe_unpack32(&msg->bf_cycle_last, buffer);
+	safe_unpack32(&msg->bf_cycle_max, buffer);
+	safe_unpack64(&msg->bf_cycle_sum, buffer);
+	safe_unpack_time(&msg->bf_when_last_cycle, buffer);
+	safe_unpack32(&msg->bf_depth_last, buffer);
+	safe_unpack64(&msg->bf_depth_sum, buffer);
+	safe_unpack32(&msg->bf_depth_try_last, buffer);
+	safe_unpack64(&msg->bf_depth_try_sum, buffer);
+	safe_unpack32(&msg->bf_queue_len, buffer);
+	safe_unpack32(&msg->bf_jobs_started, buffer);
+	safe_unpack32(&msg->bf_start_dropped, buffer);
+	safe_unpack32(&msg->bf_exit_table_full, buffer);
+	safe_unpack32(&msg->bf_skip_busy, buffer);
+	safe_unpack32(&msg->bf_class_hits, buffer);
+	safe_unpack32(&msg->bf_class_tests, buffer);
+	safe_unpack32(&msg->bf_spec_tests, buffer);
+	safe_unpack32(&msg->bf_spec_discarded, buffer);
+
+	safe_unpack32(&msg->job_cache_hits, buffer);
+	safe_unpack32(&msg->job_cache_misses, buffer);
+	safe_unpack32(&msg->node_cache_hits, buffer);
+	safe_unpack32(&msg->node_cache_misses, buffer);
+	safe_unpack32(&msg->part_cache_hits, buffer);
+	safe_unpack32(&msg->part_cache_misses, buffer);
+	safe_unpack32(&msg->cache_entries, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_stats_response_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
+
+static void _pack_job_info_delta_request_msg(
+		job_info_delta_request_msg_t *msg, Buf buffer,
+		uint16_t protocol_version)
+{
+	xassert(msg != NULL);
+
+	pack32(msg->delta_id, buffer);
+	pack32(msg->delta_seq, buffer);
+	pack16(msg->show_flags, buffer);
+}
+
+static int  _unpack_job_info_delta_request_msg(
+		job_info_delta_request_msg_t **msg_ptr, Buf buffer,
+		uint16_t protocol_version)
+{
+	job_info_delta_request_msg_t *msg;
+
+	xassert(msg_ptr != NULL);
+
+	msg = xmalloc(sizeof(job_info_delta_request_msg_t));
+	*msg_ptr = msg;
+
+	safe_unpack32(&msg->delta_id, buffer);
+	safe_unpack32(&msg->delta_seq, buffer);
+	safe_unpack16(&msg->show_flags, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_request_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
+/* The body of RESPONSE_JOB_INFO_DELTA is packed by slurmctld: a header
+ * followed by the same layout as RESPONSE_JOB_INFO and the IDs of purged
+ * jobs */
+static int  _unpack_job_info_delta_msg(job_info_delta_msg_t **msg_ptr,
+				       Buf buffer, uint16_t protocol_version)
+{
+	job_info_delta_msg_t *msg;
+
+	xassert(msg_ptr != NULL);
+
+	msg = xmalloc(sizeof(job_info_delta_msg_t));
+	*msg_ptr = msg;
+
+	safe_unpack32(&msg->delta_id, buffer);
+	safe_unpack32(&msg->delta_seq, buffer);
+	safe_unpack16(&msg->full, buffer);
+	if (_unpack_job_info_msg(&msg->job_info, buffer, protocol_version))
+		goto unpack_error;
+	safe_unpack32_array(&msg->purged_job_id, &msg->purged_cnt, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
 
 /* template
    void pack_ ( * msg , Buf buffer )
@@ -242,6 +242,8 @@
 #define	unpack8			slurm_unpack8
 #define	pack32_array		slurm_pack32_array
 #define	unpack32_array		slurm_unpack32_array
+#define	pack64_array		slurm_pack64_array
+#define	unpack64_array		slurm_unpack64_array
 #define	packmem			slurm_packmem
 #define	unpackmem		slurm_unpackmem
 #define	unpackmem_ptr		slurm_unpackmem_ptr
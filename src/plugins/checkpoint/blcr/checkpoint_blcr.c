@@ -70,6 +70,7 @@
 #include "src/common/xmalloc.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/acct_policy.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmd/slurmstepd/slurmstepd_job.h"
@@ -585,6 +586,7 @@ static void _requeue_when_finished(uint32_t job_id)
 		job_ptr = find_job_record(job_id);
 		if (IS_JOB_FINISHED(job_ptr)) {
 			job_ptr->job_state = JOB_PENDING;
+			job_index_update(job_ptr);
 			job_ptr->details->submit_time = time(NULL);
 			job_ptr->restart_cnt++;
 			/* Since the job completion logger
@@ -62,6 +62,7 @@
 #include "src/common/assoc_mgr.h"
 #include "src/common/parse_time.h"
 
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/locks.h"
 
 #define SECS_PER_DAY	(24 * 60 * 60)
@@ -890,6 +891,7 @@ static void *_decay_thread(void *no_data)
 
 			job_ptr->priority =
 				_get_priority_internal(start_time, job_ptr);
+			job_index_update(job_ptr);
 			last_job_update = time(NULL);
 			debug2("priority for job %u is now %u",
 			       job_ptr->job_id, job_ptr->priority);
@@ -13,6 +13,13 @@
  *  three nodes. Without explicitly forcing the second job to use nodes
  *  "lx[06-08]", we can't start it without possibly delaying the higher
  *  priority job.
+ *
+ *  Each cycle copies the pending jobs and the resources of running jobs
+ *  while holding the slurmctld locks, plans the start of every pending job
+ *  against that copy without job or node locks, then locks again to start
+ *  the jobs planned to start now. A planned start is dropped if its job
+ *  changed or select_nodes() finds the planned nodes no longer have the
+ *  resources.
  *****************************************************************************
  *  Copyright (C) 2003-2007 The Regents of the University of California.
  *  Copyright (C) 2008-2010 Lawrence Livermore National Security.
@@ -60,6 +67,8 @@
 #include "slurm/slurm.h"
 #include "slurm/slurm_errno.h"
 
+#include "src/common/gres.h"
+#include "src/common/job_resources.h"
 #include "src/common/list.h"
 #include "src/common/macros.h"
 #include "src/common/node_select.h"
@@ -70,15 +79,16 @@
 
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/node_scheduler.h"
-#include "src/slurmctld/preempt.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
 #include "backfill.h"
+#include "node_space.h"
 
 #ifndef BACKFILL_INTERVAL
 #  define BACKFILL_INTERVAL	30
@@ -92,12 +102,11 @@
 
 #define SLURMCTLD_THREAD_LIMIT	5
 
-typedef struct node_space_map {
-	time_t begin_time;
-	time_t end_time;
-	bitstr_t *avail_bitmap;
-	int next;	/* next record, by time, zero termination */
-} node_space_map_t;
+#define BF_MAX_THREADS		16	/* limit of bf_threads */
+#define BF_SPECS_PER_THREAD	4	/* jobs tested by each thread in a
+					 * batch of speculative tests */
+#define BF_MAX_SELECT_TRIES	4	/* select plugin tests of a job */
+
 int backfilled_jobs = 0;
 
 /*********************** local variables *********************/
@@ -110,52 +119,183 @@ static uint32_t debug_flags = 0;
 static int backfill_interval = BACKFILL_INTERVAL;
 static int backfill_window = BACKFILL_WINDOW;
 static int max_backfill_job_cnt = 50;
+static int backfill_threads = 1;
+static uint32_t cr_enabled = 0;
+static uint16_t max_threads = 1;	/* most threads per core of any node */
+
+/* Statistics for the current backfill cycle. Folded into
+ * slurmctld_diag_stats when the cycle completes. */
+static uint32_t cycle_depth = 0, cycle_depth_try = 0, cycle_started = 0;
+static uint32_t cycle_queue_len = 0, cycle_start_dropped = 0;
+static uint32_t cycle_class_hits = 0, cycle_class_tests = 0;
+static uint32_t cycle_spec_tests = 0, cycle_spec_discarded = 0;
+static bool cycle_table_full = false;
+
+/* Fields of a pending job which determine whether and when it can start,
+ * numeric fields only so keys can be compared with memcmp() */
+typedef struct job_class_key {
+	struct part_record *part_ptr;
+	uint32_t user_id;
+	uint32_t assoc_id;
+	uint32_t qos_id;
+	uint32_t resv_id;
+	uint32_t time_limit;
+	uint32_t time_min;
+	uint32_t min_nodes;
+	uint32_t max_nodes;
+	uint32_t min_cpus;
+	uint32_t max_cpus;
+	uint32_t num_tasks;
+	uint32_t pn_min_cpus;
+	uint32_t pn_min_memory;
+	uint32_t pn_min_tmp_disk;
+	uint16_t contiguous;
+	uint16_t cpus_per_task;
+	uint16_t ntasks_per_node;
+	uint16_t plane_size;
+	uint16_t shared;
+	uint16_t task_dist;
+	uint16_t overcommit;
+	multi_core_data_t mc;
+} job_class_key_t;
+
+/* Pending jobs with the same key and the same features, GRES and licenses.
+ * Once one is tested, the others get the same result until the timeline
+ * or the state of nodes or running jobs changes. */
+typedef struct job_class {
+	job_class_key_t key;
+	char *features;
+	char *gres;
+	char *licenses;
+	uint32_t hash;
+	bool tested;			/* set if result below is valid */
+	uint32_t space_gen;		/* timeline generation of result */
+	time_t start_time;		/* expected start, zero if none */
+	struct job_class *next;
+} job_class_t;
+
+typedef struct job_class_table {
+	job_class_t **class_hash;
+	int hash_size;
+} job_class_table_t;
+
+/* Scheduling data of a pending job in one partition, copied while
+ * slurmctld locks are held so that its start can be planned without them */
+typedef struct bf_job {
+	uint32_t job_id;
+	struct part_record *part_ptr;	/* only compared without locks */
+	bool multi_part;		/* job queued in several partitions */
+	job_class_t *job_class;
+	bitstr_t *avail_bitmap;		/* nodes the job may use */
+	bitstr_t *req_node_bitmap;	/* nodes the job requires, or NULL */
+	node_space_req_t space_req;
+	time_t start_res;		/* earliest start in reservations */
+	uint32_t min_nodes;
+	uint32_t max_nodes;
+	uint32_t req_nodes;
+	uint32_t min_cpus;
+	uint32_t time_limit;		/* minutes to plan for */
+	uint32_t comp_time_limit;	/* job's limit within partition's */
+	bool no_reserve;		/* QOS reserves no resources */
+	time_t start_time;		/* planned start, zero if none */
+	bitstr_t *use_bitmap;		/* nodes for a job to start now */
+	struct job_record *select_job;	/* copy tested by select plugin */
+} bf_job_t;
+
+/* State copied at the start of a backfill cycle */
+typedef struct bf_snapshot {
+	time_t now;
+	time_t part_update;		/* last_part_update when copied */
+	bool part_changed;		/* partitions changed since copied */
+	node_space_t *node_space;	/* running jobs and plans */
+	int base_slice_cnt;		/* time slices of running jobs */
+	uint32_t *node_cpus;		/* CPUs of each node */
+	int node_cnt;
+	bf_job_t *jobs;			/* in the order to be considered */
+	int job_cnt;
+	job_class_table_t class_table;
+} bf_snapshot_t;
+
+/* Speculative test of a pending job against the timeline as it was when
+ * its batch was tested */
+typedef struct bf_spec {
+	int inx;			/* index in bf_snapshot_t.jobs */
+	time_t start_time;		/* earliest start, if use_bitmap set */
+	bitstr_t *use_bitmap;		/* nodes to use, NULL if the job can
+					 * not start within the window */
+} bf_spec_t;
+
+/* Jobs tested speculatively by the backfill threads. The worker threads
+ * last for a backfill cycle, waiting on work_cond for each batch. */
+typedef struct bf_batch {
+	pthread_mutex_t lock;		/* protects the fields below it */
+	pthread_cond_t work_cond;	/* batch to test or shutdown */
+	pthread_cond_t done_cond;	/* all tests of the batch done */
+	int spec_cnt;
+	int next_test;			/* next spec for a thread to test */
+	int test_done;			/* specs tested */
+	bool shutdown;			/* worker threads to exit */
+	bf_snapshot_t *snap;
+	bf_spec_t *specs;		/* in the order jobs are considered */
+	int spec_max;
+	int next_use;			/* next spec for the plan to use */
+	uint32_t space_gen;		/* timeline generation when tested */
+	pthread_t thread_id[BF_MAX_THREADS];
+	int thread_cnt;			/* worker threads started */
+} bf_batch_t;
 
 /*********************** local functions *********************/
-static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs);
-static int  _attempt_backfill(void);
+static void _batch_free(bf_batch_t *batch);
+static void _batch_init(bf_batch_t *batch, bf_snapshot_t *snap);
+static bf_spec_t *_batch_spec(bf_batch_t *batch, int inx);
+static void _batch_test(bf_batch_t *batch, int inx, uint32_t space_gen);
+static void *_batch_thread(void *arg);
+static void _batch_work(bf_batch_t *batch, bool worker);
+static void _cycle_stats_begin(void);
+static void _cycle_stats_end(struct timeval *tv1, struct timeval *tv2);
 static void _diff_tv_str(struct timeval *tv1,struct timeval *tv2,
 		char *tv_str, int len_tv_str);
 static bool _job_is_completing(void);
+static bool _job_plan_valid(bf_snapshot_t *snap, bf_job_t *bf_job,
+			    struct job_record *job_ptr);
+static void _job_select(bf_snapshot_t *snap, bf_job_t *bf_job,
+			time_t *start_time, bitstr_t **use_bitmap);
+static bool _job_start_planned(bf_snapshot_t *snap, int inx);
+static bitstr_t *_job_test(bf_snapshot_t *snap, bf_job_t *bf_job,
+			   time_t *start_time);
+static job_class_t *_job_class_find(job_class_table_t *class_table,
+				    struct job_record *job_ptr);
+static void _job_class_set(job_class_t *job_class, uint32_t space_gen,
+			   time_t start_time);
+static void _job_class_table_free(job_class_table_t *class_table);
 static void _load_config(void);
 static bool _many_pending_rpcs(void);
 static bool _more_work(time_t last_backfill_time);
 static void _my_sleep(int secs);
-static int  _num_feature_count(struct job_record *job_ptr);
+static void _job_space_req(struct job_record *job_ptr,
+			   struct part_record *part_ptr,
+			   node_space_req_t *req);
+static uint32_t _node_cpus(bf_snapshot_t *snap, bf_job_t *bf_job, int inx);
+static bitstr_t *_pick_nodes(bf_snapshot_t *snap, bf_job_t *bf_job,
+			     bitstr_t *avail_bitmap);
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
-				  node_space_map_t *node_space);
+				  node_space_t *node_space, time_t min_end);
+static bool _snapshot_build(bf_snapshot_t *snap);
+static void _snapshot_commit(bf_snapshot_t *snap);
+static void _snapshot_free(bf_snapshot_t *snap);
+static bool _snapshot_job(bf_snapshot_t *snap, bf_job_t *bf_job,
+			  struct job_record *job_ptr,
+			  struct part_record *part_ptr);
+static void _snapshot_nodes(bf_snapshot_t *snap);
+static int  _snapshot_plan(bf_snapshot_t *snap);
 static int  _start_job(struct job_record *job_ptr, bitstr_t *avail_bitmap);
-static bool _test_resv_overlap(node_space_map_t *node_space,
-			       bitstr_t *use_bitmap, uint32_t start_time,
-			       uint32_t end_reserve);
-static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
-		       uint32_t min_nodes, uint32_t max_nodes,
-		       uint32_t req_nodes);
-
-/* Log resource allocate table */
-static void _dump_node_space_table(node_space_map_t *node_space_ptr)
-{
-	int i = 0;
-	char begin_buf[32], end_buf[32], *node_list;
-
-	info("=========================================");
-	while (1) {
-		slurm_make_time_str(&node_space_ptr[i].begin_time,
-				    begin_buf, sizeof(begin_buf));
-		slurm_make_time_str(&node_space_ptr[i].end_time,
-				    end_buf, sizeof(end_buf));
-		node_list = bitmap2node_name(node_space_ptr[i].avail_bitmap);
-		info("Begin:%s End:%s Nodes:%s",
-		     begin_buf, end_buf, node_list);
-		xfree(node_list);
-		if ((i = node_space_ptr[i].next) == 0)
-			break;
-	}
-	info("=========================================");
-}
+static int  _strcmp(const char *s1, const char *s2);
+static struct job_record *_select_job_copy(struct job_record *job_ptr,
+					   struct part_record *part_ptr,
+					   uint32_t time_limit);
+static void _select_job_free(struct job_record *job_ptr);
+static int  _select_test(bf_snapshot_t *snap, bf_job_t *bf_job,
+			 bitstr_t *avail_bitmap);
 
 /*
  * _diff_tv_str - build a string showing the time difference between two times
@@ -217,125 +357,6 @@ static bool _many_pending_rpcs(void)
 	return false;
 }
 
-/* test if job has feature count specification */
-static int _num_feature_count(struct job_record *job_ptr)
-{
-	struct job_details *detail_ptr = job_ptr->details;
-	int rc = 0;
-	ListIterator feat_iter;
-	struct feature_record *feat_ptr;
-
-	if (detail_ptr->feature_list == NULL)	/* no constraints */
-		return rc;
-
-	feat_iter = list_iterator_create(detail_ptr->feature_list);
-	if (feat_iter == NULL)
-		fatal("list_iterator_create: malloc failure");
-	while ((feat_ptr = (struct feature_record *) list_next(feat_iter))) {
-		if (feat_ptr->count)
-			rc++;
-	}
-	list_iterator_destroy(feat_iter);
-
-	return rc;
-}
-
-/* Attempt to schedule a specific job on specific available nodes
- * IN job_ptr - job to schedule
- * IN/OUT avail_bitmap - nodes available/selected to use
- * RET SLURM_SUCCESS on success, otherwise an error code
- */
-static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
-		       uint32_t min_nodes, uint32_t max_nodes,
-		       uint32_t req_nodes)
-{
-	bitstr_t *tmp_bitmap;
-	int rc = SLURM_SUCCESS;
-	int feat_cnt = _num_feature_count(job_ptr);
-	List preemptee_candidates = NULL;
-
-	if (feat_cnt) {
-		/* Ideally schedule the job feature by feature,
-		 * but I don't want to add that complexity here
-		 * right now, so clear the feature counts and try
-		 * to schedule. This will work if there is only
-		 * one feature count. It should work fairly well
-		 * in cases where there are multiple feature
-		 * counts. */
-		struct job_details *detail_ptr = job_ptr->details;
-		ListIterator feat_iter;
-		struct feature_record *feat_ptr;
-		int i = 0, list_size;
-		uint16_t *feat_cnt_orig = NULL, high_cnt = 0;
-
-		/* Clear the feature counts */
-		list_size = list_count(detail_ptr->feature_list);
-		feat_cnt_orig = xmalloc(sizeof(uint16_t) * list_size);
-		feat_iter = list_iterator_create(detail_ptr->feature_list);
-		if (feat_iter == NULL)
-			fatal("list_iterator_create: malloc failure");
-		while ((feat_ptr =
-			(struct feature_record *) list_next(feat_iter))) {
-			high_cnt = MAX(high_cnt, feat_ptr->count);
-			feat_cnt_orig[i++] = feat_ptr->count;
-			feat_ptr->count = 0;
-		}
-		list_iterator_destroy(feat_iter);
-
-		if ((job_req_node_filter(job_ptr, *avail_bitmap) !=
-		     SLURM_SUCCESS) ||
-		    (bit_set_count(*avail_bitmap) < high_cnt)) {
-			rc = ESLURM_NODES_BUSY;
-		} else {
-			preemptee_candidates =
-					slurm_find_preemptable_jobs(job_ptr);
-			rc = select_g_job_test(job_ptr, *avail_bitmap,
-					       high_cnt, max_nodes, req_nodes,
-					       SELECT_MODE_WILL_RUN,
-					       preemptee_candidates, NULL);
-		}
-
-		/* Restore the feature counts */
-		i = 0;
-		feat_iter = list_iterator_create(detail_ptr->feature_list);
-		while ((feat_ptr =
-			(struct feature_record *) list_next(feat_iter))) {
-			feat_ptr->count = feat_cnt_orig[i++];
-		}
-		list_iterator_destroy(feat_iter);
-		xfree(feat_cnt_orig);
-	} else {
-		/* Try to schedule the job. First on dedicated nodes
-		 * then on shared nodes (if so configured). */
-		uint16_t orig_shared;
-		time_t now = time(NULL);
-		preemptee_candidates = slurm_find_preemptable_jobs(job_ptr);
-		orig_shared = job_ptr->details->shared;
-		job_ptr->details->shared = 0;
-		tmp_bitmap = bit_copy(*avail_bitmap);
-		rc = select_g_job_test(job_ptr, *avail_bitmap, min_nodes,
-				       max_nodes, req_nodes,
-				       SELECT_MODE_WILL_RUN,
-				       preemptee_candidates, NULL);
-		job_ptr->details->shared = orig_shared;
-		if (((rc != SLURM_SUCCESS) || (job_ptr->start_time > now)) &&
-		    (orig_shared != 0)) {
-			FREE_NULL_BITMAP(*avail_bitmap);
-			*avail_bitmap= tmp_bitmap;
-			rc = select_g_job_test(job_ptr, *avail_bitmap,
-					       min_nodes, max_nodes, req_nodes,
-					       SELECT_MODE_WILL_RUN,
-					       preemptee_candidates, NULL);
-		} else
-			FREE_NULL_BITMAP(tmp_bitmap);
-	}
-
-	if (preemptee_candidates)
-		list_destroy(preemptee_candidates);
-	return rc;
-
-}
-
 /* Terminate backfill_agent */
 extern void stop_backfill_agent(void)
 {
@@ -382,107 +403,309 @@ static void _load_config(void)
 		fatal("Invalid backfill scheduler max_job_bf: %d",
 		      max_backfill_job_cnt);
 	}
+	backfill_threads = 1;
+	if (sched_params && (tmp_ptr=strstr(sched_params, "bf_threads=")))
+		backfill_threads = atoi(tmp_ptr + 11);
+	if ((backfill_threads < 1) || (backfill_threads > BF_MAX_THREADS)) {
+		fatal("Invalid backfill scheduler bf_threads: %d",
+		      backfill_threads);
+	}
 	xfree(sched_params);
+
+	cr_enabled = 0;	/* select/linear and bluegene are no-ops */
+	(void) select_g_get_info_from_plugin(SELECT_CR_PLUGIN, NULL,
+					     &cr_enabled);
 }
 
-/* Note that slurm.conf has changed */
-extern void backfill_reconfig(void)
+/* Set the most CPUs and memory a pending job may use of one node. The
+ * select plugin only lays out a job's resources when starting it, so
+ * this is an upper bound on what it will be given. */
+static void _job_space_req(struct job_record *job_ptr,
+			   struct part_record *part_ptr,
+			   node_space_req_t *req)
 {
-	config_flag = true;
+	struct job_details *detail_ptr = job_ptr->details;
+	uint32_t mem;
+
+	memset(req, 0, sizeof(node_space_req_t));
+	if (!cr_enabled ||
+	    (slurmctld_conf.select_type_param & CR_SOCKET) ||
+	    (part_ptr->max_share == 0) || (detail_ptr->shared == 0)) {
+		req->whole_node = true;
+		return;
+	}
+
+	/* Every other node of the job gets at least one CPU */
+	req->cpus = detail_ptr->min_cpus;
+	if ((detail_ptr->min_nodes > 1) && (req->cpus >= detail_ptr->min_nodes))
+		req->cpus -= (detail_ptr->min_nodes - 1);
+	req->cpus = MAX(req->cpus, detail_ptr->pn_min_cpus);
+	req->cpus = MAX(req->cpus, 1);
+	if (slurmctld_conf.select_type_param & CR_CORE)
+		req->cpus *= max_threads;	/* whole cores are allocated */
+
+	mem = detail_ptr->pn_min_memory;
+	if (mem & MEM_PER_CPU)
+		req->mem_per_cpu = mem & (~MEM_PER_CPU);
+	else
+		req->mem_per_node = mem;
 }
 
-/* backfill_agent - detached thread periodically attempts to backfill jobs */
-extern void *backfill_agent(void *args)
+/* Build the timeline of a snapshot with every CPU and, if memory is a
+ * consumable resource, all memory of the available nodes free except for
+ * that of running and suspended jobs.
+ * Call with job and node read locks */
+static void _snapshot_nodes(bf_snapshot_t *snap)
 {
-	struct timeval tv1, tv2;
-	char tv_str[20];
-	time_t now;
-	double wait_time;
-	static time_t last_backfill_time = 0;
-	/* Read config and partitions; Write jobs and nodes */
-	slurmctld_lock_t all_locks = {
-		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
-
-	_load_config();
-	last_backfill_time = time(NULL);
-	while (!stop_backfill) {
-		_my_sleep(backfill_interval);
-		if (stop_backfill)
-			break;
-		if (config_flag) {
-			config_flag = false;
-			_load_config();
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	struct node_record *node_ptr;
+	node_space_req_t space_req;
+	uint32_t *mem = NULL;
+	time_t end_time;
+	int i;
+
+	snap->node_cnt = node_record_count;
+	snap->node_cpus = xmalloc(sizeof(uint32_t) * node_record_count);
+	if (cr_enabled && (slurmctld_conf.select_type_param & CR_MEMORY))
+		mem = xmalloc(sizeof(uint32_t) * node_record_count);
+	max_threads = 1;
+	for (i = 0, node_ptr = node_record_table_ptr; i < node_record_count;
+	     i++, node_ptr++) {
+		if (slurmctld_conf.fast_schedule) {
+			snap->node_cpus[i] = node_ptr->config_ptr->cpus;
+			if (mem)
+				mem[i] = node_ptr->config_ptr->real_memory;
+			max_threads = MAX(max_threads,
+					  node_ptr->config_ptr->threads);
+		} else {
+			snap->node_cpus[i] = node_ptr->cpus;
+			if (mem)
+				mem[i] = node_ptr->real_memory;
+			max_threads = MAX(max_threads, node_ptr->threads);
 		}
-		now = time(NULL);
-		wait_time = difftime(now, last_backfill_time);
-		if ((wait_time < backfill_interval) ||
-		    _job_is_completing() || _many_pending_rpcs() ||
-		    !avail_front_end() || !_more_work(last_backfill_time))
+	}
+	snap->node_space = node_space_create(snap->now,
+					     snap->now + backfill_window,
+					     avail_node_bitmap,
+					     node_record_count,
+					     snap->node_cpus, mem);
+	xfree(mem);
+
+	/* Jobs past their end time or completing hold their resources a
+	 * little longer, so plan nothing else to start on them now */
+	memset(&space_req, 0, sizeof(node_space_req_t));
+	space_req.whole_node = !cr_enabled;
+	job_iterator = list_iterator_create(job_list);
+	if (job_iterator == NULL)
+		fatal("list_iterator_create: malloc failure");
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		if ((!IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr) &&
+		     !IS_JOB_COMPLETING(job_ptr)) ||
+		    (job_ptr->node_bitmap == NULL))
 			continue;
-
-		gettimeofday(&tv1, NULL);
-		lock_slurmctld(all_locks);
-		while (_attempt_backfill()) ;
-		last_backfill_time = time(NULL);
-		unlock_slurmctld(all_locks);
-		gettimeofday(&tv2, NULL);
-		_diff_tv_str(&tv1, &tv2, tv_str, 20);
-		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			info("backfill: completed, %s", tv_str);
+		end_time = MAX(job_ptr->end_time, snap->now + 1);
+		if (IS_JOB_COMPLETING(job_ptr))
+			end_time = snap->now + 1;
+		space_req.job_resrcs = job_ptr->job_resrcs;
+		node_space_reserve(snap->node_space, &space_req,
+				   job_ptr->node_bitmap, snap->now, end_time);
 	}
-	return NULL;
+	list_iterator_destroy(job_iterator);
+	snap->base_slice_cnt = node_space_count(snap->node_space);
 }
 
-/* Return non-zero to break the backfill loop if change in job, node or
- * partition state or the backfill scheduler needs to be stopped. */
-static int _yield_locks(void)
+/* Copy the scheduling data of a pending job in one of its partitions.
+ * RET true if the job may start in the partition at some time */
+static bool _snapshot_job(bf_snapshot_t *snap, bf_job_t *bf_job,
+			  struct job_record *job_ptr,
+			  struct part_record *part_ptr)
 {
-	slurmctld_lock_t all_locks = {
-		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
-	time_t job_update, node_update, part_update;
-
-	job_update  = last_job_update;
-	node_update = last_node_update;
-	part_update = last_part_update;
+	struct job_details *detail_ptr = job_ptr->details;
+	slurmdb_qos_rec_t *qos_ptr = job_ptr->qos_ptr;
+	uint32_t time_limit, orig_time_limit;
+	uint32_t min_nodes, max_nodes, req_nodes;
+	bitstr_t *avail_bitmap = NULL;
+	time_t start_res;
+	int rc;
 
-	unlock_slurmctld(all_locks);
-	_my_sleep(backfill_interval);
-	lock_slurmctld(all_locks);
+	memset(bf_job, 0, sizeof(bf_job_t));
 
-	if ((last_job_update  == job_update)  &&
-	    (last_node_update == node_update) &&
-	    (last_part_update == part_update) &&
-	    (! stop_backfill) && (! config_flag))
-		return 0;
+	/* Determine minimum and maximum node counts */
+	min_nodes = MAX(detail_ptr->min_nodes, part_ptr->min_nodes);
+	if (detail_ptr->max_nodes == 0)
+		max_nodes = part_ptr->max_nodes;
 	else
-		return 1;
+		max_nodes = MIN(detail_ptr->max_nodes, part_ptr->max_nodes);
+	max_nodes = MIN(max_nodes, 500000);     /* prevent overflows */
+	if (detail_ptr->max_nodes)
+		req_nodes = max_nodes;
+	else
+		req_nodes = min_nodes;
+	if (min_nodes > max_nodes) {
+		/* job's min_nodes exceeds partition's max_nodes */
+		return false;
+	}
+
+	/* Determine job's expected completion time */
+	if (job_ptr->time_limit == NO_VAL) {
+		if (part_ptr->max_time == INFINITE)
+			time_limit = 365 * 24 * 60; /* one year */
+		else
+			time_limit = part_ptr->max_time;
+	} else {
+		if (part_ptr->max_time == INFINITE)
+			time_limit = job_ptr->time_limit;
+		else
+			time_limit = MIN(job_ptr->time_limit,
+					 part_ptr->max_time);
+	}
+	bf_job->comp_time_limit = time_limit;
+	bf_job->no_reserve = (qos_ptr &&
+			      (qos_ptr->flags & QOS_FLAG_NO_RESERVE));
+	if (bf_job->no_reserve)
+		time_limit = 1;
+	else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
+		time_limit = job_ptr->time_min;
+	bf_job->time_limit = time_limit;
+
+	/* Determine impact of any resource reservations */
+	orig_time_limit = job_ptr->time_limit;
+	job_ptr->time_limit = time_limit;
+	start_res = snap->now;
+	rc = job_test_resv(job_ptr, &start_res, true, &avail_bitmap);
+	job_ptr->time_limit = orig_time_limit;
+	if (rc != SLURM_SUCCESS) {
+		FREE_NULL_BITMAP(avail_bitmap);
+		return false;
+	}
+
+	/* Identify usable nodes for this job */
+	bit_and(avail_bitmap, part_ptr->node_bitmap);
+	bit_and(avail_bitmap, up_node_bitmap);
+	bit_and(avail_bitmap, avail_node_bitmap);
+	if (detail_ptr->exc_node_bitmap) {
+		bit_not(detail_ptr->exc_node_bitmap);
+		bit_and(avail_bitmap, detail_ptr->exc_node_bitmap);
+		bit_not(detail_ptr->exc_node_bitmap);
+	}
+
+	/* Test if insufficient nodes remain OR
+	 *	required nodes missing OR
+	 *	nodes lack features */
+	if ((bit_set_count(avail_bitmap) < min_nodes) ||
+	    ((detail_ptr->req_node_bitmap) &&
+	     (!bit_super_set(detail_ptr->req_node_bitmap, avail_bitmap))) ||
+	    (job_req_node_filter(job_ptr, avail_bitmap))) {
+		FREE_NULL_BITMAP(avail_bitmap);
+		return false;
+	}
+
+	bf_job->job_id = job_ptr->job_id;
+	bf_job->part_ptr = part_ptr;
+	bf_job->multi_part = (job_ptr->part_ptr_list != NULL);
+	bf_job->job_class = _job_class_find(&snap->class_table, job_ptr);
+	bf_job->avail_bitmap = avail_bitmap;
+	if (detail_ptr->req_node_bitmap)
+		bf_job->req_node_bitmap = bit_copy(detail_ptr->req_node_bitmap);
+	_job_space_req(job_ptr, part_ptr, &bf_job->space_req);
+	bf_job->start_res = start_res;
+	bf_job->min_nodes = min_nodes;
+	bf_job->max_nodes = max_nodes;
+	bf_job->req_nodes = req_nodes;
+	bf_job->min_cpus = detail_ptr->min_cpus;
+	bf_job->select_job = _select_job_copy(job_ptr, part_ptr, time_limit);
+	return true;
+}
+
+/* Copy the fields of a pending job which the select plugin reads, so that
+ * it can test the job while slurmctld job locks are not held */
+static struct job_record *_select_job_copy(struct job_record *job_ptr,
+					   struct part_record *part_ptr,
+					   uint32_t time_limit)
+{
+	struct job_record *copy_ptr = xmalloc(sizeof(struct job_record));
+	struct job_details *detail_ptr = xmalloc(sizeof(struct job_details));
+
+	/* Scalars only, the strings and lists are not read by the plugin */
+	memcpy(detail_ptr, job_ptr->details, sizeof(struct job_details));
+	detail_ptr->argv = NULL;
+	detail_ptr->ckpt_dir = NULL;
+	detail_ptr->cpu_bind = NULL;
+	detail_ptr->depend_list = NULL;
+	detail_ptr->dependency = NULL;
+	detail_ptr->orig_dependency = NULL;
+	detail_ptr->env_sup = NULL;
+	detail_ptr->exc_node_bitmap = NULL;
+	detail_ptr->exc_nodes = NULL;
+	detail_ptr->feature_list = NULL;
+	detail_ptr->features = NULL;
+	detail_ptr->mc_ptr = NULL;
+	detail_ptr->mem_bind = NULL;
+	detail_ptr->req_node_bitmap = NULL;
+	detail_ptr->req_node_layout = NULL;
+	detail_ptr->req_nodes = NULL;
+	detail_ptr->restart_dir = NULL;
+	detail_ptr->std_err = NULL;
+	detail_ptr->std_in = NULL;
+	detail_ptr->std_out = NULL;
+	detail_ptr->work_dir = NULL;
+	if (job_ptr->details->mc_ptr) {
+		detail_ptr->mc_ptr = xmalloc(sizeof(multi_core_data_t));
+		memcpy(detail_ptr->mc_ptr, job_ptr->details->mc_ptr,
+		       sizeof(multi_core_data_t));
+	}
+	if (job_ptr->details->exc_node_bitmap) {
+		detail_ptr->exc_node_bitmap =
+			bit_copy(job_ptr->details->exc_node_bitmap);
+	}
+	if (job_ptr->details->req_node_bitmap) {
+		detail_ptr->req_node_bitmap =
+			bit_copy(job_ptr->details->req_node_bitmap);
+	}
+
+	copy_ptr->magic = job_ptr->magic;
+	copy_ptr->job_id = job_ptr->job_id;
+	copy_ptr->user_id = job_ptr->user_id;
+	copy_ptr->group_id = job_ptr->group_id;
+	copy_ptr->job_state = job_ptr->job_state;
+	copy_ptr->priority = job_ptr->priority;
+	copy_ptr->time_limit = time_limit;
+	copy_ptr->part_ptr = part_ptr;
+	copy_ptr->details = detail_ptr;
+	copy_ptr->gres_list = gres_plugin_job_state_dup(job_ptr->gres_list);
+	return copy_ptr;
 }
 
-static int _attempt_backfill(void)
+static void _select_job_free(struct job_record *job_ptr)
+{
+	if (job_ptr == NULL)
+		return;
+	FREE_NULL_BITMAP(job_ptr->details->exc_node_bitmap);
+	FREE_NULL_BITMAP(job_ptr->details->req_node_bitmap);
+	xfree(job_ptr->details->mc_ptr);
+	xfree(job_ptr->details);
+	if (job_ptr->gres_list)
+		list_destroy(job_ptr->gres_list);
+	free_job_resources(&job_ptr->job_resrcs);
+	xfree(job_ptr);
+}
+
+/* Copy the pending jobs and the resources in use.
+ * Call with job write lock, build_job_queue() updates jobs, and node and
+ * partition read locks.
+ * RET true if there are jobs to plan */
+static bool _snapshot_build(bf_snapshot_t *snap)
 {
 	bool filter_root = false;
 	List job_queue;
 	job_queue_rec_t *job_queue_rec;
-	slurmdb_qos_rec_t *qos_ptr = NULL;
-	int i, j, node_space_recs;
 	struct job_record *job_ptr;
 	struct part_record *part_ptr;
-	uint32_t end_time, end_reserve;
-	uint32_t time_limit, comp_time_limit, orig_time_limit;
-	uint32_t min_nodes, max_nodes, req_nodes;
-	bitstr_t *avail_bitmap = NULL, *resv_bitmap = NULL;
-	time_t now = time(NULL), sched_start, later_start, start_res;
-	node_space_map_t *node_space;
-	static int sched_timeout = 0;
-	int this_sched_timeout = 0, rc = 0;
 
-	sched_start = now;
-	if (sched_timeout == 0) {
-		sched_timeout = slurm_get_msg_timeout() / 2;
-		sched_timeout = MAX(sched_timeout, 1);
-		sched_timeout = MIN(sched_timeout, 10);
-	}
-	this_sched_timeout = sched_timeout;
+	memset(snap, 0, sizeof(bf_snapshot_t));
+	snap->now = time(NULL);
+	snap->part_update = last_part_update;
 
 #ifdef HAVE_CRAY
 	/*
@@ -492,7 +715,7 @@ static int _attempt_backfill(void)
 	 */
 	if (select_g_reconfigure()) {
 		debug4("backfill: not scheduling due to ALPS");
-		return SLURM_SUCCESS;
+		return false;
 	}
 #endif
 
@@ -500,33 +723,27 @@ static int _attempt_backfill(void)
 		filter_root = true;
 
 	job_queue = build_job_queue(true);
-	if (list_count(job_queue) <= 1) {
+	cycle_queue_len = list_count(job_queue);
+	if (cycle_queue_len <= 1) {
 		debug("backfill: no jobs to backfill");
 		list_destroy(job_queue);
-		return 0;
+		return false;
 	}
 
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt + 3));
-	node_space[0].begin_time = sched_start;
-	node_space[0].end_time = sched_start + backfill_window;
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
-	node_space[0].next = 0;
-	node_space_recs = 1;
+	_snapshot_nodes(snap);
 	if (debug_flags & DEBUG_FLAG_BACKFILL)
-		_dump_node_space_table(node_space);
+		node_space_dump(snap->node_space);
+	snap->jobs = xmalloc(sizeof(bf_job_t) * cycle_queue_len);
+	snap->class_table.hash_size = cycle_queue_len;
+	snap->class_table.class_hash = xmalloc(sizeof(job_class_t *) *
+					       cycle_queue_len);
 
-	while ((job_queue_rec = (job_queue_rec_t *)
-				list_pop_bottom(job_queue, sort_job_queue2))) {
+	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
 		job_ptr  = job_queue_rec->job_ptr;
 		part_ptr = job_queue_rec->part_ptr;
 		xfree(job_queue_rec);
 		if (!IS_JOB_PENDING(job_ptr))
-			continue;	/* started in other partition */
-		job_ptr->part_ptr = part_ptr;
-
-		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			info("backfill test for job %u", job_ptr->job_id);
+			continue;
 
 		if ((job_ptr->state_reason == WAIT_ASSOC_JOB_LIMIT) ||
 		    (job_ptr->state_reason == WAIT_ASSOC_RESOURCE_LIMIT) ||
@@ -550,216 +767,783 @@ static int _attempt_backfill(void)
 		    (license_job_test(job_ptr, time(NULL)) != SLURM_SUCCESS))
 			continue;
 
-		/* Determine minimum and maximum node counts */
-		min_nodes = MAX(job_ptr->details->min_nodes,
-				part_ptr->min_nodes);
-		if (job_ptr->details->max_nodes == 0)
-			max_nodes = part_ptr->max_nodes;
-		else
-			max_nodes = MIN(job_ptr->details->max_nodes,
-					part_ptr->max_nodes);
-		max_nodes = MIN(max_nodes, 500000);     /* prevent overflows */
-		if (job_ptr->details->max_nodes)
-			req_nodes = max_nodes;
-		else
-			req_nodes = min_nodes;
-		if (min_nodes > max_nodes) {
-			/* job's min_nodes exceeds partition's max_nodes */
+		job_ptr->part_ptr = part_ptr;
+		job_index_update(job_ptr);
+		if (_snapshot_job(snap, &snap->jobs[snap->job_cnt], job_ptr,
+				  part_ptr))
+			snap->job_cnt++;
+	}
+	list_destroy(job_queue);
+	return true;
+}
+
+/* CPUs a job may use of a node */
+static uint32_t _node_cpus(bf_snapshot_t *snap, bf_job_t *bf_job, int inx)
+{
+	if (bf_job->space_req.whole_node)
+		return snap->node_cpus[inx];
+	return MIN(bf_job->space_req.cpus, snap->node_cpus[inx]);
+}
+
+/* Choose nodes for a job from those with resources free for it, its
+ * required nodes first and then the lowest numbered, until it has enough
+ * nodes and CPUs. This only tests the timeline quickly, without locks,
+ * the nodes a job is planned to use are chosen by _job_select().
+ * RET the nodes or NULL if those available are too few */
+static bitstr_t *_pick_nodes(bf_snapshot_t *snap, bf_job_t *bf_job,
+			     bitstr_t *avail_bitmap)
+{
+	bitstr_t *use_bitmap;
+	uint32_t node_cnt = 0, cpu_cnt = 0;
+	int i;
+
+	if ((bit_set_count(avail_bitmap) < bf_job->min_nodes) ||
+	    (bf_job->req_node_bitmap &&
+	     !bit_super_set(bf_job->req_node_bitmap, avail_bitmap)))
+		return NULL;
+
+	if (bf_job->req_node_bitmap) {
+		use_bitmap = bit_copy(bf_job->req_node_bitmap);
+		for (i = 0; i < snap->node_cnt; i++) {
+			if (!bit_test(use_bitmap, i))
+				continue;
+			node_cnt++;
+			cpu_cnt += _node_cpus(snap, bf_job, i);
+		}
+	} else
+		use_bitmap = bit_alloc(snap->node_cnt);
+	for (i = 0; i < snap->node_cnt; i++) {
+		if (((node_cnt >= bf_job->req_nodes) &&
+		     (cpu_cnt >= bf_job->min_cpus)) ||
+		    (node_cnt >= bf_job->max_nodes))
+			break;
+		if (!bit_test(avail_bitmap, i) || bit_test(use_bitmap, i))
 			continue;
+		bit_set(use_bitmap, i);
+		node_cnt++;
+		cpu_cnt += _node_cpus(snap, bf_job, i);
+	}
+	if ((node_cnt < bf_job->min_nodes) || (cpu_cnt < bf_job->min_cpus))
+		FREE_NULL_BITMAP(use_bitmap);
+	return use_bitmap;
+}
+
+/* Test if a job queued in several partitions is planned to start now in
+ * an earlier one */
+static bool _job_start_planned(bf_snapshot_t *snap, int inx)
+{
+	int i;
+
+	if (!snap->jobs[inx].multi_part)
+		return false;
+	for (i = 0; i < inx; i++) {
+		if ((snap->jobs[i].job_id == snap->jobs[inx].job_id) &&
+		    snap->jobs[i].use_bitmap)
+			return true;
+	}
+	return false;
+}
+
+/* Find the earliest time within the backfill window from which the
+ * resources of a job are free for its time limit. Only reads the timeline,
+ * so may be called by several threads once it is settled.
+ * IN/OUT start_time - earliest time to test, or zero, set to the time found
+ * RET the nodes to use or NULL if the job can not start in the window */
+static bitstr_t *_job_test(bf_snapshot_t *snap, bf_job_t *bf_job,
+			   time_t *start_time)
+{
+	time_t end_window = snap->now + backfill_window;
+	time_t later_start, end_reserve;
+	bitstr_t *avail_bitmap, *use_bitmap = NULL;
+
+	*start_time = MAX(*start_time, bf_job->start_res);
+	*start_time = MAX(*start_time, snap->now);
+	while (*start_time < end_window) {
+		avail_bitmap = bit_copy(bf_job->avail_bitmap);
+		end_reserve = *start_time + (bf_job->time_limit * 60);
+		later_start = node_space_avail(snap->node_space, *start_time,
+					       end_reserve, &bf_job->space_req,
+					       avail_bitmap);
+		use_bitmap = _pick_nodes(snap, bf_job, avail_bitmap);
+		FREE_NULL_BITMAP(avail_bitmap);
+		if (use_bitmap || (later_start == 0))
+			break;
+		*start_time = later_start;
+	}
+	return use_bitmap;
+}
+
+/* Test with the select plugin if a job can use nodes, as when starting
+ * it, and reduce them to those it would use. The plugin knows the topology,
+ * GRES and layout rules which the timeline does not, while the timeline
+ * holds the running jobs and the plans, so the plugin is given the nodes
+ * free for the job in the timeline and tests the job's copy made with the
+ * snapshot in SELECT_MODE_TEST_ONLY, which ignores their other use. The
+ * commit tests the job again. Several threads may test different jobs at
+ * once. Call with the config and partition read locks, which keep the
+ * plugin's node and partition tables in place.
+ * IN/OUT avail_bitmap - nodes to test, set to the nodes to use
+ * RET SLURM_SUCCESS or an error if the job can not use the nodes */
+static int _select_test(bf_snapshot_t *snap, bf_job_t *bf_job,
+			bitstr_t *avail_bitmap)
+{
+	struct job_record *job_ptr = bf_job->select_job;
+	int rc;
+
+	rc = select_g_job_test(job_ptr, avail_bitmap, bf_job->min_nodes,
+			       bf_job->max_nodes, bf_job->req_nodes,
+			       SELECT_MODE_TEST_ONLY, NULL, NULL);
+	free_job_resources(&job_ptr->job_resrcs);
+	return rc;
+}
+
+/* Have the select plugin choose the nodes of a job from those free for it
+ * in the timeline when the timeline test found it can start. If it finds
+ * no layout for the job on them, later starts when other nodes become free
+ * are tested, up to BF_MAX_SELECT_TRIES tests in all. Only reads the
+ * timeline, see _select_test() for the locks needed.
+ * IN/OUT start_time - start found by the timeline, set to that planned
+ * IN/OUT use_bitmap - nodes found by the timeline, set to the nodes to use
+ *	or NULL if the job can not start within the window */
+static void _job_select(bf_snapshot_t *snap, bf_job_t *bf_job,
+			time_t *start_time, bitstr_t **use_bitmap)
+{
+	time_t later_start;
+	bitstr_t *avail_bitmap;
+	int tries = 0;
+
+	while (*use_bitmap) {
+		FREE_NULL_BITMAP(*use_bitmap);
+		avail_bitmap = bit_copy(bf_job->avail_bitmap);
+		later_start = node_space_avail(snap->node_space, *start_time,
+					       *start_time +
+					       (bf_job->time_limit * 60),
+					       &bf_job->space_req,
+					       avail_bitmap);
+		if (_select_test(snap, bf_job, avail_bitmap) ==
+		    SLURM_SUCCESS) {
+			/* As many of them as the job needs */
+			*use_bitmap = _pick_nodes(snap, bf_job, avail_bitmap);
 		}
+		FREE_NULL_BITMAP(avail_bitmap);
+		if (*use_bitmap || (later_start == 0) ||
+		    (++tries >= BF_MAX_SELECT_TRIES))
+			break;
+		/* No layout on these nodes, try when others free */
+		*start_time = later_start;
+		*use_bitmap = _job_test(snap, bf_job, start_time);
+	}
+}
 
-		/* Determine job's expected completion time */
-		if (job_ptr->time_limit == NO_VAL) {
-			if (part_ptr->max_time == INFINITE)
-				time_limit = 365 * 24 * 60; /* one year */
-			else
-				time_limit = part_ptr->max_time;
-		} else {
-			if (part_ptr->max_time == INFINITE)
-				time_limit = job_ptr->time_limit;
-			else
-				time_limit = MIN(job_ptr->time_limit,
-						 part_ptr->max_time);
+/* Test the specs of the current batch until none are left. A worker
+ * thread then waits for the next batch until shutdown, the plan's thread
+ * returns once all tests of the batch are done. */
+static void _batch_work(bf_batch_t *batch, bool worker)
+{
+	bf_spec_t *spec;
+	bf_job_t *bf_job;
+	int i;
+
+	slurm_mutex_lock(&batch->lock);
+	while (!batch->shutdown) {
+		if (batch->next_test < batch->spec_cnt) {
+			i = batch->next_test++;
+			slurm_mutex_unlock(&batch->lock);
+			spec = &batch->specs[i];
+			bf_job = &batch->snap->jobs[spec->inx];
+			spec->start_time = 0;
+			spec->use_bitmap = _job_test(batch->snap, bf_job,
+						     &spec->start_time);
+			_job_select(batch->snap, bf_job, &spec->start_time,
+				    &spec->use_bitmap);
+			slurm_mutex_lock(&batch->lock);
+			if (++batch->test_done == batch->spec_cnt)
+				pthread_cond_signal(&batch->done_cond);
+		} else if (worker) {
+			pthread_cond_wait(&batch->work_cond, &batch->lock);
+		} else if (batch->test_done < batch->spec_cnt) {
+			pthread_cond_wait(&batch->done_cond, &batch->lock);
+		} else
+			break;
+	}
+	slurm_mutex_unlock(&batch->lock);
+}
+
+static void *_batch_thread(void *arg)
+{
+	_batch_work((bf_batch_t *) arg, true);
+	return NULL;
+}
+
+/* Test the job at index inx and the next jobs which may need testing
+ * against the current timeline and with the select plugin, on the worker
+ * threads and this one. Jobs of a class already tested or in the batch are
+ * left out, the plan finds them from their class or tests them in a later
+ * batch. Sets snap->part_changed and tests nothing if the partitions
+ * changed since the snapshot. */
+static void _batch_test(bf_batch_t *batch, int inx, uint32_t space_gen)
+{
+	/* Read config and partitions, see _select_test() */
+	slurmctld_lock_t select_locks = {
+		READ_LOCK, NO_LOCK, NO_LOCK, READ_LOCK };
+	bf_snapshot_t *snap = batch->snap;
+	job_class_t *job_class;
+	int i, j, spec_cnt = 0;
+
+	/* No worker touches the specs until the batch is published */
+	slurm_mutex_lock(&batch->lock);
+	batch->spec_cnt = 0;
+	batch->next_test = 0;
+	batch->test_done = 0;
+	slurm_mutex_unlock(&batch->lock);
+	for (i = 0; i < batch->spec_max; i++)
+		FREE_NULL_BITMAP(batch->specs[i].use_bitmap);
+	batch->next_use = 0;
+	batch->space_gen = space_gen;
+
+	batch->specs[spec_cnt++].inx = inx;
+	for (i = inx + 1; (i < snap->job_cnt) &&
+	     (spec_cnt < batch->spec_max); i++) {
+		if (_job_start_planned(snap, i))
+			continue;
+		job_class = snap->jobs[i].job_class;
+		if (job_class && job_class->tested &&
+		    (job_class->space_gen == space_gen))
+			continue;
+		for (j = 0; job_class && (j < spec_cnt); j++) {
+			if (snap->jobs[batch->specs[j].inx].job_class ==
+			    job_class)
+				break;
 		}
-		comp_time_limit = time_limit;
-		orig_time_limit = job_ptr->time_limit;
-		if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE))
-			time_limit = job_ptr->time_limit = 1;
-		else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
-			time_limit = job_ptr->time_limit = job_ptr->time_min;
-
-		/* Determine impact of any resource reservations */
-		later_start = now;
- TRY_LATER:	FREE_NULL_BITMAP(avail_bitmap);
-		start_res   = later_start;
-		later_start = 0;
-		j = job_test_resv(job_ptr, &start_res, true, &avail_bitmap);
-		if (j != SLURM_SUCCESS) {
-			job_ptr->time_limit = orig_time_limit;
+		if (job_class && (j < spec_cnt))
 			continue;
+		batch->specs[spec_cnt++].inx = i;
+	}
+	cycle_spec_tests += spec_cnt;
+
+	/* This thread is one of the workers */
+	if (batch->thread_cnt && (spec_cnt > 1))
+		node_space_settle(snap->node_space);
+	lock_slurmctld(select_locks);
+	if (last_part_update != snap->part_update) {
+		/* The partitions of the job copies may be gone */
+		unlock_slurmctld(select_locks);
+		snap->part_changed = true;
+		return;
+	}
+	slurm_mutex_lock(&batch->lock);
+	batch->spec_cnt = spec_cnt;
+	if (spec_cnt > 1)
+		pthread_cond_broadcast(&batch->work_cond);
+	slurm_mutex_unlock(&batch->lock);
+	_batch_work(batch, false);
+	unlock_slurmctld(select_locks);
+}
+
+/* Find the speculative test of the job at index inx in the batch.
+ * RET the test or NULL if the job was not in the batch */
+static bf_spec_t *_batch_spec(bf_batch_t *batch, int inx)
+{
+	while ((batch->next_use < batch->spec_cnt) &&
+	       (batch->specs[batch->next_use].inx < inx))
+		batch->next_use++;
+	if ((batch->next_use < batch->spec_cnt) &&
+	    (batch->specs[batch->next_use].inx == inx))
+		return &batch->specs[batch->next_use];
+	return NULL;
+}
+
+/* Set up a batch for a backfill cycle, starting backfill_threads - 1
+ * worker threads to test its jobs along with the plan's thread */
+static void _batch_init(bf_batch_t *batch, bf_snapshot_t *snap)
+{
+	pthread_attr_t attr;
+	int i;
+
+	memset(batch, 0, sizeof(bf_batch_t));
+	slurm_mutex_init(&batch->lock);
+	pthread_cond_init(&batch->work_cond, NULL);
+	pthread_cond_init(&batch->done_cond, NULL);
+	batch->snap = snap;
+	batch->spec_max = backfill_threads * BF_SPECS_PER_THREAD;
+	batch->specs = xmalloc(sizeof(bf_spec_t) * batch->spec_max);
+
+	slurm_attr_init(&attr);
+	for (i = 1; i < backfill_threads; i++) {
+		if (pthread_create(&batch->thread_id[batch->thread_cnt],
+				   &attr, _batch_thread, batch)) {
+			error("pthread_create error %m");
+			break;
 		}
-		if (start_res > now)
-			end_time = (time_limit * 60) + start_res;
-		else
-			end_time = (time_limit * 60) + now;
-
-		/* Identify usable nodes for this job */
-		bit_and(avail_bitmap, part_ptr->node_bitmap);
-		bit_and(avail_bitmap, up_node_bitmap);
-		for (j=0; ; ) {
-			if ((node_space[j].end_time > start_res) &&
-			     node_space[j].next && (later_start == 0))
-				later_start = node_space[j].end_time;
-			if (node_space[j].end_time <= start_res)
-				;
-			else if (node_space[j].begin_time <= end_time) {
-				bit_and(avail_bitmap,
-					node_space[j].avail_bitmap);
-			} else
-				break;
-			if ((j = node_space[j].next) == 0)
-				break;
+		batch->thread_cnt++;
+	}
+	slurm_attr_destroy(&attr);
+}
+
+static void _batch_free(bf_batch_t *batch)
+{
+	int i;
+
+	slurm_mutex_lock(&batch->lock);
+	batch->shutdown = true;
+	pthread_cond_broadcast(&batch->work_cond);
+	slurm_mutex_unlock(&batch->lock);
+	for (i = 0; i < batch->thread_cnt; i++)
+		pthread_join(batch->thread_id[i], NULL);
+
+	for (i = 0; i < batch->spec_max; i++)
+		FREE_NULL_BITMAP(batch->specs[i].use_bitmap);
+	xfree(batch->specs);
+	pthread_cond_destroy(&batch->work_cond);
+	pthread_cond_destroy(&batch->done_cond);
+	slurm_mutex_destroy(&batch->lock);
+}
+
+/* Plan when each pending job can start, in priority order, reserving its
+ * resources in the timeline. Called without slurmctld locks, only the
+ * config and partition read locks are taken while a batch is tested.
+ * Jobs are tested against the timeline and with the select plugin in
+ * batches, several at once if bf_threads is set. A reservation made after
+ * a batch was tested only removes resources, so the test of a later job in
+ * the batch still holds unless its planned nodes lack the resources now,
+ * in which case a new batch is tested from it.
+ * RET SLURM_SUCCESS or SLURM_ERROR if backfill must stop */
+static int _snapshot_plan(bf_snapshot_t *snap)
+{
+	time_t now = snap->now;
+	time_t start_time, end_reserve;
+	uint32_t space_gen = 0;		/* changed with timeline */
+	bf_batch_t batch;
+	bf_spec_t *spec;
+	job_class_t *job_class;
+	bf_job_t *bf_job;
+	int i, rc = SLURM_SUCCESS;
+
+	_batch_init(&batch, snap);
+
+	for (i = 0; i < snap->job_cnt; i++) {
+		bf_job = &snap->jobs[i];
+		cycle_depth++;
+		if (stop_backfill || config_flag) {
+			rc = SLURM_ERROR;
+			break;
 		}
+		if (_job_start_planned(snap, i))
+			continue;	/* starts in other partition */
 
-		if (job_ptr->details->exc_node_bitmap) {
-			bit_not(job_ptr->details->exc_node_bitmap);
-			bit_and(avail_bitmap,
-				job_ptr->details->exc_node_bitmap);
-			bit_not(job_ptr->details->exc_node_bitmap);
+		if (debug_flags & DEBUG_FLAG_BACKFILL)
+			info("backfill test for job %u", bf_job->job_id);
+
+		/* Skip the job if another of its class was tested since the
+		 * timeline last changed */
+		job_class = bf_job->job_class;
+		if (job_class && job_class->tested &&
+		    (job_class->space_gen == space_gen)) {
+			bf_job->start_time = job_class->start_time;
+			cycle_class_hits++;
+			continue;
 		}
 
-		/* Test if insufficient nodes remain OR
-		 *	required nodes missing OR
-		 *	nodes lack features */
-		if ((bit_set_count(avail_bitmap) < min_nodes) ||
-		    ((job_ptr->details->req_node_bitmap) &&
-		     (!bit_super_set(job_ptr->details->req_node_bitmap,
-				     avail_bitmap))) ||
-		    (job_req_node_filter(job_ptr, avail_bitmap))) {
-			if (later_start) {
-				job_ptr->start_time = 0;	
-				goto TRY_LATER;
+		cycle_depth_try++;
+		spec = _batch_spec(&batch, i);
+		if (spec && spec->use_bitmap &&
+		    (batch.space_gen != space_gen) &&
+		    node_space_overlap(snap->node_space, &bf_job->space_req,
+				       spec->use_bitmap, spec->start_time,
+				       spec->start_time +
+				       (bf_job->time_limit * 60) + 1)) {
+			cycle_spec_discarded++;
+			spec = NULL;
+		}
+		if (spec == NULL) {
+			_batch_test(&batch, i, space_gen);
+			if (snap->part_changed) {
+				rc = SLURM_ERROR;
+				break;
 			}
-			job_ptr->time_limit = orig_time_limit;
+			spec = &batch.specs[0];
+		}
+		start_time = spec->start_time;
+		bf_job->use_bitmap = spec->use_bitmap;
+		spec->use_bitmap = NULL;
+		if (bf_job->use_bitmap == NULL) {
+			/* Can not start within the backfill window */
+			_job_class_set(job_class, space_gen, 0);
 			continue;
 		}
-
-		/* Identify nodes which are definitely off limits */
-		FREE_NULL_BITMAP(resv_bitmap);
-		resv_bitmap = bit_copy(avail_bitmap);
-		bit_not(resv_bitmap);
-
-		if ((time(NULL) - sched_start) >= this_sched_timeout) {
-			debug("backfill: loop taking too long, yielding locks");
-			if (_yield_locks()) {
-				debug("backfill: system state changed, "
-				      "breaking out");
-				rc = 1;
+		bf_job->start_time = start_time;
+		end_reserve = start_time + (bf_job->time_limit * 60);
+
+		/* Jobs to start now always hold their resources, the
+		 * others only up to max_job_bf time slices */
+		if (start_time > now) {
+			if (bf_job->no_reserve ||
+			    ((node_space_count(snap->node_space) -
+			      snap->base_slice_cnt + 1) >=
+			     max_backfill_job_cnt)) {
+				FREE_NULL_BITMAP(bf_job->use_bitmap);
+				if (bf_job->no_reserve)
+					continue;
+				/* Already have too many jobs to deal with */
+				cycle_table_full = true;
 				break;
-			} else {
-				this_sched_timeout += sched_timeout;
 			}
 		}
-		/* this is the time consuming operation */
-		debug2("backfill: entering _try_sched for job %u.",
-		       job_ptr->job_id);
-		j = _try_sched(job_ptr, &avail_bitmap,
-			       min_nodes, max_nodes, req_nodes);
-		debug2("backfill: finished _try_sched for job %u.",
-		       job_ptr->job_id);
-		now = time(NULL);
-		if (j != SLURM_SUCCESS) {
-			job_ptr->time_limit = orig_time_limit;
-			job_ptr->start_time = 0;	
-			continue;	/* not runable */
+		node_space_reserve(snap->node_space, &bf_job->space_req,
+				   bf_job->use_bitmap, start_time,
+				   end_reserve);
+		space_gen++;
+		if (start_time > now)
+			FREE_NULL_BITMAP(bf_job->use_bitmap);
+	}
+	_batch_free(&batch);
+	return rc;
+}
+
+/* Test if a job is still pending in the partition it was planned for */
+static bool _job_plan_valid(bf_snapshot_t *snap, bf_job_t *bf_job,
+			    struct job_record *job_ptr)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+	bool found = false;
+
+	if ((job_ptr == NULL) || !IS_JOB_PENDING(job_ptr) ||
+	    IS_JOB_COMPLETING(job_ptr) || (job_ptr->priority == 0) ||
+	    (last_part_update != snap->part_update))
+		return false;
+	if (job_ptr->part_ptr_list == NULL)
+		return (job_ptr->part_ptr == bf_job->part_ptr);
+	part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+	if (part_iterator == NULL)
+		fatal("list_iterator_create: malloc failure");
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		if (part_ptr == bf_job->part_ptr) {
+			found = true;
+			break;
 		}
+	}
+	list_iterator_destroy(part_iterator);
+	return found;
+}
 
-		if (start_res > job_ptr->start_time) {
-			job_ptr->start_time = start_res;
-			last_job_update = now;
+/* Start the jobs planned to start now and set the expected start time of
+ * the others. A start is dropped if the job changed or the select plugin
+ * finds its planned nodes no longer have the resources.
+ * Call with job and node write locks and partition read lock */
+static void _snapshot_commit(bf_snapshot_t *snap)
+{
+	struct job_record *job_ptr;
+	bitstr_t *resv_bitmap;
+	bf_job_t *bf_job;
+	uint32_t orig_time_limit;
+	time_t now = time(NULL);
+	int i, rc;
+
+	for (i = 0; i < snap->job_cnt; i++) {
+		bf_job = &snap->jobs[i];
+		if (bf_job->start_time == 0)
+			continue;
+		job_ptr = find_job_record(bf_job->job_id);
+		if (!_job_plan_valid(snap, bf_job, job_ptr)) {
+			if (bf_job->use_bitmap)
+				cycle_start_dropped++;
+			continue;
 		}
-		if (job_ptr->start_time <= now) {
-			int rc = _start_job(job_ptr, resv_bitmap);
-			if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE))
-				job_ptr->time_limit = orig_time_limit;
-			else if ((rc == SLURM_SUCCESS) && job_ptr->time_min) {
-				/* Set time limit as high as possible */
-				job_ptr->time_limit = comp_time_limit;
-				job_ptr->end_time = job_ptr->start_time +
-						    (comp_time_limit * 60);
-				_reset_job_time_limit(job_ptr, now,
-						      node_space);
-				time_limit = job_ptr->time_limit;
-			} else {
-				job_ptr->time_limit = orig_time_limit;
-			}
-			if (rc == ESLURM_ACCOUNTING_POLICY) {
-				/* Unknown future start time, just skip job */
-				job_ptr->start_time = 0;	
-				continue;
-			} else if (rc != SLURM_SUCCESS) {
-				/* Planned to start job, but something bad
-				 * happended. */
-				job_ptr->start_time = 0;	
-				break;
-			} else {
-				/* Started this job, move to next one */
-				continue;
+		if (bf_job->use_bitmap == NULL) {
+			if ((job_ptr->start_time == 0) ||
+			    (job_ptr->start_time > bf_job->start_time)) {
+				job_ptr->start_time = bf_job->start_time;
+				last_job_update = now;
 			}
+			continue;
+		}
+
+		job_ptr->part_ptr = bf_job->part_ptr;
+		job_index_update(job_ptr);
+		orig_time_limit = job_ptr->time_limit;
+		if (bf_job->time_limit != bf_job->comp_time_limit)
+			job_ptr->time_limit = bf_job->time_limit;
+		resv_bitmap = bit_copy(bf_job->use_bitmap);
+		bit_not(resv_bitmap);
+		rc = _start_job(job_ptr, resv_bitmap);
+		FREE_NULL_BITMAP(resv_bitmap);
+		if (bf_job->no_reserve)
+			job_ptr->time_limit = orig_time_limit;
+		else if ((rc == SLURM_SUCCESS) && job_ptr->time_min) {
+			/* Set time limit as high as possible */
+			job_ptr->time_limit = bf_job->comp_time_limit;
+			job_ptr->end_time = job_ptr->start_time +
+					    (bf_job->comp_time_limit * 60);
+			_reset_job_time_limit(job_ptr, now, snap->node_space,
+					      bf_job->start_time +
+					      (bf_job->time_limit * 60));
 		} else
 			job_ptr->time_limit = orig_time_limit;
-
-		if (later_start && (job_ptr->start_time > later_start)) {
-			/* Try later when some nodes currently reserved for
-			 * pending jobs are free */
-			job_ptr->start_time = 0;	
-			goto TRY_LATER;
+		if (rc == SLURM_SUCCESS) {
+			cycle_started++;
+		} else {
+			job_ptr->start_time = 0;
+			cycle_start_dropped++;
 		}
+	}
+}
 
-		if (job_ptr->start_time > (sched_start + backfill_window)) {
-			/* Starts too far in the future to worry about */
-			continue;
-		}
+static void _snapshot_free(bf_snapshot_t *snap)
+{
+	int i;
+
+	for (i = 0; i < snap->job_cnt; i++) {
+		FREE_NULL_BITMAP(snap->jobs[i].avail_bitmap);
+		FREE_NULL_BITMAP(snap->jobs[i].req_node_bitmap);
+		FREE_NULL_BITMAP(snap->jobs[i].use_bitmap);
+		_select_job_free(snap->jobs[i].select_job);
+	}
+	xfree(snap->jobs);
+	node_space_destroy(snap->node_space);
+	xfree(snap->node_cpus);
+	_job_class_table_free(&snap->class_table);
+}
+
+/* Note that slurm.conf has changed */
+extern void backfill_reconfig(void)
+{
+	config_flag = true;
+}
 
-		if (node_space_recs >= max_backfill_job_cnt) {
-			/* Already have too many jobs to deal with */
+/* backfill_agent - detached thread periodically attempts to backfill jobs */
+extern void *backfill_agent(void *args)
+{
+	struct timeval tv1, tv2;
+	char tv_str[20];
+	time_t now;
+	double wait_time;
+	static time_t last_backfill_time = 0;
+	bf_snapshot_t snap;
+	bool plan;
+	/* Read config and partitions; Write jobs and nodes */
+	slurmctld_lock_t all_locks = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
+
+	_load_config();
+	last_backfill_time = time(NULL);
+	while (!stop_backfill) {
+		_my_sleep(backfill_interval);
+		if (stop_backfill)
 			break;
+		if (config_flag) {
+			config_flag = false;
+			_load_config();
 		}
-
-		end_reserve = job_ptr->start_time + (time_limit * 60);
-		if (_test_resv_overlap(node_space, avail_bitmap,
-				       job_ptr->start_time, end_reserve)) {
-			/* This job overlaps with an existing reservation for
-			 * job to be backfill scheduled, which the sched
-			 * plugin does not know about. Try again later. */
-			later_start = job_ptr->start_time;
-			job_ptr->start_time = 0;	
-			goto TRY_LATER;
+		now = time(NULL);
+		wait_time = difftime(now, last_backfill_time);
+		if ((wait_time < backfill_interval) ||
+		    _job_is_completing() ||
+		    !avail_front_end() || !_more_work(last_backfill_time))
+			continue;
+		if (_many_pending_rpcs()) {
+			slurm_mutex_lock(&slurmctld_diag_stats_lock);
+			slurmctld_diag_stats.bf_skip_busy++;
+			slurm_mutex_unlock(&slurmctld_diag_stats_lock);
+			continue;
 		}
 
-		/*
-		 * Add reservation to scheduling table if appropriate
-		 */
-		qos_ptr = job_ptr->qos_ptr;
-		if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE))
-			continue;
-		bit_not(avail_bitmap);
-		_add_reservation(job_ptr->start_time, end_reserve,
-				 avail_bitmap, node_space, &node_space_recs);
+		gettimeofday(&tv1, NULL);
+		_cycle_stats_begin();
+		lock_slurmctld(all_locks);
+		plan = _snapshot_build(&snap);
+		unlock_slurmctld(all_locks);
+		if (plan && (_snapshot_plan(&snap) == SLURM_SUCCESS)) {
+			lock_slurmctld(all_locks);
+			_snapshot_commit(&snap);
+			if (debug_flags & DEBUG_FLAG_BACKFILL)
+				node_space_dump(snap.node_space);
+			unlock_slurmctld(all_locks);
+		}
+		_snapshot_free(&snap);
+		last_backfill_time = time(NULL);
+		gettimeofday(&tv2, NULL);
+		_cycle_stats_end(&tv1, &tv2);
+		_diff_tv_str(&tv1, &tv2, tv_str, 20);
 		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			_dump_node_space_table(node_space);
+			info("backfill: completed, %s", tv_str);
 	}
-	FREE_NULL_BITMAP(avail_bitmap);
-	FREE_NULL_BITMAP(resv_bitmap);
+	return NULL;
+}
 
-	for (i=0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
+/* Clear the statistics of the backfill cycle about to start */
+static void _cycle_stats_begin(void)
+{
+	cycle_depth = 0;
+	cycle_depth_try = 0;
+	cycle_started = 0;
+	cycle_queue_len = 0;
+	cycle_class_hits = 0;
+	cycle_class_tests = 0;
+	cycle_spec_tests = 0;
+	cycle_spec_discarded = 0;
+	cycle_start_dropped = 0;
+	cycle_table_full = false;
+}
+
+/* Add the statistics of a completed backfill cycle to slurmctld's
+ * scheduler statistics
+ * IN tv1, tv2 - cycle start and end times */
+static void _cycle_stats_end(struct timeval *tv1, struct timeval *tv2)
+{
+	long delta_t = diff_tv(tv1, tv2);
+
+	slurm_mutex_lock(&slurmctld_diag_stats_lock);
+	slurmctld_diag_stats.bf_cycle_cnt++;
+	slurmctld_diag_stats.bf_cycle_last = delta_t;
+	slurmctld_diag_stats.bf_cycle_sum += delta_t;
+	if (delta_t > slurmctld_diag_stats.bf_cycle_max)
+		slurmctld_diag_stats.bf_cycle_max = delta_t;
+	slurmctld_diag_stats.bf_when_last_cycle = tv2->tv_sec;
+	slurmctld_diag_stats.bf_depth_last = cycle_depth;
+	slurmctld_diag_stats.bf_depth_sum += cycle_depth;
+	slurmctld_diag_stats.bf_depth_try_last = cycle_depth_try;
+	slurmctld_diag_stats.bf_depth_try_sum += cycle_depth_try;
+	slurmctld_diag_stats.bf_queue_len = cycle_queue_len;
+	slurmctld_diag_stats.bf_jobs_started += cycle_started;
+	slurmctld_diag_stats.bf_class_hits += cycle_class_hits;
+	slurmctld_diag_stats.bf_class_tests += cycle_class_tests;
+	slurmctld_diag_stats.bf_start_dropped += cycle_start_dropped;
+	slurmctld_diag_stats.bf_spec_tests += cycle_spec_tests;
+	slurmctld_diag_stats.bf_spec_discarded += cycle_spec_discarded;
+	if (cycle_table_full)
+		slurmctld_diag_stats.bf_exit_table_full++;
+	slurm_mutex_unlock(&slurmctld_diag_stats_lock);
+}
+
+/* Variant of strcmp that will accept NULL string pointers */
+static int  _strcmp(const char *s1, const char *s2)
+{
+	if ((s1 != NULL) && (s2 == NULL))
+		return 1;
+	if ((s1 == NULL) && (s2 == NULL))
+		return 0;
+	if ((s1 == NULL) && (s2 != NULL))
+		return -1;
+	return strcmp(s1, s2);
+}
+
+static uint32_t _hash_bytes(uint32_t hash, const void *data, int len)
+{
+	const unsigned char *byte = data;
+	int i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash ^ byte[i]) * 16777619;	/* FNV-1a */
+	return hash;
+}
+
+static uint32_t _hash_str(uint32_t hash, const char *str)
+{
+	if (str)
+		hash = _hash_bytes(hash, str, strlen(str));
+	return _hash_bytes(hash, "", 1);
+}
+
+/* Find or add the class of a pending job.
+ * RET the class or NULL if the job is not put in a class */
+static job_class_t *_job_class_find(job_class_table_t *class_table,
+				    struct job_record *job_ptr)
+{
+	struct job_details *detail_ptr = job_ptr->details;
+	job_class_key_t key;
+	job_class_t *job_class;
+	uint32_t hash;
+	int inx;
+
+	/* Jobs which name nodes are rarely alike */
+	if ((class_table->hash_size == 0) ||
+	    detail_ptr->req_node_bitmap || detail_ptr->exc_node_bitmap)
+		return NULL;
+
+	memset(&key, 0, sizeof(job_class_key_t));
+	key.part_ptr        = job_ptr->part_ptr;
+	key.user_id         = job_ptr->user_id;
+	key.assoc_id        = job_ptr->assoc_id;
+	key.qos_id          = job_ptr->qos_id;
+	key.resv_id         = job_ptr->resv_id;
+	key.time_limit      = job_ptr->time_limit;
+	key.time_min        = job_ptr->time_min;
+	key.min_nodes       = detail_ptr->min_nodes;
+	key.max_nodes       = detail_ptr->max_nodes;
+	key.min_cpus        = detail_ptr->min_cpus;
+	key.max_cpus        = detail_ptr->max_cpus;
+	key.num_tasks       = detail_ptr->num_tasks;
+	key.pn_min_cpus     = detail_ptr->pn_min_cpus;
+	key.pn_min_memory   = detail_ptr->pn_min_memory;
+	key.pn_min_tmp_disk = detail_ptr->pn_min_tmp_disk;
+	key.contiguous      = detail_ptr->contiguous;
+	key.cpus_per_task   = detail_ptr->cpus_per_task;
+	key.ntasks_per_node = detail_ptr->ntasks_per_node;
+	key.plane_size      = detail_ptr->plane_size;
+	key.shared          = detail_ptr->shared;
+	key.task_dist       = detail_ptr->task_dist;
+	key.overcommit      = detail_ptr->overcommit;
+	if (detail_ptr->mc_ptr)
+		key.mc = *detail_ptr->mc_ptr;
+
+	hash = _hash_bytes(2166136261U, &key, sizeof(job_class_key_t));
+	hash = _hash_str(hash, detail_ptr->features);
+	hash = _hash_str(hash, job_ptr->gres);
+	hash = _hash_str(hash, job_ptr->licenses);
+
+	cycle_class_tests++;
+	inx = hash % class_table->hash_size;
+	for (job_class = class_table->class_hash[inx]; job_class;
+	     job_class = job_class->next) {
+		if ((job_class->hash == hash) &&
+		    !memcmp(&job_class->key, &key, sizeof(job_class_key_t)) &&
+		    !_strcmp(job_class->features, detail_ptr->features) &&
+		    !_strcmp(job_class->gres, job_ptr->gres) &&
+		    !_strcmp(job_class->licenses, job_ptr->licenses))
+			return job_class;
 	}
-	xfree(node_space);
-	list_destroy(job_queue);
-	return rc;
+
+	job_class = xmalloc(sizeof(job_class_t));
+	job_class->key      = key;
+	job_class->features = xstrdup(detail_ptr->features);
+	job_class->gres     = xstrdup(job_ptr->gres);
+	job_class->licenses = xstrdup(job_ptr->licenses);
+	job_class->hash     = hash;
+	job_class->next     = class_table->class_hash[inx];
+	class_table->class_hash[inx] = job_class;
+	return job_class;
+}
+
+/* Record that a job of a class could not start before start_time (zero if
+ * it can not run) and made no change to the timeline */
+static void _job_class_set(job_class_t *job_class, uint32_t space_gen,
+			   time_t start_time)
+{
+	if (job_class == NULL)
+		return;
+	job_class->tested = true;
+	job_class->space_gen = space_gen;
+	job_class->start_time = start_time;
+}
+
+static void _job_class_table_free(job_class_table_t *class_table)
+{
+	job_class_t *job_class, *next_class;
+	int i;
+
+	for (i = 0; i < class_table->hash_size; i++) {
+		for (job_class = class_table->class_hash[i]; job_class;
+		     job_class = next_class) {
+			next_class = job_class->next;
+			xfree(job_class->features);
+			xfree(job_class->gres);
+			xfree(job_class->licenses);
+			xfree(job_class);
+		}
+	}
+	xfree(class_table->class_hash);
+	class_table->hash_size = 0;
 }
 
 /* Try to start the job on any non-reserved nodes */
@@ -815,26 +1599,28 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
 /* Reset a job's time limit (and end_time) as high as possible
  *	within the range job_ptr->time_min and job_ptr->time_limit.
  *	Avoid using resources reserved for pending jobs or in resource
- *	reservations */
+ *	reservations. The job's own resources are reserved in node_space
+ *	until min_end, so only later conflicts are sought. */
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
-				  node_space_map_t *node_space)
+				  node_space_t *node_space, time_t min_end)
 {
-	int32_t j, resv_delay;
+	int32_t resv_delay;
 	uint32_t orig_time_limit = job_ptr->time_limit;
-
-	for (j=0; ; ) {
-		if ((node_space[j].begin_time != now) &&
-		    (node_space[j].begin_time < job_ptr->end_time) &&
-		    (!bit_super_set(job_ptr->node_bitmap,
-				    node_space[j].avail_bitmap))) {
-			/* Job overlaps pending job's resource reservation */
-			resv_delay = difftime(node_space[j].begin_time, now);
-			resv_delay /= 60;	/* seconds to minutes */
-			if (resv_delay < job_ptr->time_limit)
-				job_ptr->time_limit = resv_delay;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
+	time_t resv_start;
+	node_space_req_t space_req;
+
+	/* Job overlaps the first pending job's resource reservation */
+	memset(&space_req, 0, sizeof(node_space_req_t));
+	space_req.whole_node = !cr_enabled;
+	space_req.job_resrcs = job_ptr->job_resrcs;
+	resv_start = node_space_conflict(node_space, &space_req,
+					 job_ptr->node_bitmap,
+					 min_end - 1, job_ptr->end_time);
+	if (resv_start) {
+		resv_delay = difftime(resv_start, now);
+		resv_delay /= 60;	/* seconds to minutes */
+		if (resv_delay < job_ptr->time_limit)
+			job_ptr->time_limit = resv_delay;
 	}
 	job_ptr->time_limit = MAX(job_ptr->time_min, job_ptr->time_limit);
 	job_ptr->end_time = job_ptr->start_time + (job_ptr->time_limit * 60);
@@ -861,89 +1647,3 @@ static bool _more_work (time_t last_backfill_time)
 	pthread_mutex_unlock( &thread_flag_mutex );
 	return rc;
 }
-
-/* Create a reservation for a job in the future */
-static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs)
-{
-	bool placed = false;
-	int i, j;
-
-	for (j=0; ; ) {
-		if (node_space[j].end_time > start_time) {
-			/* insert start entry record */
-			i = *node_space_recs;
-			node_space[i].begin_time = start_time;
-			node_space[i].end_time = node_space[j].end_time;
-			node_space[j].end_time = start_time;
-			node_space[i].avail_bitmap =
-				bit_copy(node_space[j].avail_bitmap);
-			node_space[i].next = node_space[j].next;
-			node_space[j].next = i;
-			(*node_space_recs)++;
-			placed = true;
-		}
-		if (node_space[j].end_time == start_time) {
-			/* no need to insert new start entry record */
-			placed = true;
-		}
-		if (placed == true) {
-			j = node_space[j].next;
-			if (j && (end_reserve < node_space[j].end_time)) {
-				/* insert end entry record */
-				i = *node_space_recs;
-				node_space[i].begin_time = end_reserve;
-				node_space[i].end_time = node_space[j].
-							 end_time;
-				node_space[j].end_time = end_reserve;
-				node_space[i].avail_bitmap =
-					bit_copy(node_space[j].avail_bitmap);
-				node_space[i].next = node_space[j].next;
-				node_space[j].next = i;
-				(*node_space_recs)++;
-			}
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-
-	for (j=0; ; ) {
-		if ((node_space[j].begin_time >= start_time) &&
-		    (node_space[j].end_time <= end_reserve))
-			bit_and(node_space[j].avail_bitmap, res_bitmap);
-		if ((node_space[j].begin_time >= end_reserve) ||
-		    ((j = node_space[j].next) == 0))
-			break;
-	}
-}
-
-/*
- * Determine if the resource specification for a new job overlaps with a
- *	reservation that the backfill scheduler has made for a job to be
- *	started in the future.
- * IN use_bitmap - nodes to be allocated
- * IN start_time - start time of job
- * IN end_reserve - end time of job
- */
-static bool _test_resv_overlap(node_space_map_t *node_space,
-			       bitstr_t *use_bitmap, uint32_t start_time,
-			       uint32_t end_reserve)
-{
-	bool overlap = false;
-	int j;
-
-	for (j=0; ; ) {
-		if ((node_space[j].end_time   > start_time) &&
-		    (node_space[j].begin_time < end_reserve) &&
-		    (!bit_super_set(use_bitmap, node_space[j].avail_bitmap))) {
-			overlap = true;
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-	return overlap;
-}
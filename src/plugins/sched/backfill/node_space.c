@@ -0,0 +1,822 @@
+/*****************************************************************************\
+ *  node_space.c - timeline of node availability used by the backfill
+ *	scheduler to plan when pending jobs can start
+ *
+ *  The time slices are kept in a treap ordered by begin time. Each slice
+ *  holds the CPUs and memory of every node not yet reserved throughout it,
+ *  and each record also holds the least free in any slice of its subtree,
+ *  so the resources free throughout a period are found by visiting a
+ *  logarithmic number of records rather than every slice in the period.
+ *  Reservations are applied the same way: a subtree wholly inside the
+ *  reserved period is updated at its root and the resources used are
+ *  subtracted from its children only when they are next visited.
+ *
+ *  Vectors are reference counted and copied only when written, so the two
+ *  halves of a split slice and the reservations pushed down to many
+ *  subtrees share one vector until they differ.
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/parse_time.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/slurmctld.h"
+
+#include "node_space.h"
+
+/* Reference counted vector with an entry for the CPUs of each node,
+ * followed by one for the memory of each node if memory is tracked.
+ * Copied before being written if shared. */
+typedef struct space_vec {
+	int32_t *val;
+	int refs;
+} space_vec_t;
+
+/* Resources a job uses of each of the nodes it uses. Reference counted, as
+ * reservations deferred in the tree are shared by the records below. */
+typedef struct space_use {
+	int *node_inx;			/* indexes of nodes used, ascending */
+	int32_t *cpus;			/* CPUs used of each */
+	int32_t *mem;			/* MB of memory used of each */
+	int node_cnt;
+	int refs;
+} space_use_t;
+
+typedef struct space_rec {
+	time_t begin_time;		/* slice is [begin_time, end_time) */
+	time_t end_time;
+	space_vec_t *avail;		/* resources free in this slice */
+	space_vec_t *sub_avail;		/* least free in any slice of this
+					 * subtree */
+	space_use_t *pend_use;		/* resources reserved in this record
+					 * but not yet in its children, or
+					 * NULL */
+	time_t sub_first;		/* first begin_time in subtree */
+	time_t sub_last;		/* last begin_time in subtree */
+	uint32_t prio;			/* treap heap order, random */
+	struct space_rec *left;
+	struct space_rec *right;
+} space_rec_t;
+
+struct node_space {
+	space_rec_t *root;
+	time_t end_time;		/* end of the last slice */
+	int rec_cnt;
+	uint32_t rand;
+	int node_cnt;
+	int width;			/* entries in each vector */
+	bool track_mem;
+	int32_t *capacity;		/* CPUs and memory of each node */
+	bitstr_t *avail_bitmap;		/* nodes usable at all */
+};
+
+static space_vec_t *_vec_alloc(node_space_t *space)
+{
+	space_vec_t *vec = xmalloc(sizeof(space_vec_t));
+
+	vec->val = xmalloc(sizeof(int32_t) * space->width);
+	vec->refs = 1;
+	return vec;
+}
+
+static space_vec_t *_vec_copy(node_space_t *space, space_vec_t *vec)
+{
+	space_vec_t *new_vec = xmalloc(sizeof(space_vec_t));
+
+	new_vec->val = xmalloc(sizeof(int32_t) * space->width);
+	memcpy(new_vec->val, vec->val, sizeof(int32_t) * space->width);
+	new_vec->refs = 1;
+	return new_vec;
+}
+
+static space_vec_t *_vec_ref(space_vec_t *vec)
+{
+	vec->refs++;
+	return vec;
+}
+
+static void _vec_unref(space_vec_t *vec)
+{
+	if (vec && (--vec->refs == 0)) {
+		xfree(vec->val);
+		xfree(vec);
+	}
+}
+
+/* Make *vec_pp writable, copying it if it is shared */
+static int32_t *_vec_write(node_space_t *space, space_vec_t **vec_pp)
+{
+	if ((*vec_pp)->refs > 1) {
+		(*vec_pp)->refs--;
+		*vec_pp = _vec_copy(space, *vec_pp);
+	}
+	return (*vec_pp)->val;
+}
+
+/* Subtract the resources used from those of the nodes used */
+static void _vec_sub(node_space_t *space, space_vec_t **vec_pp,
+		     space_use_t *use)
+{
+	int32_t *val = _vec_write(space, vec_pp);
+	int i, j;
+
+	for (i = 0; i < use->node_cnt; i++) {
+		j = use->node_inx[i];
+		val[j] -= use->cpus[i];
+		if (space->track_mem)
+			val[space->node_cnt + j] -= use->mem[i];
+	}
+}
+
+/* Lower each entry of *vec_pp to that of other, if it is less */
+static void _vec_min(node_space_t *space, space_vec_t **vec_pp,
+		     space_vec_t *other)
+{
+	int32_t *val;
+	int i;
+
+	if (*vec_pp == other)
+		return;
+	val = _vec_write(space, vec_pp);
+	for (i = 0; i < space->width; i++)
+		val[i] = MIN(val[i], other->val[i]);
+}
+
+/* Lower each entry of avail to that of vec, if it is less. Only the entries
+ * of the nodes used are lowered, unless use is NULL. */
+static void _avail_min(node_space_t *space, int32_t *avail, space_vec_t *vec,
+		       space_use_t *use)
+{
+	int i, j;
+
+	if (use == NULL) {
+		for (i = 0; i < space->width; i++)
+			avail[i] = MIN(avail[i], vec->val[i]);
+		return;
+	}
+	for (i = 0; i < use->node_cnt; i++) {
+		j = use->node_inx[i];
+		avail[j] = MIN(avail[j], vec->val[j]);
+		if (space->track_mem) {
+			j += space->node_cnt;
+			avail[j] = MIN(avail[j], vec->val[j]);
+		}
+	}
+}
+
+/* Test if the vector has the resources used of every node used */
+static bool _vec_fits(node_space_t *space, int32_t *val, space_use_t *use)
+{
+	int i, j;
+
+	for (i = 0; i < use->node_cnt; i++) {
+		j = use->node_inx[i];
+		if (val[j] < use->cpus[i])
+			return false;
+		if (space->track_mem &&
+		    (val[space->node_cnt + j] < use->mem[i]))
+			return false;
+	}
+	return true;
+}
+
+static uint32_t _space_rand(node_space_t *space)
+{
+	space->rand = space->rand * 1103515245 + 12345;
+	return space->rand;
+}
+
+/* Set the CPUs and memory a job may use of one node */
+static void _node_need(node_space_t *space, node_space_req_t *req, int inx,
+		       int32_t *cpus, int32_t *mem)
+{
+	int64_t need_mem;
+
+	if (req->whole_node) {
+		*cpus = space->capacity[inx];
+		*mem = 0;
+		if (space->track_mem)
+			*mem = space->capacity[space->node_cnt + inx];
+		return;
+	}
+	*cpus = MIN(req->cpus, space->capacity[inx]);
+	need_mem = (int64_t) req->mem_per_cpu * (*cpus) + req->mem_per_node;
+	*mem = MIN(need_mem, INT32_MAX);
+}
+
+static space_use_t *_use_alloc(int node_cnt)
+{
+	space_use_t *use = xmalloc(sizeof(space_use_t));
+
+	use->node_inx = xmalloc(sizeof(int) * MAX(node_cnt, 1));
+	use->cpus = xmalloc(sizeof(int32_t) * MAX(node_cnt, 1));
+	use->mem = xmalloc(sizeof(int32_t) * MAX(node_cnt, 1));
+	use->refs = 1;
+	return use;
+}
+
+static space_use_t *_use_ref(space_use_t *use)
+{
+	use->refs++;
+	return use;
+}
+
+static void _use_unref(space_use_t *use)
+{
+	if (use && (--use->refs == 0)) {
+		xfree(use->node_inx);
+		xfree(use->cpus);
+		xfree(use->mem);
+		xfree(use);
+	}
+}
+
+/* Build the resources a job uses of the nodes in use_bitmap. Only the nodes
+ * from the first to the last in use_bitmap, or in the job's allocation if
+ * it has one, are scanned. */
+static space_use_t *_use_build(node_space_t *space, node_space_req_t *req,
+			       bitstr_t *use_bitmap)
+{
+	job_resources_t *job_resrcs = req->job_resrcs;
+	space_use_t *use;
+	int i, j = 0, first, last;
+	int32_t cpus, mem;
+
+	use = _use_alloc(bit_set_count(use_bitmap));
+	first = bit_ffs(use_bitmap);
+	last = bit_fls(use_bitmap);
+	if (job_resrcs && job_resrcs->node_bitmap) {
+		/* Count the job's nodes from its first, to index its
+		 * resources */
+		first = bit_ffs(job_resrcs->node_bitmap);
+		last = MIN(last, bit_fls(job_resrcs->node_bitmap));
+	}
+	if (first < 0)
+		return use;
+	for (i = first; i <= last; i++) {
+		if (job_resrcs && job_resrcs->node_bitmap) {
+			if (!bit_test(job_resrcs->node_bitmap, i))
+				continue;
+			j++;
+			if (!bit_test(use_bitmap, i))
+				continue;
+			cpus = job_resrcs->cpus[j - 1];
+			mem = 0;
+			if (space->track_mem && job_resrcs->memory_allocated)
+				mem = job_resrcs->memory_allocated[j - 1];
+		} else {
+			if (!bit_test(use_bitmap, i))
+				continue;
+			_node_need(space, req, i, &cpus, &mem);
+		}
+		use->node_inx[use->node_cnt] = i;
+		use->cpus[use->node_cnt] = cpus;
+		use->mem[use->node_cnt] = mem;
+		use->node_cnt++;
+	}
+	return use;
+}
+
+/* Add the resources of use to those of *use_pp, merging their nodes */
+static void _use_add(space_use_t **use_pp, space_use_t *use)
+{
+	space_use_t *old_use = *use_pp, *new_use;
+	int i = 0, j = 0, k;
+
+	new_use = _use_alloc(old_use->node_cnt + use->node_cnt);
+	while ((i < old_use->node_cnt) || (j < use->node_cnt)) {
+		k = new_use->node_cnt++;
+		if ((j >= use->node_cnt) ||
+		    ((i < old_use->node_cnt) &&
+		     (old_use->node_inx[i] < use->node_inx[j]))) {
+			new_use->node_inx[k] = old_use->node_inx[i];
+			new_use->cpus[k] = old_use->cpus[i];
+			new_use->mem[k] = old_use->mem[i];
+			i++;
+		} else if ((i >= old_use->node_cnt) ||
+			   (use->node_inx[j] < old_use->node_inx[i])) {
+			new_use->node_inx[k] = use->node_inx[j];
+			new_use->cpus[k] = use->cpus[j];
+			new_use->mem[k] = use->mem[j];
+			j++;
+		} else {
+			new_use->node_inx[k] = use->node_inx[j];
+			new_use->cpus[k] = old_use->cpus[i] + use->cpus[j];
+			new_use->mem[k] = old_use->mem[i] + use->mem[j];
+			i++;
+			j++;
+		}
+	}
+	_use_unref(old_use);
+	*use_pp = new_use;
+}
+
+/* Make a record's sub_avail, sub_first and sub_last match its children.
+ * Its pend_use must already have been pushed down. */
+static void _rec_update(node_space_t *space, space_rec_t *rec)
+{
+	xassert(rec->pend_use == NULL);
+	rec->sub_first = rec->left  ? rec->left->sub_first  : rec->begin_time;
+	rec->sub_last  = rec->right ? rec->right->sub_last  : rec->begin_time;
+	_vec_unref(rec->sub_avail);
+	rec->sub_avail = _vec_ref(rec->avail);
+	if (rec->left)
+		_vec_min(space, &rec->sub_avail, rec->left->sub_avail);
+	if (rec->right)
+		_vec_min(space, &rec->sub_avail, rec->right->sub_avail);
+}
+
+/* Lower an entry of a record's sub_avail to the least free in its
+ * children, if that is less */
+static int32_t _child_min(space_rec_t *rec, int inx, int32_t val)
+{
+	if (rec->left)
+		val = MIN(val, rec->left->sub_avail->val[inx]);
+	if (rec->right)
+		val = MIN(val, rec->right->sub_avail->val[inx]);
+	return val;
+}
+
+/* Make a record's sub_avail match its children after a reservation which
+ * only changed the resources of the nodes used, in it or below it.
+ * Its pend_use must already have been pushed down. */
+static void _rec_update_use(node_space_t *space, space_rec_t *rec,
+			    space_use_t *use)
+{
+	int32_t *avail = rec->avail->val, *val;
+	int i, j, k, mem_cnt = space->track_mem ? 2 : 1;
+
+	xassert(rec->pend_use == NULL);
+	if (rec->sub_avail == rec->avail) {
+		/* Shared with avail until some child has less free of a
+		 * node used than this slice */
+		for (i = 0; i < use->node_cnt; i++) {
+			for (k = 0; k < mem_cnt; k++) {
+				j = use->node_inx[i] + (k * space->node_cnt);
+				if (_child_min(rec, j, avail[j]) < avail[j])
+					break;
+			}
+			if (k < mem_cnt)
+				break;
+		}
+		if (i >= use->node_cnt)
+			return;
+	}
+	val = _vec_write(space, &rec->sub_avail);
+	for (i = 0; i < use->node_cnt; i++) {
+		for (k = 0; k < mem_cnt; k++) {
+			j = use->node_inx[i] + (k * space->node_cnt);
+			val[j] = _child_min(rec, j, avail[j]);
+		}
+	}
+}
+
+/* Reserve resources in every slice of a subtree, deferring its children */
+static void _rec_apply(node_space_t *space, space_rec_t *rec,
+		       space_use_t *use)
+{
+	if (rec->sub_avail == rec->avail) {
+		_vec_unref(rec->sub_avail);
+		_vec_sub(space, &rec->avail, use);
+		rec->sub_avail = _vec_ref(rec->avail);
+	} else {
+		_vec_sub(space, &rec->avail, use);
+		_vec_sub(space, &rec->sub_avail, use);
+	}
+	if ((rec->left == NULL) && (rec->right == NULL))
+		return;
+	if (rec->pend_use)
+		_use_add(&rec->pend_use, use);
+	else
+		rec->pend_use = _use_ref(use);
+}
+
+/* Apply a record's deferred reservations to its children */
+static void _rec_push(node_space_t *space, space_rec_t *rec)
+{
+	if (rec->pend_use == NULL)
+		return;
+	if (rec->left)
+		_rec_apply(space, rec->left, rec->pend_use);
+	if (rec->right)
+		_rec_apply(space, rec->right, rec->pend_use);
+	_use_unref(rec->pend_use);
+	rec->pend_use = NULL;
+}
+
+/* Apply the deferred reservations of every record of a subtree */
+static void _rec_settle(node_space_t *space, space_rec_t *rec)
+{
+	if (rec == NULL)
+		return;
+	_rec_push(space, rec);
+	_rec_settle(space, rec->left);
+	_rec_settle(space, rec->right);
+}
+
+static void _rec_free(space_rec_t *rec)
+{
+	if (rec == NULL)
+		return;
+	_rec_free(rec->left);
+	_rec_free(rec->right);
+	_vec_unref(rec->avail);
+	_vec_unref(rec->sub_avail);
+	_use_unref(rec->pend_use);
+	xfree(rec);
+}
+
+/* Make a child, which now has the slices of a record's subtree, take its
+ * sub_avail, sub_first and sub_last, then update the record */
+static void _rec_rotated(node_space_t *space, space_rec_t *rec,
+			 space_rec_t *child)
+{
+	_vec_unref(child->sub_avail);
+	child->sub_avail = _vec_ref(rec->sub_avail);
+	child->sub_first = rec->sub_first;
+	child->sub_last = rec->sub_last;
+	_rec_update(space, rec);
+}
+
+static space_rec_t *_rotate_right(node_space_t *space, space_rec_t *rec)
+{
+	space_rec_t *child = rec->left;
+
+	_rec_push(space, child);
+	rec->left = child->right;
+	child->right = rec;
+	_rec_rotated(space, rec, child);
+	return child;
+}
+
+static space_rec_t *_rotate_left(node_space_t *space, space_rec_t *rec)
+{
+	space_rec_t *child = rec->right;
+
+	_rec_push(space, child);
+	rec->right = child->left;
+	child->left = rec;
+	_rec_rotated(space, rec, child);
+	return child;
+}
+
+/* Insert a slice with the same free resources as the slice preceding it,
+ * pred. pred is on the path of the new slice and it and the records above
+ * it already have those resources in their subtree, so only the sub_avail
+ * of records on the path below pred change. pred is NULL below it. */
+static space_rec_t *_rec_insert(node_space_t *space, space_rec_t *rec,
+				space_rec_t *new_rec, space_rec_t *pred)
+{
+	if (rec == NULL)
+		return new_rec;
+	_rec_push(space, rec);
+	if (new_rec->begin_time < rec->begin_time) {
+		rec->left = _rec_insert(space, rec->left, new_rec,
+					(rec == pred) ? NULL : pred);
+	} else {
+		rec->right = _rec_insert(space, rec->right, new_rec,
+					 (rec == pred) ? NULL : pred);
+	}
+	rec->sub_first = rec->left  ? rec->left->sub_first  : rec->begin_time;
+	rec->sub_last  = rec->right ? rec->right->sub_last  : rec->begin_time;
+	if (pred == NULL)
+		_vec_min(space, &rec->sub_avail, new_rec->avail);
+	if (rec->left && (rec->left->prio > rec->prio))
+		return _rotate_right(space, rec);
+	if (rec->right && (rec->right->prio > rec->prio))
+		return _rotate_left(space, rec);
+	return rec;
+}
+
+/* Find the slice containing a time, without pushing down reservations */
+static space_rec_t *_rec_find(node_space_t *space, time_t when)
+{
+	space_rec_t *rec = space->root;
+
+	while (rec) {
+		if (when < rec->begin_time)
+			rec = rec->left;
+		else if (when >= rec->end_time)
+			rec = rec->right;
+		else
+			break;
+	}
+	return rec;
+}
+
+/* Split the slice containing a time, if the time is not its start */
+static void _space_cut(node_space_t *space, time_t when)
+{
+	space_rec_t *rec = space->root, *new_rec;
+
+	while (rec) {
+		_rec_push(space, rec);
+		if (when < rec->begin_time)
+			rec = rec->left;
+		else if (when >= rec->end_time)
+			rec = rec->right;
+		else
+			break;
+	}
+	if ((rec == NULL) || (rec->begin_time == when))
+		return;
+
+	new_rec = xmalloc(sizeof(space_rec_t));
+	new_rec->begin_time = when;
+	new_rec->end_time = rec->end_time;
+	new_rec->avail = _vec_ref(rec->avail);
+	new_rec->prio = _space_rand(space);
+	_rec_update(space, new_rec);
+	rec->end_time = when;
+	space->root = _rec_insert(space, space->root, new_rec, rec);
+	space->rec_cnt++;
+}
+
+/* Lower each entry of avail to the least free in slices of a subtree which
+ * begin at or after first and before last. Only the entries of the nodes
+ * used are lowered, unless use is NULL.
+ * RET true if any slice was in that range */
+static bool _range_min(node_space_t *space, space_rec_t *rec, time_t first,
+		       time_t last, int32_t *avail, space_use_t *use)
+{
+	bool found = false;
+
+	if ((rec == NULL) || (rec->sub_last < first) ||
+	    (rec->sub_first >= last))
+		return false;
+	if ((rec->sub_first >= first) && (rec->sub_last < last)) {
+		_avail_min(space, avail, rec->sub_avail, use);
+		return true;
+	}
+	_rec_push(space, rec);
+	if (_range_min(space, rec->left, first, last, avail, use))
+		found = true;
+	if ((rec->begin_time >= first) && (rec->begin_time < last)) {
+		_avail_min(space, avail, rec->avail, use);
+		found = true;
+	}
+	if (_range_min(space, rec->right, first, last, avail, use))
+		found = true;
+	return found;
+}
+
+/* Reserve resources in slices of a subtree which begin at or after first
+ * and before last */
+static void _range_apply(node_space_t *space, space_rec_t *rec, time_t first,
+			 time_t last, space_use_t *use)
+{
+	if ((rec == NULL) || (rec->sub_last < first) ||
+	    (rec->sub_first >= last))
+		return;
+	if ((rec->sub_first >= first) && (rec->sub_last < last)) {
+		_rec_apply(space, rec, use);
+		return;
+	}
+	_rec_push(space, rec);
+	_range_apply(space, rec->left, first, last, use);
+	if ((rec->begin_time >= first) && (rec->begin_time < last)) {
+		if (rec->sub_avail == rec->avail) {
+			_vec_unref(rec->sub_avail);
+			_vec_sub(space, &rec->avail, use);
+			rec->sub_avail = _vec_ref(rec->avail);
+		} else
+			_vec_sub(space, &rec->avail, use);
+	}
+	_range_apply(space, rec->right, first, last, use);
+	_rec_update_use(space, rec, use);
+}
+
+static time_t _rec_conflict(node_space_t *space, space_rec_t *rec,
+			    space_use_t *use, time_t after_time,
+			    time_t before_time)
+{
+	time_t when;
+
+	if ((rec == NULL) || (rec->sub_last <= after_time) ||
+	    (rec->sub_first >= before_time))
+		return (time_t) 0;
+	_rec_push(space, rec);
+	if ((rec->sub_first > after_time) && (rec->sub_last < before_time) &&
+	    _vec_fits(space, rec->sub_avail->val, use))
+		return (time_t) 0;
+	when = _rec_conflict(space, rec->left, use, after_time, before_time);
+	if (when)
+		return when;
+	if ((rec->begin_time > after_time) &&
+	    (rec->begin_time < before_time) &&
+	    !_vec_fits(space, rec->avail->val, use))
+		return rec->begin_time;
+	return _rec_conflict(space, rec->right, use, after_time,
+			     before_time);
+}
+
+static void _rec_dump(node_space_t *space, space_rec_t *rec)
+{
+	char begin_buf[32], end_buf[32], *idle_list, *part_list;
+	bitstr_t *idle_bitmap, *part_bitmap;
+	int i;
+
+	if (rec == NULL)
+		return;
+	_rec_push(space, rec);
+	_rec_dump(space, rec->left);
+	slurm_make_time_str(&rec->begin_time, begin_buf, sizeof(begin_buf));
+	slurm_make_time_str(&rec->end_time, end_buf, sizeof(end_buf));
+	idle_bitmap = bit_copy(space->avail_bitmap);
+	part_bitmap = bit_alloc(space->node_cnt);
+	for (i = 0; i < space->node_cnt; i++) {
+		if (!bit_test(idle_bitmap, i) ||
+		    (rec->avail->val[i] >= space->capacity[i]))
+			continue;
+		bit_clear(idle_bitmap, i);
+		if (rec->avail->val[i] > 0)
+			bit_set(part_bitmap, i);
+	}
+	idle_list = bitmap2node_name(idle_bitmap);
+	part_list = bitmap2node_name(part_bitmap);
+	info("Begin:%s End:%s Nodes:%s Partial:%s",
+	     begin_buf, end_buf, idle_list, part_list);
+	xfree(idle_list);
+	xfree(part_list);
+	FREE_NULL_BITMAP(idle_bitmap);
+	FREE_NULL_BITMAP(part_bitmap);
+	_rec_dump(space, rec->right);
+}
+
+extern node_space_t *node_space_create(time_t begin_time, time_t end_time,
+				       bitstr_t *avail_bitmap, int node_cnt,
+				       uint32_t *cpus, uint32_t *mem)
+{
+	node_space_t *space = xmalloc(sizeof(node_space_t));
+	space_rec_t *rec = xmalloc(sizeof(space_rec_t));
+	int i;
+
+	space->node_cnt = node_cnt;
+	space->track_mem = (mem != NULL);
+	space->width = space->track_mem ? (node_cnt * 2) : node_cnt;
+	space->capacity = xmalloc(sizeof(int32_t) * space->width);
+	for (i = 0; i < node_cnt; i++) {
+		space->capacity[i] = MIN(cpus[i], INT32_MAX);
+		if (space->track_mem)
+			space->capacity[node_cnt + i] = MIN(mem[i], INT32_MAX);
+	}
+	space->avail_bitmap = bit_copy(avail_bitmap);
+
+	rec->begin_time = begin_time;
+	rec->end_time = end_time;
+	rec->avail = _vec_alloc(space);
+	memcpy(rec->avail->val, space->capacity, sizeof(int32_t) * space->width);
+	_rec_update(space, rec);
+	space->rand = 1;
+	rec->prio = _space_rand(space);
+	space->root = rec;
+	space->end_time = end_time;
+	space->rec_cnt = 1;
+	return space;
+}
+
+extern void node_space_destroy(node_space_t *space)
+{
+	if (space == NULL)
+		return;
+	_rec_free(space->root);
+	xfree(space->capacity);
+	FREE_NULL_BITMAP(space->avail_bitmap);
+	xfree(space);
+}
+
+extern time_t node_space_avail(node_space_t *space, time_t start_time,
+			       time_t end_time, node_space_req_t *req,
+			       bitstr_t *avail_bitmap)
+{
+	space_rec_t *rec = _rec_find(space, start_time);
+	int32_t *avail, cpus, mem;
+	int i;
+
+	bit_and(avail_bitmap, space->avail_bitmap);
+	if (rec == NULL)
+		return (time_t) 0;
+	avail = xmalloc(sizeof(int32_t) * space->width);
+	memcpy(avail, space->capacity, sizeof(int32_t) * space->width);
+	(void) _range_min(space, space->root, rec->begin_time, end_time + 1,
+			  avail, NULL);
+	for (i = 0; i < space->node_cnt; i++) {
+		if (!bit_test(avail_bitmap, i))
+			continue;
+		_node_need(space, req, i, &cpus, &mem);
+		if ((avail[i] < cpus) ||
+		    (space->track_mem && (avail[space->node_cnt + i] < mem)))
+			bit_clear(avail_bitmap, i);
+	}
+	xfree(avail);
+	if (rec->end_time < space->end_time)
+		return rec->end_time;
+	return (time_t) 0;
+}
+
+extern bool node_space_overlap(node_space_t *space, node_space_req_t *req,
+			       bitstr_t *use_bitmap, time_t start_time,
+			       time_t end_time)
+{
+	space_rec_t *rec = _rec_find(space, start_time);
+	space_use_t *use;
+	int32_t *avail;
+	bool overlap = false;
+
+	if (rec == NULL)
+		return false;
+	use = _use_build(space, req, use_bitmap);
+	avail = xmalloc(sizeof(int32_t) * space->width);
+	memcpy(avail, space->capacity, sizeof(int32_t) * space->width);
+	if (_range_min(space, space->root, rec->begin_time, end_time, avail,
+		       use))
+		overlap = !_vec_fits(space, avail, use);
+	xfree(avail);
+	_use_unref(use);
+	return overlap;
+}
+
+extern time_t node_space_conflict(node_space_t *space, node_space_req_t *req,
+				  bitstr_t *use_bitmap, time_t after_time,
+				  time_t before_time)
+{
+	space_use_t *use;
+	time_t when;
+
+	use = _use_build(space, req, use_bitmap);
+	when = _rec_conflict(space, space->root, use, after_time,
+			     before_time);
+	_use_unref(use);
+	return when;
+}
+
+extern void node_space_reserve(node_space_t *space, node_space_req_t *req,
+			       bitstr_t *use_bitmap, time_t start_time,
+			       time_t end_time)
+{
+	space_use_t *use;
+
+	if (start_time >= end_time)
+		return;
+	_space_cut(space, start_time);
+	_space_cut(space, end_time);
+	use = _use_build(space, req, use_bitmap);
+	_range_apply(space, space->root, start_time, end_time, use);
+	_use_unref(use);
+}
+
+extern void node_space_settle(node_space_t *space)
+{
+	_rec_settle(space, space->root);
+}
+
+extern int node_space_count(node_space_t *space)
+{
+	return space->rec_cnt;
+}
+
+extern void node_space_dump(node_space_t *space)
+{
+	info("=========================================");
+	_rec_dump(space, space->root);
+	info("=========================================");
+}
@@ -0,0 +1,144 @@
+/*****************************************************************************\
+ *  node_space.h - timeline of node availability used by the backfill
+ *	scheduler to plan when pending jobs can start
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_NODE_SPACE_H
+#define _SLURM_NODE_SPACE_H
+
+#include <time.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/job_resources.h"
+
+/* The timeline is a sequence of adjacent time slices, each with the CPUs
+ * and memory of every node which are not reserved for pending jobs
+ * throughout it, kept in a balanced tree ordered by time */
+typedef struct node_space node_space_t;
+
+/* Resources a job may use on each of its nodes */
+typedef struct node_space_req {
+	bool whole_node;	/* job uses all CPUs and memory of its nodes */
+	uint32_t cpus;		/* most CPUs the job may use on one node */
+	uint32_t mem_per_cpu;	/* MB of memory per CPU used */
+	uint32_t mem_per_node;	/* MB of memory per node */
+	job_resources_t *job_resrcs; /* if set, the job's actual allocation,
+				 * used instead of the fields above */
+} node_space_req_t;
+
+/*
+ * node_space_create - build a timeline of one time slice
+ * IN begin_time, end_time - period covered by the timeline
+ * IN avail_bitmap - nodes available throughout it, copied
+ * IN node_cnt - number of nodes
+ * IN cpus - CPUs of each node, copied
+ * IN mem - MB of memory of each node, copied, or NULL if memory is not
+ *	a consumable resource
+ * RET timeline, free using node_space_destroy()
+ */
+extern node_space_t *node_space_create(time_t begin_time, time_t end_time,
+				       bitstr_t *avail_bitmap, int node_cnt,
+				       uint32_t *cpus, uint32_t *mem);
+
+extern void node_space_destroy(node_space_t *space);
+
+/*
+ * node_space_avail - remove from a bitmap the nodes which lack the
+ *	resources for a job at some time in a period
+ * IN space - timeline
+ * IN start_time, end_time - period, every slice which ends after start_time
+ *	and begins no later than end_time is tested
+ * IN req - resources the job may use on each node
+ * IN/OUT avail_bitmap - nodes to test
+ * RET end of the time slice containing start_time, or zero if that is the
+ *	last slice (when testing a later start time may find more nodes)
+ */
+extern time_t node_space_avail(node_space_t *space, time_t start_time,
+			       time_t end_time, node_space_req_t *req,
+			       bitstr_t *avail_bitmap);
+
+/*
+ * node_space_overlap - test if some node lacks the resources for a job at
+ *	some time which ends after start_time and begins before end_time
+ * IN space - timeline
+ * IN req - resources the job may use on each node
+ * IN use_bitmap - nodes to test
+ * IN start_time, end_time - period to test
+ */
+extern bool node_space_overlap(node_space_t *space, node_space_req_t *req,
+			       bitstr_t *use_bitmap, time_t start_time,
+			       time_t end_time);
+
+/*
+ * node_space_conflict - find the first time slice which begins after
+ *	after_time and before before_time in which some node lacks the
+ *	resources for a job
+ * IN space - timeline
+ * IN req - resources the job may use on each node
+ * IN use_bitmap - nodes to test
+ * IN after_time, before_time - period to search
+ * RET begin time of the slice or zero if none
+ */
+extern time_t node_space_conflict(node_space_t *space, node_space_req_t *req,
+				  bitstr_t *use_bitmap, time_t after_time,
+				  time_t before_time);
+
+/*
+ * node_space_reserve - reserve the resources of a job during a period,
+ *	splitting the time slices containing its start and end
+ * IN space - timeline
+ * IN req - resources the job may use on each node
+ * IN use_bitmap - nodes to reserve
+ * IN start_time, end_time - period of the reservation
+ */
+extern void node_space_reserve(node_space_t *space, node_space_req_t *req,
+			       bitstr_t *use_bitmap, time_t start_time,
+			       time_t end_time);
+
+/*
+ * node_space_settle - apply reservations deferred in the tree to every time
+ *	slice, so node_space_avail() and node_space_overlap() do not modify
+ *	the timeline and may be called by several threads at once until it
+ *	is next changed by node_space_reserve()
+ * IN space - timeline
+ */
+extern void node_space_settle(node_space_t *space);
+
+/* node_space_count - RET number of time slices in a timeline */
+extern int node_space_count(node_space_t *space);
+
+/* node_space_dump - log the time slices of a timeline */
+extern void node_space_dump(node_space_t *space);
+
+#endif	/* _SLURM_NODE_SPACE_H */
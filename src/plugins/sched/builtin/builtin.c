@@ -147,8 +147,7 @@ static void _compute_start_times(void)
 	if (alloc_bitmap == NULL)
 		fatal("bit_alloc: malloc failure");
 	job_queue = build_job_queue(true);
-	while ((job_queue_rec = (job_queue_rec_t *) 
-				list_pop_bottom(job_queue, sort_job_queue2))) {
+	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
 		job_ptr  = job_queue_rec->job_ptr;
 		part_ptr = job_queue_rec->part_ptr;
 		xfree(job_queue_rec);
@@ -38,6 +38,7 @@
 
 #include "./msg.h"
 #include <strings.h>
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
@@ -182,6 +183,7 @@ host_fini:	if (rc) {
 		xfree(job_ptr->partition);
 		job_ptr->partition = xstrdup(part_name_ptr);
 		job_ptr->part_ptr = part_ptr;
+		job_index_update(job_ptr);
 		last_job_update = time(NULL);
 		update_accounting = true;
 	}
@@ -42,6 +42,7 @@
 #include "src/common/gres.h"
 #include "src/common/node_select.h"
 #include "src/common/slurm_accounting_storage.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
@@ -318,6 +319,7 @@ host_fini:	if (rc) {
 		xfree(job_ptr->partition);
 		job_ptr->partition = xstrdup(part_name_ptr);
 		job_ptr->part_ptr = part_ptr;
+		job_index_update(job_ptr);
 		last_job_update = now;
 		update_accounting = true;
 	}
@@ -40,6 +40,7 @@
 #include "src/common/node_select.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/xstring.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
@@ -306,6 +307,7 @@ static int	_start_job(uint32_t jobid, int task_cnt, char *hostlist,
 	old_task_cnt = job_ptr->details->min_cpus;
 	job_ptr->details->min_cpus = MAX(task_cnt, old_task_cnt);
 	job_ptr->priority = 100000000;
+	job_index_update(job_ptr);
 
  fini:	unlock_slurmctld(job_write_lock);
 	if (rc)
@@ -346,6 +348,7 @@ static int	_start_job(uint32_t jobid, int task_cnt, char *hostlist,
 
 		/* restore some of job state */
 		job_ptr->priority = 0;
+		job_index_update(job_ptr);
 		job_ptr->details->min_cpus = old_task_cnt;
 		rc = -1;
 	}
@@ -62,6 +62,7 @@
 #include "src/common/node_select.h"
 #include "src/common/uid.h"
 #include "src/common/xstring.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/proc_req.h"
 #include "bg_core.h"
 
@@ -904,6 +905,7 @@ extern int sync_jobs(List job_list)
 			if (!good_block) {
 				job_ptr->job_state = JOB_FAILED
 					| JOB_COMPLETING;
+				job_index_update(job_ptr);
 				job_ptr->end_time = time(NULL);
 				last_job_update = time(NULL);
 				_destroy_bg_action(bg_action_ptr);
@@ -0,0 +1,278 @@
+/*****************************************************************************\
+ *  info_stats.c - slurmctld statistics functions for scontrol.
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "scontrol.h"
+#include "src/common/uid.h"
+
+/* Used by qsort comparison functions to sort array indexes */
+static uint32_t *sort_count = NULL;
+
+/* Sort array indexes by decreasing sort_count */
+static int _sort_by_count(const void *a, const void *b)
+{
+	uint32_t count_a = sort_count[*(const int *) a];
+	uint32_t count_b = sort_count[*(const int *) b];
+
+	if (count_a > count_b)
+		return -1;
+	if (count_a < count_b)
+		return 1;
+	return 0;
+}
+
+/* Return an array of indexes into count, ordered by decreasing count.
+ * Caller must xfree the return value. */
+static int *_sorted_index(uint32_t *count, uint32_t cnt)
+{
+	int i, *index = xmalloc(sizeof(int) * (cnt + 1));
+
+	for (i = 0; i < cnt; i++)
+		index[i] = i;
+	sort_count = count;
+	qsort(index, cnt, sizeof(int), _sort_by_count);
+	sort_count = NULL;
+	return index;
+}
+
+/* Print main and backfill scheduler statistics */
+static void _print_sched_stats(stats_info_response_msg_t *stats)
+{
+	char time_str[32];
+
+	printf("\nMain schedule statistics (microseconds):\n");
+	printf("   Cycles=%u LastCycle=%u MaxCycle=%u MeanCycle=%"PRIu64"\n",
+	       stats->schedule_cycle_cnt, stats->schedule_cycle_last,
+	       stats->schedule_cycle_max,
+	       stats->schedule_cycle_cnt ?
+	       stats->schedule_cycle_sum / stats->schedule_cycle_cnt : 0);
+	printf("   LastDepth=%u MeanDepth=%"PRIu64" LastQueueLength=%u\n",
+	       stats->schedule_depth_last,
+	       stats->schedule_cycle_cnt ?
+	       stats->schedule_depth_sum / stats->schedule_cycle_cnt : 0,
+	       stats->schedule_queue_len);
+	printf("   JobsStarted=%u EndedByTimeLimit=%u EndedByDepthLimit=%u\n",
+	       stats->jobs_started, stats->schedule_exit_timeout,
+	       stats->schedule_exit_depth);
+
+	printf("\nBackfill statistics (microseconds):\n");
+	if (stats->bf_when_last_cycle) {
+		slurm_make_time_str(&stats->bf_when_last_cycle, time_str,
+				    sizeof(time_str));
+	} else
+		snprintf(time_str, sizeof(time_str), "N/A");
+	printf("   Cycles=%u LastCycleWhen=%s\n", stats->bf_cycle_cnt,
+	       time_str);
+	printf("   LastCycle=%u MaxCycle=%u MeanCycle=%"PRIu64"\n",
+	       stats->bf_cycle_last, stats->bf_cycle_max,
+	       stats->bf_cycle_cnt ?
+	       stats->bf_cycle_sum / stats->bf_cycle_cnt : 0);
+	printf("   LastDepth=%u MeanDepth=%"PRIu64" LastDepthTry=%u "
+	       "MeanDepthTry=%"PRIu64" LastQueueLength=%u\n",
+	       stats->bf_depth_last,
+	       stats->bf_cycle_cnt ?
+	       stats->bf_depth_sum / stats->bf_cycle_cnt : 0,
+	       stats->bf_depth_try_last,
+	       stats->bf_cycle_cnt ?
+	       stats->bf_depth_try_sum / stats->bf_cycle_cnt : 0,
+	       stats->bf_queue_len);
+	printf("   JobsStarted=%u StartsDropped=%u\n",
+	       stats->bf_jobs_started, stats->bf_start_dropped);
+	printf("   EndedByMaxJobBf=%u SkippedBusyRPCs=%u\n",
+	       stats->bf_exit_table_full, stats->bf_skip_busy);
+	printf("   JobClassHits=%u JobClassTests=%u JobClassHitRate=%u%%\n",
+	       stats->bf_class_hits, stats->bf_class_tests,
+	       stats->bf_class_tests ?
+	       (uint32_t) ((uint64_t) stats->bf_class_hits * 100 /
+			   stats->bf_class_tests) : 0);
+	printf("   SpeculativeTests=%u SpeculativeDiscarded=%u\n",
+	       stats->bf_spec_tests, stats->bf_spec_discarded);
+}
+
+/* Print hits and misses of the cache of packed info responses */
+static void _print_cache_stats(stats_info_response_msg_t *stats)
+{
+	printf("\nInfo response cache (entries=%u):\n", stats->cache_entries);
+	printf("   Jobs:       hits=%u misses=%u\n",
+	       stats->job_cache_hits, stats->job_cache_misses);
+	printf("   Nodes:      hits=%u misses=%u\n",
+	       stats->node_cache_hits, stats->node_cache_misses);
+	printf("   Partitions: hits=%u misses=%u\n",
+	       stats->part_cache_hits, stats->part_cache_misses);
+}
+
+/* Print per RPC type, per user and per lock statistics */
+static void _print_rpc_lock_stats(stats_info_response_msg_t *stats)
+{
+	uint32_t *hist;
+	char *user_name;
+	int i, j, *index;
+
+	if (stats->rpc_type_cnt)
+		printf("\nRPCs by message type (histogram buckets are <1ms, "
+		       "<10ms, <100ms, <1s, <10s, >=10s):\n");
+	index = _sorted_index(stats->rpc_type_count, stats->rpc_type_cnt);
+	for (i = 0; i < stats->rpc_type_cnt; i++) {
+		j = index[i];
+		hist = stats->rpc_type_hist + (j * STATS_RPC_HIST_CNT);
+		printf("   %-32s Count=%-8u AveTime=%-8"PRIu64" "
+		       "MaxTime=%-8u Hist=%u/%u/%u/%u/%u/%u\n",
+		       rpc_num2string(stats->rpc_type_id[j]),
+		       stats->rpc_type_count[j],
+		       stats->rpc_type_count[j] ?
+		       stats->rpc_type_time_total[j] /
+		       stats->rpc_type_count[j] : 0,
+		       stats->rpc_type_time_max[j],
+		       hist[0], hist[1], hist[2], hist[3], hist[4], hist[5]);
+	}
+	xfree(index);
+
+	if (stats->rpc_user_cnt)
+		printf("\nRPCs by user:\n");
+	index = _sorted_index(stats->rpc_user_count, stats->rpc_user_cnt);
+	for (i = 0; i < stats->rpc_user_cnt; i++) {
+		j = index[i];
+		user_name = uid_to_string((uid_t) stats->rpc_user_id[j]);
+		printf("   %-16s(%-6u) Count=%-8u AveTime=%-8"PRIu64" "
+		       "TotalTime=%"PRIu64"\n",
+		       user_name, stats->rpc_user_id[j],
+		       stats->rpc_user_count[j],
+		       stats->rpc_user_count[j] ?
+		       stats->rpc_user_time_total[j] /
+		       stats->rpc_user_count[j] : 0,
+		       stats->rpc_user_time_total[j]);
+		xfree(user_name);
+	}
+	xfree(index);
+
+	if (stats->lock_cnt)
+		printf("\nslurmctld locks:\n");
+	for (i = 0; i < stats->lock_cnt; i++) {
+		printf("   %-16s Count=%-8u WaitCount=%-8u "
+		       "WaitAve=%-8"PRIu64" WaitMax=%-8u "
+		       "HoldTotal=%-10"PRIu64" HoldMax=%u\n",
+		       stats->lock_name[i], stats->lock_count[i],
+		       stats->lock_wait_cnt[i],
+		       stats->lock_wait_cnt[i] ?
+		       stats->lock_wait_total[i] / stats->lock_wait_cnt[i] : 0,
+		       stats->lock_wait_max[i], stats->lock_hold_total[i],
+		       stats->lock_hold_max[i]);
+	}
+	if (stats->rpc_type_cnt || stats->lock_cnt)
+		printf("\nAll times are in microseconds.\n");
+}
+
+/* Print the contents of a slurmctld statistics message */
+static void _print_stats(stats_info_response_msg_t *stats)
+{
+	char time_str[32];
+	int i;
+
+	slurm_make_time_str(&stats->req_time, time_str, sizeof(time_str));
+	printf("StatsTime=%s ", time_str);
+	slurm_make_time_str(&stats->req_time_start, time_str,
+			    sizeof(time_str));
+	printf("StatsStart=%s\n", time_str);
+	printf("   ServerThreadCount=%u\n", stats->server_thread_count);
+
+	if (stats->rpc_pool) {
+		printf("   RpcPoolThreads=%u RpcPoolBusy=%u\n",
+		       stats->rpc_pool_threads, stats->rpc_pool_busy);
+		printf("   RpcQueueSize=%u RpcQueueDepth=%u "
+		       "RpcQueueDepthMax=%u\n",
+		       stats->rpc_queue_size, stats->rpc_queue_depth,
+		       stats->rpc_queue_depth_max);
+		printf("   RpcQueueCount=%u RpcQueueFull=%u\n",
+		       stats->rpc_queue_cnt, stats->rpc_queue_full_cnt);
+		printf("   RpcQueueWaitMax=%u usec RpcQueueWaitMean=%"PRIu64
+		       " usec\n", stats->rpc_queue_wait_max,
+		       stats->rpc_queue_cnt ?
+		       stats->rpc_queue_wait_total / stats->rpc_queue_cnt : 0);
+	} else {
+		printf("   RpcPoolThreads=0 (thread per connection)\n");
+	}
+
+	for (i = 0; i < stats->rpc_class_cnt; i++) {
+		printf("   RpcClass=%s Active=%u Waiting=%u Admitted=%u "
+		       "Delayed=%u Busy=%u RateLimited=%u WaitMean=%"PRIu64
+		       " usec\n",
+		       stats->rpc_class_name[i], stats->rpc_class_active[i],
+		       stats->rpc_class_waiting[i],
+		       stats->rpc_class_admit_cnt[i],
+		       stats->rpc_class_delay_cnt[i],
+		       stats->rpc_class_busy_cnt[i],
+		       stats->rpc_class_rate_cnt[i],
+		       stats->rpc_class_delay_cnt[i] ?
+		       stats->rpc_class_wait_total[i] /
+		       stats->rpc_class_delay_cnt[i] : 0);
+	}
+
+	_print_sched_stats(stats);
+	_print_cache_stats(stats);
+	_print_rpc_lock_stats(stats);
+}
+
+/*
+ * scontrol_print_stats - print slurmctld statistics
+ */
+extern void scontrol_print_stats(void)
+{
+	stats_info_request_msg_t req;
+	stats_info_response_msg_t *stats = NULL;
+
+	req.command_id = STAT_COMMAND_GET;
+	if (slurm_get_statistics(&stats, &req) || (stats == NULL)) {
+		exit_code = 1;
+		if (quiet_flag != 1)
+			slurm_perror("slurm_get_statistics error");
+		return;
+	}
+	_print_stats(stats);
+	slurm_free_stats_response_msg(stats);
+}
+
+/*
+ * scontrol_reset_stats - clear slurmctld statistics counters
+ */
+extern void scontrol_reset_stats(void)
+{
+	stats_info_request_msg_t req;
+
+	req.command_id = STAT_COMMAND_RESET;
+	if (slurm_reset_statistics(&req)) {
+		exit_code = 1;
+		if (quiet_flag != 1)
+			slurm_perror("slurm_reset_statistics error");
+	}
+}
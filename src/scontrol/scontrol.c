@@ -758,6 +758,27 @@ _process_command (int argc, char *argv[])
 			}
 		}
 	}
+	else if (strncasecmp (tag, "reset", MAX(tag_len, 5)) == 0) {
+		/* require full command name */
+		if (argc != 2) {
+			exit_code = 1;
+			if (quiet_flag != 1)
+				fprintf(stderr,
+					"wrong number of arguments for "
+					"keyword:%s\n", tag);
+		} else if ((strncasecmp(argv[1], "statistics",
+					MAX(strlen(argv[1]), 3)) == 0) ||
+			   (strncasecmp(argv[1], "stats",
+					MAX(strlen(argv[1]), 5)) == 0)) {
+			scontrol_reset_stats();
+		} else {
+			exit_code = 1;
+			if (quiet_flag != 1)
+				fprintf(stderr,
+					"invalid entity:%s for keyword:%s\n",
+					argv[1], tag);
+		}
+	}
 	else if (strncasecmp (tag, "requeue", MAX(tag_len, 3)) == 0) {
 		if (argc > 2) {
 			exit_code = 1;
@@ -1330,6 +1351,9 @@ _show_it (int argc, char *argv[])
 		scontrol_print_res (val);
 	} else if (strncasecmp (tag, "slurmd", MAX(tag_len, 2)) == 0) {
 		_print_slurmd (val);
+	} else if ((strncasecmp (tag, "statistics", MAX(tag_len, 3)) == 0) ||
+		   (strncasecmp (tag, "stats", MAX(tag_len, 5)) == 0)) {
+		scontrol_print_stats ();
 	} else if (strncasecmp (tag, "steps", MAX(tag_len, 2)) == 0) {
 		scontrol_print_step (val);
 	} else if (strncasecmp (tag, "topology", MAX(tag_len, 1)) == 0) {
@@ -1686,6 +1710,7 @@ scontrol [<OPTION>] [<COMMAND>]                                            \n\
      reconfigure              re-read configuration files.                 \n\
      release <job_id>         permit specified job to start (see hold)     \n\
      requeue <job_id>         re-queue a batch job                         \n\
+     reset statistics         clear slurmctld statistics counters          \n\
      resume <job_id>          resume previously suspended job (see suspend)\n\
      setdebug <level>         set slurmctld debug level                    \n\
      setdebugflags [+|-]<flag>  add or remove slurmctld DebugFlags         \n\
@@ -1707,7 +1732,8 @@ scontrol [<OPTION>] [<COMMAND>]                                            \n\
 									   \n\
   <ENTITY> may be \"aliases\", \"config\", \"daemons\", \"frontend\",      \n\
        \"hostlist\", \"hostnames\", \"job\", \"node\", \"partition\",      \n\
-       \"reservation\", \"slurmd\", \"step\", or \"topology\"              \n\
+       \"reservation\", \"slurmd\", \"statistics\", \"step\", or         \n\
+       \"topology\"                                                        \n\
        (also for BlueGene only: \"block\" or \"subbp\").                   \n\
 									   \n\
   <ID> may be a configuration parameter name, job id, node name, partition \n\
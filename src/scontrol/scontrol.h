@@ -148,6 +148,8 @@ extern void	scontrol_print_node_list (char *node_list);
 extern void	scontrol_print_part (char *partition_name);
 extern void	scontrol_print_block (char *block_name);
 extern void	scontrol_print_res (char *reservation_name);
+extern void	scontrol_print_stats (void);
+extern void	scontrol_reset_stats (void);
 extern void	scontrol_print_step (char *job_step_id_str);
 extern void	scontrol_print_topo (char *node_list);
 extern int	scontrol_requeue(char *job_step_id_str);
@@ -47,6 +47,7 @@
 
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/acct_policy.h"
+#include "src/slurmctld/job_index.h"
 
 #define _DEBUG 0
 
@@ -63,6 +64,7 @@ static void _cancel_job(struct job_record *job_ptr)
 
 	last_job_update = now;
 	job_ptr->job_state = JOB_FAILED;
+	job_index_update(job_ptr);
 	job_ptr->exit_code = 1;
 	job_ptr->state_reason = FAIL_ACCOUNT;
 	xfree(job_ptr->state_desc);
@@ -90,6 +90,8 @@
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/agent_engine.h"
+#include "src/slurmctld/agent_merge.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/ping_nodes.h"
@@ -139,6 +141,8 @@ typedef struct agent_info {
 	bool get_reply;			/* flag if reply expected */
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void **msg_args_pptr;		/* RPC data to be used */
+	agent_arg_t *agent_arg_ptr;	/* request, if issued by the engine */
+	time_t begin_time;		/* time issued by the engine */
 } agent_info_t;
 
 typedef struct task_info {
@@ -151,24 +155,28 @@ typedef struct task_info {
 	bool get_reply;			/* flag if reply expected */
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void *msg_args_ptr;		/* ptr to RPC data to be used */
+	agent_info_t *agent_info_ptr;	/* agent issuing the RPC */
 } task_info_t;
 
-typedef struct queued_request {
-	agent_arg_t* agent_arg_ptr;	/* The queued request */
-	time_t       first_attempt;	/* Time of first check for batch
-					 * launch RPC *only* */
-	time_t       last_attempt;	/* Time of last xmit attempt */
-} queued_request_t;
-
 typedef struct mail_info {
 	char *user_name;
 	char *message;
 } mail_info_t;
 
 static void _sig_handler(int dummy);
+static void _agent_complete(agent_info_t *agent_ptr, thd_complete_t *thd_comp);
+static void _agent_state(agent_info_t *agent_ptr, thd_complete_t *thd_comp);
 static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
+static void _engine_agent(agent_arg_t *agent_arg_ptr);
+static void _engine_agent_done(agent_arg_t *agent_arg_ptr,
+			       agent_info_t *agent_info_ptr);
+static void _engine_rpc_done(void *arg, int rc, List ret_list);
+static bool _is_srun_msg(slurm_msg_type_t msg_type);
 static void _list_delete_retry(void *retry_entry);
+static void *_merge_flush(void *arg);
+static bool _multi_msg_nodes(hostlist_t hostlist);
+static bool _multi_msg_type(slurm_msg_type_t msg_type);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
 static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx);
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr);
@@ -180,6 +188,7 @@ static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			  int count, int *spot);
 static void _slurmctld_free_batch_job_launch_msg(batch_job_launch_msg_t * msg);
 static void _spawn_retry_agent(agent_arg_t * agent_arg_ptr);
+static void _test_wiki2_sched(void);
 static void *_thread_per_group_rpc(void *args);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
 static void *_wdog(void *args);
@@ -192,6 +201,8 @@ static char *_mail_type_str(uint16_t mail_type);
 static pthread_mutex_t retry_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mail_mutex  = PTHREAD_MUTEX_INITIALIZER;
 static List retry_list = NULL;		/* agent_arg_t list for retry */
+static uint32_t merge_delay = 0;	/* msec mergeable RPCs are held */
+static bool merge_flush_running = false;	/* _merge_flush() started */
 static List mail_list = NULL;		/* pending e-mail requests */
 
 static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -226,13 +237,7 @@ void *agent(void *args)
 	     agent_cnt, MAX_AGENT_CNT, agent_arg_ptr->msg_type);
 #endif
 	slurm_mutex_lock(&agent_cnt_mutex);
-	if (!wiki2_sched_test) {
-		char *sched_type = slurm_get_sched_type();
-		if (strcmp(sched_type, "sched/wiki2") == 0)
-			wiki2_sched = true;
-		xfree(sched_type);
-		wiki2_sched_test = true;
-	}
+	_test_wiki2_sched();
 
 	while (1) {
 		if (slurmctld_config.shutdown_time ||
@@ -476,6 +481,7 @@ static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
 	task_info_ptr->get_reply         = agent_info_ptr->get_reply;
 	task_info_ptr->msg_type          = agent_info_ptr->msg_type;
 	task_info_ptr->msg_args_ptr      = *agent_info_ptr->msg_args_pptr;
+	task_info_ptr->agent_info_ptr    = agent_info_ptr;
 
 	return task_info_ptr;
 }
@@ -521,67 +527,76 @@ static void _update_wdog_state(thd_t *thread_ptr,
  */
 static void *_wdog(void *args)
 {
-	bool srun_agent = false;
-	int i;
 	agent_info_t *agent_ptr = (agent_info_t *) args;
-	thd_t *thread_ptr = agent_ptr->thread_struct;
 	unsigned long usec = 125000;
-	ListIterator itr;
 	thd_complete_t thd_comp;
-	ret_data_info_t *ret_data_info = NULL;
-
-	if ( (agent_ptr->msg_type == SRUN_JOB_COMPLETE)			||
-	     (agent_ptr->msg_type == SRUN_STEP_MISSING)			||
-	     (agent_ptr->msg_type == SRUN_EXEC)				||
-	     (agent_ptr->msg_type == SRUN_NODE_FAIL)			||
-	     (agent_ptr->msg_type == SRUN_PING)				||
-	     (agent_ptr->msg_type == SRUN_TIMEOUT)			||
-	     (agent_ptr->msg_type == SRUN_USER_MSG)			||
-	     (agent_ptr->msg_type == RESPONSE_RESOURCE_ALLOCATION) )
-		srun_agent = true;
 
 	thd_comp.max_delay = 0;
 
 	while (1) {
-		thd_comp.work_done   = true;/* assume all threads complete */
-		thd_comp.fail_cnt    = 0;   /* assume no threads failures */
-		thd_comp.no_resp_cnt = 0;   /* assume all threads respond */
-		thd_comp.retry_cnt   = 0;   /* assume no required retries */
-		thd_comp.now         = time(NULL);
-
 		usleep(usec);
 		usec = MIN((usec * 2), 1000000);
 
 		slurm_mutex_lock(&agent_ptr->thread_mutex);
-		for (i = 0; i < agent_ptr->thread_count; i++) {
-			//info("thread name %s",thread_ptr[i].node_name);
-			if(!thread_ptr[i].ret_list) {
-				_update_wdog_state(&thread_ptr[i],
-						   &thread_ptr[i].state,
-						   &thd_comp);
-			} else {
-				itr = list_iterator_create(
-					thread_ptr[i].ret_list);
-				while((ret_data_info = list_next(itr))) {
-					_update_wdog_state(&thread_ptr[i],
-							   &ret_data_info->err,
-							   &thd_comp);
-				}
-				list_iterator_destroy(itr);
-			}
-		}
+		_agent_state(agent_ptr, &thd_comp);
 		if (thd_comp.work_done)
 			break;
 
 		slurm_mutex_unlock(&agent_ptr->thread_mutex);
 	}
 
-	if (srun_agent) {
+	_agent_complete(agent_ptr, &thd_comp);
+	slurm_mutex_unlock(&agent_ptr->thread_mutex);
+	return (void *) NULL;
+}
+
+/* Tally the state of every node of an agent, agent's thread_mutex must be
+ * locked by the caller */
+static void _agent_state(agent_info_t *agent_ptr, thd_complete_t *thd_comp)
+{
+	int i;
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info = NULL;
+
+	thd_comp->work_done   = true;	/* assume all threads complete */
+	thd_comp->fail_cnt    = 0;	/* assume no threads failures */
+	thd_comp->no_resp_cnt = 0;	/* assume all threads respond */
+	thd_comp->retry_cnt   = 0;	/* assume no required retries */
+	thd_comp->now         = time(NULL);
+
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		//info("thread name %s",thread_ptr[i].node_name);
+		if(!thread_ptr[i].ret_list) {
+			_update_wdog_state(&thread_ptr[i],
+					   &thread_ptr[i].state,
+					   thd_comp);
+		} else {
+			itr = list_iterator_create(thread_ptr[i].ret_list);
+			while((ret_data_info = list_next(itr))) {
+				_update_wdog_state(&thread_ptr[i],
+						   &ret_data_info->err,
+						   thd_comp);
+			}
+			list_iterator_destroy(itr);
+		}
+	}
+}
+
+/* Notify slurmctld of the results of an agent once all of its nodes have
+ * completed and release their records, agent's thread_mutex must be locked
+ * by the caller */
+static void _agent_complete(agent_info_t *agent_ptr, thd_complete_t *thd_comp)
+{
+	int i;
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+
+	if (_is_srun_msg(agent_ptr->msg_type)) {
 		_notify_slurmctld_jobs(agent_ptr);
 	} else {
 		_notify_slurmctld_nodes(agent_ptr,
-					thd_comp.no_resp_cnt,
-					thd_comp.retry_cnt);
+					thd_comp->no_resp_cnt,
+					thd_comp->retry_cnt);
 	}
 
 	for (i = 0; i < agent_ptr->thread_count; i++) {
@@ -590,11 +605,8 @@ static void *_wdog(void *args)
 		xfree(thread_ptr[i].nodelist);
 	}
 
-	if (thd_comp.max_delay)
-		debug2("agent maximum delay %d seconds", thd_comp.max_delay);
-
-	slurm_mutex_unlock(&agent_ptr->thread_mutex);
-	return (void *) NULL;
+	if (thd_comp->max_delay)
+		debug2("agent maximum delay %d seconds", thd_comp->max_delay);
 }
 
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr)
@@ -745,11 +757,7 @@ finished:	;
 	unlock_slurmctld(node_write_lock);
 	if (run_scheduler) {
 		run_scheduler = false;
-		/* below functions all have their own locking */
-		if (schedule(0))	{
-			schedule_job_save();
-			schedule_node_save();
-		}
+		queue_job_scheduler(0);
 	}
 	if ((agent_ptr->msg_type == REQUEST_PING) ||
 	    (agent_ptr->msg_type == REQUEST_HEALTH_CHECK) ||
@@ -793,6 +801,209 @@ static int _wif_status(void)
 	return rc;
 }
 
+/* Return true if the RPC is sent to srun rather than to slurmd */
+static bool _is_srun_msg(slurm_msg_type_t msg_type)
+{
+	return ((msg_type == SRUN_PING)				||
+		(msg_type == SRUN_EXEC)				||
+		(msg_type == SRUN_JOB_COMPLETE)			||
+		(msg_type == SRUN_STEP_MISSING)			||
+		(msg_type == SRUN_TIMEOUT)			||
+		(msg_type == SRUN_USER_MSG)			||
+		(msg_type == RESPONSE_RESOURCE_ALLOCATION)	||
+		(msg_type == SRUN_NODE_FAIL));
+}
+
+/*
+ * _process_rc - process the return code of an RPC from one node
+ * IN msg_type, msg_args - the RPC issued
+ * IN rc - its return code
+ * IN/OUT ret_data_info - response of the node
+ * RET state of the node
+ */
+static state_t _process_rc(slurm_msg_type_t msg_type, void *msg_args, int rc,
+			   ret_data_info_t *ret_data_info)
+{
+	state_t thread_state = DSH_NO_RESP;
+	bool is_kill_msg, srun_agent;
+
+#if AGENT_IS_THREAD
+	/* Locks: Write job, write node */
+	slurmctld_lock_t job_write_lock = {
+		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
+#endif
+	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
+			(msg_type == REQUEST_TERMINATE_JOB) );
+	srun_agent = _is_srun_msg(msg_type);
+
+#if AGENT_IS_THREAD
+	/* SPECIAL CASE: Mark node as IDLE if job already
+	   complete */
+	if (is_kill_msg &&
+	    (rc == ESLURMD_KILL_JOB_ALREADY_COMPLETE)) {
+		kill_job_msg_t *kill_job;
+		kill_job = (kill_job_msg_t *) msg_args;
+		rc = SLURM_SUCCESS;
+		lock_slurmctld(job_write_lock);
+		if (job_epilog_complete(kill_job->job_id,
+					ret_data_info->node_name, rc))
+			run_scheduler = true;
+		unlock_slurmctld(job_write_lock);
+	}
+	/* SPECIAL CASE: Kill non-startable batch job,
+	 * Requeue the job on ESLURMD_PROLOG_FAILED */
+	if ((msg_type == REQUEST_BATCH_JOB_LAUNCH) &&
+	    (rc != SLURM_SUCCESS) && (rc != ESLURMD_PROLOG_FAILED) &&
+	    (ret_data_info->type != RESPONSE_FORWARD_FAILED)) {
+		batch_job_launch_msg_t *launch_msg_ptr = msg_args;
+		uint32_t job_id = launch_msg_ptr->job_id;
+		info("Killing non-startable batch job %u: %s",
+		     job_id, slurm_strerror(rc));
+		thread_state = DSH_DONE;
+		ret_data_info->err = thread_state;
+		lock_slurmctld(job_write_lock);
+		job_complete(job_id, 0, false, false, _wif_status());
+		unlock_slurmctld(job_write_lock);
+		return thread_state;
+	}
+#endif
+
+
+	if (((msg_type == REQUEST_SIGNAL_TASKS) ||
+	     (msg_type == REQUEST_TERMINATE_TASKS)) &&
+	     (rc == ESRCH)) {
+		/* process is already dead, not a real error */
+		rc = SLURM_SUCCESS;
+	}
+
+	switch (rc) {
+	case SLURM_SUCCESS:
+		/* debug("agent processed RPC to node %s", */
+		/*       ret_data_info->node_name); */
+		thread_state = DSH_DONE;
+		break;
+	case SLURM_UNKNOWN_FORWARD_ADDR:
+		error("We were unable to forward message to '%s'.  "
+		      "Make sure the slurm.conf for each slurmd "
+		      "contain all other nodes in your system.",
+		      ret_data_info->node_name);
+		thread_state = DSH_NO_RESP;
+		break;
+	case ESLURMD_EPILOG_FAILED:
+		error("Epilog failure on host %s, "
+		      "setting DOWN",
+		      ret_data_info->node_name);
+
+		thread_state = DSH_FAILED;
+		break;
+	case ESLURMD_PROLOG_FAILED:
+		thread_state = DSH_FAILED;
+		break;
+	case ESLURM_INVALID_JOB_ID:
+		/* Not indicative of a real error */
+	case ESLURMD_JOB_NOTRUNNING:
+		/* Not indicative of a real error */
+		debug2("agent processed RPC to node %s: %s",
+		       ret_data_info->node_name,
+		       slurm_strerror(rc));
+
+		thread_state = DSH_DONE;
+		break;
+	default:
+		if (!srun_agent) {
+			if (ret_data_info->err)
+				errno = ret_data_info->err;
+			else
+				errno = rc;
+			rc = _comm_err(ret_data_info->node_name, msg_type);
+		}
+		if (srun_agent)
+			thread_state = DSH_FAILED;
+		else if(ret_data_info->type == RESPONSE_FORWARD_FAILED)
+			/* check if a forward failed */
+			thread_state = DSH_NO_RESP;
+		else {	/* some will fail that don't mean anything went
+			 * bad like a job term request on a job that is
+			 * already finished, we will just exit on those
+			 * cases */
+			thread_state = DSH_DONE;
+		}
+	}
+	return thread_state;
+}
+
+/*
+ * _process_multi_rc - process the return codes of the RPCs sent to one node
+ *	in a REQUEST_MULTI_MSG
+ * IN multi_msg - the RPCs issued
+ * IN/OUT ret_data_info - response of the node
+ * RET state of the node, the worst of its RPCs
+ */
+static state_t _process_multi_rc(multi_msg_t *multi_msg,
+				 ret_data_info_t *ret_data_info)
+{
+	multi_rc_msg_t *multi_rc = (multi_rc_msg_t *) ret_data_info->data;
+	state_t msg_state, thread_state = DSH_DONE;
+	slurm_msg_t *sub_msg;
+	ListIterator itr;
+	uint32_t i = 0;
+
+	if (multi_rc->rc_cnt != list_count(multi_msg->msg_list)) {
+		error("agent: node %s returned %u codes for %d RPCs",
+		      ret_data_info->node_name, multi_rc->rc_cnt,
+		      list_count(multi_msg->msg_list));
+		return DSH_NO_RESP;
+	}
+
+	itr = list_iterator_create(multi_msg->msg_list);
+	while ((sub_msg = list_next(itr))) {
+		msg_state = _process_rc(sub_msg->msg_type, sub_msg->data,
+					multi_rc->rc_array[i++],
+					ret_data_info);
+		if ((msg_state == DSH_FAILED) ||
+		    ((msg_state == DSH_NO_RESP) &&
+		     (thread_state != DSH_FAILED)))
+			thread_state = msg_state;
+	}
+	list_iterator_destroy(itr);
+
+	return thread_state;
+}
+
+/*
+ * _process_ret_list - process the responses to an RPC issued for a group of
+ *	nodes, setting the err field of each ret_list entry to its state_t
+ * IN task_ptr - the RPC issued
+ * IN/OUT ret_list - responses of the nodes
+ * RET state of the last node processed
+ */
+static state_t _process_ret_list(task_info_t *task_ptr, List ret_list)
+{
+	int rc;
+	state_t thread_state = DSH_NO_RESP;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info = NULL;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr)) != NULL) {
+		if ((task_ptr->msg_type == REQUEST_MULTI_MSG) &&
+		    (ret_data_info->type == RESPONSE_MULTI_MSG)) {
+			thread_state = _process_multi_rc(
+				task_ptr->msg_args_ptr, ret_data_info);
+		} else {
+			rc = slurm_get_return_code(ret_data_info->type,
+						   ret_data_info->data);
+			thread_state = _process_rc(task_ptr->msg_type,
+						   task_ptr->msg_args_ptr, rc,
+						   ret_data_info);
+		}
+		ret_data_info->err = thread_state;
+	}
+	list_iterator_destroy(itr);
+
+	return thread_state;
+}
+
 /*
  * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
  *                         sending message out to one and forwarding it to
@@ -801,7 +1012,6 @@ static int _wif_status(void)
  */
 static void *_thread_per_group_rpc(void *args)
 {
-	int rc = SLURM_SUCCESS;
 	slurm_msg_t msg;
 	task_info_t *task_ptr = (task_info_t *) args;
 	/* we cache some pointers from task_info_t because we need
@@ -815,31 +1025,14 @@ static void *_thread_per_group_rpc(void *args)
 	thd_t           *thread_ptr         = task_ptr->thread_struct_ptr;
 	state_t thread_state = DSH_NO_RESP;
 	slurm_msg_type_t msg_type = task_ptr->msg_type;
-	bool is_kill_msg, srun_agent;
+	bool srun_agent;
 	List ret_list = NULL;
-	ListIterator itr;
-	ret_data_info_t *ret_data_info = NULL;
-	int found = 0;
 	int sig_array[2] = {SIGUSR1, 0};
 
-#if AGENT_IS_THREAD
-	/* Locks: Write job, write node */
-	slurmctld_lock_t job_write_lock = {
-		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
-#endif
 	xassert(args != NULL);
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sig_array);
-	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
-			(msg_type == REQUEST_TERMINATE_JOB) );
-	srun_agent = (	(msg_type == SRUN_PING)			||
-			(msg_type == SRUN_EXEC)			||
-			(msg_type == SRUN_JOB_COMPLETE)		||
-			(msg_type == SRUN_STEP_MISSING)		||
-			(msg_type == SRUN_TIMEOUT)		||
-			(msg_type == SRUN_USER_MSG)		||
-			(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
-			(msg_type == SRUN_NODE_FAIL) );
+	srun_agent = _is_srun_msg(msg_type);
 
 	thread_ptr->start_time = time(NULL);
 
@@ -901,113 +1094,7 @@ static void *_thread_per_group_rpc(void *args)
 		goto cleanup;
 	}
 
-	//info("got %d messages back", list_count(ret_list));
-	found = 0;
-	itr = list_iterator_create(ret_list);
-	while ((ret_data_info = list_next(itr)) != NULL) {
-		rc = slurm_get_return_code(ret_data_info->type,
-					   ret_data_info->data);
-#if AGENT_IS_THREAD
-		/* SPECIAL CASE: Mark node as IDLE if job already
-		   complete */
-		if (is_kill_msg &&
-		    (rc == ESLURMD_KILL_JOB_ALREADY_COMPLETE)) {
-			kill_job_msg_t *kill_job;
-			kill_job = (kill_job_msg_t *)
-				task_ptr->msg_args_ptr;
-			rc = SLURM_SUCCESS;
-			lock_slurmctld(job_write_lock);
-			if (job_epilog_complete(kill_job->job_id,
-						ret_data_info->
-						node_name,
-						rc))
-				run_scheduler = true;
-			unlock_slurmctld(job_write_lock);
-		}
-		/* SPECIAL CASE: Kill non-startable batch job,
-		 * Requeue the job on ESLURMD_PROLOG_FAILED */
-		if ((msg_type == REQUEST_BATCH_JOB_LAUNCH) &&
-		    (rc != SLURM_SUCCESS) && (rc != ESLURMD_PROLOG_FAILED) &&
-		    (ret_data_info->type != RESPONSE_FORWARD_FAILED)) {
-			batch_job_launch_msg_t *launch_msg_ptr =
-				task_ptr->msg_args_ptr;
-			uint32_t job_id = launch_msg_ptr->job_id;
-			info("Killing non-startable batch job %u: %s",
-			     job_id, slurm_strerror(rc));
-			thread_state = DSH_DONE;
-			ret_data_info->err = thread_state;
-			lock_slurmctld(job_write_lock);
-			job_complete(job_id, 0, false, false, _wif_status());
-			unlock_slurmctld(job_write_lock);
-			continue;
-		}
-#endif
-
-
-		if (((msg_type == REQUEST_SIGNAL_TASKS) ||
-		     (msg_type == REQUEST_TERMINATE_TASKS)) &&
-		     (rc == ESRCH)) {
-			/* process is already dead, not a real error */
-			rc = SLURM_SUCCESS;
-		}
-
-		switch (rc) {
-		case SLURM_SUCCESS:
-			/* debug("agent processed RPC to node %s", */
-			/*       ret_data_info->node_name); */
-			thread_state = DSH_DONE;
-			break;
-		case SLURM_UNKNOWN_FORWARD_ADDR:
-			error("We were unable to forward message to '%s'.  "
-			      "Make sure the slurm.conf for each slurmd "
-			      "contain all other nodes in your system.",
-			      ret_data_info->node_name);
-			thread_state = DSH_NO_RESP;
-			break;
-		case ESLURMD_EPILOG_FAILED:
-			error("Epilog failure on host %s, "
-			      "setting DOWN",
-			      ret_data_info->node_name);
-
-			thread_state = DSH_FAILED;
-			break;
-		case ESLURMD_PROLOG_FAILED:
-			thread_state = DSH_FAILED;
-			break;
-		case ESLURM_INVALID_JOB_ID:
-			/* Not indicative of a real error */
-		case ESLURMD_JOB_NOTRUNNING:
-			/* Not indicative of a real error */
-			debug2("agent processed RPC to node %s: %s",
-			       ret_data_info->node_name,
-			       slurm_strerror(rc));
-
-			thread_state = DSH_DONE;
-			break;
-		default:
-			if (!srun_agent) {
-				if (ret_data_info->err)
-					errno = ret_data_info->err;
-				else
-					errno = rc;
-				rc = _comm_err(ret_data_info->node_name,
-					       msg_type);
-			}
-			if (srun_agent)
-				thread_state = DSH_FAILED;
-			else if(ret_data_info->type == RESPONSE_FORWARD_FAILED)
-				/* check if a forward failed */
-				thread_state = DSH_NO_RESP;
-			else {	/* some will fail that don't mean anything went
-				 * bad like a job term request on a job that is
-				 * already finished, we will just exit on those
-				 * cases */
-				thread_state = DSH_DONE;
-			}
-		}
-		ret_data_info->err = thread_state;
-	}
-	list_iterator_destroy(itr);
+	thread_state = _process_ret_list(task_ptr, ret_list);
 
 cleanup:
 	xfree(args);
@@ -1026,6 +1113,149 @@ cleanup:
 	return (void *) NULL;
 }
 
+/* Note if sched/wiki2 is configured, agent_cnt_mutex must be locked */
+static void _test_wiki2_sched(void)
+{
+	if (!wiki2_sched_test) {
+		char *sched_type = slurm_get_sched_type();
+		if (strcmp(sched_type, "sched/wiki2") == 0)
+			wiki2_sched = true;
+		xfree(sched_type);
+		wiki2_sched_test = true;
+	}
+}
+
+/*
+ * _engine_agent - issue the RPC of an agent through the agent engine rather
+ *	than a pthread for each group of nodes. Returns without waiting, the
+ *	agent completes in _engine_rpc_done() once every group responded.
+ * IN agent_arg_ptr - the request, xfree'd upon completion
+ */
+static void _engine_agent(agent_arg_t *agent_arg_ptr)
+{
+	agent_info_t *agent_info_ptr;
+	thd_t *thread_ptr;
+	task_info_t **task_ptr;
+	uint32_t i, thread_count;
+
+	slurm_mutex_lock(&agent_cnt_mutex);
+	_test_wiki2_sched();
+	agent_cnt++;
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
+	if (slurmctld_config.shutdown_time ||
+	    _valid_agent_arg(agent_arg_ptr)) {
+		_engine_agent_done(agent_arg_ptr, NULL);
+		return;
+	}
+
+	agent_info_ptr = _make_agent_info(agent_arg_ptr);
+	agent_info_ptr->agent_arg_ptr = agent_arg_ptr;
+	agent_info_ptr->begin_time = time(NULL);
+	thread_ptr = agent_info_ptr->thread_struct;
+	thread_count = agent_info_ptr->thread_count;
+	if (thread_count == 0) {
+		_engine_agent_done(agent_arg_ptr, agent_info_ptr);
+		return;
+	}
+	debug2("agent engine sending msg_type %u to %u groups",
+	       agent_info_ptr->msg_type, thread_count);
+
+	/* The agent may complete as soon as the last RPC is issued,
+	 * so set up every RPC before issuing any */
+	task_ptr = xmalloc(sizeof(task_info_t *) * thread_count);
+	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+	for (i = 0; i < thread_count; i++) {
+		task_ptr[i] = _make_task_data(agent_info_ptr, i);
+		thread_ptr[i].start_time = agent_info_ptr->begin_time;
+		thread_ptr[i].state = DSH_ACTIVE;
+	}
+	agent_info_ptr->threads_active = thread_count;
+	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+
+	for (i = 0; i < thread_count; i++) {
+		agent_engine_send(thread_ptr[i].nodelist, thread_ptr[i].addr,
+				  task_ptr[i]->msg_type,
+				  task_ptr[i]->msg_args_ptr,
+				  task_ptr[i]->get_reply,
+				  _engine_rpc_done, task_ptr[i]);
+	}
+	xfree(task_ptr);
+}
+
+/* Release an agent issued by the engine and issue pending requests */
+static void _engine_agent_done(agent_arg_t *agent_arg_ptr,
+			       agent_info_t *agent_info_ptr)
+{
+	_purge_agent_args(agent_arg_ptr);
+	if (agent_info_ptr) {
+		slurm_mutex_destroy(&agent_info_ptr->thread_mutex);
+		pthread_cond_destroy(&agent_info_ptr->thread_cond);
+		xfree(agent_info_ptr->thread_struct);
+		xfree(agent_info_ptr);
+	}
+
+	slurm_mutex_lock(&agent_cnt_mutex);
+	if (agent_cnt > 0)
+		agent_cnt--;
+	else {
+		error("agent_cnt underflow");
+		agent_cnt = 0;
+	}
+	pthread_cond_broadcast(&agent_cnt_cond);
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
+	/* Called from an engine thread, so leave mail for agent_retry()
+	 * calls from the slurmctld background thread */
+	agent_retry(RPC_RETRY_INTERVAL, false);
+}
+
+/* Process the responses to an RPC issued by _engine_agent() for one group
+ * of nodes, completing the agent after its last group */
+static void _engine_rpc_done(void *arg, int rc, List ret_list)
+{
+	task_info_t *task_ptr = (task_info_t *) arg;
+	agent_info_t *agent_info_ptr = task_ptr->agent_info_ptr;
+	thd_t *thread_ptr = task_ptr->thread_struct_ptr;
+	state_t thread_state = DSH_NO_RESP;
+	thd_complete_t thd_comp;
+	int delay;
+	bool last;
+
+	if (task_ptr->get_reply)
+		thread_state = _process_ret_list(task_ptr, ret_list);
+	else if (rc == SLURM_SUCCESS)
+		thread_state = DSH_DONE;
+	else if (!_is_srun_msg(task_ptr->msg_type)) {
+		errno = rc;
+		_comm_err(thread_ptr->nodelist, task_ptr->msg_type);
+	}
+	xfree(task_ptr);
+
+	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+	thread_ptr->ret_list = ret_list;
+	thread_ptr->state = thread_state;
+	thread_ptr->end_time = (time_t) difftime(time(NULL),
+						 thread_ptr->start_time);
+	last = (--agent_info_ptr->threads_active == 0);
+	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+	if (!last)
+		return;
+
+	thd_comp.max_delay = 0;
+	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+	_agent_state(agent_info_ptr, &thd_comp);
+	_agent_complete(agent_info_ptr, &thd_comp);
+	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+
+	delay = (int) difftime(time(NULL), agent_info_ptr->begin_time);
+	if (delay > (slurm_get_msg_timeout() * 2)) {
+		info("agent msg_type=%u ran for %d seconds",
+			agent_info_ptr->msg_type, delay);
+	}
+	_engine_agent_done(agent_info_ptr->agent_arg_ptr, agent_info_ptr);
+}
+
 /*
  * Signal handler.  We are really interested in interrupting hung communictions
  * and causing them to return EINTR. Multiple interupts might be required.
@@ -1140,6 +1370,7 @@ static void _list_delete_retry(void *retry_entry)
 
 	queued_req_ptr = (queued_request_t *) retry_entry;
 	_purge_agent_args(queued_req_ptr->agent_arg_ptr);
+	xfree(queued_req_ptr->node_list);
 	xfree(queued_req_ptr);
 }
 
@@ -1186,21 +1417,30 @@ extern int agent_retry (int min_wait, bool mail_too)
 			last_msg_time = now;
 		}
 	}
-	if (agent_cnt >= MAX_AGENT_CNT) {	/* too much work already */
+	if ((agent_cnt >= MAX_AGENT_CNT) &&	/* too much work already */
+	    !agent_engine_configured()) {
 		slurm_mutex_unlock(&retry_mutex);
 		return list_size;
 	}
 
 	if (retry_list) {
 		/* first try to find a new (never tried) record */
+		struct timeval tv_now;
 
+		gettimeofday(&tv_now, NULL);
 		retry_iter = list_iterator_create(retry_list);
 		while ((queued_req_ptr = (queued_request_t *)
 				list_next(retry_iter))) {
+			if (agent_merge_held(queued_req_ptr, &tv_now)) {
+				/* Issue nothing queued after it for now */
+				queued_req_ptr = NULL;
+				break;
+			}
 			rc = _batch_launch_defer(queued_req_ptr);
 			if (rc == -1) {		/* abort request */
 				_purge_agent_args(queued_req_ptr->
 						  agent_arg_ptr);
+				xfree(queued_req_ptr->node_list);
 				xfree(queued_req_ptr);
 				list_remove(retry_iter);
 				list_size--;
@@ -1230,6 +1470,7 @@ extern int agent_retry (int min_wait, bool mail_too)
 			if (rc == -1) { 	/* abort request */
 				_purge_agent_args(queued_req_ptr->
 						  agent_arg_ptr);
+				xfree(queued_req_ptr->node_list);
 				xfree(queued_req_ptr);
 				list_remove(retry_iter);
 				list_size--;
@@ -1237,6 +1478,8 @@ extern int agent_retry (int min_wait, bool mail_too)
 			}
 			if (rc > 0)
 				continue;
+			if (queued_req_ptr->last_attempt == 0)
+				continue;	/* issued in order above */
 			age = difftime(now, queued_req_ptr->last_attempt);
 			if (age > min_wait) {
 				list_remove(retry_iter);
@@ -1250,6 +1493,7 @@ extern int agent_retry (int min_wait, bool mail_too)
 
 	if (queued_req_ptr) {
 		agent_arg_ptr = queued_req_ptr->agent_arg_ptr;
+		xfree(queued_req_ptr->node_list);
 		xfree(queued_req_ptr);
 		if (agent_arg_ptr) {
 			_spawn_retry_agent(agent_arg_ptr);
@@ -1276,8 +1520,15 @@ extern int agent_retry (int min_wait, bool mail_too)
 void agent_queue_request(agent_arg_t *agent_arg_ptr)
 {
 	queued_request_t *queued_req_ptr = NULL;
+	char *node_list = NULL;
+	bool start_flush = false;
 
-	if (agent_arg_ptr->msg_type == REQUEST_SHUTDOWN) {
+	if ((agent_arg_ptr->msg_type == REQUEST_SHUTDOWN) &&
+	    agent_engine_configured()) {
+		/* execute now */
+		_engine_agent(agent_arg_ptr);
+		return;
+	} else if (agent_arg_ptr->msg_type == REQUEST_SHUTDOWN) {
 		/* execute now */
 		pthread_attr_t attr_agent;
 		pthread_t thread_agent;
@@ -1295,11 +1546,29 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 		}
 	}
 
+	if (_multi_msg_type(agent_arg_ptr->msg_type) && !agent_arg_ptr->addr &&
+	    _multi_msg_nodes(agent_arg_ptr->hostlist))
+		node_list = hostlist_ranged_string_xmalloc(
+				agent_arg_ptr->hostlist);
+
+	slurm_mutex_lock(&retry_mutex);
+	if (node_list && agent_merge_request(retry_list, agent_arg_ptr,
+					     node_list)) {
+		slurm_mutex_unlock(&retry_mutex);
+		xfree(node_list);
+		return;
+	}
+
 	queued_req_ptr = xmalloc(sizeof(queued_request_t));
 	queued_req_ptr->agent_arg_ptr = agent_arg_ptr;
+	queued_req_ptr->node_list     = node_list;
 /*	queued_req_ptr->last_attempt  = 0; Implicit */
-
-	slurm_mutex_lock(&retry_mutex);
+	if (node_list && merge_delay) {
+		/* Hold it for RPCs to the same nodes to be merged into */
+		agent_merge_hold(queued_req_ptr, merge_delay);
+		if (!merge_flush_running)
+			start_flush = merge_flush_running = true;
+	}
 
 	if (retry_list == NULL) {
 		retry_list = list_create(_list_delete_retry);
@@ -1309,11 +1578,98 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 	list_append(retry_list, (void *)queued_req_ptr);
 	slurm_mutex_unlock(&retry_mutex);
 
+	if (start_flush) {
+		pthread_attr_t attr_flush;
+		pthread_t thread_flush;
+		int retries = 0;
+
+		slurm_attr_init(&attr_flush);
+		if (pthread_attr_setdetachstate(&attr_flush,
+						PTHREAD_CREATE_DETACHED))
+			error("pthread_attr_setdetachstate error %m");
+		while (pthread_create(&thread_flush, &attr_flush,
+				      _merge_flush, NULL)) {
+			error("pthread_create error %m");
+			if (++retries > MAX_RETRIES)
+				fatal("Can't create pthread");
+			usleep(10000);	/* sleep and retry */
+		}
+		slurm_attr_destroy(&attr_flush);
+	}
+
 	/* now process the request in a separate pthread
 	 * (if we can create another pthread to do so) */
 	agent_retry(999, false);
 }
 
+/* Return true if RPCs of this type to the same nodes may be sent together
+ * in one REQUEST_MULTI_MSG */
+static bool _multi_msg_type(slurm_msg_type_t msg_type)
+{
+	return ((msg_type == REQUEST_KILL_PREEMPTED)	||
+		(msg_type == REQUEST_KILL_TIMELIMIT)	||
+		(msg_type == REQUEST_SIGNAL_TASKS)	||
+		(msg_type == REQUEST_TERMINATE_JOB)	||
+		(msg_type == REQUEST_TERMINATE_TASKS));
+}
+
+/* Return true if every node of a request runs a slurmd which accepts
+ * REQUEST_MULTI_MSG, as known from its registration. Needs a read lock on
+ * the nodes, as held by the callers queuing RPCs which may be merged. */
+static bool _multi_msg_nodes(hostlist_t hostlist)
+{
+	hostlist_iterator_t host_iter;
+	struct node_record *node_ptr;
+	char *host;
+	bool rc = true;
+
+	if (!hostlist)
+		return false;
+	host_iter = hostlist_iterator_create(hostlist);
+	while (rc && (host = hostlist_next(host_iter))) {
+		node_ptr = find_node_record(host);
+		if (!node_ptr ||
+		    (node_ptr->protocol_version < SLURM_2_3_PROTOCOL_VERSION))
+			rc = false;
+		free(host);
+	}
+	hostlist_iterator_destroy(host_iter);
+	return rc;
+}
+
+/* _merge_flush - issue the requests held by agent_merge_hold() once their
+ *	hold time has passed, exit when none remain queued */
+static void *_merge_flush(void *arg)
+{
+	ListIterator retry_iter;
+	queued_request_t *queued_req_ptr;
+	int held_cnt;
+
+	while (1) {
+		usleep(MAX(merge_delay, 1) * 1000);
+		held_cnt = 0;
+		slurm_mutex_lock(&retry_mutex);
+		if (retry_list) {
+			retry_iter = list_iterator_create(retry_list);
+			while ((queued_req_ptr = (queued_request_t *)
+					list_next(retry_iter))) {
+				if (timerisset(&queued_req_ptr->merge_end))
+					held_cnt++;
+			}
+			list_iterator_destroy(retry_iter);
+		}
+		if (held_cnt == 0)
+			merge_flush_running = false;
+		slurm_mutex_unlock(&retry_mutex);
+		if (held_cnt == 0)
+			break;
+		/* Each call issues at most one request */
+		while (held_cnt--)
+			agent_retry(999, false);
+	}
+	return NULL;
+}
+
 /* _spawn_retry_agent - pthread_create an agent for the given task */
 static void _spawn_retry_agent(agent_arg_t * agent_arg_ptr)
 {
@@ -1324,6 +1680,13 @@ static void _spawn_retry_agent(agent_arg_t * agent_arg_ptr)
 	if (agent_arg_ptr == NULL)
 		return;
 
+	if (agent_engine_configured()) {
+		debug2("Issuing RPC msg_type %u through agent engine",
+		       agent_arg_ptr->msg_type);
+		_engine_agent(agent_arg_ptr);
+		return;
+	}
+
 	debug2("Spawning RPC agent for msg_type %u",
 	       agent_arg_ptr->msg_type);
 	slurm_attr_init(&attr_agent);
@@ -1377,6 +1740,45 @@ extern int get_agent_count(void)
 	return agent_cnt;
 }
 
+/*
+ * agent_reconfig - load the agent options from SlurmctldParameters
+ *	(adaptive_tree, agent_merge_delay)
+ */
+extern void agent_reconfig(void)
+{
+	char *ctld_params = slurm_get_slurmctld_params();
+	char *tmp_ptr;
+	bool adaptive = false;
+	int delay = 0;
+
+	/* Without the engine, each request is issued as soon as queued and
+	 * only merged into ones waiting for an agent to be available */
+	if (agent_engine_configured()) {
+		delay = DEFAULT_AGENT_MERGE_DELAY;
+		if (ctld_params &&
+		    (tmp_ptr = strstr(ctld_params, "agent_merge_delay="))) {
+			delay = atoi(tmp_ptr + 18);
+			if (delay < 0) {
+				error("Invalid SlurmctldParameters "
+				      "agent_merge_delay: %d", delay);
+				delay = DEFAULT_AGENT_MERGE_DELAY;
+			}
+		}
+	}
+	slurm_mutex_lock(&retry_mutex);
+	merge_delay = delay;
+	slurm_mutex_unlock(&retry_mutex);
+
+	if (ctld_params && strstr(ctld_params, "adaptive_tree"))
+		adaptive = true;
+	if (adaptive != forward_get_adaptive()) {
+		info("agent: adaptive forwarding tree %s",
+		     adaptive ? "enabled" : "disabled");
+		forward_set_adaptive(adaptive);
+	}
+	xfree(ctld_params);
+}
+
 static void _purge_agent_args(agent_arg_t *agent_arg_ptr)
 {
 	if (agent_arg_ptr == NULL)
@@ -1407,6 +1809,8 @@ static void _purge_agent_args(agent_arg_t *agent_arg_ptr)
 				agent_arg_ptr->msg_args);
 		else if (agent_arg_ptr->msg_type == REQUEST_JOB_NOTIFY)
 			slurm_free_job_notify_msg(agent_arg_ptr->msg_args);
+		else if (agent_arg_ptr->msg_type == REQUEST_MULTI_MSG)
+			slurm_free_multi_msg(agent_arg_ptr->msg_args);
 		else
 			xfree(agent_arg_ptr->msg_args);
 	}
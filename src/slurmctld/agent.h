@@ -100,6 +100,9 @@ extern void agent_purge (void);
 /* get_agent_count - find out how many active agents we have */
 extern int get_agent_count(void);
 
+/* agent_reconfig - load the agent options from SlurmctldParameters */
+extern void agent_reconfig(void);
+
 /*
  * mail_job_info - Send e-mail notice of job state change
  * IN job_ptr - job identification
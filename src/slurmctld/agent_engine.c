@@ -0,0 +1,885 @@
+/*****************************************************************************\
+ *  agent_engine.c - event driven engine sending agent RPCs to many nodes
+ *	over a few threads
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
+#include "src/common/fd.h"
+#include "src/common/forward.h"
+#include "src/common/hostlist.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/agent_engine.h"
+#include "src/slurmctld/slurmctld.h"
+
+/* Maximum events reported by one epoll_wait() call */
+#define MAX_POLL_EVENTS		64
+
+/* Milliseconds between checks for connections past their deadline */
+#define DEADLINE_CHECK_MSEC	100
+
+/* Largest response accepted, as MAX_MSG_SIZE in slurm_protocol_socket */
+#define MAX_RESP_SIZE		(16 * 1024 * 1024)
+
+/* An RPC issued by agent_engine_send(), sent over one connection for each
+ * branch of the forwarding tree */
+typedef struct eng_req {
+	pthread_mutex_t lock;		/* protects branch_cnt and ret_list */
+	slurm_msg_type_t msg_type;
+	void *msg_args;
+	slurm_addr_t *addr;
+	bool get_reply;
+	int branch_cnt;			/* branches not yet complete */
+	int rc;				/* result if no reply expected */
+	List ret_list;			/* responses if reply expected */
+	agent_engine_done_t done_func;
+	void *done_arg;
+} eng_req_t;
+
+typedef enum {
+	CONN_PREPARE,		/* worker to pack message for next node */
+	CONN_WAIT,		/* waiting for a connection slot */
+	CONN_CONNECT,		/* connect in progress */
+	CONN_SEND,		/* sending message */
+	CONN_RECV_LEN,		/* reading response length */
+	CONN_RECV,		/* reading response */
+	CONN_DONE		/* worker to process result */
+} conn_state_t;
+
+/* Connection to the head node of one branch of the forwarding tree, which
+ * forwards the message to the other nodes of the branch. If the head node
+ * can not be reached, the next node of the branch becomes its head. */
+typedef struct eng_conn {
+	eng_req_t *req;
+	conn_state_t state;
+	hostlist_t hl;			/* nodes of branch not yet contacted */
+	char *name;			/* node contacted, malloc'd */
+	slurm_addr_t address;
+	slurm_fd_t fd;
+	int timeout;			/* msec allowed for the RPC */
+	long deadline;			/* msec, see _now_msec() */
+	int err;			/* error if no response */
+	char *out_buf;			/* message length and data */
+	uint32_t out_len, out_off;
+	uint32_t in_len;		/* response length */
+	uint32_t in_off;
+	char *in_buf;			/* response data */
+	bool active;			/* in active list of I/O thread */
+	struct eng_conn *prev;
+	struct eng_conn *next;
+} eng_conn_t;
+
+typedef struct eng_queue {
+	eng_conn_t *head;
+	eng_conn_t *tail;
+} eng_queue_t;
+
+static uint32_t engine_threads = DEFAULT_AGENT_ENGINE_THREADS;
+static uint32_t engine_conns   = DEFAULT_AGENT_ENGINE_CONNS;
+
+/* Connections for the worker threads and connections waiting for the I/O
+ * thread, protected by engine_lock */
+static pthread_mutex_t engine_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  work_cond   = PTHREAD_COND_INITIALIZER;
+static eng_queue_t work_queue = { NULL, NULL };
+static eng_queue_t wait_queue = { NULL, NULL };
+static bool engine_running = false;
+static bool wake_pending   = false;
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Used only by the I/O thread */
+static eng_conn_t *active_list = NULL;
+static uint32_t active_cnt = 0;
+static int epoll_fd = -1;
+static int wake_fd[2] = { -1, -1 };
+
+static void  _branch_done(eng_conn_t *conn);
+static eng_conn_t *_conn_create(eng_req_t *req, hostlist_t hl);
+static void  _conn_failed(eng_conn_t *conn);
+static void  _conn_prepare(eng_conn_t *conn);
+static void  _io_done(eng_conn_t *conn);
+#endif
+
+/*
+ * agent_engine_configured - parse SlurmctldParameters for the agent_engine
+ *	options. Read only once, changes require a slurmctld restart.
+ * RET true if agent RPCs should be issued by the engine rather than by a
+ *	pthread for each group of nodes
+ */
+extern bool agent_engine_configured(void)
+{
+	static bool parsed = false, use_engine = false;
+	char *ctld_params, *tmp_ptr;
+	int i;
+
+	slurm_mutex_lock(&engine_lock);
+	if (parsed) {
+		slurm_mutex_unlock(&engine_lock);
+		return use_engine;
+	}
+	parsed = true;
+
+	ctld_params = slurm_get_slurmctld_params();
+	tmp_ptr = ctld_params;
+	while (tmp_ptr && (tmp_ptr = strstr(tmp_ptr, "agent_engine"))) {
+		/* Skip "agent_engine_threads=#" */
+		if ((tmp_ptr[12] == '\0') || (tmp_ptr[12] == ',')) {
+			use_engine = true;
+			break;
+		}
+		tmp_ptr += 12;
+	}
+	if (ctld_params &&
+	    (tmp_ptr = strstr(ctld_params, "agent_engine_threads="))) {
+		i = atoi(tmp_ptr + 21);
+		if (i < 1) {
+			error("Invalid SlurmctldParameters "
+			      "agent_engine_threads: %d", i);
+		} else
+			engine_threads = i;
+	}
+	if (ctld_params &&
+	    (tmp_ptr = strstr(ctld_params, "agent_engine_conns="))) {
+		i = atoi(tmp_ptr + 19);
+		if (i < 1) {
+			error("Invalid SlurmctldParameters "
+			      "agent_engine_conns: %d", i);
+		} else
+			engine_conns = i;
+	}
+	xfree(ctld_params);
+
+#ifndef HAVE_SYS_EPOLL_H
+	if (use_engine) {
+		error("SlurmctldParameters agent_engine requires epoll, "
+		      "using a pthread for each group of nodes");
+		use_engine = false;
+	}
+#endif
+	slurm_mutex_unlock(&engine_lock);
+
+	return use_engine;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static long _now_msec(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return ((long) now.tv_sec * 1000) + (now.tv_usec / 1000);
+}
+
+static void _queue_append(eng_queue_t *queue, eng_conn_t *conn)
+{
+	conn->next = NULL;
+	conn->prev = queue->tail;
+	if (queue->tail)
+		queue->tail->next = conn;
+	else
+		queue->head = conn;
+	queue->tail = conn;
+}
+
+static eng_conn_t *_queue_pop(eng_queue_t *queue)
+{
+	eng_conn_t *conn = queue->head;
+
+	if (conn) {
+		queue->head = conn->next;
+		if (queue->head)
+			queue->head->prev = NULL;
+		else
+			queue->tail = NULL;
+		conn->next = NULL;
+	}
+	return conn;
+}
+
+/* Hand a connection to the worker threads */
+static void _work_enqueue(eng_conn_t *conn)
+{
+	slurm_mutex_lock(&engine_lock);
+	_queue_append(&work_queue, conn);
+	pthread_cond_signal(&work_cond);
+	slurm_mutex_unlock(&engine_lock);
+}
+
+/* Hand a connection with a packed message to the I/O thread */
+static void _wait_enqueue(eng_conn_t *conn)
+{
+	bool wake;
+	char c = '\0';
+
+	conn->state = CONN_WAIT;
+	slurm_mutex_lock(&engine_lock);
+	_queue_append(&wait_queue, conn);
+	wake = !wake_pending;
+	wake_pending = true;
+	slurm_mutex_unlock(&engine_lock);
+
+	if (wake && (write(wake_fd[1], &c, 1) < 0) && (errno != EAGAIN))
+		error("agent_engine: write: %m");
+}
+
+/* Pack the message for the head node of a branch, forwarding it to the
+ * remaining nodes of the branch.
+ * RET SLURM_SUCCESS or SLURM_ERROR with conn->err set */
+static int _conn_pack(eng_conn_t *conn)
+{
+	eng_req_t *req = conn->req;
+	slurm_msg_t msg;
+	Buf buffer;
+	uint32_t fwd_cnt, msg_len, msg_timeout;
+	int steps;
+
+	conn->fd = -1;
+	conn->err = SLURM_SUCCESS;
+	conn->out_off = 0;
+	conn->in_len = 0;
+	conn->in_off = 0;
+
+	slurm_msg_t_init(&msg);
+	msg.msg_type = req->msg_type;
+	msg.data = req->msg_args;
+	if (req->addr)
+		msg.address = *req->addr;
+	else if (slurm_conf_get_addr(conn->name, &msg.address) ==
+		 SLURM_ERROR) {
+		error("agent_engine: can't find address for host %s, "
+		      "check slurm.conf", conn->name);
+		conn->err = SLURM_UNKNOWN_FORWARD_ADDR;
+		return SLURM_ERROR;
+	}
+	conn->address = msg.address;
+
+	/* Deadline as set by _send_and_recv_msgs() for the branch */
+	msg_timeout = slurm_get_msg_timeout() * 1000;
+	msg.forward.timeout = msg_timeout;
+	conn->timeout = msg_timeout;
+	if (req->get_reply && !req->addr &&
+	    (fwd_cnt = hostlist_count(conn->hl))) {
+		msg.forward.cnt = fwd_cnt;
+		msg.forward.nodelist = hostlist_ranged_string_xmalloc(conn->hl);
+		steps = (fwd_cnt + 1) / slurm_get_tree_width();
+		conn->timeout = msg_timeout * steps;
+		steps++;
+		conn->timeout += msg.forward.timeout * steps;
+	}
+
+	buffer = slurm_pack_node_msg(&msg);
+	xfree(msg.forward.nodelist);
+	if (!buffer) {
+		conn->err = errno;
+		return SLURM_ERROR;
+	}
+
+	msg_len = get_buf_offset(buffer);
+	conn->out_len = msg_len + sizeof(uint32_t);
+	conn->out_buf = xmalloc(conn->out_len);
+	msg_len = htonl(msg_len);
+	memcpy(conn->out_buf, &msg_len, sizeof(uint32_t));
+	memcpy(conn->out_buf + sizeof(uint32_t), get_buf_data(buffer),
+	       get_buf_offset(buffer));
+	free_buf(buffer);
+
+	return SLURM_SUCCESS;
+}
+
+/* Pack the message for the next node of a branch and queue it for the I/O
+ * thread, or complete the branch once no nodes remain */
+static void _conn_prepare(eng_conn_t *conn)
+{
+	while ((conn->name = hostlist_shift(conn->hl))) {
+		if (_conn_pack(conn) == SLURM_SUCCESS) {
+			_wait_enqueue(conn);
+			return;
+		}
+		_conn_failed(conn);
+	}
+	_branch_done(conn);
+}
+
+/* Record that the node contacted did not respond */
+static void _conn_failed(eng_conn_t *conn)
+{
+	eng_req_t *req = conn->req;
+
+	if (req->get_reply) {
+		slurm_mutex_lock(&req->lock);
+		mark_as_failed_forward(&req->ret_list, conn->name, conn->err);
+		slurm_mutex_unlock(&req->lock);
+	} else
+		req->rc = conn->err;
+	free(conn->name);
+	conn->name = NULL;
+}
+
+/* Split the nodes left to contact in a branch whose head failed into the
+ * branches the head would have forwarded to, as done by start_msg_tree()
+ * with an adaptive tree. The first one remains in conn. */
+static void _conn_split(eng_conn_t *conn)
+{
+	eng_req_t *req = conn->req;
+	hostlist_t hl = conn->hl, branch_hl;
+	int *span, branch = 0, i;
+	char *name;
+
+	if (!req->get_reply || req->addr || (hostlist_count(hl) <= 1))
+		return;
+	span = set_span(hostlist_count(hl), 0);
+	while ((name = hostlist_shift(hl))) {
+		branch_hl = hostlist_create(name);
+		free(name);
+		for (i = 0; i < span[branch]; i++) {
+			if (!(name = hostlist_shift(hl)))
+				break;
+			hostlist_push_host(branch_hl, name);
+			free(name);
+		}
+		if (branch++ == 0) {
+			conn->hl = branch_hl;
+			continue;
+		}
+		slurm_mutex_lock(&req->lock);
+		req->branch_cnt++;
+		slurm_mutex_unlock(&req->lock);
+		_work_enqueue(_conn_create(req, branch_hl));
+	}
+	hostlist_destroy(hl);
+	xfree(span);
+}
+
+/* Process the result of a connection: collect the responses of the branch
+ * or fail over to the next node of the branch */
+static void _conn_finish(eng_conn_t *conn)
+{
+	eng_req_t *req = conn->req;
+	ret_data_info_t *ret_data_info;
+	List ret_list;
+	int msec = _now_msec() - (conn->deadline - conn->timeout);
+
+	if (conn->err == SLURM_SUCCESS) {
+		if (!req->get_reply) {
+			req->rc = SLURM_SUCCESS;
+			free(conn->name);
+			conn->name = NULL;
+			_branch_done(conn);
+			return;
+		}
+		/* slurm_unpack_msgs() frees in_buf */
+		ret_list = slurm_unpack_msgs(conn->in_buf, conn->in_len, -1);
+		conn->in_buf = NULL;
+		if (ret_list) {
+			forward_record_stats(conn->name, ret_list, msec,
+					     hostlist_count(conn->hl));
+			slurm_mutex_lock(&req->lock);
+			while ((ret_data_info = list_pop(ret_list))) {
+				if (!ret_data_info->node_name) {
+					ret_data_info->node_name =
+						xstrdup(conn->name);
+				}
+				list_push(req->ret_list, ret_data_info);
+			}
+			slurm_mutex_unlock(&req->lock);
+			list_destroy(ret_list);
+			free(conn->name);
+			conn->name = NULL;
+			_branch_done(conn);
+			return;
+		}
+		conn->err = errno ? errno : SLURM_COMMUNICATIONS_RECEIVE_ERROR;
+	}
+	forward_record_stats(conn->name, NULL, 0, 0);
+	_conn_failed(conn);
+	if (forward_get_adaptive())
+		_conn_split(conn);
+	_conn_prepare(conn);
+}
+
+static void _branch_done(eng_conn_t *conn)
+{
+	eng_req_t *req = conn->req;
+	bool req_done;
+
+	hostlist_destroy(conn->hl);
+	xfree(conn->out_buf);
+	xfree(conn->in_buf);
+	xfree(conn);
+
+	slurm_mutex_lock(&req->lock);
+	req_done = (--req->branch_cnt == 0);
+	slurm_mutex_unlock(&req->lock);
+	if (!req_done)
+		return;
+
+	(req->done_func)(req->done_arg, req->rc, req->ret_list);
+	slurm_mutex_destroy(&req->lock);
+	xfree(req);
+}
+
+/* Worker thread, pack messages and process their responses */
+static void *_engine_worker(void *no_data)
+{
+	eng_conn_t *conn;
+
+	while (1) {
+		slurm_mutex_lock(&engine_lock);
+		while (!(conn = _queue_pop(&work_queue)))
+			pthread_cond_wait(&work_cond, &engine_lock);
+		slurm_mutex_unlock(&engine_lock);
+
+		if (conn->state == CONN_PREPARE)
+			_conn_prepare(conn);
+		else
+			_conn_finish(conn);
+	}
+
+	return NULL;
+}
+
+/* Complete the I/O of a connection and hand it to the worker threads */
+static void _io_done(eng_conn_t *conn)
+{
+	if (conn->active) {
+		if (conn->prev)
+			conn->prev->next = conn->next;
+		else
+			active_list = conn->next;
+		if (conn->next)
+			conn->next->prev = conn->prev;
+		conn->active = false;
+		active_cnt--;
+	}
+	if (conn->fd >= 0) {
+		(void) close(conn->fd);
+		conn->fd = -1;
+	}
+	xfree(conn->out_buf);
+	conn->state = CONN_DONE;
+	_work_enqueue(conn);
+}
+
+static void _io_fail(eng_conn_t *conn, int err)
+{
+	xfree(conn->in_buf);
+	conn->err = err;
+	_io_done(conn);
+}
+
+static void _io_connect(eng_conn_t *conn)
+{
+	struct epoll_event ev;
+
+	conn->deadline = _now_msec() + conn->timeout;
+	conn->fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (conn->fd < 0) {
+		error("agent_engine: socket: %m");
+		_io_fail(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+	fd_set_nonblocking(conn->fd);
+	fd_set_close_on_exec(conn->fd);
+
+	if (connect(conn->fd, (struct sockaddr *) &conn->address,
+		    sizeof(conn->address)) == 0)
+		conn->state = CONN_SEND;
+	else if (errno == EINPROGRESS)
+		conn->state = CONN_CONNECT;
+	else {
+		debug2("agent_engine: connect to %s: %m", conn->name);
+		_io_fail(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+
+	ev.events = EPOLLOUT;
+	ev.data.ptr = conn;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) < 0) {
+		error("agent_engine: epoll_ctl: %m");
+		_io_fail(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+
+	conn->active = true;
+	conn->prev = NULL;
+	conn->next = active_list;
+	if (active_list)
+		active_list->prev = conn;
+	active_list = conn;
+	active_cnt++;
+}
+
+/* Start connections waiting for a slot, up to engine_conns at once */
+static void _io_start(void)
+{
+	eng_queue_t start_queue = { NULL, NULL };
+	eng_conn_t *conn;
+	uint32_t start_cnt = active_cnt;
+
+	slurm_mutex_lock(&engine_lock);
+	while ((start_cnt < engine_conns) &&
+	       (conn = _queue_pop(&wait_queue))) {
+		_queue_append(&start_queue, conn);
+		start_cnt++;
+	}
+	slurm_mutex_unlock(&engine_lock);
+
+	while ((conn = _queue_pop(&start_queue)))
+		_io_connect(conn);
+}
+
+static void _io_send(eng_conn_t *conn)
+{
+	struct epoll_event ev;
+	ssize_t n;
+
+	while (conn->out_off < conn->out_len) {
+		n = send(conn->fd, conn->out_buf + conn->out_off,
+			 conn->out_len - conn->out_off, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+			debug2("agent_engine: send to %s: %m", conn->name);
+			_io_fail(conn, SLURM_COMMUNICATIONS_SEND_ERROR);
+			return;
+		}
+		conn->out_off += n;
+	}
+	xfree(conn->out_buf);
+
+	if (!conn->req->get_reply) {
+		_io_done(conn);
+		return;
+	}
+	conn->state = CONN_RECV_LEN;
+	ev.events = EPOLLIN;
+	ev.data.ptr = conn;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) < 0) {
+		error("agent_engine: epoll_ctl: %m");
+		_io_fail(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+	}
+}
+
+static void _io_recv(eng_conn_t *conn)
+{
+	char *ptr;
+	uint32_t len;
+	ssize_t n;
+
+	while (1) {
+		if (conn->state == CONN_RECV_LEN) {
+			ptr = ((char *) &conn->in_len) + conn->in_off;
+			len = sizeof(uint32_t) - conn->in_off;
+		} else {
+			ptr = conn->in_buf + conn->in_off;
+			len = conn->in_len - conn->in_off;
+		}
+		n = recv(conn->fd, ptr, len, 0);
+		if (n == 0) {
+			debug2("agent_engine: connection to %s closed",
+			       conn->name);
+			_io_fail(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+			return;
+		}
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+			debug2("agent_engine: recv from %s: %m", conn->name);
+			_io_fail(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+			return;
+		}
+		conn->in_off += n;
+		if (conn->in_off < ((conn->state == CONN_RECV_LEN) ?
+				    sizeof(uint32_t) : conn->in_len))
+			continue;
+
+		if (conn->state == CONN_RECV) {
+			_io_done(conn);
+			return;
+		}
+		conn->in_len = ntohl(conn->in_len);
+		if ((conn->in_len == 0) || (conn->in_len > MAX_RESP_SIZE)) {
+			error("agent_engine: invalid response length %u "
+			      "from %s", conn->in_len, conn->name);
+			_io_fail(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+			return;
+		}
+		conn->in_buf = xmalloc(conn->in_len);
+		conn->in_off = 0;
+		conn->state = CONN_RECV;
+	}
+}
+
+static void _io_event(eng_conn_t *conn)
+{
+	int err = 0;
+	socklen_t err_len = sizeof(err);
+
+	if (conn->state == CONN_CONNECT) {
+		if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err,
+			       &err_len) < 0)
+			err = errno;
+		if (err) {
+			errno = err;
+			debug2("agent_engine: connect to %s: %m", conn->name);
+			_io_fail(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+			return;
+		}
+		conn->state = CONN_SEND;
+	}
+	if (conn->state == CONN_SEND)
+		_io_send(conn);
+	else
+		_io_recv(conn);
+}
+
+/* Report connections past their deadline as not responding */
+static void _io_expire(long now)
+{
+	eng_conn_t *conn, *next;
+
+	for (conn = active_list; conn; conn = next) {
+		next = conn->next;
+		if (now < conn->deadline)
+			continue;
+		debug("agent_engine: RPC %u to %s timed out",
+		      conn->req->msg_type, conn->name);
+		_io_fail(conn, SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT);
+	}
+}
+
+/* I/O thread, drive every connection of the engine */
+static void *_engine_io(void *no_data)
+{
+	struct epoll_event events[MAX_POLL_EVENTS];
+	char buf[64];
+	long now, next_check = 0;
+	int i, n;
+
+	while (1) {
+		_io_start();
+		n = epoll_wait(epoll_fd, events, MAX_POLL_EVENTS,
+			       DEADLINE_CHECK_MSEC);
+		if ((n < 0) && (errno != EINTR))
+			error("agent_engine: epoll_wait: %m");
+		for (i = 0; i < n; i++) {
+			if (events[i].data.ptr) {
+				_io_event((eng_conn_t *) events[i].data.ptr);
+				continue;
+			}
+			slurm_mutex_lock(&engine_lock);
+			wake_pending = false;
+			slurm_mutex_unlock(&engine_lock);
+			while (read(wake_fd[0], buf, sizeof(buf)) > 0)
+				;
+		}
+		now = _now_msec();
+		if (now >= next_check) {
+			_io_expire(now);
+			next_check = now + DEADLINE_CHECK_MSEC;
+		}
+	}
+
+	return NULL;
+}
+
+/* Start the engine threads on first use */
+static void _engine_start(void)
+{
+	pthread_attr_t thread_attr;
+	pthread_t thread_id;
+	struct epoll_event ev;
+	uint32_t i;
+
+	slurm_mutex_lock(&engine_lock);
+	if (engine_running) {
+		slurm_mutex_unlock(&engine_lock);
+		return;
+	}
+
+	if ((epoll_fd = epoll_create(MAX_POLL_EVENTS)) < 0)
+		fatal("agent_engine: epoll_create: %m");
+	fd_set_close_on_exec(epoll_fd);
+	if (pipe(wake_fd) < 0)
+		fatal("agent_engine: pipe: %m");
+	for (i = 0; i < 2; i++) {
+		fd_set_nonblocking(wake_fd[i]);
+		fd_set_close_on_exec(wake_fd[i]);
+	}
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd[0], &ev) < 0)
+		fatal("agent_engine: epoll_ctl: %m");
+
+	slurm_attr_init(&thread_attr);
+	if (pthread_attr_setdetachstate(&thread_attr,
+					PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate %m");
+	if (pthread_create(&thread_id, &thread_attr, _engine_io, NULL))
+		fatal("agent_engine: pthread_create: %m");
+	for (i = 0; i < engine_threads; i++) {
+		if (pthread_create(&thread_id, &thread_attr, _engine_worker,
+				   NULL))
+			fatal("agent_engine: pthread_create: %m");
+	}
+	slurm_attr_destroy(&thread_attr);
+
+	verbose("agent_engine: started with %u threads and up to %u "
+		"connections", engine_threads, engine_conns);
+	engine_running = true;
+	slurm_mutex_unlock(&engine_lock);
+}
+
+static eng_conn_t *_conn_create(eng_req_t *req, hostlist_t hl)
+{
+	eng_conn_t *conn = xmalloc(sizeof(eng_conn_t));
+
+	conn->req = req;
+	conn->state = CONN_PREPARE;
+	conn->hl = hl;
+	conn->fd = -1;
+	return conn;
+}
+#endif	/* HAVE_SYS_EPOLL_H */
+
+/*
+ * agent_engine_send - issue an RPC to a set of nodes without waiting for it
+ *	to complete. Messages are forwarded along the same tree as
+ *	slurm_send_recv_msgs(). Each connection has a deadline based upon
+ *	MessageTimeout and its depth in the tree, after which its nodes are
+ *	reported as not responding.
+ * IN nodelist - nodes to send to, one node if get_reply is false
+ * IN addr - if set, send to this address rather than that of the node
+ * IN msg_type, msg_args - RPC to issue, must not be changed or freed until
+ *	done_func is called
+ * IN get_reply - if set, wait for the response of every node
+ * IN done_func - function to call with the results, from an engine thread
+ * IN done_arg - argument of done_func
+ */
+extern void agent_engine_send(char *nodelist, slurm_addr_t *addr,
+			      slurm_msg_type_t msg_type, void *msg_args,
+			      bool get_reply, agent_engine_done_t done_func,
+			      void *done_arg)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	eng_req_t *req;
+	eng_conn_t *conn;
+	eng_queue_t conn_queue = { NULL, NULL };
+	hostlist_t hl, branch_hl;
+	char *name;
+	int *span = NULL, branch = 0, i;
+
+	_engine_start();
+
+	req = xmalloc(sizeof(eng_req_t));
+	slurm_mutex_init(&req->lock);
+	req->msg_type  = msg_type;
+	req->msg_args  = msg_args;
+	req->addr      = addr;
+	req->get_reply = get_reply;
+	req->rc        = SLURM_SUCCESS;
+	req->done_func = done_func;
+	req->done_arg  = done_arg;
+	if (get_reply)
+		req->ret_list = list_create(destroy_data_info);
+
+	hl = hostlist_create(nodelist);
+	if (!get_reply || addr) {
+		_queue_append(&conn_queue, _conn_create(req, hl));
+		req->branch_cnt = 1;
+	} else {
+		/* Split the nodes into branches as done by start_msg_tree() */
+		hostlist_uniq(hl);
+		forward_tree_order(hl);
+		span = set_span(hostlist_count(hl), 0);
+		while ((name = hostlist_shift(hl))) {
+			branch_hl = hostlist_create(name);
+			free(name);
+			for (i = 0; i < span[branch]; i++) {
+				if (!(name = hostlist_shift(hl)))
+					break;
+				hostlist_push_host(branch_hl, name);
+				free(name);
+			}
+			_queue_append(&conn_queue,
+				      _conn_create(req, branch_hl));
+			req->branch_cnt++;
+			branch++;
+		}
+		xfree(span);
+		hostlist_destroy(hl);
+	}
+
+	if (req->branch_cnt == 0) {
+		(done_func)(done_arg, req->rc, req->ret_list);
+		slurm_mutex_destroy(&req->lock);
+		xfree(req);
+		return;
+	}
+
+	slurm_mutex_lock(&engine_lock);
+	while ((conn = _queue_pop(&conn_queue)))
+		_queue_append(&work_queue, conn);
+	pthread_cond_broadcast(&work_cond);
+	slurm_mutex_unlock(&engine_lock);
+#else
+	fatal("agent_engine_send: epoll is not available");
+#endif
+}
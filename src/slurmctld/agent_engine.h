@@ -0,0 +1,84 @@
+/*****************************************************************************\
+ *  agent_engine.h - event driven engine sending agent RPCs to many nodes
+ *	over a few threads
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_AGENT_ENGINE_H
+#define _HAVE_AGENT_ENGINE_H
+
+#include "src/slurmctld/slurmctld.h"
+
+/* Default values for the SlurmctldParameters agent_engine options */
+#define DEFAULT_AGENT_ENGINE_THREADS	4
+#define DEFAULT_AGENT_ENGINE_CONNS	1024
+
+/*
+ * Function called when an RPC issued by agent_engine_send() completes
+ * IN arg - the done_arg given to agent_engine_send()
+ * IN rc - if no reply was expected, SLURM_SUCCESS if the message was sent,
+ *	otherwise an error code
+ * IN ret_list - if a reply was expected, a List of ret_data_info_t with
+ *	an entry for every node the message was sent to, as returned by
+ *	slurm_send_recv_msgs(). The function must destroy it.
+ */
+typedef void (*agent_engine_done_t) (void *arg, int rc, List ret_list);
+
+/*
+ * agent_engine_configured - parse SlurmctldParameters for the agent_engine
+ *	options. Read only once, changes require a slurmctld restart.
+ * RET true if agent RPCs should be issued by the engine rather than by a
+ *	pthread for each group of nodes
+ */
+extern bool agent_engine_configured(void);
+
+/*
+ * agent_engine_send - issue an RPC to a set of nodes without waiting for it
+ *	to complete. Messages are forwarded along the same tree as
+ *	slurm_send_recv_msgs(). Each connection has a deadline based upon
+ *	MessageTimeout and its depth in the tree, after which its nodes are
+ *	reported as not responding.
+ * IN nodelist - nodes to send to, one node if get_reply is false
+ * IN addr - if set, send to this address rather than that of the node
+ * IN msg_type, msg_args - RPC to issue, must not be changed or freed until
+ *	done_func is called
+ * IN get_reply - if set, wait for the response of every node
+ * IN done_func - function to call with the results, from an engine thread
+ * IN done_arg - argument of done_func
+ */
+extern void agent_engine_send(char *nodelist, slurm_addr_t *addr,
+			      slurm_msg_type_t msg_type, void *msg_args,
+			      bool get_reply, agent_engine_done_t done_func,
+			      void *done_arg);
+
+#endif	/* !_HAVE_AGENT_ENGINE_H */
@@ -0,0 +1,159 @@
+/*****************************************************************************\
+ *  agent_merge.c - merge agent RPCs queued for the same nodes into one
+ *	REQUEST_MULTI_MSG
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "src/common/hostlist.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/agent_merge.h"
+
+/* Return true if a queued request is for any of the nodes in hl1,
+ * whose ranged string is hl1_str */
+static bool _hostlist_overlap(hostlist_t hl1, char *hl1_str,
+			      queued_request_t *queued_req_ptr)
+{
+	agent_arg_t *queued_arg_ptr = queued_req_ptr->agent_arg_ptr;
+	hostlist_iterator_t host_iter;
+	char *host;
+	bool rc = false;
+
+	if (!queued_arg_ptr || queued_arg_ptr->addr ||
+	    !queued_arg_ptr->hostlist)
+		return false;	/* Not to slurmd */
+	if (queued_req_ptr->node_list &&
+	    !strcmp(queued_req_ptr->node_list, hl1_str))
+		return true;
+	host_iter = hostlist_iterator_create(hl1);
+	while (!rc && (host = hostlist_next(host_iter))) {
+		if (hostlist_find(queued_arg_ptr->hostlist, host) >= 0)
+			rc = true;
+		free(host);
+	}
+	hostlist_iterator_destroy(host_iter);
+	return rc;
+}
+
+extern bool agent_merge_request(List retry_list, agent_arg_t *agent_arg_ptr,
+				char *node_list)
+{
+	ListIterator retry_iter;
+	queued_request_t *queued_req_ptr, *last_req_ptr = NULL;
+	agent_arg_t *queued_arg_ptr = NULL;
+	multi_msg_t *multi_msg = NULL;
+	slurm_msg_t *sub_msg;
+
+	if (!retry_list)
+		return false;
+	retry_iter = list_iterator_create(retry_list);
+	while ((queued_req_ptr = (queued_request_t *)
+			list_next(retry_iter))) {
+		if (_hostlist_overlap(agent_arg_ptr->hostlist, node_list,
+				      queued_req_ptr))
+			last_req_ptr = queued_req_ptr;
+	}
+	list_iterator_destroy(retry_iter);
+	if (!last_req_ptr || !last_req_ptr->node_list ||
+	    last_req_ptr->last_attempt ||
+	    strcmp(last_req_ptr->node_list, node_list))
+		return false;
+	queued_arg_ptr = last_req_ptr->agent_arg_ptr;
+	if (queued_arg_ptr->retry != agent_arg_ptr->retry)
+		return false;
+	if (queued_arg_ptr->msg_type == REQUEST_MULTI_MSG) {
+		multi_msg = queued_arg_ptr->msg_args;
+		if (list_count(multi_msg->msg_list) >= MAX_MULTI_MSG_CNT)
+			return false;
+	}
+
+	if (queued_arg_ptr->msg_type != REQUEST_MULTI_MSG) {
+		multi_msg = xmalloc(sizeof(multi_msg_t));
+		multi_msg->msg_list =
+			list_create(slurm_destroy_multi_msg_entry);
+		sub_msg = xmalloc(sizeof(slurm_msg_t));
+		slurm_msg_t_init(sub_msg);
+		sub_msg->msg_type = queued_arg_ptr->msg_type;
+		sub_msg->data     = queued_arg_ptr->msg_args;
+		list_append(multi_msg->msg_list, sub_msg);
+		queued_arg_ptr->msg_type = REQUEST_MULTI_MSG;
+		queued_arg_ptr->msg_args = multi_msg;
+	}
+	sub_msg = xmalloc(sizeof(slurm_msg_t));
+	slurm_msg_t_init(sub_msg);
+	sub_msg->msg_type = agent_arg_ptr->msg_type;
+	sub_msg->data     = agent_arg_ptr->msg_args;
+	list_append(multi_msg->msg_list, sub_msg);
+	debug3("agent: merged msg_type %u into request with %d RPCs for %s",
+	       agent_arg_ptr->msg_type, list_count(multi_msg->msg_list),
+	       node_list);
+
+	/* msg_args now belongs to the REQUEST_MULTI_MSG */
+	hostlist_destroy(agent_arg_ptr->hostlist);
+	xfree(agent_arg_ptr->addr);
+	xfree(agent_arg_ptr);
+	return true;
+}
+
+extern void agent_merge_hold(queued_request_t *queued_req_ptr,
+			     uint32_t delay_msec)
+{
+	struct timeval delay;
+
+	if (delay_msec == 0)
+		return;
+	gettimeofday(&queued_req_ptr->merge_end, NULL);
+	delay.tv_sec  = delay_msec / 1000;
+	delay.tv_usec = (delay_msec % 1000) * 1000;
+	timeradd(&queued_req_ptr->merge_end, &delay,
+		 &queued_req_ptr->merge_end);
+}
+
+extern bool agent_merge_held(queued_request_t *queued_req_ptr,
+			     struct timeval *now)
+{
+	if (!timerisset(&queued_req_ptr->merge_end))
+		return false;
+	return timercmp(now, &queued_req_ptr->merge_end, <);
+}
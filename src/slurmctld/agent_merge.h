@@ -0,0 +1,93 @@
+/*****************************************************************************\
+ *  agent_merge.h - merge agent RPCs queued for the same nodes into one
+ *	REQUEST_MULTI_MSG
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_AGENT_MERGE_H
+#define _HAVE_AGENT_MERGE_H
+
+#include <sys/time.h>
+
+#include "src/common/list.h"
+#include "src/slurmctld/agent.h"
+
+/* Default msec a mergeable RPC is held when agent_engine is configured,
+ * SlurmctldParameters agent_merge_delay=# */
+#define DEFAULT_AGENT_MERGE_DELAY	20
+
+typedef struct queued_request {
+	agent_arg_t* agent_arg_ptr;	/* The queued request */
+	time_t       first_attempt;	/* Time of first check for batch
+					 * launch RPC *only* */
+	time_t       last_attempt;	/* Time of last xmit attempt */
+	char        *node_list;		/* Nodes of a request which other
+					 * RPCs may be merged into */
+	struct timeval merge_end;	/* Not issued before this time, so
+					 * that other RPCs may be merged */
+} queued_request_t;
+
+/*
+ * agent_merge_request - add the RPC of a request to the last one queued for
+ *	any of its nodes, if that is for the same nodes and not yet issued, so
+ *	that slurmd receives them over one connection in a REQUEST_MULTI_MSG.
+ *	An RPC is never merged ahead of another queued for its nodes, which
+ *	slurmd must process first (e.g. a batch job launch before a signal).
+ *	The caller must lock the list.
+ * IN retry_list - list of queued_request_t
+ * IN agent_arg_ptr - request to merge, xfree'd if merged
+ * IN node_list - ranged hostlist of the request
+ * RET true if merged
+ */
+extern bool agent_merge_request(List retry_list, agent_arg_t *agent_arg_ptr,
+				char *node_list);
+
+/*
+ * agent_merge_hold - hold a newly queued request, so that RPCs queued for
+ *	the same nodes within delay_msec are merged into it
+ * IN queued_req_ptr - request to hold
+ * IN delay_msec - time to hold the request, none if zero
+ */
+extern void agent_merge_hold(queued_request_t *queued_req_ptr,
+			     uint32_t delay_msec);
+
+/*
+ * agent_merge_held - test if a request is still held by agent_merge_hold()
+ * IN queued_req_ptr - request to test
+ * IN now - current time
+ * RET true if the request should not be issued yet
+ */
+extern bool agent_merge_held(queued_request_t *queued_req_ptr,
+			     struct timeval *now);
+
+#endif	/* !_HAVE_AGENT_MERGE_H */
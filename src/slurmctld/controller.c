@@ -87,6 +87,7 @@
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_delta.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -96,11 +97,15 @@
 #include "src/slurmctld/preempt.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
+#include "src/slurmctld/reg_queue.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_class.h"
+#include "src/slurmctld/rpc_pool.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/srun_comm.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_snapshot.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 
@@ -566,6 +571,18 @@ int main(int argc, char *argv[])
 		}
 		slurm_attr_destroy(&thread_attr);
 
+		/*
+		 * create attached thread for job scheduling
+		 */
+		slurm_attr_init(&thread_attr);
+		while (pthread_create(&slurmctld_config.thread_id_sched,
+				      &thread_attr, slurmctld_sched_agent,
+				      NULL)) {
+			error("pthread_create %m");
+			sleep(1);
+		}
+		slurm_attr_destroy(&thread_attr);
+
 		/*
 		 * create attached thread for node power management
   		 */
@@ -578,6 +595,8 @@ int main(int argc, char *argv[])
 
 		/* termination of controller */
 		slurm_priority_fini();
+		shutdown_job_scheduler();
+		pthread_join(slurmctld_config.thread_id_sched, NULL);
 		shutdown_state_save();
 		pthread_join(slurmctld_config.thread_id_sig,  NULL);
 		pthread_join(slurmctld_config.thread_id_rpc,  NULL);
@@ -650,6 +669,9 @@ int main(int argc, char *argv[])
 	purge_front_end_state();
 	resv_fini();
 	trigger_fini();
+	snapshot_fini();
+	job_delta_fini();
+	rpc_class_fini();
 	dir_name = slurm_get_state_save_location();
 	assoc_mgr_fini(dir_name);
 	xfree(dir_name);
@@ -779,8 +801,11 @@ static int _reconfigure_slurm(void)
 	assoc_mgr_set_missing_uids();
 	start_power_mgr(&slurmctld_config.thread_id_power);
 	trigger_reconfig();
+	rpc_class_reconfig();
+	agent_reconfig();
+	reg_queue_reconfig();
 	priority_g_reconfig();          /* notify priority plugin too */
-	schedule(0);			/* has its own locks */
+	queue_job_scheduler(0);
 	save_all_state();
 
 	return rc;
@@ -862,6 +887,7 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	pthread_attr_t thread_attr_rpc_req;
 	int no_thread;
 	int fd_next = 0, i, nports;
+	bool use_pool;
 	fd_set rfds;
 	connection_arg_t *conn_arg = NULL;
 	/* Locks: Read config */
@@ -918,10 +944,25 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sigarray);
 
+	/* Load the RPC admission class limits, agent and registration
+	 * queue options */
+	rpc_class_reconfig();
+	agent_reconfig();
+	reg_queue_reconfig();
+
+	/*
+	 * With SlurmctldParameters=rpc_pool, connections are accepted
+	 * using epoll and serviced by a fixed pool of worker threads.
+	 * rpc_pool_run() returns only upon shutdown.
+	 */
+	use_pool = rpc_pool_configured();
+	if (use_pool)
+		rpc_pool_run(sockfd, nports);
+
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
-	while (_wait_for_server_thread()) {
+	while (!use_pool && _wait_for_server_thread()) {
 		int max_fd = -1;
 		FD_ZERO(&rfds);
 		for (i=0; i<nports; i++) {
@@ -1019,9 +1060,11 @@ static void *_service_connection(void *arg)
 		/* process the request */
 		slurmctld_req(msg);
 	}
-	if ((conn->newsockfd >= 0)
-	    && slurm_close_accepted_conn(conn->newsockfd) < 0)
-		error ("close(%d): %m",  conn->newsockfd);
+	/* slurmctld_req() clears msg->conn_fd if it kept the connection
+	 * open to reply later */
+	if ((msg->conn_fd >= 0)
+	    && slurm_close_accepted_conn(msg->conn_fd) < 0)
+		error ("close(%d): %m",  msg->conn_fd);
 
 cleanup:
 	slurm_free_msg(msg);
@@ -1084,6 +1127,22 @@ static void _free_server_thread(void)
 	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
 }
 
+/* server_thread_decr - stop counting an RPC as a server thread, while it
+ *	waits for admission or once done */
+extern void server_thread_decr(void)
+{
+	_free_server_thread();
+}
+
+/* server_thread_incr - count an RPC as a server thread again, even if
+ *	above MAX_SERVER_THREADS */
+extern void server_thread_incr(void)
+{
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	slurmctld_config.server_thread_count++;
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+}
+
 static int _accounting_cluster_ready()
 {
 	struct node_record *node_ptr;
@@ -1465,8 +1524,7 @@ static void *_slurmctld_background(void *no_data)
 		if (difftime(now, last_sched_time) >= PERIODIC_SCHEDULE) {
 			now = time(NULL);
 			last_sched_time = now;
-			if (schedule(INFINITE))
-				last_checkpoint_time = 0; /* force state save */
+			queue_job_scheduler(INFINITE);
 			set_job_elig_time();
 		}
 
@@ -50,6 +50,7 @@
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
@@ -777,6 +778,7 @@ extern void sync_front_end_state(void)
 				      job_ptr->batch_host, job_ptr->job_id);
 				job_ptr->job_state = JOB_NODE_FAIL |
 						     JOB_COMPLETING;
+				job_index_update(job_ptr);
 			} else if (job_ptr->front_end_ptr == NULL) {
 				info("front end node %s has vanished",
 				     job_ptr->batch_host);
@@ -0,0 +1,460 @@
+/*****************************************************************************\
+ *  job_delta.c - track job modification sequence numbers and pack only
+ *	the jobs changed since a client's last request
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Job records are modified in many places, not all of which could
+ * reliably be made to note the change. Instead, when a delta is requested
+ * after slurmctld job state may have changed, every job is packed once and
+ * compared with the packed record kept from the previous pass. Jobs whose
+ * record differs are assigned the next modification sequence number and
+ * jobs which are no longer reported are added to a list of purged jobs.
+ * The cost of that pass is shared by all clients; each request then only
+ * copies the records with a sequence number above the client's.
+ *
+ * Records are packed with SHOW_ALL and without SHOW_DETAIL, so deltas are
+ * only offered when that content is what the requester would see. Other
+ * requests (PrivateData=jobs, hidden or group restricted partitions
+ * without SHOW_ALL, SHOW_DETAIL or older clients) get all jobs packed for
+ * them and a delta_id of zero, so their next request is also complete.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <string.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/job_delta.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+
+/* Purged job IDs kept for clients which are behind. A client older than
+ * the oldest discarded entry gets all jobs. */
+#define DELTA_PURGE_MAX		10000
+
+typedef struct delta_rec {
+	uint32_t job_id;
+	uint32_t mod_seq;		/* delta_seq when last changed */
+	uint32_t pass;			/* last refresh pass seeing job */
+	char *data;			/* packed job record */
+	uint32_t size;
+	struct delta_rec *hash_next;
+	struct delta_rec *prev, *next;	/* ordered by mod_seq */
+} delta_rec_t;
+
+static pthread_mutex_t delta_lock = PTHREAD_MUTEX_INITIALIZER;
+static delta_rec_t **hash_table = NULL;
+static uint32_t hash_size = 0;
+static delta_rec_t *rec_head = NULL, *rec_tail = NULL;
+static uint32_t rec_cnt = 0;
+static uint32_t delta_id = 0;		/* slurmctld instance */
+static uint32_t delta_seq = 0;		/* latest modification sequence */
+static uint32_t pass_cnt = 0;
+static uint32_t *purge_job_id = NULL;	/* ordered by purge_seq */
+static uint32_t *purge_seq = NULL;
+static uint32_t purge_cnt = 0;
+static uint32_t purge_floor = 0;	/* seq of newest discarded purge */
+
+/* State when the records were last refreshed */
+static bool refreshed = false;
+static uint32_t refresh_epoch;
+static time_t refresh_time;
+static time_t refresh_stamps[2];
+static bool shared_all;			/* records valid for SHOW_ALL */
+static bool shared_default;		/* records valid without SHOW_ALL */
+
+/* Test if the records may be out of date, delta_lock must be held */
+static bool _need_refresh(void)
+{
+	if (!refreshed)
+		return true;
+	if (get_write_epoch() == refresh_epoch)
+		return false;
+	/* As in state_snapshot.c, a change in the second of the last
+	 * refresh may not be reflected in last_job_update */
+	if ((last_job_update  != refresh_stamps[0]) ||
+	    (last_part_update != refresh_stamps[1]) ||
+	    (last_job_update  >= refresh_time) ||
+	    (last_part_update >= refresh_time))
+		return true;
+	return false;
+}
+
+static delta_rec_t *_find_rec(uint32_t job_id)
+{
+	delta_rec_t *rec;
+
+	for (rec = hash_table[job_id % hash_size]; rec; rec = rec->hash_next) {
+		if (rec->job_id == job_id)
+			return rec;
+	}
+	return NULL;
+}
+
+static void _hash_add(delta_rec_t *rec)
+{
+	uint32_t inx = rec->job_id % hash_size;
+
+	rec->hash_next = hash_table[inx];
+	hash_table[inx] = rec;
+}
+
+static void _hash_remove(delta_rec_t *rec)
+{
+	delta_rec_t **rec_pptr = &hash_table[rec->job_id % hash_size];
+
+	while (*rec_pptr) {
+		if (*rec_pptr == rec) {
+			*rec_pptr = rec->hash_next;
+			return;
+		}
+		rec_pptr = &(*rec_pptr)->hash_next;
+	}
+}
+
+/* Size the hash table for MaxJobCount, rebuilding it if that changed */
+static void _rehash(void)
+{
+	uint32_t new_size = MAX(slurmctld_conf.max_job_cnt, 1024);
+	delta_rec_t *rec;
+
+	if (new_size == hash_size)
+		return;
+	xfree(hash_table);
+	hash_size = new_size;
+	hash_table = xmalloc(sizeof(delta_rec_t *) * hash_size);
+	for (rec = rec_head; rec; rec = rec->next)
+		_hash_add(rec);
+}
+
+static void _list_remove(delta_rec_t *rec)
+{
+	if (rec->prev)
+		rec->prev->next = rec->next;
+	else
+		rec_head = rec->next;
+	if (rec->next)
+		rec->next->prev = rec->prev;
+	else
+		rec_tail = rec->prev;
+	rec->prev = rec->next = NULL;
+}
+
+static void _list_append(delta_rec_t *rec)
+{
+	rec->prev = rec_tail;
+	rec->next = NULL;
+	if (rec_tail)
+		rec_tail->next = rec;
+	else
+		rec_head = rec;
+	rec_tail = rec;
+}
+
+static void _add_purge(uint32_t job_id, uint32_t seq)
+{
+	uint32_t drop;
+
+	if (purge_cnt >= DELTA_PURGE_MAX) {
+		drop = DELTA_PURGE_MAX / 2;
+		purge_floor = purge_seq[drop - 1];
+		purge_cnt -= drop;
+		memmove(purge_job_id, purge_job_id + drop,
+			sizeof(uint32_t) * purge_cnt);
+		memmove(purge_seq, purge_seq + drop,
+			sizeof(uint32_t) * purge_cnt);
+	}
+	if (purge_job_id == NULL) {
+		purge_job_id = xmalloc(sizeof(uint32_t) * DELTA_PURGE_MAX);
+		purge_seq    = xmalloc(sizeof(uint32_t) * DELTA_PURGE_MAX);
+	}
+	purge_job_id[purge_cnt] = job_id;
+	purge_seq[purge_cnt]    = seq;
+	purge_cnt++;
+}
+
+/*
+ * Pack every job and compare with the records of the previous pass.
+ * Config read, job read and partition read locks and delta_lock must be
+ * held.
+ */
+static void _refresh(void)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	delta_rec_t *rec, *next;
+	uint32_t new_seq = delta_seq + 1, size;
+	bool changed = false;
+	time_t min_age = 0, now = time(NULL);
+	Buf buffer;
+	DEF_TIMERS;
+
+	START_TIMER;
+	if (delta_id == 0)
+		delta_id = (uint32_t) now;
+	refresh_epoch = get_write_epoch();
+	refresh_time = now;
+	refresh_stamps[0] = last_job_update;
+	refresh_stamps[1] = last_part_update;
+	shared_all = !(slurmctld_conf.private_data & PRIVATE_DATA_JOBS);
+	shared_default = shared_all && part_filter_shared();
+	refreshed = true;
+
+	_rehash();
+	pass_cnt++;
+	if (slurmctld_conf.min_job_age > 0)
+		min_age = now - slurmctld_conf.min_job_age;
+
+	buffer = init_buf(BUF_SIZE);
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		/* Same test as pack_all_jobs() */
+		if ((min_age > 0) && (job_ptr->end_time < min_age) &&
+		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
+			continue;
+
+		set_buf_offset(buffer, 0);
+		pack_job(job_ptr, SHOW_ALL, buffer, SLURM_PROTOCOL_VERSION,
+			 (uid_t) 0);
+		size = get_buf_offset(buffer);
+
+		rec = _find_rec(job_ptr->job_id);
+		if (rec == NULL) {
+			rec = xmalloc(sizeof(delta_rec_t));
+			rec->job_id = job_ptr->job_id;
+			_hash_add(rec);
+			rec_cnt++;
+		} else if ((rec->size == size) &&
+			   !memcmp(rec->data, get_buf_data(buffer), size)) {
+			rec->pass = pass_cnt;
+			continue;
+		} else {
+			_list_remove(rec);
+			xfree(rec->data);
+		}
+		rec->data = xmalloc(size);
+		memcpy(rec->data, get_buf_data(buffer), size);
+		rec->size = size;
+		rec->mod_seq = new_seq;
+		rec->pass = pass_cnt;
+		_list_append(rec);
+		changed = true;
+	}
+	list_iterator_destroy(job_iterator);
+	free_buf(buffer);
+
+	for (rec = rec_head; rec; rec = next) {
+		next = rec->next;
+		if (rec->pass == pass_cnt)
+			continue;
+		_add_purge(rec->job_id, new_seq);
+		_list_remove(rec);
+		_hash_remove(rec);
+		xfree(rec->data);
+		xfree(rec);
+		rec_cnt--;
+		changed = true;
+	}
+
+	if (changed)
+		delta_seq = new_seq;
+	END_TIMER2("job_delta_refresh");
+	debug3("job_delta: refreshed %u jobs, seq=%u %s",
+	       rec_cnt, delta_seq, TIME_STR);
+}
+
+/* Pack all jobs as seen by this user, not usable as a delta base */
+static void _pack_private(job_info_delta_request_msg_t *req, uid_t uid,
+			  uint16_t protocol_version,
+			  char **buffer_ptr, int *buffer_size)
+{
+	/* Locks: Read config job, write partition (for hiding) */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK };
+	char *dump = NULL;
+	int dump_size = 0;
+	Buf buffer;
+
+	lock_slurmctld(job_read_lock);
+	pack_all_jobs(&dump, &dump_size, req->show_flags, uid,
+		      protocol_version, NULL);
+	unlock_slurmctld_unchanged(job_read_lock);
+
+	buffer = init_buf(dump_size + 64);
+	pack32((uint32_t) 0, buffer);	/* delta_id */
+	pack32((uint32_t) 0, buffer);	/* delta_seq */
+	pack16((uint16_t) 1, buffer);	/* full */
+	packmem_array(dump, dump_size, buffer);
+	pack32((uint32_t) 0, buffer);	/* purged_cnt */
+	xfree(dump);
+
+	*buffer_size = get_buf_offset(buffer);
+	*buffer_ptr = xfer_buf_data(buffer);
+}
+
+/*
+ * job_delta_pack - pack a RESPONSE_JOB_INFO_DELTA body with the jobs
+ *	changed or purged since the sequence number in the request
+ * IN req - the request
+ * IN uid - user making the request
+ * IN protocol_version - protocol version of the client
+ * OUT buffer_ptr - the pointer is set to the allocated buffer
+ * OUT buffer_size - set to size of the buffer in bytes
+ * RET SLURM_SUCCESS or SLURM_NO_CHANGE_IN_DATA (no buffer returned)
+ * NOTE: Takes slurmctld locks as needed, call with none held
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern int job_delta_pack(job_info_delta_request_msg_t *req, uid_t uid,
+			  uint16_t protocol_version,
+			  char **buffer_ptr, int *buffer_size)
+{
+	/* Locks: Read config, job and partition */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK };
+	delta_rec_t *rec;
+	uint32_t jobs_packed = 0, tmp_offset, i;
+	uint16_t full;
+	bool shared;
+	Buf buffer;
+
+	*buffer_ptr = NULL;
+	*buffer_size = 0;
+
+	slurm_mutex_lock(&delta_lock);
+	if (_need_refresh()) {
+		/* slurmctld locks are never requested holding delta_lock */
+		slurm_mutex_unlock(&delta_lock);
+		lock_slurmctld(job_read_lock);
+		slurm_mutex_lock(&delta_lock);
+		if (_need_refresh())
+			_refresh();
+		unlock_slurmctld(job_read_lock);
+	}
+
+	if (req->show_flags & SHOW_ALL)
+		shared = shared_all;
+	else
+		shared = shared_default;
+	if (!shared || (req->show_flags & SHOW_DETAIL) ||
+	    (protocol_version != SLURM_PROTOCOL_VERSION)) {
+		slurm_mutex_unlock(&delta_lock);
+		_pack_private(req, uid, protocol_version,
+			      buffer_ptr, buffer_size);
+		return SLURM_SUCCESS;
+	}
+
+	if ((req->delta_id == delta_id) && (req->delta_seq == delta_seq)) {
+		slurm_mutex_unlock(&delta_lock);
+		return SLURM_NO_CHANGE_IN_DATA;
+	}
+	full = ((req->delta_id != delta_id) || (req->delta_seq > delta_seq) ||
+		(req->delta_seq < purge_floor));
+
+	buffer = init_buf(BUF_SIZE);
+	pack32(delta_id, buffer);
+	pack32(delta_seq, buffer);
+	pack16(full, buffer);
+
+	/* Same layout as pack_all_jobs(), record count set below */
+	pack32(jobs_packed, buffer);
+	pack_time(refresh_time, buffer);
+	if (full)
+		rec = rec_head;
+	else {
+		/* Records are ordered by mod_seq, find the oldest one
+		 * changed after the client's copy */
+		for (rec = rec_tail; rec && rec->prev &&
+		     (rec->prev->mod_seq > req->delta_seq); rec = rec->prev)
+			;
+		if (rec && (rec->mod_seq <= req->delta_seq))
+			rec = NULL;
+	}
+	for ( ; rec; rec = rec->next) {
+		packmem_array(rec->data, rec->size, buffer);
+		jobs_packed++;
+	}
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 10);	/* after delta header */
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	if (full)
+		pack32((uint32_t) 0, buffer);
+	else {
+		for (i = purge_cnt; i > 0; i--) {
+			if (purge_seq[i - 1] <= req->delta_seq)
+				break;
+		}
+		pack32_array(purge_job_id + i, purge_cnt - i, buffer);
+	}
+	slurm_mutex_unlock(&delta_lock);
+
+	*buffer_size = get_buf_offset(buffer);
+	*buffer_ptr = xfer_buf_data(buffer);
+	return SLURM_SUCCESS;
+}
+
+/* job_delta_fini - free all job delta records (memory leak testing) */
+extern void job_delta_fini(void)
+{
+	delta_rec_t *rec, *next;
+
+	slurm_mutex_lock(&delta_lock);
+	for (rec = rec_head; rec; rec = next) {
+		next = rec->next;
+		xfree(rec->data);
+		xfree(rec);
+	}
+	rec_head = rec_tail = NULL;
+	rec_cnt = 0;
+	xfree(hash_table);
+	hash_size = 0;
+	xfree(purge_job_id);
+	xfree(purge_seq);
+	purge_cnt = 0;
+	refreshed = false;
+	slurm_mutex_unlock(&delta_lock);
+}
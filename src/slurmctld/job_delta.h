@@ -0,0 +1,61 @@
+/*****************************************************************************\
+ *  job_delta.h - track job modification sequence numbers and pack only
+ *	the jobs changed since a client's last request
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_JOB_DELTA_H
+#define _HAVE_JOB_DELTA_H
+
+#include "src/common/slurm_protocol_defs.h"
+
+/*
+ * job_delta_pack - pack a RESPONSE_JOB_INFO_DELTA body with the jobs
+ *	changed or purged since the sequence number in the request
+ * IN req - the request
+ * IN uid - user making the request
+ * IN protocol_version - protocol version of the client
+ * OUT buffer_ptr - the pointer is set to the allocated buffer
+ * OUT buffer_size - set to size of the buffer in bytes
+ * RET SLURM_SUCCESS or SLURM_NO_CHANGE_IN_DATA (no buffer returned)
+ * NOTE: Takes slurmctld locks as needed, call with none held
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern int job_delta_pack(job_info_delta_request_msg_t *req, uid_t uid,
+			  uint16_t protocol_version,
+			  char **buffer_ptr, int *buffer_size);
+
+/* job_delta_fini - free all job delta records (memory leak testing) */
+extern void job_delta_fini(void);
+
+#endif /* !_HAVE_JOB_DELTA_H */
@@ -0,0 +1,235 @@
+/*****************************************************************************\
+ *  job_hash.c - job_id to job record lookup table
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * A chained table. Its bucket count is a power of 2 and a job's bucket is
+ * its job ID masked by the bucket count. Job IDs are assigned in sequence,
+ * so while the live job IDs span no more than the bucket count every chain
+ * holds at most one job, and a lookup reads one bucket and then the job
+ * record its caller goes on to use anyway. Masking rather than taking the
+ * job ID modulo MaxJobCount also avoids a division on every lookup.
+ *
+ * Once the job count exceeds three quarters of the bucket count, a table
+ * with twice as many buckets is allocated and the old one kept. Each later
+ * add or remove then moves the chains of JOB_HASH_MIGRATE buckets of the
+ * old table into the new one, so no single call pays for rehashing every
+ * job. Until that is done, lookups search the new table then the old one.
+ * Lookups never modify either table.
+ *
+ * Open addressing with the job ID stored next to the record pointer was
+ * tried first. With at least 12 bytes per slot and a quarter or more of
+ * the slots empty, its footprint is twice that of the bucket array or more.
+ * At 100k and 1M jobs fewer of its slots stay cached, and its hits were
+ * slower than those of the chained table it replaced.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "slurm/slurm.h"
+
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/job_hash.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define JOB_HASH_MIN_SIZE	1024
+#define JOB_HASH_MIGRATE	64
+
+typedef struct job_table {
+	uint32_t size;			/* bucket count, a power of 2 */
+	uint32_t count;			/* job records in the table */
+	struct job_record **bucket;
+} job_table_t;
+
+static job_table_t *cur_table = NULL;	/* receives all new entries */
+static job_table_t *old_table = NULL;	/* being moved into cur_table */
+static uint32_t migrate_inx = 0;	/* next bucket of old_table to move */
+
+#define JOB_HASH_INX(_table, _job_id) \
+	((_job_id) & ((_table)->size - 1))
+
+static job_table_t *_table_create(uint32_t min_size)
+{
+	job_table_t *table;
+
+	table = xmalloc(sizeof(job_table_t));
+	table->size = JOB_HASH_MIN_SIZE;
+	while ((table->size < min_size) && (table->size < 0x80000000))
+		table->size <<= 1;
+	table->bucket = xmalloc(sizeof(struct job_record *) * table->size);
+	return table;
+}
+
+static void _table_destroy(job_table_t *table)
+{
+	if (table == NULL)
+		return;
+	xfree(table->bucket);
+	xfree(table);
+}
+
+static struct job_record *_table_find(job_table_t *table, uint32_t job_id)
+{
+	struct job_record *job_ptr;
+
+	job_ptr = table->bucket[JOB_HASH_INX(table, job_id)];
+	while (job_ptr) {
+		if (job_ptr->job_id == job_id)
+			return job_ptr;
+		job_ptr = job_ptr->job_next;
+	}
+	return NULL;
+}
+
+static void _table_insert(job_table_t *table, struct job_record *job_ptr)
+{
+	uint32_t inx = JOB_HASH_INX(table, job_ptr->job_id);
+
+	job_ptr->job_next = table->bucket[inx];
+	table->bucket[inx] = job_ptr;
+	table->count++;
+}
+
+/* Unlink and return the record of job_id, NULL if not in the table */
+static struct job_record *_table_remove(job_table_t *table, uint32_t job_id)
+{
+	struct job_record **job_pptr, *job_ptr;
+
+	job_pptr = &table->bucket[JOB_HASH_INX(table, job_id)];
+	while ((job_ptr = *job_pptr)) {
+		if (job_ptr->job_id == job_id) {
+			*job_pptr = job_ptr->job_next;
+			job_ptr->job_next = NULL;
+			table->count--;
+			return job_ptr;
+		}
+		job_pptr = &job_ptr->job_next;
+	}
+	return NULL;
+}
+
+/* Move the chains of up to bucket_cnt buckets of old_table into cur_table */
+static void _migrate(uint32_t bucket_cnt)
+{
+	struct job_record *job_ptr;
+
+	while (old_table && bucket_cnt--) {
+		if ((migrate_inx >= old_table->size) ||
+		    (old_table->count == 0)) {
+			_table_destroy(old_table);
+			old_table = NULL;
+			break;
+		}
+		while ((job_ptr = old_table->bucket[migrate_inx])) {
+			old_table->bucket[migrate_inx] = job_ptr->job_next;
+			old_table->count--;
+			_table_insert(cur_table, job_ptr);
+		}
+		migrate_inx++;
+	}
+}
+
+/* Start moving the entries into a table with twice as many buckets */
+static void _resize(void)
+{
+	if (old_table)		/* finish the previous resize first */
+		_migrate(NO_VAL);
+	debug2("job_hash: resizing table of %u buckets with %u entries",
+	       cur_table->size, cur_table->count);
+	old_table = cur_table;
+	cur_table = _table_create(old_table->size * 2);
+	migrate_inx = 0;
+}
+
+extern void job_hash_init(uint32_t size_hint)
+{
+	if (cur_table)
+		return;
+	cur_table = _table_create(size_hint + (size_hint / 3));
+}
+
+extern void job_hash_fini(void)
+{
+	_table_destroy(cur_table);
+	_table_destroy(old_table);
+	cur_table = old_table = NULL;
+	migrate_inx = 0;
+}
+
+extern void job_hash_add(uint32_t job_id, struct job_record *job_ptr)
+{
+	if (job_id != job_ptr->job_id) {
+		error("job_hash_add: job_id %u does not match record %u",
+		      job_id, job_ptr->job_id);
+		return;
+	}
+	if (cur_table == NULL)
+		job_hash_init(0);
+
+	_migrate(JOB_HASH_MIGRATE);
+	if ((cur_table->count + 1) * 4 > cur_table->size * 3)
+		_resize();
+	_table_insert(cur_table, job_ptr);
+}
+
+extern struct job_record *job_hash_remove(uint32_t job_id)
+{
+	struct job_record *job_ptr;
+
+	if (cur_table == NULL)
+		return NULL;
+
+	_migrate(JOB_HASH_MIGRATE);
+	job_ptr = _table_remove(cur_table, job_id);
+	if ((job_ptr == NULL) && old_table)
+		job_ptr = _table_remove(old_table, job_id);
+	return job_ptr;
+}
+
+extern struct job_record *job_hash_find(uint32_t job_id)
+{
+	struct job_record *job_ptr;
+
+	if (cur_table == NULL)
+		return NULL;
+
+	job_ptr = _table_find(cur_table, job_id);
+	if ((job_ptr == NULL) && old_table)
+		job_ptr = _table_find(old_table, job_id);
+	return job_ptr;
+}
@@ -0,0 +1,78 @@
+/*****************************************************************************\
+ *  job_hash.h - job_id to job record lookup table
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_JOB_HASH_H
+#define _HAVE_JOB_HASH_H
+
+#include <inttypes.h>
+
+struct job_record;
+
+/*
+ * job_hash_init - create the job hash table if it does not yet exist
+ * IN size_hint - expected number of job records (e.g. MaxJobCount), the
+ *	table resizes itself as needed so this only sets its initial size
+ */
+extern void job_hash_init(uint32_t size_hint);
+
+/* job_hash_fini - free the job hash table */
+extern void job_hash_fini(void);
+
+/*
+ * job_hash_add - add a job record to the table
+ * IN job_id - job ID of job_ptr, must not already be in the table
+ * IN job_ptr - job record, its job_next field links the table chains
+ * NOTE: Write lock on jobs must be held
+ */
+extern void job_hash_add(uint32_t job_id, struct job_record *job_ptr);
+
+/*
+ * job_hash_remove - remove a job record from the table
+ * IN job_id - job ID
+ * RET the job record removed or NULL if job_id was not in the table
+ * NOTE: Write lock on jobs must be held
+ */
+extern struct job_record *job_hash_remove(uint32_t job_id);
+
+/*
+ * job_hash_find - return the job record with the given job_id
+ * IN job_id - job ID
+ * RET pointer to the job record or NULL if not found
+ * NOTE: Read lock on jobs must be held. The table is not modified by
+ *	lookups, so any number of threads may search it concurrently.
+ */
+extern struct job_record *job_hash_find(uint32_t job_id);
+
+#endif /* !_HAVE_JOB_HASH_H */
@@ -0,0 +1,570 @@
+/*****************************************************************************\
+ *  job_index.c - secondary indexes of job records by user, partition and
+ *	job state
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Each job record has one job_index_rec_t, linked into the chain of its
+ * user's hash bucket and into the chain of its base job state. For each
+ * partition the job uses or is queued in, a job_part_link_t is linked into
+ * a chain headed by that partition record. The indexed values are kept in
+ * the job_index_rec_t so that job_index_update() can tell which chains to
+ * move a job between, and the chains are doubly linked so that doing so
+ * does not depend upon their length.
+ *
+ * Pending jobs are also linked into a skip list kept in scheduling order:
+ * jobs with a reservation first, then by decreasing priority, then in the
+ * order they became pending. The sort key is copied into the
+ * job_index_rec_t when the job is linked, so that job_index_update() can
+ * find the job's old position and move it when its priority changes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/job_index.h"
+#include "src/slurmctld/slurmctld.h"
+
+/* With one level in four promoted, 16 levels cover some 4 billion jobs */
+#define PRIO_MAX_LEVEL	16
+
+#define USER_HASH_SIZE	1024
+#define USER_HASH_INX(_uid)	((_uid) % USER_HASH_SIZE)
+
+/* Jobs with an unknown base state are indexed under JOB_END */
+#define STATE_INX(_state)	\
+	(((_state) & JOB_STATE_BASE) < JOB_END ? \
+	 ((_state) & JOB_STATE_BASE) : JOB_END)
+
+struct job_part_link {
+	struct job_record *job_ptr;
+	struct part_record *part_ptr;
+	struct job_part_link *prev;	/* links of the same partition */
+	struct job_part_link *next;
+	struct job_part_link *job_next;	/* links of the same job */
+};
+
+struct job_index_rec {
+	struct job_record *job_ptr;
+	uint32_t user_id;		/* indexed user_id */
+	uint16_t state_inx;		/* indexed base job_state */
+	struct job_index_rec *user_prev, *user_next;
+	struct job_index_rec *state_prev, *state_next;
+	struct job_part_link *part_links;
+	uint32_t prio;			/* indexed priority */
+	bool prio_resv;			/* indexed (resv_id != 0) */
+	uint32_t prio_seq;		/* order in which the job became pending */
+	uint16_t prio_level;		/* skip list levels, 0 if not linked */
+	struct job_index_rec *prio_next[PRIO_MAX_LEVEL];
+};
+
+static struct job_index_rec *user_hash[USER_HASH_SIZE];
+/* State chains are kept in the order jobs entered the state, so that
+ * pending jobs of equal priority are still found in submission order */
+static struct job_index_rec *state_head[JOB_END + 1];
+static struct job_index_rec *state_tail[JOB_END + 1];
+static struct job_index_rec *prio_head[PRIO_MAX_LEVEL];
+static uint32_t prio_seq = 0;
+static uint32_t prio_rand = 1;
+
+static void _user_link(struct job_index_rec *rec)
+{
+	struct job_index_rec **head = &user_hash[USER_HASH_INX(rec->user_id)];
+
+	rec->user_prev = NULL;
+	rec->user_next = *head;
+	if (*head)
+		(*head)->user_prev = rec;
+	*head = rec;
+}
+
+static void _user_unlink(struct job_index_rec *rec)
+{
+	if (rec->user_prev)
+		rec->user_prev->user_next = rec->user_next;
+	else
+		user_hash[USER_HASH_INX(rec->user_id)] = rec->user_next;
+	if (rec->user_next)
+		rec->user_next->user_prev = rec->user_prev;
+	rec->user_prev = rec->user_next = NULL;
+}
+
+static void _state_link(struct job_index_rec *rec)
+{
+	struct job_index_rec **tail = &state_tail[rec->state_inx];
+
+	rec->state_prev = *tail;
+	rec->state_next = NULL;
+	if (*tail)
+		(*tail)->state_next = rec;
+	else
+		state_head[rec->state_inx] = rec;
+	*tail = rec;
+}
+
+static void _state_unlink(struct job_index_rec *rec)
+{
+	if (rec->state_prev)
+		rec->state_prev->state_next = rec->state_next;
+	else
+		state_head[rec->state_inx] = rec->state_next;
+	if (rec->state_next)
+		rec->state_next->state_prev = rec->state_prev;
+	else
+		state_tail[rec->state_inx] = rec->state_prev;
+	rec->state_prev = rec->state_next = NULL;
+}
+
+/* Return true if rec1 is to be scheduled before rec2 */
+static bool _prio_before(struct job_index_rec *rec1,
+			 struct job_index_rec *rec2)
+{
+	if (rec1->prio_resv != rec2->prio_resv)
+		return rec1->prio_resv;
+	if (rec1->prio != rec2->prio)
+		return (rec1->prio > rec2->prio);
+	/* Sequence numbers wrap, compare their distance */
+	return ((int32_t) (rec1->prio_seq - rec2->prio_seq) < 0);
+}
+
+/* Fill in update[] with the address of the link to rec, or to where rec
+ * belongs, at each level of the skip list */
+static void _prio_search(struct job_index_rec *rec,
+			 struct job_index_rec **update[])
+{
+	struct job_index_rec **fwd = prio_head;
+	int level;
+
+	for (level = PRIO_MAX_LEVEL - 1; level >= 0; level--) {
+		while (fwd[level] && _prio_before(fwd[level], rec))
+			fwd = fwd[level]->prio_next;
+		update[level] = &fwd[level];
+	}
+}
+
+static void _prio_link(struct job_index_rec *rec)
+{
+	struct job_index_rec **update[PRIO_MAX_LEVEL];
+	struct job_record *job_ptr = rec->job_ptr;
+	int level;
+
+	rec->prio      = job_ptr->priority;
+	rec->prio_resv = (job_ptr->resv_id != 0);
+	/* A simple LCG, leaving random() to the rest of slurmctld */
+	rec->prio_level = 1;
+	prio_rand = prio_rand * 1103515245 + 12345;
+	while ((rec->prio_level < PRIO_MAX_LEVEL) &&
+	       (((prio_rand >> (2 * rec->prio_level + 4)) & 3) == 0))
+		rec->prio_level++;
+
+	_prio_search(rec, update);
+	for (level = 0; level < rec->prio_level; level++) {
+		rec->prio_next[level] = *update[level];
+		*update[level] = rec;
+	}
+}
+
+static void _prio_unlink(struct job_index_rec *rec)
+{
+	struct job_index_rec **update[PRIO_MAX_LEVEL];
+	int level;
+
+	if (rec->prio_level == 0)
+		return;
+	_prio_search(rec, update);
+	for (level = 0; level < rec->prio_level; level++) {
+		if (*update[level] != rec) {
+			error("job_index: job %u missing from priority "
+			      "list", rec->job_ptr->job_id);
+			break;
+		}
+		*update[level] = rec->prio_next[level];
+		rec->prio_next[level] = NULL;
+	}
+	rec->prio_level = 0;
+}
+
+/* Test if a job's priority list entry matches its state and sort key */
+static bool _prio_current(struct job_index_rec *rec)
+{
+	struct job_record *job_ptr = rec->job_ptr;
+
+	if (rec->state_inx != JOB_PENDING)
+		return (rec->prio_level == 0);
+	return ((rec->prio_level != 0) &&
+		(rec->prio == job_ptr->priority) &&
+		(rec->prio_resv == (job_ptr->resv_id != 0)));
+}
+
+static void _part_unlink(struct job_part_link *link)
+{
+	if (link->prev)
+		link->prev->next = link->next;
+	else
+		link->part_ptr->job_links = link->next;
+	if (link->next)
+		link->next->prev = link->prev;
+}
+
+/* Unlink and free all partition links of a job */
+static void _part_unlink_all(struct job_index_rec *rec)
+{
+	struct job_part_link *link, *next;
+
+	for (link = rec->part_links; link; link = next) {
+		next = link->job_next;
+		_part_unlink(link);
+		xfree(link);
+	}
+	rec->part_links = NULL;
+}
+
+static bool _part_linked(struct job_index_rec *rec,
+			 struct part_record *part_ptr)
+{
+	struct job_part_link *link;
+
+	for (link = rec->part_links; link; link = link->job_next) {
+		if (link->part_ptr == part_ptr)
+			return true;
+	}
+	return false;
+}
+
+static void _part_link(struct job_index_rec *rec,
+		       struct part_record *part_ptr)
+{
+	struct job_part_link *link;
+
+	if ((part_ptr == NULL) || _part_linked(rec, part_ptr))
+		return;
+	link = xmalloc(sizeof(struct job_part_link));
+	link->job_ptr  = rec->job_ptr;
+	link->part_ptr = part_ptr;
+	link->next = part_ptr->job_links;
+	if (link->next)
+		link->next->prev = link;
+	part_ptr->job_links = link;
+	link->job_next = rec->part_links;
+	rec->part_links = link;
+}
+
+static int _list_find_ptr(void *x, void *key)
+{
+	return (x == key);
+}
+
+/* Test if a job uses or is queued in a partition */
+static bool _part_current(struct job_record *job_ptr,
+			  struct part_record *part_ptr)
+{
+	if (job_ptr->part_ptr == part_ptr)
+		return true;
+	if (job_ptr->part_ptr_list &&
+	    list_find_first(job_ptr->part_ptr_list, _list_find_ptr, part_ptr))
+		return true;
+	return false;
+}
+
+/* Test if a job's partition links match its part_ptr and part_ptr_list */
+static bool _part_links_current(struct job_index_rec *rec)
+{
+	struct job_record *job_ptr = rec->job_ptr;
+	struct job_part_link *link;
+	struct part_record *part_ptr;
+	ListIterator part_iterator;
+	bool current = true;
+
+	for (link = rec->part_links; link; link = link->job_next) {
+		if (!_part_current(job_ptr, link->part_ptr))
+			return false;
+	}
+	if (job_ptr->part_ptr && !_part_linked(rec, job_ptr->part_ptr))
+		return false;
+	if (job_ptr->part_ptr_list) {
+		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+		if (part_iterator == NULL)
+			fatal("list_iterator_create malloc failure");
+		while ((part_ptr = list_next(part_iterator))) {
+			if (!_part_linked(rec, part_ptr)) {
+				current = false;
+				break;
+			}
+		}
+		list_iterator_destroy(part_iterator);
+	}
+	return current;
+}
+
+static void _part_link_all(struct job_index_rec *rec)
+{
+	struct job_record *job_ptr = rec->job_ptr;
+	struct part_record *part_ptr;
+	ListIterator part_iterator;
+
+	_part_link(rec, job_ptr->part_ptr);
+	if (job_ptr->part_ptr_list) {
+		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+		if (part_iterator == NULL)
+			fatal("list_iterator_create malloc failure");
+		while ((part_ptr = list_next(part_iterator)))
+			_part_link(rec, part_ptr);
+		list_iterator_destroy(part_iterator);
+	}
+}
+
+/*
+ * job_index_add - add a new job record to the indexes
+ * IN job_ptr - job record, already in job_list
+ * NOTE: Write lock on jobs must be held
+ */
+extern void job_index_add(struct job_record *job_ptr)
+{
+	struct job_index_rec *rec;
+
+	xassert(job_ptr->index_rec == NULL);
+	rec = xmalloc(sizeof(struct job_index_rec));
+	rec->job_ptr   = job_ptr;
+	rec->user_id   = job_ptr->user_id;
+	rec->state_inx = STATE_INX(job_ptr->job_state);
+	job_ptr->index_rec = rec;
+	_user_link(rec);
+	_state_link(rec);
+	_part_link_all(rec);
+	if (rec->state_inx == JOB_PENDING) {
+		rec->prio_seq = prio_seq++;
+		_prio_link(rec);
+	}
+}
+
+/*
+ * job_index_remove - remove a job record from the indexes
+ * IN job_ptr - job record about to be deleted
+ * NOTE: Write lock on jobs must be held
+ */
+extern void job_index_remove(struct job_record *job_ptr)
+{
+	struct job_index_rec *rec = job_ptr->index_rec;
+
+	if (rec == NULL)
+		return;
+	_user_unlink(rec);
+	_state_unlink(rec);
+	_part_unlink_all(rec);
+	_prio_unlink(rec);
+	xfree(rec);
+	job_ptr->index_rec = NULL;
+}
+
+/*
+ * job_index_update - move a job record to the index entries matching its
+ *	current user_id, base job_state, part_ptr, part_ptr_list, priority
+ *	and resv_id. Call after changing any of them.
+ * IN job_ptr - job record
+ * RET true if any index entry of the job was out of date
+ * NOTE: Write lock on jobs must be held
+ */
+extern bool job_index_update(struct job_record *job_ptr)
+{
+	struct job_index_rec *rec = job_ptr->index_rec;
+	uint16_t state_inx;
+	bool changed = false;
+
+	if (rec == NULL)
+		return false;
+
+	if (rec->user_id != job_ptr->user_id) {
+		_user_unlink(rec);
+		rec->user_id = job_ptr->user_id;
+		_user_link(rec);
+		changed = true;
+	}
+
+	state_inx = STATE_INX(job_ptr->job_state);
+	if (rec->state_inx != state_inx) {
+		_state_unlink(rec);
+		if (state_inx == JOB_PENDING)
+			rec->prio_seq = prio_seq++;
+		rec->state_inx = state_inx;
+		_state_link(rec);
+		changed = true;
+	}
+
+	if (!_prio_current(rec)) {
+		_prio_unlink(rec);
+		if (rec->state_inx == JOB_PENDING)
+			_prio_link(rec);
+		changed = true;
+	}
+
+	if (!_part_links_current(rec)) {
+		_part_unlink_all(rec);
+		_part_link_all(rec);
+		changed = true;
+	}
+
+	return changed;
+}
+
+/*
+ * job_index_part_delete - remove all index entries of a partition record
+ *	which is about to be deleted
+ * IN part_ptr - partition record
+ * NOTE: Write lock on jobs and partitions must be held
+ */
+extern void job_index_part_delete(struct part_record *part_ptr)
+{
+	struct job_part_link *link, **link_pptr;
+	struct job_index_rec *rec;
+
+	while ((link = part_ptr->job_links)) {
+		part_ptr->job_links = link->next;
+		if (link->next)
+			link->next->prev = NULL;
+		rec = link->job_ptr->index_rec;
+		for (link_pptr = &rec->part_links; *link_pptr;
+		     link_pptr = &(*link_pptr)->job_next) {
+			if (*link_pptr == link) {
+				*link_pptr = link->job_next;
+				break;
+			}
+		}
+		xfree(link);
+	}
+}
+
+/*
+ * job_index_user_jobs - build a list of a user's jobs
+ * IN user_id - user ID
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Read lock on jobs must be held
+ */
+extern List job_index_user_jobs(uint32_t user_id)
+{
+	struct job_index_rec *rec;
+	List job_queue;
+
+	job_queue = list_create(NULL);
+	if (job_queue == NULL)
+		fatal("list_create memory allocation failure");
+	for (rec = user_hash[USER_HASH_INX(user_id)]; rec;
+	     rec = rec->user_next) {
+		if (rec->user_id == user_id)
+			list_append(job_queue, rec->job_ptr);
+	}
+	return job_queue;
+}
+
+/*
+ * job_index_part_jobs - build a list of the jobs using or queued in a
+ *	partition, either as part_ptr or as any member of part_ptr_list
+ * IN part_ptr - partition record
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Read lock on jobs and partitions must be held
+ */
+extern List job_index_part_jobs(struct part_record *part_ptr)
+{
+	struct job_part_link *link;
+	List job_queue;
+
+	job_queue = list_create(NULL);
+	if (job_queue == NULL)
+		fatal("list_create memory allocation failure");
+	for (link = part_ptr->job_links; link; link = link->next)
+		list_append(job_queue, link->job_ptr);
+	return job_queue;
+}
+
+/*
+ * job_index_state_jobs - build a list of jobs in a base job state
+ * IN state - base job state (e.g. JOB_PENDING), flags are ignored
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Read lock on jobs must be held
+ */
+extern List job_index_state_jobs(uint16_t state)
+{
+	struct job_index_rec *rec;
+	List job_queue;
+
+	job_queue = list_create(NULL);
+	if (job_queue == NULL)
+		fatal("list_create memory allocation failure");
+	for (rec = state_head[STATE_INX(state)]; rec; rec = rec->state_next)
+		list_append(job_queue, rec->job_ptr);
+	return job_queue;
+}
+
+/*
+ * job_index_prio_jobs - build a list of pending jobs in scheduling order:
+ *	jobs with a reservation first, then by decreasing priority, then in
+ *	the order in which they became pending
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Write lock on jobs must be held, jobs whose priority or resv_id
+ *	changed without a call to job_index_update() are moved first
+ */
+extern List job_index_prio_jobs(void)
+{
+	struct job_index_rec *rec;
+	struct job_record *job_ptr;
+	List job_queue, stale_list = NULL;
+
+	job_queue = list_create(NULL);
+	if (job_queue == NULL)
+		fatal("list_create memory allocation failure");
+	for (rec = prio_head[0]; rec; rec = rec->prio_next[0]) {
+		if (!_prio_current(rec)) {
+			if (stale_list == NULL)
+				stale_list = list_create(NULL);
+			list_append(stale_list, rec->job_ptr);
+		} else if (stale_list == NULL)
+			list_append(job_queue, rec->job_ptr);
+	}
+	if (stale_list == NULL)
+		return job_queue;
+
+	error("job_index: %d jobs changed priority without an index update",
+	      list_count(stale_list));
+	while ((job_ptr = list_pop(stale_list)))
+		job_index_update(job_ptr);
+	list_destroy(stale_list);
+	list_flush(job_queue);
+	for (rec = prio_head[0]; rec; rec = rec->prio_next[0])
+		list_append(job_queue, rec->job_ptr);
+	return job_queue;
+}
@@ -0,0 +1,110 @@
+/*****************************************************************************\
+ *  job_index.h - secondary indexes of job records by user, partition and
+ *	job state
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_JOB_INDEX_H
+#define _HAVE_JOB_INDEX_H
+
+#include "src/common/list.h"
+#include "src/slurmctld/slurmctld.h"
+
+/*
+ * job_index_add - add a new job record to the indexes
+ * IN job_ptr - job record, already in job_list
+ * NOTE: Write lock on jobs must be held
+ */
+extern void job_index_add(struct job_record *job_ptr);
+
+/*
+ * job_index_remove - remove a job record from the indexes
+ * IN job_ptr - job record about to be deleted
+ * NOTE: Write lock on jobs must be held
+ */
+extern void job_index_remove(struct job_record *job_ptr);
+
+/*
+ * job_index_update - move a job record to the index entries matching its
+ *	current user_id, base job_state, part_ptr, part_ptr_list, priority
+ *	and resv_id. Call after changing any of them.
+ * IN job_ptr - job record
+ * RET true if any index entry of the job was out of date
+ * NOTE: Write lock on jobs must be held
+ */
+extern bool job_index_update(struct job_record *job_ptr);
+
+/*
+ * job_index_part_delete - remove all index entries of a partition record
+ *	which is about to be deleted
+ * IN part_ptr - partition record
+ * NOTE: Write lock on jobs and partitions must be held
+ */
+extern void job_index_part_delete(struct part_record *part_ptr);
+
+/*
+ * job_index_user_jobs - build a list of a user's jobs
+ * IN user_id - user ID
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Read lock on jobs must be held
+ */
+extern List job_index_user_jobs(uint32_t user_id);
+
+/*
+ * job_index_part_jobs - build a list of the jobs using or queued in a
+ *	partition, either as part_ptr or as any member of part_ptr_list
+ * IN part_ptr - partition record
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Read lock on jobs and partitions must be held
+ */
+extern List job_index_part_jobs(struct part_record *part_ptr);
+
+/*
+ * job_index_state_jobs - build a list of jobs in a base job state
+ * IN state - base job state (e.g. JOB_PENDING), flags are ignored
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Read lock on jobs must be held
+ */
+extern List job_index_state_jobs(uint16_t state);
+
+/*
+ * job_index_prio_jobs - build a list of pending jobs in scheduling order:
+ *	jobs with a reservation first, then by decreasing priority, then in
+ *	the order in which they became pending
+ * RET list of pointers to job records, free using list_destroy()
+ * NOTE: Write lock on jobs must be held, jobs whose priority or resv_id
+ *	changed without a call to job_index_update() are moved first
+ */
+extern List job_index_prio_jobs(void);
+
+#endif /* !_HAVE_JOB_INDEX_H */
@@ -0,0 +1,602 @@
+/*****************************************************************************\
+ *  job_journal.c - append only journal of job state changes between full
+ *	job state checkpoints
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * With JobStateJournal set, dump_all_job_state() only writes the full
+ * job_state file (the checkpoint) now and then. Other passes pack every
+ * job as before, but only the records which differ from the previous pass
+ * (by a hash kept for each job) and the IDs of jobs no longer saved are
+ * appended as one batch to job_state.journal. Writes then follow the rate
+ * of job changes rather than the job count.
+ *
+ * The journal header names the checkpoint it follows by its header time
+ * and size, so a journal left beside a newer or older job_state file (a
+ * crash during compaction or recovery from job_state.old) is ignored.
+ * Each batch carries its size and checksum and replay stops at the first
+ * incomplete batch. Once the journal grows larger than the checkpoint,
+ * the next pass of the state save thread writes a new checkpoint and
+ * starts an empty journal.
+ *
+ * File layout:
+ *	header: JOB_JOURNAL_VERSION, protocol version, checkpoint time and
+ *		checkpoint size
+ *	batch:	JOB_JOURNAL_MAGIC, payload size, payload checksum, payload
+ *	payload: job_id_sequence, count and IDs of jobs purged, count of
+ *		jobs changed and for each the job ID and packed record
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/job_journal.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/state_save.h"
+
+/* Change JOB_JOURNAL_VERSION value when changing the journal format */
+#define JOB_JOURNAL_VERSION	"JNL001"
+#define JOB_JOURNAL_MAGIC	0x4a4e4c31
+#define JOB_JOURNAL_HEAD_SIZE	12	/* magic, size and checksum */
+
+/* Journal size below which no compaction is done */
+#define JOB_JOURNAL_MIN_COMPACT	(1024 * 1024)
+
+typedef struct journal_rec {
+	uint32_t job_id;
+	uint32_t pass;			/* last save pass seeing job */
+	uint64_t hash;			/* hash of packed job record */
+	struct journal_rec *hash_next;
+} journal_rec_t;
+
+/* Held from job_journal_begin() to the end of the save pass */
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+static journal_rec_t **hash_table = NULL;
+static uint32_t hash_size = 0;
+static uint32_t rec_cnt = 0;
+static uint32_t pass_cnt = 0;
+
+static bool tracking = false;		/* JobStateJournal set this pass */
+static bool ckpt_pass = false;		/* this pass writes job_state */
+static bool journal_valid = false;	/* journal follows job_state */
+static uint32_t ckpt_bytes = 0;		/* size of job_state */
+static uint32_t journal_bytes = 0;	/* size of job_state.journal */
+static uint32_t last_job_id_seq = 0;	/* in job_state or journal */
+static Buf update_buf = NULL;		/* jobs changed this pass */
+static uint32_t update_cnt = 0;
+
+/* FNV-1a hash */
+static uint64_t _hash(uint64_t hash, char *data, uint32_t size)
+{
+	uint32_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= (unsigned char) data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+#define HASH_INIT	0xcbf29ce484222325ULL
+
+static char *_journal_file(char *suffix)
+{
+	char *file_name = slurm_get_state_save_location();
+
+	xstrcat(file_name, "/job_state.journal");
+	if (suffix)
+		xstrcat(file_name, suffix);
+	return file_name;
+}
+
+static journal_rec_t *_find_rec(uint32_t job_id)
+{
+	journal_rec_t *rec;
+
+	for (rec = hash_table[job_id % hash_size]; rec; rec = rec->hash_next) {
+		if (rec->job_id == job_id)
+			return rec;
+	}
+	return NULL;
+}
+
+/* Size the hash table for MaxJobCount, rebuilding it if that changed */
+static void _rehash(void)
+{
+	uint32_t new_size = MAX(slurmctld_conf.max_job_cnt, 1024);
+	uint32_t old_size = hash_size, i, inx;
+	journal_rec_t **old_table = hash_table, *rec, *next;
+
+	if (new_size == hash_size)
+		return;
+	hash_size = new_size;
+	hash_table = xmalloc(sizeof(journal_rec_t *) * hash_size);
+	for (i = 0; i < old_size; i++) {
+		for (rec = old_table[i]; rec; rec = next) {
+			next = rec->hash_next;
+			inx = rec->job_id % hash_size;
+			rec->hash_next = hash_table[inx];
+			hash_table[inx] = rec;
+		}
+	}
+	xfree(old_table);
+}
+
+/* Remove records of jobs not seen in this pass, packing their job IDs
+ * into buffer if not NULL. RET count of records removed */
+static uint32_t _sweep(Buf buffer)
+{
+	journal_rec_t **rec_pptr, *rec;
+	uint32_t i, purge_cnt = 0;
+
+	for (i = 0; i < hash_size; i++) {
+		rec_pptr = &hash_table[i];
+		while ((rec = *rec_pptr)) {
+			if (rec->pass == pass_cnt) {
+				rec_pptr = &rec->hash_next;
+				continue;
+			}
+			if (buffer)
+				pack32(rec->job_id, buffer);
+			*rec_pptr = rec->hash_next;
+			xfree(rec);
+			rec_cnt--;
+			purge_cnt++;
+		}
+	}
+	return purge_cnt;
+}
+
+static void _free_recs(void)
+{
+	pass_cnt++;
+	(void) _sweep(NULL);
+	xfree(hash_table);
+	hash_size = 0;
+}
+
+static int _write_file(int fd, char *data, uint32_t size, char *file_name)
+{
+	int amount;
+
+	while (size > 0) {
+		amount = write(fd, data, size);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			error("Error writing file %s, %m", file_name);
+			return errno;
+		}
+		size -= amount;
+		data += amount;
+	}
+	return SLURM_SUCCESS;
+}
+
+static char *_read_file(char *file_name, uint32_t *size)
+{
+	int fd, data_read, data_allocated;
+	char *data;
+
+	*size = 0;
+	fd = open(file_name, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	data_allocated = BUF_SIZE;
+	data = xmalloc(data_allocated);
+	while (1) {
+		data_read = read(fd, &data[*size], BUF_SIZE);
+		if (data_read < 0) {
+			if (errno == EINTR)
+				continue;
+			error("Read error on %s: %m", file_name);
+			break;
+		} else if (data_read == 0)	/* eof */
+			break;
+		*size          += data_read;
+		data_allocated += data_read;
+		xrealloc(data, data_allocated);
+	}
+	close(fd);
+	return data;
+}
+
+/*
+ * job_journal_begin - start a job state save pass, call with no slurmctld
+ *	locks held and follow with job_journal_add() for every job saved and
+ *	job_journal_append() or job_journal_reset()
+ * RET true if this pass must write a full job_state checkpoint, false if
+ *	it only appends the changed jobs to the journal
+ */
+extern bool job_journal_begin(void)
+{
+	slurm_mutex_lock(&journal_lock);
+	tracking = slurmctld_conf.job_state_journal;
+	ckpt_pass = (!tracking || !journal_valid ||
+		     (journal_bytes > MAX(ckpt_bytes, JOB_JOURNAL_MIN_COMPACT)));
+	if (tracking) {
+		_rehash();
+		pass_cnt++;
+	}
+	if (!ckpt_pass) {
+		update_buf = init_buf(BUF_SIZE);
+		update_cnt = 0;
+	}
+	return ckpt_pass;
+}
+
+/*
+ * job_journal_add - note the packed state of a job in this save pass
+ * IN job_id - the job's ID
+ * IN data - the job's record as packed by _dump_job_state()
+ * IN size - size of data in bytes
+ */
+extern void job_journal_add(uint32_t job_id, char *data, uint32_t size)
+{
+	journal_rec_t *rec;
+	uint64_t hash;
+
+	if (!tracking)
+		return;
+
+	hash = _hash(HASH_INIT, data, size);
+	rec = _find_rec(job_id);
+	if (rec == NULL) {
+		rec = xmalloc(sizeof(journal_rec_t));
+		rec->job_id = job_id;
+		rec->hash_next = hash_table[job_id % hash_size];
+		hash_table[job_id % hash_size] = rec;
+		rec_cnt++;
+	} else if (rec->hash == hash) {
+		rec->pass = pass_cnt;
+		return;
+	}
+	rec->hash = hash;
+	rec->pass = pass_cnt;
+
+	if (!ckpt_pass) {
+		pack32(job_id, update_buf);
+		packmem(data, size, update_buf);
+		update_cnt++;
+	}
+}
+
+/*
+ * job_journal_append - end a journal pass, appending the jobs changed or
+ *	gone since the previous pass to the journal file
+ * IN job_id_sequence - current job_id_sequence
+ * RET 0 or error code
+ */
+extern int job_journal_append(uint32_t job_id_sequence)
+{
+	uint32_t purge_cnt, batch_size, update_size, tmp_offset;
+	char *file_name;
+	Buf buffer;
+	int fd, rc, error_code = SLURM_SUCCESS;
+
+	xassert(!ckpt_pass);
+	buffer = init_buf(BUF_SIZE);
+	pack32((uint32_t) JOB_JOURNAL_MAGIC, buffer);
+	pack32((uint32_t) 0, buffer);	/* payload size, set below */
+	pack32((uint32_t) 0, buffer);	/* payload checksum, set below */
+	pack32(job_id_sequence, buffer);
+	tmp_offset = get_buf_offset(buffer);
+	pack32((uint32_t) 0, buffer);	/* purge count, set below */
+	purge_cnt = _sweep(buffer);
+
+	if ((purge_cnt == 0) && (update_cnt == 0) &&
+	    (job_id_sequence == last_job_id_seq)) {
+		free_buf(update_buf);
+		update_buf = NULL;
+		free_buf(buffer);
+		slurm_mutex_unlock(&journal_lock);
+		return SLURM_SUCCESS;
+	}
+
+	/* Build the payload, then fill in the header */
+	update_size = get_buf_offset(update_buf);
+	pack32(update_cnt, buffer);
+	batch_size = get_buf_offset(buffer);
+	if (remaining_buf(buffer) < update_size)
+		grow_buf(buffer, update_size);
+	memcpy(get_buf_data(buffer) + batch_size, get_buf_data(update_buf),
+	       update_size);
+	batch_size += update_size;
+	set_buf_offset(buffer, tmp_offset);
+	pack32(purge_cnt, buffer);
+	set_buf_offset(buffer, 4);
+	pack32(batch_size - JOB_JOURNAL_HEAD_SIZE, buffer);
+	pack32((uint32_t) _hash(HASH_INIT,
+				get_buf_data(buffer) + JOB_JOURNAL_HEAD_SIZE,
+				batch_size - JOB_JOURNAL_HEAD_SIZE), buffer);
+	free_buf(update_buf);
+	update_buf = NULL;
+
+	file_name = _journal_file(NULL);
+	lock_state_files();
+	fd = open(file_name, O_WRONLY | O_APPEND);
+	if (fd < 0) {
+		error("Can't save state, open file %s error %m", file_name);
+		error_code = errno;
+	} else {
+		error_code = _write_file(fd, get_buf_data(buffer),
+					 batch_size, file_name);
+		rc = fsync_and_close(fd, "job journal");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	unlock_state_files();
+	free_buf(buffer);
+
+	if (error_code) {
+		/* The journal may now end with part of this batch, so
+		 * nothing after it would be replayed */
+		journal_valid = false;
+	} else {
+		journal_bytes += batch_size;
+		last_job_id_seq = job_id_sequence;
+		debug2("Journaled %u changed and %u purged jobs to %s",
+		       update_cnt, purge_cnt, file_name);
+	}
+	xfree(file_name);
+	slurm_mutex_unlock(&journal_lock);
+	return error_code;
+}
+
+/*
+ * job_journal_reset - end a checkpoint pass, starting a new journal for it
+ *	or removing the journal if JobStateJournal is not set
+ * IN ckpt_time - time in the header of the job_state file written
+ * IN ckpt_size - size of the job_state file written
+ * IN ckpt_rc - result of writing job_state, no journal is started if set
+ */
+extern void job_journal_reset(time_t ckpt_time, uint32_t ckpt_size,
+			      int ckpt_rc)
+{
+	char *file_name, *new_file;
+	Buf buffer;
+	int fd, rc, error_code = SLURM_SUCCESS;
+
+	xassert(ckpt_pass);
+	journal_valid = false;
+	file_name = _journal_file(NULL);
+	if (!tracking) {
+		_free_recs();
+		if (ckpt_rc == SLURM_SUCCESS) {
+			/* A journal left from JobStateJournal=YES does not
+			 * follow this job_state file, remove it */
+			lock_state_files();
+			(void) unlink(file_name);
+			unlock_state_files();
+		}
+		xfree(file_name);
+		slurm_mutex_unlock(&journal_lock);
+		return;
+	}
+	(void) _sweep(NULL);
+	if (ckpt_rc) {
+		xfree(file_name);
+		slurm_mutex_unlock(&journal_lock);
+		return;
+	}
+
+	buffer = init_buf(BUF_SIZE);
+	packstr(JOB_JOURNAL_VERSION, buffer);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack_time(ckpt_time, buffer);
+	pack32(ckpt_size, buffer);
+
+	new_file = _journal_file(".new");
+	lock_state_files();
+	fd = creat(new_file, 0600);
+	if (fd < 0) {
+		error("Can't save state, create file %s error %m", new_file);
+		error_code = errno;
+	} else {
+		error_code = _write_file(fd, get_buf_data(buffer),
+					 get_buf_offset(buffer), new_file);
+		rc = fsync_and_close(fd, "job journal");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	if (error_code)
+		(void) unlink(new_file);
+	else if (rename(new_file, file_name)) {
+		error("Can't save state, rename %s to %s error %m",
+		      new_file, file_name);
+		error_code = errno;
+		(void) unlink(new_file);
+	}
+	unlock_state_files();
+
+	if (error_code == SLURM_SUCCESS) {
+		journal_valid = true;
+		journal_bytes = get_buf_offset(buffer);
+		ckpt_bytes = ckpt_size;
+		/* job_id_sequence is in the job_state header */
+		last_job_id_seq = 0;
+	}
+	free_buf(buffer);
+	xfree(file_name);
+	xfree(new_file);
+	slurm_mutex_unlock(&journal_lock);
+}
+
+/*
+ * job_journal_replay - apply the journal written after a job_state file
+ *	to the jobs recovered from it
+ * IN ckpt_time - time in the header of the job_state file read
+ * IN ckpt_size - size of the job_state file read
+ * IN protocol_version - protocol version of the job_state file read
+ * IN load_job - function to load one job record, NULL to only read the
+ *	job_id_sequence
+ * IN purge_job - function to remove a job record, NULL to only read the
+ *	job_id_sequence
+ * IN/OUT job_id_sequence - raised to the latest saved job_id_sequence
+ * RET count of jobs loaded or purged
+ */
+extern int job_journal_replay(time_t ckpt_time, uint32_t ckpt_size,
+			      uint16_t protocol_version,
+			      int (*load_job)(Buf buffer,
+					      uint16_t protocol_version),
+			      int (*purge_job)(uint32_t job_id),
+			      uint32_t *job_id_sequence)
+{
+	char *data, *file_name, *ver_str = NULL, *rec_data;
+	uint32_t data_size, ver_str_len, rec_size, job_id, saved_job_id;
+	uint32_t magic, payload_size, checksum, payload_end;
+	uint32_t batch_cnt = 0, purge_cnt, update_cnt, i;
+	uint16_t journal_version;
+	time_t journal_time;
+	uint32_t journal_size;
+	int job_cnt = 0;
+	Buf buffer, rec_buf;
+
+	file_name = _journal_file(NULL);
+	lock_state_files();
+	data = _read_file(file_name, &data_size);
+	unlock_state_files();
+	if (data == NULL) {
+		debug("No job state journal (%s) to recover", file_name);
+		xfree(file_name);
+		return 0;
+	}
+
+	buffer = create_buf(data, data_size);
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if ((ver_str == NULL) || strcmp(ver_str, JOB_JOURNAL_VERSION)) {
+		error("Can not recover job state journal %s, "
+		      "incompatible version", file_name);
+		goto fini;
+	}
+	safe_unpack16(&journal_version, buffer);
+	safe_unpack_time(&journal_time, buffer);
+	safe_unpack32(&journal_size, buffer);
+	if ((journal_time != ckpt_time) || (journal_size != ckpt_size) ||
+	    (journal_version != protocol_version)) {
+		info("Job state journal %s does not follow the job state "
+		     "file, ignored", file_name);
+		goto fini;
+	}
+
+	while (remaining_buf(buffer) > 0) {
+		if (remaining_buf(buffer) < JOB_JOURNAL_HEAD_SIZE)
+			goto unpack_error;
+		safe_unpack32(&magic, buffer);
+		safe_unpack32(&payload_size, buffer);
+		safe_unpack32(&checksum, buffer);
+		if ((magic != JOB_JOURNAL_MAGIC) ||
+		    (payload_size > remaining_buf(buffer)) ||
+		    (checksum != (uint32_t) _hash(HASH_INIT,
+				get_buf_data(buffer) + get_buf_offset(buffer),
+				payload_size)))
+			goto unpack_error;
+		payload_end = get_buf_offset(buffer) + payload_size;
+
+		safe_unpack32(&saved_job_id, buffer);
+		*job_id_sequence = MAX(*job_id_sequence, saved_job_id);
+		safe_unpack32(&purge_cnt, buffer);
+		for (i = 0; i < purge_cnt; i++) {
+			safe_unpack32(&job_id, buffer);
+			if (purge_job) {
+				(void) (*purge_job)(job_id);
+				job_cnt++;
+			}
+		}
+		safe_unpack32(&update_cnt, buffer);
+		for (i = 0; i < update_cnt; i++) {
+			safe_unpack32(&job_id, buffer);
+			if (!load_job) {
+				safe_unpackmem_ptr(&rec_data, &rec_size,
+						   buffer);
+				continue;
+			}
+			safe_unpackmem_xmalloc(&rec_data, &rec_size, buffer);
+			/* Replace the record rather than loading over it,
+			 * which would duplicate its steps */
+			(void) (*purge_job)(job_id);
+			rec_buf = create_buf(rec_data, rec_size);
+			if ((*load_job)(rec_buf, journal_version)) {
+				error("Can not recover job %u from job state "
+				      "journal", job_id);
+			}
+			free_buf(rec_buf);
+			job_cnt++;
+		}
+		if (get_buf_offset(buffer) != payload_end)
+			goto unpack_error;
+		batch_cnt++;
+	}
+	goto fini;
+
+unpack_error:
+	error("Incomplete job state journal %s, ignoring it after %u batches",
+	      file_name, batch_cnt);
+fini:
+	if (load_job && batch_cnt) {
+		info("Recovered %d job changes from %u job state journal "
+		     "batches", job_cnt, batch_cnt);
+	}
+	xfree(ver_str);
+	xfree(file_name);
+	free_buf(buffer);
+	return job_cnt;
+}
+
+/* job_journal_fini - free all job journal records (memory leak testing) */
+extern void job_journal_fini(void)
+{
+	slurm_mutex_lock(&journal_lock);
+	_free_recs();
+	journal_valid = false;
+	slurm_mutex_unlock(&journal_lock);
+}
@@ -0,0 +1,104 @@
+/*****************************************************************************\
+ *  job_journal.h - append only journal of job state changes between full
+ *	job state checkpoints
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_JOB_JOURNAL_H
+#define _HAVE_JOB_JOURNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "src/common/pack.h"
+
+/*
+ * job_journal_begin - start a job state save pass, call with no slurmctld
+ *	locks held and follow with job_journal_add() for every job saved and
+ *	job_journal_append() or job_journal_reset()
+ * RET true if this pass must write a full job_state checkpoint, false if
+ *	it only appends the changed jobs to the journal
+ */
+extern bool job_journal_begin(void);
+
+/*
+ * job_journal_add - note the packed state of a job in this save pass
+ * IN job_id - the job's ID
+ * IN data - the job's record as packed by _dump_job_state()
+ * IN size - size of data in bytes
+ */
+extern void job_journal_add(uint32_t job_id, char *data, uint32_t size);
+
+/*
+ * job_journal_append - end a journal pass, appending the jobs changed or
+ *	gone since the previous pass to the journal file
+ * IN job_id_sequence - current job_id_sequence
+ * RET 0 or error code
+ */
+extern int job_journal_append(uint32_t job_id_sequence);
+
+/*
+ * job_journal_reset - end a checkpoint pass, starting a new journal for it
+ *	or removing the journal if JobStateJournal is not set
+ * IN ckpt_time - time in the header of the job_state file written
+ * IN ckpt_size - size of the job_state file written
+ * IN ckpt_rc - result of writing job_state, no journal is started if set
+ */
+extern void job_journal_reset(time_t ckpt_time, uint32_t ckpt_size,
+			      int ckpt_rc);
+
+/*
+ * job_journal_replay - apply the journal written after a job_state file
+ *	to the jobs recovered from it
+ * IN ckpt_time - time in the header of the job_state file read
+ * IN ckpt_size - size of the job_state file read
+ * IN protocol_version - protocol version of the job_state file read
+ * IN load_job - function to load one job record, NULL to only read the
+ *	job_id_sequence
+ * IN purge_job - function to remove a job record, NULL to only read the
+ *	job_id_sequence
+ * IN/OUT job_id_sequence - raised to the latest saved job_id_sequence
+ * RET count of jobs loaded or purged
+ */
+extern int job_journal_replay(time_t ckpt_time, uint32_t ckpt_size,
+			      uint16_t protocol_version,
+			      int (*load_job)(Buf buffer,
+					      uint16_t protocol_version),
+			      int (*purge_job)(uint32_t job_id),
+			      uint32_t *job_id_sequence);
+
+/* job_journal_fini - free all job journal records (memory leak testing) */
+extern void job_journal_fini(void);
+
+#endif /* !_HAVE_JOB_JOURNAL_H */
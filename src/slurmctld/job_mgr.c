@@ -44,6 +44,10 @@
 #  include "config.h"
 #endif
 
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
@@ -78,6 +82,9 @@
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_hash.h"
+#include "src/slurmctld/job_index.h"
+#include "src/slurmctld/job_journal.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -97,14 +104,24 @@
 #define STEP_FLAG 0xbbbb
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 
-#define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
-
 /* Change JOB_STATE_VERSION value when changing the state save format */
 #define JOB_STATE_VERSION      "VER011"
 #define JOB_2_3_STATE_VERSION  "VER011"		/* SLURM version 2.3 */
 #define JOB_2_2_STATE_VERSION  "VER010"		/* SLURM version 2.2 */
 #define JOB_2_1_STATE_VERSION  "VER009"		/* SLURM version 2.1 */
 
+/* reset_job_bitmaps() rebuilds the node bitmaps of this many or more jobs
+ * using up to RESET_BITMAP_THREADS threads, RESET_BITMAP_CHUNK jobs at a
+ * time */
+#define RESET_BITMAP_MIN_JOBS	1000
+#define RESET_BITMAP_THREADS	16
+#define RESET_BITMAP_CHUNK	64
+
+/* Bitmaps which could not be built for a job by _reset_job_node_bitmaps() */
+#define RESET_FAIL_NODES	0x01
+#define RESET_FAIL_NODES_CG	0x02
+#define RESET_FAIL_DETAILS	0x04
+
 #define JOB_CKPT_VERSION      "JOB_CKPT_002"
 #define JOB_2_2_CKPT_VERSION  "JOB_CKPT_002"	/* SLURM version 2.2 */
 #define JOB_2_1_CKPT_VERSION  "JOB_CKPT_001"	/* SLURM version 2.1 */
@@ -116,14 +133,27 @@ time_t last_job_update;		/* time of last update to job records */
 /* Local variables */
 static uint32_t highest_prio = 0;
 static uint32_t lowest_prio  = TOP_PRIORITY;
-static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
-static struct   job_record **job_hash = NULL;
 static bool     wiki_sched = false;
 static bool     wiki2_sched = false;
 static bool     wiki_sched_test = false;
 
+/* job_state file read by load_job_state_prefetch() */
+static pthread_t prefetch_thread;
+static bool      prefetch_started = false;
+static char     *prefetch_data = NULL;
+static uint32_t  prefetch_size = 0;
+static int       prefetch_rc = SLURM_SUCCESS;
+
+typedef struct reset_bitmap_args {
+	struct job_record **job_array;
+	uint8_t *fail;			/* RESET_FAIL_* for each job */
+	uint32_t job_cnt;
+	uint32_t next_inx;		/* next job to process */
+	pthread_mutex_t lock;		/* protects next_inx */
+} reset_bitmap_args_t;
+
 /* Local functions */
 static void _add_job_hash(struct job_record *job_ptr);
 static int  _checkpoint_job_record (struct job_record *job_ptr,
@@ -148,6 +178,7 @@ static void _dump_job_state(struct job_record *dump_job_ptr, Buf buffer);
 static int  _find_batch_dir(void *x, void *key);
 static void _get_batch_job_dir_ids(List batch_dirs);
 static void _job_timed_out(struct job_record *job_ptr);
+static int  _journal_job_state(void);
 static int  _job_create(job_desc_msg_t * job_specs, int allocate, int will_run,
 			struct job_record **job_rec_ptr, uid_t submit_uid);
 static void _list_delete_job(void *job_entry);
@@ -168,13 +199,19 @@ static void _pack_pending_job_details(struct job_details *detail_ptr,
 				      uint16_t protocol_version);
 static int  _purge_job_record(uint32_t job_id);
 static void _purge_missing_jobs(int node_inx, time_t now);
+static void *_prefetch_job_state(void *no_data);
 static void _read_data_array_from_file(char *file_name, char ***data,
 				       uint32_t * size,
  				       struct job_record *job_ptr);
 static void _read_data_from_file(char *file_name, char **data);
 static char *_read_job_ckpt_file(char *ckpt_file, int *size_ptr);
+static int  _read_job_state_file(char **data_ptr, uint32_t *size_ptr);
 static void _remove_defunct_batch_dirs(List batch_dirs);
+static void *_reset_bitmap_thread(void *args);
 static int  _reset_detail_bitmaps(struct job_record *job_ptr);
+static uint8_t _reset_job_node_bitmaps(struct job_record *job_ptr);
+static void _reset_node_bitmaps(struct job_record **job_array,
+				uint8_t *fail, uint32_t job_cnt);
 static void _reset_step_bitmaps(struct job_record *job_ptr);
 static int  _resume_job_nodes(struct job_record *job_ptr, bool clear_prio);
 static void _send_job_kill(struct job_record *job_ptr);
@@ -236,6 +273,7 @@ struct job_record *create_job_record(int *error_code)
 			       * hasn't been set yet  */
 	if (list_append(job_list, job_ptr) == 0)
 		fatal("list_append memory allocation failure");
+	job_index_add(job_ptr);
 
 	return job_ptr;
 }
@@ -385,11 +423,16 @@ int dump_all_job_state(void)
 		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	Buf buffer = init_buf(high_buffer_size);
+	Buf buffer;
 	time_t min_age = 0, now = time(NULL);
+	uint32_t job_offset;
 	DEF_TIMERS;
 
+	if (!job_journal_begin())
+		return _journal_job_state();
+
 	START_TIMER;
+	buffer = init_buf(high_buffer_size);
 	/* write header: version, time */
 	packstr(JOB_STATE_VERSION, buffer);
 	pack_time(now, buffer);
@@ -416,7 +459,11 @@ int dump_all_job_state(void)
 		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
 			continue;	/* job ready for purging, don't dump */
 
+		job_offset = get_buf_offset(buffer);
 		_dump_job_state(job_ptr, buffer);
+		job_journal_add(job_ptr->job_id,
+				(char *) get_buf_data(buffer) + job_offset,
+				get_buf_offset(buffer) - job_offset);
 	}
 	list_iterator_destroy(job_iterator);
 
@@ -486,12 +533,58 @@ int dump_all_job_state(void)
 	xfree(reg_file);
 	xfree(new_file);
 	unlock_state_files();
+	job_journal_reset(now, get_buf_offset(buffer), error_code);
 
 	free_buf(buffer);
 	END_TIMER2("dump_all_job_state");
 	return error_code;
 }
 
+/*
+ * _journal_job_state - save the state of the jobs changed since the
+ *	previous save to the job state journal, see job_journal.c
+ * RET 0 or error code
+ */
+static int _journal_job_state(void)
+{
+	/* Locks: Read config and job */
+	slurmctld_lock_t job_read_lock =
+		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	Buf buffer = init_buf(BUF_SIZE);
+	time_t min_age = 0, now = time(NULL);
+	uint32_t job_id_seq;
+	int error_code;
+	DEF_TIMERS;
+
+	START_TIMER;
+	if (slurmctld_conf.min_job_age > 0)
+		min_age = now  - slurmctld_conf.min_job_age;
+
+	lock_slurmctld(job_read_lock);
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		xassert (job_ptr->magic == JOB_MAGIC);
+		if ((min_age > 0) && (job_ptr->end_time < min_age) &&
+		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
+			continue;	/* job ready for purging, don't dump */
+
+		set_buf_offset(buffer, 0);
+		_dump_job_state(job_ptr, buffer);
+		job_journal_add(job_ptr->job_id, get_buf_data(buffer),
+				get_buf_offset(buffer));
+	}
+	list_iterator_destroy(job_iterator);
+	job_id_seq = job_id_sequence;
+	unlock_slurmctld(job_read_lock);
+	free_buf(buffer);
+
+	error_code = job_journal_append(job_id_seq);
+	END_TIMER2("journal_job_state");
+	return error_code;
+}
+
 /* Open the job state save file, or backup if necessary.
  * state_file IN - the name of the state save file used
  * RET the file description to read from or error code
@@ -521,26 +614,18 @@ static int _open_job_state_file(char **state_file)
 	return state_fd;
 }
 
-/*
- * load_all_job_state - load the job state from file, recover from last
- *	checkpoint. Execute this after loading the configuration file data.
- *	Changes here should be reflected in load_last_job_id().
+/* Read the job state save file, or backup if necessary.
+ * data_ptr OUT - file contents, must be xfreed by the caller
+ * size_ptr OUT - size of file contents in bytes
  * RET 0 or error code
  */
-extern int load_all_job_state(void)
+static int _read_job_state_file(char **data_ptr, uint32_t *size_ptr)
 {
 	int data_allocated, data_read = 0, error_code = SLURM_SUCCESS;
 	uint32_t data_size = 0;
-	int state_fd, job_cnt = 0;
+	int state_fd;
 	char *data = NULL, *state_file;
-	Buf buffer;
-	time_t buf_time;
-	uint32_t saved_job_id;
-	char *ver_str = NULL;
-	uint32_t ver_str_len;
-	uint16_t protocol_version = (uint16_t)NO_VAL;
 
-	/* read the file */
 	lock_state_files();
 	state_fd = _open_job_state_file(&state_file);
 	if (state_fd < 0) {
@@ -571,6 +656,66 @@ extern int load_all_job_state(void)
 	xfree(state_file);
 	unlock_state_files();
 
+	*data_ptr = data;
+	*size_ptr = data_size;
+	return error_code;
+}
+
+static void *_prefetch_job_state(void *no_data)
+{
+	prefetch_rc = _read_job_state_file(&prefetch_data, &prefetch_size);
+	return NULL;
+}
+
+/*
+ * load_job_state_prefetch - start reading the job state file in the
+ *	background, so that the read overlaps the recovery of node and
+ *	partition state. load_all_job_state() uses the data read.
+ */
+extern void load_job_state_prefetch(void)
+{
+	pthread_attr_t attr;
+
+	if (prefetch_started)
+		return;
+	slurm_attr_init(&attr);
+	if (pthread_create(&prefetch_thread, &attr, _prefetch_job_state,
+			   NULL))
+		error("pthread_create error %m");
+	else
+		prefetch_started = true;
+	slurm_attr_destroy(&attr);
+}
+
+/*
+ * load_all_job_state - load the job state from file, recover from last
+ *	checkpoint. Execute this after loading the configuration file data.
+ *	Changes here should be reflected in load_last_job_id().
+ * RET 0 or error code
+ */
+extern int load_all_job_state(void)
+{
+	int error_code = SLURM_SUCCESS;
+	uint32_t data_size = 0;
+	int job_cnt = 0;
+	char *data = NULL;
+	Buf buffer;
+	time_t buf_time;
+	uint32_t saved_job_id;
+	char *ver_str = NULL;
+	uint32_t ver_str_len;
+	uint16_t protocol_version = (uint16_t)NO_VAL;
+
+	if (prefetch_started) {
+		pthread_join(prefetch_thread, NULL);
+		prefetch_started = false;
+		data = prefetch_data;
+		data_size = prefetch_size;
+		error_code = prefetch_rc;
+		prefetch_data = NULL;
+	} else
+		error_code = _read_job_state_file(&data, &data_size);
+
 	job_id_sequence = MAX(job_id_sequence, slurmctld_conf.first_job_id);
 	if (error_code)
 		return error_code;
@@ -608,6 +753,9 @@ extern int load_all_job_state(void)
 			goto unpack_error;
 		job_cnt++;
 	}
+	(void) job_journal_replay(buf_time, data_size, protocol_version,
+				  _load_job_state, _purge_job_record,
+				  &saved_job_id);
 
 	job_id_sequence = MAX(saved_job_id, job_id_sequence);
 	debug3("Set job_id_sequence to %u", job_id_sequence);
@@ -692,6 +840,8 @@ extern int load_last_job_id( void )
 	safe_unpack_time(&buf_time, buffer);
 	safe_unpack32( &job_id_sequence, buffer);
 	debug3("Job ID in job_state header is %u", job_id_sequence);
+	(void) job_journal_replay(buf_time, data_size, SLURM_PROTOCOL_VERSION,
+				  NULL, NULL, &job_id_sequence);
 
 	/* Ignore the state for individual jobs stored here */
 
@@ -987,6 +1137,7 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 		if ((details == DETAILS_FLAG) &&
 		    (_load_job_details(job_ptr, buffer, protocol_version))) {
 			job_ptr->job_state = JOB_FAILED;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = 1;
 			job_ptr->state_reason = FAIL_SYSTEM;
 			xfree(job_ptr->state_desc);
@@ -1134,6 +1285,7 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 		if ((details == DETAILS_FLAG) &&
 		    (_load_job_details(job_ptr, buffer, protocol_version))) {
 			job_ptr->job_state = JOB_FAILED;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = 1;
 			job_ptr->state_reason = FAIL_SYSTEM;
 			xfree(job_ptr->state_desc);
@@ -1275,6 +1427,7 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 		if ((details == DETAILS_FLAG) &&
 		    (_load_job_details(job_ptr, buffer, protocol_version))) {
 			job_ptr->job_state = JOB_FAILED;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = 1;
 			job_ptr->state_reason = FAIL_SYSTEM;
 			xfree(job_ptr->state_desc);
@@ -1419,6 +1572,7 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 	job_ptr->limit_set_min_cpus  = limit_set_max_cpus;
 	job_ptr->limit_set_min_nodes = limit_set_min_nodes;
 	job_ptr->limit_set_time      = limit_set_time;
+	job_index_update(job_ptr);
 
 	memset(&assoc_rec, 0, sizeof(slurmdb_association_rec_t));
 
@@ -1444,6 +1598,7 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 		info("Cancelling job %u with invalid association",
 		     job_id);
 		job_ptr->job_state = JOB_CANCELLED;
+		job_index_update(job_ptr);
 		job_ptr->state_reason = FAIL_ACCOUNT;
 		xfree(job_ptr->state_desc);
 		if (IS_JOB_PENDING(job_ptr))
@@ -1481,6 +1636,7 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 		if (qos_error != SLURM_SUCCESS) {
 			info("Cancelling job %u with invalid qos", job_id);
 			job_ptr->job_state = JOB_CANCELLED;
+			job_index_update(job_ptr);
 			job_ptr->state_reason = FAIL_QOS;
 			xfree(job_ptr->state_desc);
 			if (IS_JOB_PENDING(job_ptr))
@@ -1867,11 +2023,7 @@ unpack_error:
  */
 void _add_job_hash(struct job_record *job_ptr)
 {
-	int inx;
-
-	inx = JOB_HASH_INX(job_ptr->job_id);
-	job_ptr->job_next = job_hash[inx];
-	job_hash[inx] = job_ptr;
+	job_hash_add(job_ptr->job_id, job_ptr);
 }
 
 /*
@@ -1883,16 +2035,7 @@ void _add_job_hash(struct job_record *job_ptr)
  */
 struct job_record *find_job_record(uint32_t job_id)
 {
-	struct job_record *job_ptr;
-
-	job_ptr = job_hash[JOB_HASH_INX(job_id)];
-	while (job_ptr) {
-		if (job_ptr->job_id == job_id)
-			return job_ptr;
-		job_ptr = job_ptr->job_next;
-	}
-
-	return NULL;
+	return job_hash_find(job_id);
 }
 
 /* rebuild a job's partition name list based upon the contents of its
@@ -1939,6 +2082,7 @@ static void _rebuild_part_name_list(struct job_record  *job_ptr)
  */
 extern int kill_job_by_part_name(char *part_name)
 {
+	List job_queue;
 	ListIterator job_iterator, part_iterator;
 	struct job_record  *job_ptr;
 	struct part_record *part_ptr, *part2_ptr;
@@ -1949,7 +2093,10 @@ extern int kill_job_by_part_name(char *part_name)
 	if (part_ptr == NULL)	/* No such partition */
 		return 0;
 
-	job_iterator = list_iterator_create(job_list);
+	job_queue = job_index_part_jobs(part_ptr);
+	job_iterator = list_iterator_create(job_queue);
+	if (job_iterator == NULL)
+		fatal("list_iterator_create malloc failure");
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		bool pending = false, suspended = false;
 
@@ -1981,8 +2128,10 @@ extern int kill_job_by_part_name(char *part_name)
 			}
 		}
 
-		if (job_ptr->part_ptr != part_ptr)
+		if (job_ptr->part_ptr != part_ptr) {
+			job_index_update(job_ptr);
 			continue;
+		}
 
 		if (IS_JOB_SUSPENDED(job_ptr)) {
 			enum job_states suspend_job_state = job_ptr->job_state;
@@ -1999,6 +2148,7 @@ extern int kill_job_by_part_name(char *part_name)
 			info("Killing job_id %u on defunct partition %s",
 			     job_ptr->job_id, part_name);
 			job_ptr->job_state = JOB_NODE_FAIL | JOB_COMPLETING;
+			job_index_update(job_ptr);
 			build_cg_bitmap(job_ptr);
 			job_ptr->exit_code = MAX(job_ptr->exit_code, 1);
 			job_ptr->state_reason = FAIL_DOWN_PARTITION;
@@ -2018,6 +2168,7 @@ extern int kill_job_by_part_name(char *part_name)
 			info("Killing job_id %u on defunct partition %s",
 			     job_ptr->job_id, part_name);
 			job_ptr->job_state	= JOB_CANCELLED;
+			job_index_update(job_ptr);
 			job_ptr->start_time	= now;
 			job_ptr->end_time	= now;
 			job_ptr->exit_code	= 1;
@@ -2025,8 +2176,10 @@ extern int kill_job_by_part_name(char *part_name)
 		}
 		job_ptr->part_ptr = NULL;
 		FREE_NULL_LIST(job_ptr->part_ptr_list);
+		job_index_update(job_ptr);
 	}
 	list_iterator_destroy(job_iterator);
+	list_destroy(job_queue);
 
 	if (job_count)
 		last_job_update = now;
@@ -2130,12 +2283,14 @@ extern int kill_job_by_front_end_name(char *node_name)
 				 * Set a new submit time so the restarted
 				 * job looks like a new job. */
 				job_ptr->job_state  = JOB_NODE_FAIL;
+				job_index_update(job_ptr);
 				build_cg_bitmap(job_ptr);
 				deallocate_nodes(job_ptr, false, suspended,
 						 false);
 				job_completion_logger(job_ptr, true);
 				job_ptr->db_index = 0;
 				job_ptr->job_state = JOB_PENDING;
+				job_index_update(job_ptr);
 				if (job_ptr->node_cnt)
 					job_ptr->job_state |= JOB_COMPLETING;
 				job_ptr->details->submit_time = now;
@@ -2163,6 +2318,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 				srun_node_fail(job_ptr->job_id, node_name);
 				job_ptr->job_state = JOB_NODE_FAIL |
 						     JOB_COMPLETING;
+				job_index_update(job_ptr);
 				build_cg_bitmap(job_ptr);
 				job_ptr->exit_code = MAX(job_ptr->exit_code, 1);
 				job_ptr->state_reason = FAIL_DOWN_NODE;
@@ -2199,27 +2355,30 @@ extern int kill_job_by_front_end_name(char *node_name)
  */
 extern bool partition_in_use(char *part_name)
 {
+	List job_queue;
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
 	struct part_record *part_ptr;
+	bool in_use = false;
 
 	part_ptr = find_part_record (part_name);
 	if (part_ptr == NULL)	/* No such partition */
 		return false;
 
-	job_iterator = list_iterator_create(job_list);
+	job_queue = job_index_part_jobs(part_ptr);
+	job_iterator = list_iterator_create(job_queue);
 	if (job_iterator == NULL)
 		fatal("list_iterator_create: malloc failure");
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
-		if (job_ptr->part_ptr == part_ptr) {
-			if (!IS_JOB_FINISHED(job_ptr)) {
-				list_iterator_destroy(job_iterator);
-				return true;
-			}
+		if ((job_ptr->part_ptr == part_ptr) &&
+		    !IS_JOB_FINISHED(job_ptr)) {
+			in_use = true;
+			break;
 		}
 	}
 	list_iterator_destroy(job_iterator);
-	return false;
+	list_destroy(job_queue);
+	return in_use;
 }
 
 /*
@@ -2230,8 +2389,12 @@ extern bool partition_in_use(char *part_name)
  */
 extern bool allocated_session_in_use(job_desc_msg_t *new_alloc)
 {
+	static const uint16_t active_states[] = {
+		JOB_PENDING, JOB_RUNNING, JOB_SUSPENDED };
+	List job_queue;
 	ListIterator job_iter;
-	struct job_record *job_ptr;
+	struct job_record *job_ptr = NULL;
+	int i;
 	/* Locks: Read job */
 	slurmctld_lock_t job_read_lock = {
 		NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
@@ -2240,19 +2403,23 @@ extern bool allocated_session_in_use(job_desc_msg_t *new_alloc)
 		return false;
 
 	lock_slurmctld(job_read_lock);
-	job_iter = list_iterator_create(job_list);
-	if (job_iter == NULL)
-		fatal("list_iterator_create: malloc failure");
-
-	while ((job_ptr = (struct job_record *)list_next(job_iter))) {
-		if (job_ptr->batch_flag || IS_JOB_FINISHED(job_ptr))
-			continue;
-		if (job_ptr->alloc_node &&
-		    (strcmp(job_ptr->alloc_node, new_alloc->alloc_node) == 0) &&
-		    (job_ptr->alloc_sid == new_alloc->alloc_sid))
-			break;
+	for (i = 0; (i < 3) && (job_ptr == NULL); i++) {
+		job_queue = job_index_state_jobs(active_states[i]);
+		job_iter = list_iterator_create(job_queue);
+		if (job_iter == NULL)
+			fatal("list_iterator_create: malloc failure");
+		while ((job_ptr = (struct job_record *)list_next(job_iter))) {
+			if (job_ptr->batch_flag || IS_JOB_FINISHED(job_ptr))
+				continue;
+			if (job_ptr->alloc_node &&
+			    (strcmp(job_ptr->alloc_node,
+				    new_alloc->alloc_node) == 0) &&
+			    (job_ptr->alloc_sid == new_alloc->alloc_sid))
+				break;
+		}
+		list_iterator_destroy(job_iter);
+		list_destroy(job_queue);
 	}
-	list_iterator_destroy(job_iter);
 	unlock_slurmctld(job_read_lock);
 
 	return job_ptr != NULL;
@@ -2363,12 +2530,14 @@ extern int kill_running_job_by_node_name(char *node_name)
 				 * Set a new submit time so the restarted
 				 * job looks like a new job. */
 				job_ptr->job_state  = JOB_NODE_FAIL;
+				job_index_update(job_ptr);
 				build_cg_bitmap(job_ptr);
 				deallocate_nodes(job_ptr, false, suspended,
 						 false);
 				job_completion_logger(job_ptr, true);
 				job_ptr->db_index = 0;
 				job_ptr->job_state = JOB_PENDING;
+				job_index_update(job_ptr);
 				if (job_ptr->node_cnt)
 					job_ptr->job_state |= JOB_COMPLETING;
 				job_ptr->details->submit_time = now;
@@ -2396,6 +2565,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 				srun_node_fail(job_ptr->job_id, node_name);
 				job_ptr->job_state = JOB_NODE_FAIL |
 						     JOB_COMPLETING;
+				job_index_update(job_ptr);
 				build_cg_bitmap(job_ptr);
 				job_ptr->exit_code = MAX(job_ptr->exit_code, 1);
 				job_ptr->state_reason = FAIL_DOWN_NODE;
@@ -2671,23 +2841,13 @@ int init_job_conf(void)
 }
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create the job hash table if needed. The table resizes
+ *	itself as jobs are added, so a changed MaxJobCount needs no rebuild.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void)
 {
-	if (job_hash == NULL) {
-		hash_table_size = slurmctld_conf.max_job_cnt;
-		job_hash = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
-	}
+	job_hash_init(slurmctld_conf.max_job_cnt);
 }
 
 /*
@@ -2727,6 +2887,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 		if (job_ptr && (immediate || will_run)) {
 			/* this should never really happen here */
 			job_ptr->job_state = JOB_FAILED;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = 1;
 			job_ptr->state_reason = FAIL_BAD_CONSTRAINTS;
 			xfree(job_ptr->state_desc);
@@ -2778,6 +2939,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 					 * it is not runable anyway */
 	if (immediate && (too_fragmented || (!top_prio) || (!independent))) {
 		job_ptr->job_state  = JOB_FAILED;
+		job_index_update(job_ptr);
 		job_ptr->exit_code  = 1;
 		job_ptr->state_reason = FAIL_BAD_CONSTRAINTS;
 		xfree(job_ptr->state_desc);
@@ -2798,6 +2960,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 		job_desc_msg.job_id = job_ptr->job_id;
 		rc = job_start_data(&job_desc_msg, resp);
 		job_ptr->job_state  = JOB_FAILED;
+		job_index_update(job_ptr);
 		job_ptr->exit_code  = 1;
 		job_ptr->start_time = job_ptr->end_time = now;
 		_purge_job_record(job_ptr->job_id);
@@ -2833,6 +2996,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 		/* Not fatal error, but job can't be scheduled right now */
 		if (immediate) {
 			job_ptr->job_state  = JOB_FAILED;
+			job_index_update(job_ptr);
 			job_ptr->exit_code  = 1;
 			job_ptr->state_reason = FAIL_BAD_CONSTRAINTS;
 			xfree(job_ptr->state_desc);
@@ -2849,6 +3013,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 
 	if (error_code) {	/* fundamental flaw in job request */
 		job_ptr->job_state  = JOB_FAILED;
+		job_index_update(job_ptr);
 		job_ptr->exit_code  = 1;
 		job_ptr->state_reason = FAIL_BAD_CONSTRAINTS;
 		xfree(job_ptr->state_desc);
@@ -2859,6 +3024,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 
 	if (will_run) {		/* job would run, flag job destruction */
 		job_ptr->job_state  = JOB_FAILED;
+		job_index_update(job_ptr);
 		job_ptr->exit_code  = 1;
 		job_ptr->start_time = job_ptr->end_time = now;
 		_purge_job_record(job_ptr->job_id);
@@ -2915,6 +3081,7 @@ extern int job_fail(uint32_t job_id)
 			job_ptr->end_time       = now;
 		last_job_update                 = now;
 		job_ptr->job_state = JOB_FAILED | JOB_COMPLETING;
+		job_index_update(job_ptr);
 		build_cg_bitmap(job_ptr);
 		job_ptr->exit_code = 1;
 		job_ptr->state_reason = FAIL_LAUNCH;
@@ -2995,6 +3162,7 @@ extern int job_signal(uint32_t job_id, uint16_t signal, uint16_t batch_flag,
 		if ((job_ptr->job_state & JOB_STATE_BASE) == JOB_PENDING) {
 			/* Prevent job requeue, otherwise preserve state */
 			job_ptr->job_state = JOB_CANCELLED | JOB_COMPLETING;
+			job_index_update(job_ptr);
 		}
 		/* build_cg_bitmap() not needed, job already completing */
 		verbose("job_signal of requeuing job %u successful", job_id);
@@ -3004,6 +3172,7 @@ extern int job_signal(uint32_t job_id, uint16_t signal, uint16_t batch_flag,
 	if (IS_JOB_PENDING(job_ptr) && (signal == SIGKILL)) {
 		last_job_update		= now;
 		job_ptr->job_state	= JOB_CANCELLED;
+		job_index_update(job_ptr);
 		job_ptr->start_time	= now;
 		job_ptr->end_time	= now;
 		srun_allocate_abort(job_ptr);
@@ -3021,6 +3190,7 @@ extern int job_signal(uint32_t job_id, uint16_t signal, uint16_t batch_flag,
 		job_ptr->end_time       = job_ptr->suspend_time;
 		job_ptr->tot_sus_time  += difftime(now, job_ptr->suspend_time);
 		job_ptr->job_state      = job_term_state | JOB_COMPLETING;
+		job_index_update(job_ptr);
 		build_cg_bitmap(job_ptr);
 		jobacct_storage_g_job_suspend(acct_db_conn, job_ptr);
 		deallocate_nodes(job_ptr, false, true, preempt);
@@ -3037,6 +3207,7 @@ extern int job_signal(uint32_t job_id, uint16_t signal, uint16_t batch_flag,
 			job_ptr->end_time		= now;
 			last_job_update			= now;
 			job_ptr->job_state = job_term_state | JOB_COMPLETING;
+			job_index_update(job_ptr);
 			build_cg_bitmap(job_ptr);
 			deallocate_nodes(job_ptr, false, false, preempt);
 			job_completion_logger(job_ptr, false);
@@ -3164,6 +3335,7 @@ extern int job_complete(uint32_t job_id, uid_t uid, bool requeue,
 		 * job looks like a new job. */
 		job_ptr->end_time = now;
 		job_ptr->job_state  = JOB_NODE_FAIL;
+		job_index_update(job_ptr);
 		job_completion_logger(job_ptr, true);
 		job_ptr->db_index = 0;
 		/* Since this could happen on a launch we need to make
@@ -3175,6 +3347,7 @@ extern int job_complete(uint32_t job_id, uid_t uid, bool requeue,
 		job_ptr->batch_flag++;	/* only one retry */
 		job_ptr->restart_cnt++;
 		job_ptr->job_state = JOB_PENDING | job_comp_flag;
+		job_index_update(job_ptr);
 		/* Since the job completion logger removes the job submit
 		 * information, we need to add it again. */
 		acct_policy_add_job_submit(job_ptr);
@@ -3191,24 +3364,29 @@ extern int job_complete(uint32_t job_id, uid_t uid, bool requeue,
 	} else {
 		if (node_fail) {
 			job_ptr->job_state = JOB_NODE_FAIL | job_comp_flag;
+			job_index_update(job_ptr);
 			job_ptr->requid = uid;
 		} else if (job_return_code == NO_VAL) {
 			job_ptr->job_state = JOB_CANCELLED | job_comp_flag;
+			job_index_update(job_ptr);
 			job_ptr->requid = uid;
 		} else if (WIFEXITED(job_return_code) &&
 			   WEXITSTATUS(job_return_code)) {
 			job_ptr->job_state = JOB_FAILED   | job_comp_flag;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = job_return_code;
 			job_ptr->state_reason = FAIL_EXIT_CODE;
 			xfree(job_ptr->state_desc);
 		} else if (job_comp_flag &&		/* job was running */
 			   (job_ptr->end_time < now)) {	/* over time limit */
 			job_ptr->job_state = JOB_TIMEOUT  | job_comp_flag;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = MAX(job_ptr->exit_code, 1);
 			job_ptr->state_reason = FAIL_TIMEOUT;
 			xfree(job_ptr->state_desc);
 		} else {
 			job_ptr->job_state = JOB_COMPLETE | job_comp_flag;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = job_return_code;
 		}
 
@@ -3817,6 +3995,7 @@ static int _job_create(job_desc_msg_t * job_desc, int allocate, int will_run,
 	job_ptr->part_ptr = part_ptr;
 	job_ptr->part_ptr_list = part_ptr_list;
 	part_ptr_list = NULL;
+	job_index_update(job_ptr);
 	if ((error_code = checkpoint_alloc_jobinfo(&(job_ptr->check_job)))) {
 		error("Failed to allocate checkpoint info for job");
 		goto cleanup_fail;
@@ -3848,6 +4027,7 @@ static int _job_create(job_desc_msg_t * job_desc, int allocate, int will_run,
 	} else if (job_ptr->priority != NO_VAL) {
 		job_ptr->direct_set_prio = true;
 	}
+	job_index_update(job_ptr);	/* re-sort by the priority set here */
 
 	error_code = update_job_dependency(job_ptr, job_desc->dependency);
 	if (error_code != SLURM_SUCCESS)
@@ -3943,6 +4123,7 @@ static int _job_create(job_desc_msg_t * job_desc, int allocate, int will_run,
 		else
 			error_code = ESLURM_REQUESTED_PART_CONFIG_UNAVAILABLE;
 		job_ptr->priority = 1;      /* Move to end of queue */
+		job_index_update(job_ptr);
 		job_ptr->state_reason = fail_reason;
 		xfree(job_ptr->state_desc);
 	}
@@ -3956,6 +4137,7 @@ cleanup:
 cleanup_fail:
 	if (job_ptr) {
 		job_ptr->job_state = JOB_FAILED;
+		job_index_update(job_ptr);
 		job_ptr->exit_code = 1;
 		job_ptr->state_reason = FAIL_SYSTEM;
 		xfree(job_ptr->state_desc);
@@ -4479,6 +4661,7 @@ _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
 	job_ptr->user_id    = (uid_t) job_desc->user_id;
 	job_ptr->group_id   = (gid_t) job_desc->group_id;
 	job_ptr->job_state  = JOB_PENDING;
+	job_index_update(job_ptr);
 	job_ptr->time_limit = job_desc->time_limit;
 	if (job_desc->time_min != NO_VAL)
 		job_ptr->time_min = job_desc->time_min;
@@ -5005,6 +5188,7 @@ static void _job_timed_out(struct job_record *job_ptr)
 		job_ptr->end_time           = now;
 		job_ptr->time_last_active   = now;
 		job_ptr->job_state          = JOB_TIMEOUT | JOB_COMPLETING;
+		job_index_update(job_ptr);
 		build_cg_bitmap(job_ptr);
 		job_ptr->exit_code = MAX(job_ptr->exit_code, 1);
 		deallocate_nodes(job_ptr, true, false, false);
@@ -5113,22 +5297,16 @@ static int _validate_job_desc(job_desc_msg_t * job_desc_msg, int allocate,
 static void _list_delete_job(void *job_entry)
 {
 	struct job_record *job_ptr = (struct job_record *) job_entry;
-	struct job_record **job_pptr;
 	int i;
 
 	xassert(job_entry);
 	xassert (job_ptr->magic == JOB_MAGIC);
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
+	job_index_remove(job_ptr);
 
 	/* Remove the record from the hash table */
-	job_pptr = &job_hash[JOB_HASH_INX(job_ptr->job_id)];
-	while ((job_pptr != NULL) &&
-	       ((job_ptr = *job_pptr) != (struct job_record *) job_entry)) {
-		job_pptr = &job_ptr->job_next;
-	}
-	if (job_pptr == NULL)
+	if (job_hash_remove(job_ptr->job_id) != job_ptr)
 		fatal("job hash error");
-	*job_pptr = job_ptr->job_next;
 
 	delete_job_details(job_ptr);
 	xfree(job_ptr->account);
@@ -5196,6 +5374,13 @@ static int _list_find_job_old(void *job_entry, void *key)
 	time_t kill_age, min_age, now = time(NULL);;
 	struct job_record *job_ptr = (struct job_record *)job_entry;
 
+	/* Every job is tested here periodically, so repair any index entry
+	 * left stale by a change which failed to call job_index_update() */
+	if (job_index_update(job_ptr)) {
+		error("job_index: entries of job %u were out of date",
+		      job_ptr->job_id);
+	}
+
 	if (IS_JOB_COMPLETING(job_ptr)) {
 		kill_age = now - (slurmctld_conf.kill_wait +
 				  2 * slurm_get_msg_timeout());
@@ -5226,6 +5411,104 @@ static int _list_find_job_old(void *job_entry, void *key)
 }
 
 
+/* Test if any partition of a comma separated list is named in a job
+ * information filter */
+static bool _filter_part_match(char *part_names, job_info_filter_t *filter)
+{
+	char *token = part_names, *sep;
+	int i, len;
+
+	while (token) {
+		sep = strchr(token, ',');
+		len = sep ? (sep - token) : strlen(token);
+		for (i = 0; i < filter->partition_cnt; i++) {
+			if (!strncmp(token, filter->partitions[i], len) &&
+			    (filter->partitions[i][len] == '\0'))
+				return true;
+		}
+		token = sep ? (sep + 1) : NULL;
+	}
+	return false;
+}
+
+/*
+ * job_filter_match - test if a job matches a job information filter
+ * IN job_ptr - job to test
+ * IN filter - filter from a job or job step information request, may be
+ *	NULL to match all jobs
+ * RET true if the job should be reported
+ */
+extern bool job_filter_match(struct job_record *job_ptr,
+			     job_info_filter_t *filter)
+{
+	int i;
+
+	if (filter == NULL)
+		return true;
+
+	if (filter->job_id_cnt) {
+		for (i = 0; i < filter->job_id_cnt; i++) {
+			if (filter->job_ids[i] == job_ptr->job_id)
+				break;
+		}
+		if (i >= filter->job_id_cnt)
+			return false;
+	}
+
+	if (filter->user_cnt) {
+		for (i = 0; i < filter->user_cnt; i++) {
+			if (filter->user_ids[i] == job_ptr->user_id)
+				break;
+		}
+		if (i >= filter->user_cnt)
+			return false;
+	}
+
+	if (filter->state_cnt) {
+		for (i = 0; i < filter->state_cnt; i++) {
+			uint16_t state = filter->states[i];
+			if ((state == (job_ptr->job_state & JOB_STATE_BASE)) ||
+			    ((state == JOB_COMPLETING) &&
+			     IS_JOB_COMPLETING(job_ptr)) ||
+			    ((state == JOB_CONFIGURING) &&
+			     IS_JOB_CONFIGURING(job_ptr)))
+				break;
+		}
+		if (i >= filter->state_cnt)
+			return false;
+	}
+
+	/* A pending job may be queued in several partitions */
+	if (filter->partition_cnt &&
+	    ((job_ptr->partition == NULL) ||
+	     !_filter_part_match(job_ptr->partition, filter)))
+		return false;
+
+	if (filter->account_cnt) {
+		if (job_ptr->account == NULL)
+			return false;
+		for (i = 0; i < filter->account_cnt; i++) {
+			if (!strcasecmp(filter->accounts[i], job_ptr->account))
+				break;
+		}
+		if (i >= filter->account_cnt)
+			return false;
+	}
+
+	if (filter->name_cnt) {
+		if (job_ptr->name == NULL)
+			return false;
+		for (i = 0; i < filter->name_cnt; i++) {
+			if (!strcmp(filter->names[i], job_ptr->name))
+				break;
+		}
+		if (i >= filter->name_cnt)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * pack_all_jobs - dump all job information for all jobs in
  *	machine independent form (for network transmission)
@@ -5233,6 +5516,7 @@ static int _list_find_job_old(void *job_entry, void *key)
  * OUT buffer_size - set to size of the buffer in bytes
  * IN show_flags - job filtering options
  * IN uid - uid of user making request (for partition filtering)
+ * IN filter - jobs to pack, NULL for all jobs
  * global: job_list - global list of job records
  * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
  * NOTE: change _unpack_job_desc_msg() in common/slurm_protocol_pack.c
@@ -5240,7 +5524,8 @@ static int _list_find_job_old(void *job_entry, void *key)
  */
 extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid,
-			  uint16_t protocol_version)
+			  uint16_t protocol_version,
+			  job_info_filter_t *filter)
 {
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
@@ -5282,6 +5567,9 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
 			continue;	/* job ready for purging, don't dump */
 
+		if (!job_filter_match(job_ptr, filter))
+			continue;
+
 		pack_job(job_ptr, show_flags, buffer, protocol_version, uid);
 		jobs_packed++;
 	}
@@ -5871,12 +6159,16 @@ static void _pack_pending_job_details(struct job_details *detail_ptr,
  */
 void purge_old_job(void)
 {
+	List job_queue;
 	ListIterator job_iterator;
 	struct job_record  *job_ptr;
 	time_t now = time(NULL);
 	int i;
 
-	job_iterator = list_iterator_create(job_list);
+	job_queue = job_index_state_jobs(JOB_PENDING);
+	job_iterator = list_iterator_create(job_queue);
+	if (job_iterator == NULL)
+		fatal("list_iterator_create malloc failure");
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if (!IS_JOB_PENDING(job_ptr))
 			continue;
@@ -5884,6 +6176,7 @@ void purge_old_job(void)
 			info("Job dependency can't be satisfied, cancelling "
 			     "job %u", job_ptr->job_id);
 			job_ptr->job_state	= JOB_CANCELLED;
+			job_index_update(job_ptr);
 			xfree(job_ptr->state_desc);
 			job_ptr->start_time	= now;
 			job_ptr->end_time	= now;
@@ -5893,6 +6186,7 @@ void purge_old_job(void)
 		}
 	}
 	list_iterator_destroy(job_iterator);
+	list_destroy(job_queue);
 
 	i = list_delete_all(job_list, &_list_find_job_old, "");
 	if (i) {
@@ -5924,13 +6218,16 @@ static int _purge_job_record(uint32_t job_id)
 void reset_job_bitmaps(void)
 {
 	ListIterator job_iterator;
-	struct job_record  *job_ptr;
+	struct job_record  *job_ptr, **job_array;
 	struct part_record *part_ptr;
 	List part_ptr_list = NULL;
 	bool job_fail = false;
 	time_t now = time(NULL);
 	bool gang_flag = false;
 	static uint32_t cr_flag = NO_VAL;
+	uint32_t job_cnt, i;
+	uint8_t *fail;
+	DEF_TIMERS;
 
 	xassert(job_list);
 
@@ -5945,8 +6242,21 @@ void reset_job_bitmaps(void)
 	if (slurm_get_preempt_mode() == PREEMPT_MODE_GANG)
 		gang_flag = true;
 
+	/* Expanding node lists into bitmaps is most of the work here and
+	 * only touches each job's own records, so do that first in
+	 * parallel */
+	START_TIMER;
+	job_cnt = list_count(job_list);
+	job_array = xmalloc(sizeof(struct job_record *) * MAX(job_cnt, 1));
+	fail = xmalloc(sizeof(uint8_t) * MAX(job_cnt, 1));
 	job_iterator = list_iterator_create(job_list);
-	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+	for (i = 0; i < job_cnt; i++)
+		job_array[i] = (struct job_record *) list_next(job_iterator);
+	_reset_node_bitmaps(job_array, fail, job_cnt);
+	list_iterator_reset(job_iterator);
+
+	for (i = 0; i < job_cnt; i++) {
+		job_ptr = job_array[i];
 		xassert (job_ptr->magic == JOB_MAGIC);
 		job_fail = false;
 
@@ -5974,20 +6284,15 @@ void reset_job_bitmaps(void)
 			job_ptr->part_ptr_list = part_ptr_list;
 			part_ptr_list = NULL;	/* clear for next job */
 		}
+		job_index_update(job_ptr);
 
-		FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
-		if (job_ptr->nodes_completing &&
-		    node_name2bitmap(job_ptr->nodes_completing,
-				     false,  &job_ptr->node_bitmap_cg)) {
+		if (fail[i] & RESET_FAIL_NODES_CG) {
 			error("Invalid nodes (%s) for job_id %u",
 			      job_ptr->nodes_completing,
 			      job_ptr->job_id);
 			job_fail = true;
 		}
-		FREE_NULL_BITMAP(job_ptr->node_bitmap);
-		if (job_ptr->nodes &&
-		    node_name2bitmap(job_ptr->nodes, false,
-				     &job_ptr->node_bitmap) && !job_fail) {
+		if ((fail[i] & RESET_FAIL_NODES) && !job_fail) {
 			error("Invalid nodes (%s) for job_id %u",
 		    	      job_ptr->nodes, job_ptr->job_id);
 			job_fail = true;
@@ -6007,7 +6312,7 @@ void reset_job_bitmaps(void)
 		_reset_step_bitmaps(job_ptr);
 		build_node_details(job_ptr);	/* set node_addr */
 
-		if (_reset_detail_bitmaps(job_ptr))
+		if (fail[i] & RESET_FAIL_DETAILS)
 			job_fail = true;
 
 		if (job_fail) {
@@ -6015,15 +6320,18 @@ void reset_job_bitmaps(void)
 				job_ptr->start_time =
 					job_ptr->end_time = time(NULL);
 				job_ptr->job_state = JOB_NODE_FAIL;
+				job_index_update(job_ptr);
 			} else if (IS_JOB_RUNNING(job_ptr)) {
 				job_ptr->end_time = time(NULL);
 				job_ptr->job_state = JOB_NODE_FAIL |
 					JOB_COMPLETING;
+				job_index_update(job_ptr);
 				build_cg_bitmap(job_ptr);
 			} else if (IS_JOB_SUSPENDED(job_ptr)) {
 				job_ptr->end_time = job_ptr->suspend_time;
 				job_ptr->job_state = JOB_NODE_FAIL |
 					JOB_COMPLETING;
+				job_index_update(job_ptr);
 				build_cg_bitmap(job_ptr);
 				job_ptr->tot_sus_time +=
 					difftime(now, job_ptr->suspend_time);
@@ -6037,7 +6345,6 @@ void reset_job_bitmaps(void)
 		}
 	}
 
-	list_iterator_reset(job_iterator);
 	/* This will reinitialize the select plugin database, which
 	 * we can only do after ALL job's states and bitmaps are set
 	 * (i.e. it needs to be in this second loop) */
@@ -6048,8 +6355,98 @@ void reset_job_bitmaps(void)
 		}
 	}
 	list_iterator_destroy(job_iterator);
+	xfree(job_array);
+	xfree(fail);
 
 	last_job_update = now;
+	END_TIMER2("reset_job_bitmaps");
+	debug("reset_job_bitmaps: reset %u jobs %s", job_cnt, TIME_STR);
+}
+
+/* Build the node bitmaps of one job from its node lists.
+ * RET RESET_FAIL_* flags for bitmaps with invalid node lists */
+static uint8_t _reset_job_node_bitmaps(struct job_record *job_ptr)
+{
+	uint8_t fail = 0;
+
+	FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
+	if (job_ptr->nodes_completing &&
+	    node_name2bitmap(job_ptr->nodes_completing,
+			     false,  &job_ptr->node_bitmap_cg))
+		fail |= RESET_FAIL_NODES_CG;
+	FREE_NULL_BITMAP(job_ptr->node_bitmap);
+	if (job_ptr->nodes &&
+	    node_name2bitmap(job_ptr->nodes, false, &job_ptr->node_bitmap))
+		fail |= RESET_FAIL_NODES;
+	if (_reset_detail_bitmaps(job_ptr))
+		fail |= RESET_FAIL_DETAILS;
+	return fail;
+}
+
+static void *_reset_bitmap_thread(void *args)
+{
+	reset_bitmap_args_t *reset_args = (reset_bitmap_args_t *) args;
+	uint32_t i, end;
+
+	while (1) {
+		slurm_mutex_lock(&reset_args->lock);
+		i = reset_args->next_inx;
+		end = MIN(i + RESET_BITMAP_CHUNK, reset_args->job_cnt);
+		reset_args->next_inx = end;
+		slurm_mutex_unlock(&reset_args->lock);
+		if (i >= end)
+			break;
+		for ( ; i < end; i++) {
+			reset_args->fail[i] = _reset_job_node_bitmaps(
+						reset_args->job_array[i]);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * _reset_node_bitmaps - build the node bitmaps of many jobs, using a
+ *	thread per processor for large job counts. Node names are only
+ *	looked up, so the node table must not change meanwhile.
+ * IN job_array - jobs to process
+ * OUT fail - RESET_FAIL_* flags for each job
+ * IN job_cnt - number of jobs in job_array
+ */
+static void _reset_node_bitmaps(struct job_record **job_array,
+				uint8_t *fail, uint32_t job_cnt)
+{
+	reset_bitmap_args_t reset_args;
+	pthread_t thread_id[RESET_BITMAP_THREADS];
+	pthread_attr_t attr;
+	int thread_cnt = 1, i;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	if (job_cnt >= RESET_BITMAP_MIN_JOBS)
+		thread_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	thread_cnt = MIN(thread_cnt, RESET_BITMAP_THREADS);
+
+	memset(&reset_args, 0, sizeof(reset_bitmap_args_t));
+	reset_args.job_array = job_array;
+	reset_args.fail = fail;
+	reset_args.job_cnt = job_cnt;
+	slurm_mutex_init(&reset_args.lock);
+
+	/* This thread is one of the workers */
+	slurm_attr_init(&attr);
+	for (i = 1; i < thread_cnt; i++) {
+		if (pthread_create(&thread_id[i], &attr, _reset_bitmap_thread,
+				   &reset_args)) {
+			error("pthread_create error %m");
+			break;
+		}
+	}
+	slurm_attr_destroy(&attr);
+	thread_cnt = i;
+	(void) _reset_bitmap_thread(&reset_args);
+	for (i = 1; i < thread_cnt; i++)
+		pthread_join(thread_id[i], NULL);
+	slurm_mutex_destroy(&reset_args.lock);
 }
 
 static int _reset_detail_bitmaps(struct job_record *job_ptr)
@@ -6178,6 +6575,7 @@ static void _set_job_prio(struct job_record *job_ptr)
 		return;
 	job_ptr->priority = slurm_sched_initial_priority(lowest_prio,
 							 job_ptr);
+	job_index_update(job_ptr);
 	if ((job_ptr->priority <= 1) ||
 	    (job_ptr->direct_set_prio) ||
 	    (job_ptr->details && (job_ptr->details->nice != NICE_OFFSET)))
@@ -6201,8 +6599,10 @@ extern void sync_job_priorities(void)
 		return;
 
 	job_iterator = list_iterator_create(job_list);
-	while ((job_ptr = (struct job_record *) list_next(job_iterator)))
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		job_ptr->priority += prio_boost;
+		job_index_update(job_ptr);
+	}
 	list_iterator_destroy(job_iterator);
 	lowest_prio += prio_boost;
 }
@@ -6594,6 +6994,7 @@ int update_job(job_desc_msg_t * job_specs, uid_t uid)
 			FREE_NULL_LIST(job_ptr->part_ptr_list);
 			job_ptr->part_ptr_list = part_ptr_list;
 			part_ptr_list = NULL;	/* nothing to free */
+			job_index_update(job_ptr);
 			info("update_job: setting partition to %s for "
 			     "job_id %u", job_specs->partition,
 			     job_specs->job_id);
@@ -7066,6 +7467,7 @@ int update_job(job_desc_msg_t * job_specs, uid_t uid)
 			} else {
 				job_ptr->direct_set_prio = 1;
 				job_ptr->priority = job_specs->priority;
+				job_index_update(job_ptr);
 			}
 			info("sched: update_job: setting priority to %u for "
 			     "job_id %u", job_ptr->priority,
@@ -7101,6 +7503,7 @@ int update_job(job_desc_msg_t * job_specs, uid_t uid)
 			new_prio += job_ptr->details->nice;
 			new_prio -= job_specs->nice;
 			job_ptr->priority = MAX(new_prio, 2);
+			job_index_update(job_ptr);
 			job_ptr->details->nice = job_specs->nice;
 			info("sched: update_job: setting priority to %u for "
 			     "job_id %u", job_ptr->priority,
@@ -8262,6 +8665,7 @@ static void _validate_job_files(List batch_dirs)
 			error("Script for job %u lost, state set to FAILED",
 			      job_ptr->job_id);
 			job_ptr->job_state = JOB_FAILED;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = 1;
 			job_ptr->state_reason = FAIL_SYSTEM;
 			xfree(job_ptr->state_desc);
@@ -8493,7 +8897,8 @@ void job_fini (void)
 		list_destroy(job_list);
 		job_list = NULL;
 	}
-	xfree(job_hash);
+	job_hash_fini();
+	job_journal_fini();
 }
 
 /* log the completion of the specified job */
@@ -8590,6 +8995,7 @@ extern bool job_independent(struct job_record *job_ptr, int will_run)
 		info("Job dependency can't be satisfied, cancelling job %u",
 		     job_ptr->job_id);
 		job_ptr->job_state	= JOB_CANCELLED;
+		job_index_update(job_ptr);
 		xfree(job_ptr->state_desc);
 		job_ptr->start_time	= now;
 		job_ptr->end_time	= now;
@@ -8613,15 +9019,20 @@ extern bool job_independent(struct job_record *job_ptr, int will_run)
 
 	/* Job is eligible to start now */
 	if (job_ptr->state_reason == WAIT_DEPENDENCY) {
+		/* Passes testing only the partitions with changes would
+		 * skip its partition, so report the change */
 		job_ptr->state_reason = WAIT_NO_REASON;
 		xfree(job_ptr->state_desc);
+		queue_job_scheduler_part(job_ptr);
 	}
 	if ((detail_ptr && (detail_ptr->begin_time == 0) &&
 	    (job_ptr->priority != 0))) {
 		detail_ptr->begin_time = now;
+		queue_job_scheduler_part(job_ptr);
 	} else if (job_ptr->state_reason == WAIT_TIME) {
 		job_ptr->state_reason = WAIT_NO_REASON;
 		xfree(job_ptr->state_desc);
+		queue_job_scheduler_part(job_ptr);
 	}
 	return true;
 }
@@ -8921,6 +9332,7 @@ extern int job_suspend(suspend_msg_t *sus_ptr, uid_t uid,
 			goto reply;
 		_suspend_job(job_ptr, sus_ptr->op);
 		job_ptr->job_state = JOB_SUSPENDED;
+		job_index_update(job_ptr);
 		if (clear_prio)
 			job_ptr->priority = 0;
 		if (job_ptr->suspend_time) {
@@ -8943,6 +9355,7 @@ extern int job_suspend(suspend_msg_t *sus_ptr, uid_t uid,
 			goto reply;
 		_suspend_job(job_ptr, sus_ptr->op);
 		job_ptr->job_state = JOB_RUNNING;
+		job_index_update(job_ptr);
 		job_ptr->tot_sus_time +=
 			difftime(now, job_ptr->suspend_time);
 		if (!wiki_sched_test) {
@@ -9071,12 +9484,14 @@ extern int job_requeue (uid_t uid, uint32_t job_id, slurm_fd_t conn_fd,
 	 * accounting logs. Set a new submit time so the restarted
 	 * job looks like a new job. */
 	job_ptr->job_state  = JOB_CANCELLED;
+	job_index_update(job_ptr);
 	build_cg_bitmap(job_ptr);
 	deallocate_nodes(job_ptr, false, suspended, preempt);
 	xfree(job_ptr->details->req_node_layout);
 	job_completion_logger(job_ptr, true);
 	job_ptr->db_index = 0;
 	job_ptr->job_state = JOB_PENDING;
+	job_index_update(job_ptr);
 	if (job_ptr->node_cnt)
 		job_ptr->job_state |= JOB_COMPLETING;
 
@@ -9427,6 +9842,7 @@ extern int send_jobs_to_accounting(void)
 				     "invalid association",
 				     job_ptr->job_id);
 				job_ptr->job_state = JOB_CANCELLED;
+				job_index_update(job_ptr);
 				job_ptr->state_reason = FAIL_ACCOUNT;
 				if (IS_JOB_PENDING(job_ptr))
 					job_ptr->start_time = now;
@@ -46,6 +46,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include "src/common/assoc_mgr.h"
@@ -61,6 +62,7 @@
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
@@ -68,11 +70,19 @@
 #include "src/slurmctld/preempt.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
+#include "src/slurmctld/state_save.h"
 
 #define _DEBUG 0
 #define MAX_RETRIES 10
+#define SCHED_MAX_PART_HINTS	64	/* beyond this test every partition */
+#define SCHED_MIN_INTERVAL	1000000	/* usec between schedule() runs */
+#define SCHED_MAX_PART_THREADS	16	/* limit of sched_part_threads */
+
+diag_stats_t slurmctld_diag_stats;
+pthread_mutex_t slurmctld_diag_stats_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static char **	_build_env(struct job_record *job_ptr);
 static void	_depend_list_del(void *dep_ptr);
@@ -83,10 +93,65 @@ static void	_job_queue_rec_del(void *x);
 static void *	_run_epilog(void *arg);
 static void *	_run_prolog(void *arg);
 static bool	_scan_depend(List dependency_list, uint32_t job_id);
+static int	_schedule(uint32_t job_limit, List part_hints,
+			  bitstr_t *node_hints);
 static int	_valid_feature_list(uint32_t job_id, List feature_list);
 static int	_valid_node_feature(char *feature);
 
 
+/* Requests queued for the scheduler thread, see queue_job_scheduler() */
+static pthread_mutex_t sched_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sched_queue_cond = PTHREAD_COND_INITIALIZER;
+static int  sched_requests = 0;
+static bool sched_all_parts = false;	/* test every partition */
+static bool sched_full_queue = false;	/* test every pending job */
+static List sched_part_hints = NULL;	/* names of partitions to test */
+static bitstr_t *sched_node_hints = NULL; /* nodes made available */
+static bool run_sched_thread = true;
+static uint32_t sched_min_interval = SCHED_MIN_INTERVAL;
+
+/* Partitions which share no nodes with others, tested by one thread */
+typedef struct sched_domain {
+	List job_queue;			/* job_queue_rec_t in priority order */
+	struct part_record **failed_parts;
+	int failed_part_cnt;
+	int job_cnt;			/* jobs started */
+	bool exit_depth;
+	bool exit_timeout;
+} sched_domain_t;
+
+/* State of one _schedule() pass, shared by its domain threads */
+typedef struct sched_pass {
+	pthread_mutex_t lock;		/* serializes updates of shared state */
+	uint32_t job_limit;		/* jobs to test in all domains */
+	uint32_t job_depth;		/* jobs tested in all domains */
+	time_t now;
+	time_t sched_start;
+	int sched_timeout;
+	bool backfill_sched;
+	bool wiki_sched;
+	struct part_record **skip_parts;
+	int skip_part_cnt;
+	bitstr_t *usable_node_bitmap;	/* see _job_cannot_fit() */
+	sched_domain_t *domains;
+	int domain_cnt;
+	int next_domain;		/* next domain for a thread to test */
+	int thread_cnt;			/* threads to test domains */
+} sched_pass_t;
+
+/* Domain threads, started as sched_part_threads requires and lasting until
+ * the scheduler shuts down. Each pass with several domains is published in
+ * sched_pool_pass for them, protected by sched_pool_lock. */
+static pthread_mutex_t sched_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sched_pool_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  sched_pool_done_cond = PTHREAD_COND_INITIALIZER;
+static sched_pass_t *sched_pool_pass = NULL;
+static uint32_t sched_pool_gen = 0;	/* passes published */
+static int  sched_pool_busy = 0;	/* threads testing sched_pool_pass */
+static int  sched_pool_cnt = 0;		/* threads started */
+static bool sched_pool_shutdown = false;
+static pthread_t sched_pool_id[SCHED_MAX_PART_THREADS];
+
 /*
  * _build_user_job_list - build list of jobs for a given user
  *			  and an optional job name
@@ -101,20 +166,16 @@ static List _build_user_job_list(uint32_t user_id, char* job_name)
 	ListIterator job_iterator;
 	struct job_record *job_ptr = NULL;
 
-	job_queue = list_create(NULL);
-	if (job_queue == NULL)
-		fatal("list_create memory allocation failure");
-	job_iterator = list_iterator_create(job_list);
+	job_queue = job_index_user_jobs(user_id);
+	if (job_name == NULL)
+		return job_queue;
+	job_iterator = list_iterator_create(job_queue);
 	if (job_iterator == NULL)
 		fatal("list_iterator_create malloc failure");
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
-		if (job_ptr->user_id != user_id)
-			continue;
-		if (job_name && job_ptr->name &&
-		    strcmp(job_name, job_ptr->name))
-			continue;
-		list_append(job_queue, job_ptr);
+		if (job_ptr->name && strcmp(job_name, job_ptr->name))
+			list_delete_item(job_iterator);
 	}
 	list_iterator_destroy(job_iterator);
 
@@ -138,14 +199,15 @@ static void _job_queue_rec_del(void *x)
 }
 
 /*
- * build_job_queue - build (non-priority ordered) list of pending jobs
+ * build_job_queue - build list of pending jobs in the order they are to be
+ *	considered for scheduling, see sort_job_queue2()
  * IN clear_start - if set then clear the start_time for pending jobs
  * RET the job queue
  * NOTE: the caller must call list_destroy() on RET value to free memory
  */
 extern List build_job_queue(bool clear_start)
 {
-	List job_queue;
+	List job_queue, pending_list;
 	ListIterator job_iterator, part_iterator;
 	struct job_record *job_ptr = NULL;
 	struct part_record *part_ptr;
@@ -155,7 +217,11 @@ extern List build_job_queue(bool clear_start)
 	job_queue = list_create(_job_queue_rec_del);
 	if (job_queue == NULL)
 		fatal("list_create memory allocation failure");
-	job_iterator = list_iterator_create(job_list);
+	/* Only pending jobs are candidates. The job index keeps them in
+	 * priority order, so the queue only needs sorting when preemption
+	 * adds a partition or QOS based order ahead of job priority */
+	pending_list = job_index_prio_jobs();
+	job_iterator = list_iterator_create(pending_list);
 	if (job_iterator == NULL)
 		fatal("list_iterator_create memory allocation failure");
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
@@ -210,6 +276,7 @@ extern List build_job_queue(bool clear_start)
 					continue;
 				}
 				job_ptr->part_ptr = part_ptr;
+				job_index_update(job_ptr);
 				error("partition pointer reset for job %u, "
 				      "part %s", job_ptr->job_id,
 				      job_ptr->partition);
@@ -219,6 +286,9 @@ extern List build_job_queue(bool clear_start)
 		}
 	}
 	list_iterator_destroy(job_iterator);
+	list_destroy(pending_list);
+	if (slurm_preemption_enabled())
+		sort_job_queue(job_queue);
 
 	return job_queue;
 }
@@ -310,6 +380,50 @@ static bool _failed_partition(struct part_record *part_ptr,
 	return false;
 }
 
+static int _find_part_name(void *x, void *key)
+{
+	return (strcmp((char *) x, (char *) key) == 0);
+}
+
+/* Build an array of the partitions in which neither part_hints nor
+ * node_hints report a change, their jobs need not be tested. Return NULL
+ * if every partition is to be tested. */
+static struct part_record **_skip_parts(List part_hints, bitstr_t *node_hints,
+					int *skip_part_cnt)
+{
+	struct part_record **skip_parts, *part_ptr;
+	ListIterator part_iterator;
+	int part_cnt = 0;
+
+	*skip_part_cnt = 0;
+	if ((part_hints == NULL) && (node_hints == NULL))
+		return NULL;
+	if (node_hints && (bit_size(node_hints) != node_record_count))
+		return NULL;	/* nodes changed by reconfiguration */
+
+	skip_parts = xmalloc(sizeof(struct part_record *) *
+			     list_count(part_list));
+	part_iterator = list_iterator_create(part_list);
+	if (part_iterator == NULL)
+		fatal("list_iterator_create malloc failure");
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		part_cnt++;
+		if (node_hints && part_ptr->node_bitmap &&
+		    bit_overlap(node_hints, part_ptr->node_bitmap))
+			continue;
+		if (part_hints &&
+		    list_find_first(part_hints, _find_part_name,
+				    part_ptr->name))
+			continue;
+		skip_parts[(*skip_part_cnt)++] = part_ptr;
+	}
+	list_iterator_destroy(part_iterator);
+	debug2("sched: testing jobs in %d of %d partitions",
+	       (part_cnt - *skip_part_cnt), part_cnt);
+
+	return skip_parts;
+}
+
 /*
  * schedule - attempt to schedule all pending jobs
  *	pending jobs for each partition will be scheduled in priority
@@ -318,122 +432,282 @@ static bool _failed_partition(struct part_record *part_ptr,
  *		  queue on every job submit (0 means to use the system default,
  *		  SchedulerParameters for default_queue_depth)
  * RET count of jobs scheduled
- * Note: We re-build the queue every time. Jobs can not only be added
- *	or removed from the queue, but have their priority or partition
- *	changed with the update_job RPC. In general nodes will be in priority
- *	order (by submit time), so the sorting should be pretty fast.
+ * NOTE: RPCs should use queue_job_scheduler() rather than calling this
+ *	directly, so that bursts of events result in one scheduling pass.
  */
 extern int schedule(uint32_t job_limit)
 {
-	List job_queue = NULL;
-	int error_code, failed_part_cnt = 0, job_cnt = 0, i;
-	uint32_t job_depth = 0;
+	return _schedule(job_limit, NULL, NULL);
+}
+
+/* Union-find over partition indexes, see _build_sched_domains() */
+static int _domain_root(int *parent, int inx)
+{
+	while (parent[inx] != inx) {
+		parent[inx] = parent[parent[inx]];
+		inx = parent[inx];
+	}
+	return inx;
+}
+
+static void _domain_unite(int *parent, int inx1, int inx2)
+{
+	inx1 = _domain_root(parent, inx1);
+	inx2 = _domain_root(parent, inx2);
+	if (inx1 < inx2)
+		parent[inx2] = inx1;
+	else if (inx2 < inx1)
+		parent[inx1] = inx2;
+}
+
+/*
+ * _build_sched_domains - split a job queue into scheduling domains, sets of
+ *	partitions which share no nodes with other domains. A job which may
+ *	run in several partitions places all of them in one domain.
+ * IN/OUT job_queue - records are moved from here into the domain queues,
+ *	each of which keeps the order of job_queue
+ * OUT domain_cnt - number of domains with jobs to test
+ * RET array of domain_cnt domains, free with _free_sched_domains()
+ */
+static sched_domain_t *_build_sched_domains(List job_queue, int *domain_cnt)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr, **parts;
 	job_queue_rec_t *job_queue_rec;
 	struct job_record *job_ptr;
-	struct part_record *part_ptr, **failed_parts = NULL;
-	bitstr_t *save_avail_node_bitmap;
-	/* Locks: Read config, write job, write node, read partition */
-	slurmctld_lock_t job_write_lock =
-	    { READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
-#ifdef HAVE_BG
-	char *ionodes = NULL;
-	char tmp_char[256];
-#endif
-	static bool backfill_sched = false;
-	static time_t sched_update = 0;
-	static bool wiki_sched = false;
-	static int sched_timeout = 0;
-	static int def_job_limit = 100;
-	time_t now = time(NULL), sched_start;
-
-	DEF_TIMERS;
+	ListIterator job_iterator;
+	sched_domain_t *domains;
+	int *parent, *domain_inx, part_cnt, i, j;
+
+	part_cnt = list_count(part_list);
+	parts = xmalloc(sizeof(struct part_record *) * (part_cnt + 1));
+	parent = xmalloc(sizeof(int) * (part_cnt + 1));
+	domain_inx = xmalloc(sizeof(int) * (part_cnt + 1));
+	part_iterator = list_iterator_create(part_list);
+	if (part_iterator == NULL)
+		fatal("list_iterator_create malloc failure");
+	i = 0;
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		part_ptr->sched_domain = i;
+		parts[i] = part_ptr;
+		parent[i] = i;
+		domain_inx[i] = -1;
+		i++;
+	}
+	list_iterator_destroy(part_iterator);
 
-	sched_start = now;
-	if (sched_timeout == 0) {
-		sched_timeout = slurm_get_msg_timeout() / 2;
-		sched_timeout = MAX(sched_timeout, 1);
-		sched_timeout = MIN(sched_timeout, 10);
+	for (i = 0; i < part_cnt; i++) {
+		if (parts[i]->node_bitmap == NULL)
+			continue;
+		for (j = i + 1; j < part_cnt; j++) {
+			if (parts[j]->node_bitmap &&
+			    bit_overlap(parts[i]->node_bitmap,
+					parts[j]->node_bitmap))
+				_domain_unite(parent, i, j);
+		}
 	}
 
-	START_TIMER;
-	if (sched_update != slurmctld_conf.last_update) {
-		char *sched_params, *tmp_ptr;
-		char *sched_type = slurm_get_sched_type();
-		/* On BlueGene, do FIFO only with sched/backfill */
-		if (strcmp(sched_type, "sched/backfill") == 0)
-			backfill_sched = true;
-		/* Disable avoiding of fragmentation with sched/wiki */
-		if ((strcmp(sched_type, "sched/wiki") == 0) ||
-		    (strcmp(sched_type, "sched/wiki2") == 0))
-			wiki_sched = true;
-		xfree(sched_type);
+	/* Jobs are only queued against partitions in their part_ptr_list,
+	 * so uniting each queued partition with the first of the job's
+	 * list places all of them in one domain */
+	job_iterator = list_iterator_create(job_queue);
+	if (job_iterator == NULL)
+		fatal("list_iterator_create malloc failure");
+	while ((job_queue_rec = (job_queue_rec_t *) list_next(job_iterator))) {
+		job_ptr = job_queue_rec->job_ptr;
+		if (job_ptr->part_ptr_list == NULL)
+			continue;
+		part_ptr = list_peek(job_ptr->part_ptr_list);
+		_domain_unite(parent, job_queue_rec->part_ptr->sched_domain,
+			      part_ptr->sched_domain);
+	}
+	list_iterator_destroy(job_iterator);
 
-		sched_params = slurm_get_sched_params();
-		if (sched_params &&
-		    (tmp_ptr=strstr(sched_params, "default_queue_depth="))) {
-		/*                                 01234567890123456789 */
-			i = atoi(tmp_ptr + 20);
-			if (i < 0) {
-				error("ignoring SchedulerParameters: "
-				      "default_queue_depth value of %d", i);
-			} else {
-				      def_job_limit = i;
-			}
+	*domain_cnt = 0;
+	domains = xmalloc(sizeof(sched_domain_t) * (part_cnt + 1));
+	while ((job_queue_rec = list_pop(job_queue))) {
+		i = _domain_root(parent, job_queue_rec->part_ptr->sched_domain);
+		if (domain_inx[i] == -1) {
+			domain_inx[i] = (*domain_cnt)++;
+			domains[domain_inx[i]].job_queue =
+				list_create(_job_queue_rec_del);
+			if (domains[domain_inx[i]].job_queue == NULL)
+				fatal("list_create malloc failure");
+			domains[domain_inx[i]].failed_parts =
+				xmalloc(sizeof(struct part_record *) *
+					part_cnt);
 		}
-		xfree(sched_params);
-		sched_update = slurmctld_conf.last_update;
+		list_append(domains[domain_inx[i]].job_queue, job_queue_rec);
 	}
-	if (job_limit == 0)
-		job_limit = def_job_limit;
 
-	lock_slurmctld(job_write_lock);
-	if (!avail_front_end()) {
-		unlock_slurmctld(job_write_lock);
-		debug("sched: schedule() returning, no front end nodes are "
-		       "available");
-		return SLURM_SUCCESS;
-	}
-	/* Avoid resource fragmentation if important */
-	if ((!wiki_sched) && job_is_completing()) {
-		unlock_slurmctld(job_write_lock);
-		debug("sched: schedule() returning, some job is still "
-		       "completing");
-		return SLURM_SUCCESS;
+	xfree(parts);
+	xfree(parent);
+	xfree(domain_inx);
+	return domains;
+}
+
+static void _free_sched_domains(sched_domain_t *domains, int domain_cnt)
+{
+	int i;
+
+	for (i = 0; i < domain_cnt; i++) {
+		list_destroy(domains[i].job_queue);
+		xfree(domains[i].failed_parts);
 	}
+	xfree(domains);
+}
 
-#ifdef HAVE_CRAY
-	/*
-	 * Run a Basil Inventory immediately before scheduling, to avoid
-	 * race conditions caused by ALPS node state change (caused e.g.
-	 * by the node health checker).
-	 * This relies on the above write lock for the node state.
-	 */
-	if (select_g_reconfigure()) {
-		unlock_slurmctld(job_write_lock);
-		debug4("sched: not scheduling due to ALPS");
-		return SLURM_SUCCESS;
+/* Clear the bits of node_bitmap in avail_node_bitmap. node_bitmap is not
+ * modified, as threads testing other domains may be reading it.
+ * NOTE: pass->lock must be locked */
+static void _avail_node_clear(bitstr_t *node_bitmap)
+{
+	bitstr_t *tmp_bitmap = bit_copy(node_bitmap);
+
+	if (tmp_bitmap == NULL)
+		fatal("bit_copy malloc failure");
+	bit_not(tmp_bitmap);
+	bit_and(avail_node_bitmap, tmp_bitmap);
+	FREE_NULL_BITMAP(tmp_bitmap);
+}
+
+/* Reserve the nodes of a partition in which a job could not be started, so
+ * that lower priority jobs in other partitions can not delay it.
+ * NOTE: pass->lock must be locked */
+static void _fail_partition(sched_domain_t *domain, struct part_record *part_ptr)
+{
+	domain->failed_parts[domain->failed_part_cnt++] = part_ptr;
+	_avail_node_clear(part_ptr->node_bitmap);
+}
+
+/*
+ * _job_cannot_fit - test if the nodes of a job's partition which could
+ *	accept a job are too few, or could not hold the job even if nothing
+ *	else ran on them, for it to be started now. Runs without pass->lock,
+ *	the select plugin's SELECT_MODE_TEST_ONLY test only reads the nodes'
+ *	configuration and the job. This only rejects jobs which pass the
+ *	partition tests of select_nodes() and could run on all nodes of the
+ *	partition, so that the job's reason is the one select_nodes() would set.
+ * RET true if select_nodes() need not be called for the job
+ */
+static bool _job_cannot_fit(sched_pass_t *pass, struct job_record *job_ptr)
+{
+	struct part_record *part_ptr = job_ptr->part_ptr;
+	struct job_details *detail_ptr = job_ptr->details;
+	slurmdb_qos_rec_t *qos_ptr = (slurmdb_qos_rec_t *) job_ptr->qos_ptr;
+	uint32_t min_nodes, max_nodes;
+	bitstr_t *test_bitmap;
+	bool rc = false;
+
+	if ((pass->usable_node_bitmap == NULL) || (detail_ptr == NULL) ||
+	    job_ptr->resv_name || detail_ptr->req_node_bitmap ||
+	    (part_ptr->state_up != PARTITION_UP))
+		return false;
+	if (qos_ptr && (qos_ptr->flags & (QOS_FLAG_PART_MIN_NODE |
+					  QOS_FLAG_PART_MAX_NODE |
+					  QOS_FLAG_PART_TIME_LIMIT)))
+		return false;	/* QOS overrides partition limits */
+	if ((detail_ptr->min_nodes > part_ptr->total_nodes) ||
+	    (detail_ptr->min_nodes > part_ptr->max_nodes) ||
+	    ((detail_ptr->max_nodes != 0) &&
+	     (detail_ptr->max_nodes < part_ptr->min_nodes)) ||
+	    ((job_ptr->time_limit != NO_VAL) &&
+	     (job_ptr->time_limit > part_ptr->max_time)))
+		return false;	/* select_nodes() reports a partition limit */
+
+	/* Node counts as select_nodes() computes them */
+	min_nodes = MAX(detail_ptr->min_nodes, part_ptr->min_nodes);
+	if (detail_ptr->max_nodes == 0)
+		max_nodes = part_ptr->max_nodes;
+	else
+		max_nodes = MIN(detail_ptr->max_nodes, part_ptr->max_nodes);
+	max_nodes = MIN(max_nodes, 500000);	/* prevent overflows */
+	if (max_nodes < min_nodes)
+		return false;
+
+	test_bitmap = bit_copy(pass->usable_node_bitmap);
+	bit_and(test_bitmap, part_ptr->node_bitmap);
+	if (bit_set_count(test_bitmap) < min_nodes) {
+		rc = true;
+	} else if (select_g_job_test(job_ptr, test_bitmap, min_nodes,
+				     max_nodes, min_nodes,
+				     SELECT_MODE_TEST_ONLY, NULL, NULL) !=
+		   SLURM_SUCCESS) {
+		/* Leave jobs which could never run to select_nodes() */
+		bit_copybits(test_bitmap, part_ptr->node_bitmap);
+		if (select_g_job_test(job_ptr, test_bitmap, min_nodes,
+				      max_nodes, min_nodes,
+				      SELECT_MODE_TEST_ONLY, NULL, NULL) ==
+		    SLURM_SUCCESS)
+			rc = true;
 	}
-#endif
+	FREE_NULL_BITMAP(test_bitmap);
+	return rc;
+}
 
-	failed_parts = xmalloc(sizeof(struct part_record *) *
-			       list_count(part_list));
-	save_avail_node_bitmap = bit_copy(avail_node_bitmap);
+/*
+ * _sched_domain - attempt to schedule the pending jobs of one domain
+ *	in priority order. Domains share no partitions or nodes. The queue
+ *	walk and the tests which only read state shared with other domains,
+ *	or take their own locks, run unlocked, including the select plugin's
+ *	test of jobs which can not start now (see _job_cannot_fit()).
+ *	pass->lock is only held to
+ *	count the job against the pass's job limit, to update the job index,
+ *	and from select_nodes() through the handling of its result.
+ *	avail_node_bitmap is read unlocked: other domains only change the
+ *	bits of their own nodes, and only with pass->lock locked.
+ */
+static void _sched_domain(sched_pass_t *pass, sched_domain_t *domain)
+{
+	int error_code;
+	job_queue_rec_t *job_queue_rec;
+	struct job_record *job_ptr;
+	struct part_record *part_ptr;
+	time_t now = pass->now;
+#ifdef HAVE_BG
+	char *ionodes = NULL;
+	char tmp_char[256];
+#endif
 
-	debug("sched: Running job scheduler");
-	job_queue = build_job_queue(false);
-	while ((job_queue_rec = list_pop_bottom(job_queue, sort_job_queue2))) {
+	while ((job_queue_rec = list_pop(domain->job_queue))) {
 		job_ptr  = job_queue_rec->job_ptr;
 		part_ptr = job_queue_rec->part_ptr;
 		xfree(job_queue_rec);
-		if ((time(NULL) - sched_start) >= sched_timeout) {
+		if (pass->skip_parts && IS_JOB_PENDING(job_ptr) &&
+		    (job_ptr->priority != 0) &&
+		    _failed_partition(part_ptr, pass->skip_parts,
+				      pass->skip_part_cnt)) {
+			/* Nothing changed in this partition since it was
+			 * last tested. Its highest priority job is presumed
+			 * to still be blocked, so reserve its nodes as a
+			 * failed select_nodes() would below. */
+#ifdef HAVE_BG
+			if (!pass->backfill_sched)
+				continue;
+#endif
+			if (!_failed_partition(part_ptr, domain->failed_parts,
+					       domain->failed_part_cnt)) {
+				slurm_mutex_lock(&pass->lock);
+				_fail_partition(domain, part_ptr);
+				slurm_mutex_unlock(&pass->lock);
+			}
+			continue;
+		}
+		if ((time(NULL) - pass->sched_start) >= pass->sched_timeout) {
 			debug("sched: loop taking too long, breaking out");
+			domain->exit_timeout = true;
 			break;
 		}
-		if (job_depth++ > job_limit) {
+		slurm_mutex_lock(&pass->lock);
+		if (pass->job_depth++ > pass->job_limit) {
+			pass->job_depth--;
+			slurm_mutex_unlock(&pass->lock);
 			debug3("sched: already tested %u jobs, breaking out",
-			       job_depth);
+			       pass->job_depth);
+			domain->exit_depth = true;
 			break;
 		}
+		slurm_mutex_unlock(&pass->lock);
 		if (!IS_JOB_PENDING(job_ptr))
 			continue;	/* started in other partition */
 		if (job_ptr->priority == 0)	{ /* held */
@@ -445,13 +719,16 @@ extern int schedule(uint32_t job_limit)
 			       job_ptr->priority);
 			continue;
 		}
+		slurm_mutex_lock(&pass->lock);
 		if (job_ptr->part_ptr != part_ptr) {
 			/* Cycle through partitions usable for this job */
 			job_ptr->part_ptr = part_ptr;
+			job_index_update(job_ptr);
 		}
+		slurm_mutex_unlock(&pass->lock);
 		if ((job_ptr->resv_name == NULL) &&
-		    _failed_partition(job_ptr->part_ptr, failed_parts,
-				      failed_part_cnt)) {
+		    _failed_partition(job_ptr->part_ptr, domain->failed_parts,
+				      domain->failed_part_cnt)) {
 			if (job_ptr->priority != 1) {	/* not system hold */
 				job_ptr->state_reason = WAIT_PRIORITY;
 				xfree(job_ptr->state_desc);
@@ -465,6 +742,7 @@ extern int schedule(uint32_t job_limit)
 			       job_ptr->partition);
 			continue;
 		}
+
 		if (bit_overlap(avail_node_bitmap,
 				job_ptr->part_ptr->node_bitmap) == 0) {
 			/* All nodes DRAIN, DOWN, or
@@ -500,18 +778,49 @@ extern int schedule(uint32_t job_limit)
 			 * very rare. */
 			info("sched: JobId=%u has invalid account",
 			     job_ptr->job_id);
+			slurm_mutex_lock(&pass->lock);
 			last_job_update = time(NULL);
 			job_ptr->job_state = JOB_FAILED;
+			job_index_update(job_ptr);
 			job_ptr->exit_code = 1;
 			job_ptr->state_reason = FAIL_ACCOUNT;
 			xfree(job_ptr->state_desc);
 			job_ptr->start_time = job_ptr->end_time = time(NULL);
 			job_completion_logger(job_ptr, false);
 			delete_job_details(job_ptr);
+			slurm_mutex_unlock(&pass->lock);
 			continue;
 		}
 
-		error_code = select_nodes(job_ptr, false, NULL);
+		error_code = SLURM_SUCCESS;
+		if (_job_cannot_fit(pass, job_ptr)) {
+			if (!acct_policy_job_runnable(job_ptr)) {
+				error_code = ESLURM_ACCOUNTING_POLICY;
+			} else {
+				job_ptr->state_reason = WAIT_RESOURCES;
+				xfree(job_ptr->state_desc);
+				error_code = ESLURM_NODES_BUSY;
+			}
+		}
+
+		/* Serialized with other domains from here: select_nodes()
+		 * updates node, license and limit state they share */
+		slurm_mutex_lock(&pass->lock);
+		if (error_code == ESLURM_NODES_BUSY) {
+			slurm_sched_job_is_pending();
+		} else if (error_code == SLURM_SUCCESS) {
+			if (job_ptr->license_list &&
+			    (license_job_test(job_ptr, time(NULL)) !=
+			     SLURM_SUCCESS)) {
+				/* Another domain took the licenses since
+				 * they were tested above */
+				slurm_mutex_unlock(&pass->lock);
+				job_ptr->state_reason = WAIT_LICENSES;
+				xfree(job_ptr->state_desc);
+				continue;
+			}
+			error_code = select_nodes(job_ptr, false, NULL);
+		}
 		if (error_code == ESLURM_NODES_BUSY) {
 			debug3("sched: JobId=%u. State=%s. Reason=%s. "
 			       "Priority=%u. Partition=%s.",
@@ -527,18 +836,13 @@ extern int schedule(uint32_t job_limit)
 			 * different sizes. Therefore we sort and try to
 			 * schedule every pending job unless the backfill
 			 * scheduler is configured. */
-			if (!backfill_sched)
+			if (!pass->backfill_sched)
 				fail_by_part = false;
 #endif
 			if (fail_by_part) {
 		 		/* do not schedule more jobs in this partition
 				 * or on nodes in this partition */
-				failed_parts[failed_part_cnt++] =
-						job_ptr->part_ptr;
-				bit_not(job_ptr->part_ptr->node_bitmap);
-				bit_and(avail_node_bitmap,
-					job_ptr->part_ptr->node_bitmap);
-				bit_not(job_ptr->part_ptr->node_bitmap);
+				_fail_partition(domain, job_ptr->part_ptr);
 			}
 		} else if (error_code == ESLURM_RESERVATION_NOT_USABLE) {
 			if (job_ptr->resv_ptr &&
@@ -550,10 +854,8 @@ extern int schedule(uint32_t job_limit)
 				       job_reason_string(job_ptr->
 							 state_reason),
 				       job_ptr->priority);
-				bit_not(job_ptr->resv_ptr->node_bitmap);
-				bit_and(avail_node_bitmap,
-					job_ptr->resv_ptr->node_bitmap);
-				bit_not(job_ptr->resv_ptr->node_bitmap);
+				_avail_node_clear(job_ptr->resv_ptr->
+						  node_bitmap);
 			} else {
 				/* The job has no reservation but requires
 				 * nodes that are currently in some reservation
@@ -592,16 +894,17 @@ extern int schedule(uint32_t job_limit)
 			else if (job_ptr->details->prolog_running == 0)
 				launch_job(job_ptr);
 			rebuild_job_part_list(job_ptr);
-			job_cnt++;
+			domain->job_cnt++;
 		} else if ((error_code !=
 			    ESLURM_REQUESTED_PART_CONFIG_UNAVAILABLE) &&
 			   (error_code != ESLURM_NODE_NOT_AVAIL)      &&
 			   (error_code != ESLURM_ACCOUNTING_POLICY)) {
 			info("sched: schedule: JobId=%u non-runnable: %s",
 			     job_ptr->job_id, slurm_strerror(error_code));
-			if (!wiki_sched) {
+			if (!pass->wiki_sched) {
 				last_job_update = now;
 				job_ptr->job_state = JOB_FAILED;
+				job_index_update(job_ptr);
 				job_ptr->exit_code = 1;
 				job_ptr->state_reason = FAIL_BAD_CONSTRAINTS;
 				xfree(job_ptr->state_desc);
@@ -610,17 +913,506 @@ extern int schedule(uint32_t job_limit)
 				delete_job_details(job_ptr);
 			}
 		}
+		slurm_mutex_unlock(&pass->lock);
+	}
+}
+
+static void *_sched_domain_thread(void *arg)
+{
+	sched_pass_t *pass = (sched_pass_t *) arg;
+	int i;
+
+	while (1) {
+		slurm_mutex_lock(&pass->lock);
+		i = pass->next_domain++;
+		slurm_mutex_unlock(&pass->lock);
+		if (i >= pass->domain_cnt)
+			break;
+		_sched_domain(pass, &pass->domains[i]);
+	}
+	return NULL;
+}
+
+/* Domain thread, test the domains of each published pass until shutdown.
+ * Only thread_cnt - 1 threads join a pass, the other is _schedule()'s. */
+static void *_sched_pool_thread(void *no_data)
+{
+	sched_pass_t *pass;
+	uint32_t done_gen = 0;
+
+	slurm_mutex_lock(&sched_pool_lock);
+	while (!sched_pool_shutdown) {
+		pass = sched_pool_pass;
+		if ((pass == NULL) || (done_gen == sched_pool_gen)) {
+			pthread_cond_wait(&sched_pool_work_cond,
+					  &sched_pool_lock);
+			continue;
+		}
+		done_gen = sched_pool_gen;
+		if (sched_pool_busy >= (pass->thread_cnt - 1))
+			continue;
+		sched_pool_busy++;
+		slurm_mutex_unlock(&sched_pool_lock);
+		(void) _sched_domain_thread(pass);
+		slurm_mutex_lock(&sched_pool_lock);
+		if (--sched_pool_busy == 0)
+			pthread_cond_signal(&sched_pool_done_cond);
+	}
+	slurm_mutex_unlock(&sched_pool_lock);
+	return NULL;
+}
+
+/* Test the domains of a pass with pass->thread_cnt threads: this one and
+ * those of the pool, started as needed */
+static void _sched_pool_run(sched_pass_t *pass)
+{
+	pthread_attr_t attr;
+
+	slurm_mutex_lock(&sched_pool_lock);
+	if (sched_pool_cnt < (pass->thread_cnt - 1)) {
+		slurm_attr_init(&attr);
+		while (sched_pool_cnt < (pass->thread_cnt - 1)) {
+			if (pthread_create(&sched_pool_id[sched_pool_cnt],
+					   &attr, _sched_pool_thread, NULL)) {
+				error("pthread_create error %m");
+				break;
+			}
+			sched_pool_cnt++;
+		}
+		slurm_attr_destroy(&attr);
+	}
+	sched_pool_pass = pass;
+	sched_pool_gen++;
+	pthread_cond_broadcast(&sched_pool_work_cond);
+	slurm_mutex_unlock(&sched_pool_lock);
+
+	/* This thread is one of the workers */
+	(void) _sched_domain_thread(pass);
+
+	slurm_mutex_lock(&sched_pool_lock);
+	sched_pool_pass = NULL;
+	while (sched_pool_busy)
+		pthread_cond_wait(&sched_pool_done_cond, &sched_pool_lock);
+	slurm_mutex_unlock(&sched_pool_lock);
+}
+
+/* Stop the domain threads */
+static void _sched_pool_fini(void)
+{
+	int i;
+
+	slurm_mutex_lock(&sched_pool_lock);
+	sched_pool_shutdown = true;
+	pthread_cond_broadcast(&sched_pool_work_cond);
+	slurm_mutex_unlock(&sched_pool_lock);
+	for (i = 0; i < sched_pool_cnt; i++)
+		pthread_join(sched_pool_id[i], NULL);
+
+	slurm_mutex_lock(&sched_pool_lock);
+	sched_pool_cnt = 0;
+	sched_pool_shutdown = false;
+	slurm_mutex_unlock(&sched_pool_lock);
+}
+
+/*
+ * _schedule - as schedule(), but jobs are only tested in partitions named
+ *	in part_hints or containing nodes in node_hints, unless both are NULL
+ * Note: We re-build the queue every time. Jobs can not only be added
+ *	or removed from the queue, but have their priority or partition
+ *	changed with the update_job RPC. The job index keeps pending jobs in
+ *	priority order, so the queue is built without sorting.
+ * Note: With SchedulerParameters=sched_part_threads=#, the queue is split
+ *	into domains of partitions which share no nodes and each domain is
+ *	tested by a thread of a pool lasting across passes. Only
+ *	select_nodes() and other updates of
+ *	state shared by domains are serialized, and SchedulerParameters
+ *	default_queue_depth limits the jobs tested in all domains together.
+ */
+static int _schedule(uint32_t job_limit, List part_hints, bitstr_t *node_hints)
+{
+	List job_queue = NULL;
+	int i, job_cnt = 0;
+	uint32_t job_depth = 0, queue_len;
+	bool exit_timeout = false, exit_depth = false;
+	long delta_t;
+	sched_pass_t pass;
+	bitstr_t *save_avail_node_bitmap;
+	/* Locks: Read config, write job, write node, read partition */
+	slurmctld_lock_t job_write_lock =
+	    { READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK };
+	static bool backfill_sched = false;
+	static time_t sched_update = 0;
+	static bool wiki_sched = false;
+	static int sched_timeout = 0;
+	static int def_job_limit = 100;
+	static int sched_part_threads = 1;
+	time_t now = time(NULL);
+
+	DEF_TIMERS;
+
+	if (sched_timeout == 0) {
+		sched_timeout = slurm_get_msg_timeout() / 2;
+		sched_timeout = MAX(sched_timeout, 1);
+		sched_timeout = MIN(sched_timeout, 10);
+	}
+
+	START_TIMER;
+	if (sched_update != slurmctld_conf.last_update) {
+		char *sched_params, *tmp_ptr;
+		char *sched_type = slurm_get_sched_type();
+		/* On BlueGene, do FIFO only with sched/backfill */
+		if (strcmp(sched_type, "sched/backfill") == 0)
+			backfill_sched = true;
+		/* Disable avoiding of fragmentation with sched/wiki */
+		if ((strcmp(sched_type, "sched/wiki") == 0) ||
+		    (strcmp(sched_type, "sched/wiki2") == 0))
+			wiki_sched = true;
+		xfree(sched_type);
+
+		sched_params = slurm_get_sched_params();
+		if (sched_params &&
+		    (tmp_ptr=strstr(sched_params, "default_queue_depth="))) {
+		/*                                 01234567890123456789 */
+			i = atoi(tmp_ptr + 20);
+			if (i < 0) {
+				error("ignoring SchedulerParameters: "
+				      "default_queue_depth value of %d", i);
+			} else {
+				      def_job_limit = i;
+			}
+		}
+		if (sched_params &&
+		    (tmp_ptr=strstr(sched_params, "sched_min_interval="))) {
+		/*                                 0123456789012345678 */
+			i = atoi(tmp_ptr + 19);
+			if (i < 0) {
+				error("ignoring SchedulerParameters: "
+				      "sched_min_interval value of %d", i);
+			} else {
+				slurm_mutex_lock(&sched_queue_lock);
+				sched_min_interval = i;
+				slurm_mutex_unlock(&sched_queue_lock);
+			}
+		}
+		sched_part_threads = 1;
+		if (sched_params &&
+		    (tmp_ptr=strstr(sched_params, "sched_part_threads="))) {
+		/*                                 0123456789012345678 */
+			i = atoi(tmp_ptr + 19);
+			if ((i < 1) || (i > SCHED_MAX_PART_THREADS)) {
+				error("ignoring SchedulerParameters: "
+				      "sched_part_threads value of %d", i);
+			} else
+				sched_part_threads = i;
+		}
+		xfree(sched_params);
+		sched_update = slurmctld_conf.last_update;
+	}
+	if (job_limit == 0)
+		job_limit = def_job_limit;
+
+	lock_slurmctld(job_write_lock);
+	if (!avail_front_end()) {
+		unlock_slurmctld(job_write_lock);
+		debug("sched: schedule() returning, no front end nodes are "
+		       "available");
+		return SLURM_SUCCESS;
+	}
+	/* Avoid resource fragmentation if important */
+	if ((!wiki_sched) && job_is_completing()) {
+		unlock_slurmctld(job_write_lock);
+		debug("sched: schedule() returning, some job is still "
+		       "completing");
+		return SLURM_SUCCESS;
+	}
+
+#ifdef HAVE_CRAY
+	/*
+	 * Run a Basil Inventory immediately before scheduling, to avoid
+	 * race conditions caused by ALPS node state change (caused e.g.
+	 * by the node health checker).
+	 * This relies on the above write lock for the node state.
+	 */
+	if (select_g_reconfigure()) {
+		unlock_slurmctld(job_write_lock);
+		debug4("sched: not scheduling due to ALPS");
+		return SLURM_SUCCESS;
+	}
+#endif
+
+	memset(&pass, 0, sizeof(sched_pass_t));
+	slurm_mutex_init(&pass.lock);
+	pass.job_limit = job_limit;
+	pass.now = pass.sched_start = now;
+	pass.sched_timeout = sched_timeout;
+	pass.backfill_sched = backfill_sched;
+	pass.wiki_sched = wiki_sched;
+	pass.skip_parts = _skip_parts(part_hints, node_hints,
+				      &pass.skip_part_cnt);
+	pass.thread_cnt = 1;
+	save_avail_node_bitmap = bit_copy(avail_node_bitmap);
+
+	debug("sched: Running job scheduler");
+	job_queue = build_job_queue(false);
+	queue_len = list_count(job_queue);
+	if (sched_part_threads > 1) {
+		pass.domains = _build_sched_domains(job_queue,
+						    &pass.domain_cnt);
+		pass.thread_cnt = MIN(sched_part_threads, pass.domain_cnt);
+#ifndef HAVE_BG
+		/* Nodes which could accept another job. Starting jobs only
+		 * removes nodes from this, so jobs needing more of their
+		 * partition's nodes than it holds can not be started. A job
+		 * could preempt or gang schedule with jobs on other nodes. */
+		if ((pass.thread_cnt > 1) && !slurm_preemption_enabled() &&
+		    !(slurm_get_preempt_mode() & PREEMPT_MODE_GANG)) {
+			pass.usable_node_bitmap = bit_copy(idle_node_bitmap);
+			bit_or(pass.usable_node_bitmap, share_node_bitmap);
+			bit_and(pass.usable_node_bitmap, avail_node_bitmap);
+		}
+#endif
+	} else {
+		pass.domains = xmalloc(sizeof(sched_domain_t));
+		pass.domains[0].job_queue = job_queue;
+		pass.domains[0].failed_parts =
+			xmalloc(sizeof(struct part_record *) *
+				list_count(part_list));
+		pass.domain_cnt = 1;
+		job_queue = NULL;
+	}
+
+	if (pass.thread_cnt > 1)
+		_sched_pool_run(&pass);
+	else
+		(void) _sched_domain_thread(&pass);
+	job_depth = pass.job_depth;
+
+	for (i = 0; i < pass.domain_cnt; i++) {
+		job_cnt   += pass.domains[i].job_cnt;
+		if (pass.domains[i].exit_timeout)
+			exit_timeout = true;
+		if (pass.domains[i].exit_depth)
+			exit_depth = true;
 	}
 
 	FREE_NULL_BITMAP(avail_node_bitmap);
 	avail_node_bitmap = save_avail_node_bitmap;
-	xfree(failed_parts);
-	list_destroy(job_queue);
+	FREE_NULL_BITMAP(pass.usable_node_bitmap);
+	_free_sched_domains(pass.domains, pass.domain_cnt);
+	xfree(pass.skip_parts);
+	if (job_queue)
+		list_destroy(job_queue);
+	slurm_mutex_destroy(&pass.lock);
 	unlock_slurmctld(job_write_lock);
 	END_TIMER2("schedule");
+	delta_t = DELTA_TIMER;
+
+	slurm_mutex_lock(&slurmctld_diag_stats_lock);
+	slurmctld_diag_stats.schedule_cycle_cnt++;
+	slurmctld_diag_stats.schedule_cycle_last = delta_t;
+	slurmctld_diag_stats.schedule_cycle_sum += delta_t;
+	if (delta_t > slurmctld_diag_stats.schedule_cycle_max)
+		slurmctld_diag_stats.schedule_cycle_max = delta_t;
+	slurmctld_diag_stats.schedule_depth_last = job_depth;
+	slurmctld_diag_stats.schedule_depth_sum += job_depth;
+	slurmctld_diag_stats.schedule_queue_len = queue_len;
+	if (exit_timeout)
+		slurmctld_diag_stats.schedule_exit_timeout++;
+	if (exit_depth)
+		slurmctld_diag_stats.schedule_exit_depth++;
+	slurmctld_diag_stats.jobs_started += job_cnt;
+	slurm_mutex_unlock(&slurmctld_diag_stats_lock);
+
 	return job_cnt;
 }
 
+static void _part_hint_del(void *x)
+{
+	xfree(x);
+}
+
+/* Add the comma separated partition names to sched_part_hints, or test all
+ * partitions if there are too many of them to be worth tracking.
+ * NOTE: sched_queue_lock must be locked */
+static void _add_part_hints(char *part_names)
+{
+	char *tmp_names, *tok, *save_ptr = NULL;
+
+	if (sched_part_hints == NULL) {
+		sched_part_hints = list_create(_part_hint_del);
+		if (sched_part_hints == NULL)
+			fatal("list_create malloc failure");
+	}
+	tmp_names = xstrdup(part_names);
+	tok = strtok_r(tmp_names, ",", &save_ptr);
+	while (tok && !sched_all_parts) {
+		if (!list_find_first(sched_part_hints, _find_part_name, tok)) {
+			if (list_count(sched_part_hints) >=
+			    SCHED_MAX_PART_HINTS)
+				sched_all_parts = true;
+			else
+				list_append(sched_part_hints, xstrdup(tok));
+		}
+		tok = strtok_r(NULL, ",", &save_ptr);
+	}
+	xfree(tmp_names);
+}
+
+/*
+ * queue_job_scheduler - request that the scheduler thread test pending jobs
+ *	in every partition
+ * IN job_limit - as for schedule(), INFINITE to test every pending job
+ */
+extern void queue_job_scheduler(uint32_t job_limit)
+{
+	slurm_mutex_lock(&sched_queue_lock);
+	sched_requests++;
+	sched_all_parts = true;
+	if (job_limit == INFINITE)
+		sched_full_queue = true;
+	pthread_cond_broadcast(&sched_queue_cond);
+	slurm_mutex_unlock(&sched_queue_lock);
+}
+
+/*
+ * queue_job_scheduler_part - request that the scheduler thread test pending
+ *	jobs in the partitions of a job which was added or changed
+ * IN job_ptr - job record
+ * NOTE: Read lock on jobs must be held
+ */
+extern void queue_job_scheduler_part(struct job_record *job_ptr)
+{
+	slurm_mutex_lock(&sched_queue_lock);
+	sched_requests++;
+	if (job_ptr->partition)
+		_add_part_hints(job_ptr->partition);
+	else
+		sched_all_parts = true;
+	pthread_cond_broadcast(&sched_queue_cond);
+	slurm_mutex_unlock(&sched_queue_lock);
+}
+
+/*
+ * queue_job_scheduler_nodes - request that the scheduler thread test
+ *	pending jobs in the partitions containing nodes which became available
+ * IN node_bitmap - nodes which became available, or NULL for all nodes
+ * NOTE: Read lock on nodes must be held
+ */
+extern void queue_job_scheduler_nodes(bitstr_t *node_bitmap)
+{
+	slurm_mutex_lock(&sched_queue_lock);
+	sched_requests++;
+	if ((node_bitmap == NULL) ||
+	    (bit_size(node_bitmap) != node_record_count)) {
+		sched_all_parts = true;
+	} else if (sched_node_hints == NULL) {
+		sched_node_hints = bit_copy(node_bitmap);
+		if (sched_node_hints == NULL)
+			fatal("bit_copy malloc failure");
+	} else if (bit_size(sched_node_hints) != node_record_count) {
+		sched_all_parts = true;
+	} else
+		bit_or(sched_node_hints, node_bitmap);
+	pthread_cond_broadcast(&sched_queue_cond);
+	slurm_mutex_unlock(&sched_queue_lock);
+}
+
+/* shutdown the slurmctld_sched_agent thread */
+extern void shutdown_job_scheduler(void)
+{
+	slurm_mutex_lock(&sched_queue_lock);
+	run_sched_thread = false;
+	pthread_cond_broadcast(&sched_queue_cond);
+	slurm_mutex_unlock(&sched_queue_lock);
+}
+
+/*
+ * Run as pthread to execute schedule() as requested by queue_job_scheduler()
+ * and related functions. Requests arriving within SchedulerParameters
+ * sched_min_interval of the previous pass are merged into one pass, which
+ * only tests jobs in the partitions the requests report changes in.
+ * no_data IN - unused
+ * RET - NULL
+ */
+extern void *slurmctld_sched_agent(void *no_data)
+{
+	struct timeval last_sched = {0, 0}, now;
+	struct timespec ts;
+	long delay_usec;
+	uint32_t job_limit;
+	List part_hints;
+	bitstr_t *node_hints;
+	int job_cnt, requests;
+
+	while (1) {
+		/* wait for work to perform */
+		slurm_mutex_lock(&sched_queue_lock);
+		while (1) {
+			gettimeofday(&now, NULL);
+			delay_usec = (now.tv_sec - last_sched.tv_sec) *
+				     1000000 +
+				     (now.tv_usec - last_sched.tv_usec);
+			if (!run_sched_thread) {
+				run_sched_thread = true;
+				sched_requests = 0;
+				sched_all_parts = sched_full_queue = false;
+				FREE_NULL_LIST(sched_part_hints);
+				FREE_NULL_BITMAP(sched_node_hints);
+				slurm_mutex_unlock(&sched_queue_lock);
+				_sched_pool_fini();
+				return NULL;	/* shutdown */
+			} else if (sched_requests &&
+				   ((delay_usec < 0) ||
+				    (delay_usec >= sched_min_interval))) {
+				break;		/* do the work */
+			} else if (sched_requests) { /* wait for interval */
+				delay_usec = sched_min_interval - delay_usec;
+				ts.tv_sec  = now.tv_sec + delay_usec / 1000000;
+				ts.tv_nsec = (now.tv_usec +
+					      delay_usec % 1000000) * 1000;
+				if (ts.tv_nsec >= 1000000000) {
+					ts.tv_sec++;
+					ts.tv_nsec -= 1000000000;
+				}
+				pthread_cond_timedwait(&sched_queue_cond,
+						       &sched_queue_lock, &ts);
+			} else {		/* wait for more work */
+				pthread_cond_wait(&sched_queue_cond,
+						  &sched_queue_lock);
+			}
+		}
+
+		requests = sched_requests;
+		job_limit = sched_full_queue ? INFINITE : 0;
+		if (sched_all_parts) {
+			part_hints = NULL;
+			node_hints = NULL;
+			FREE_NULL_LIST(sched_part_hints);
+			FREE_NULL_BITMAP(sched_node_hints);
+		} else {
+			part_hints = sched_part_hints;
+			node_hints = sched_node_hints;
+			sched_part_hints = NULL;
+			sched_node_hints = NULL;
+		}
+		sched_requests = 0;
+		sched_all_parts = sched_full_queue = false;
+		slurm_mutex_unlock(&sched_queue_lock);
+
+		debug2("sched: running scheduler for %d queued requests",
+		       requests);
+		job_cnt = _schedule(job_limit, part_hints, node_hints);
+		gettimeofday(&last_sched, NULL);
+		FREE_NULL_LIST(part_hints);
+		FREE_NULL_BITMAP(node_hints);
+		if (job_cnt) {
+			/* below functions all have their own locking */
+			schedule_job_save();
+			schedule_node_save();
+		}
+	}
+}
+
 /*
  * sort_job_queue - sort job_queue in decending priority order
  * IN/OUT job_queue - sorted job queue
@@ -58,7 +58,8 @@ typedef struct job_queue_rec {
 extern int build_feature_list(struct job_record *job_ptr);
 
 /*
- * build_job_queue - build (non-priority ordered) list of pending jobs
+ * build_job_queue - build list of pending jobs in the order they are to be
+ *	considered for scheduling, see sort_job_queue2()
  * IN clear_start - if set then clear the start_time for pending jobs
  * RET the job queue
  * NOTE: the caller must call list_destroy() on RET value to free memory
@@ -116,6 +117,29 @@ extern void print_job_dependency(struct job_record *job_ptr);
  */
 extern int prolog_slurmctld(struct job_record *job_ptr);
 
+/*
+ * queue_job_scheduler - request that the scheduler thread test pending jobs
+ *	in every partition
+ * IN job_limit - as for schedule(), INFINITE to test every pending job
+ */
+extern void queue_job_scheduler(uint32_t job_limit);
+
+/*
+ * queue_job_scheduler_nodes - request that the scheduler thread test
+ *	pending jobs in the partitions containing nodes which became available
+ * IN node_bitmap - nodes which became available, or NULL for all nodes
+ * NOTE: Read lock on nodes must be held
+ */
+extern void queue_job_scheduler_nodes(bitstr_t *node_bitmap);
+
+/*
+ * queue_job_scheduler_part - request that the scheduler thread test pending
+ *	jobs in the partitions of a job which was added or changed
+ * IN job_ptr - job record
+ * NOTE: Read lock on jobs must be held
+ */
+extern void queue_job_scheduler_part(struct job_record *job_ptr);
+
 /* If a job can run in multiple partitions, make sure that the one 
  * actually used is first in the string. Needed for job state save/restore */
 extern void rebuild_job_part_list(struct job_record *job_ptr);
@@ -128,10 +152,8 @@ extern void rebuild_job_part_list(struct job_record *job_ptr);
  *		  queue on every job submit (0 means to use the system default,
  *		  SchedulerParameters for default_queue_depth)
  * RET count of jobs scheduled
- * Note: We re-build the queue every time. Jobs can not only be added
- *	or removed from the queue, but have their priority or partition
- *	changed with the update_job RPC. In general nodes will be in priority
- *	order (by submit time), so the sorting should be pretty fast.
+ * NOTE: RPCs should use queue_job_scheduler() rather than calling this
+ *	directly, so that bursts of events result in one scheduling pass.
  */
 extern int schedule(uint32_t job_limit);
 
@@ -141,6 +163,19 @@ extern int schedule(uint32_t job_limit);
  */
 extern void set_job_elig_time(void);
 
+/* shutdown the slurmctld_sched_agent thread */
+extern void shutdown_job_scheduler(void);
+
+/*
+ * Run as pthread to execute schedule() as requested by queue_job_scheduler()
+ * and related functions. Requests arriving within SchedulerParameters
+ * sched_min_interval of the previous pass are merged into one pass, which
+ * only tests jobs in the partitions the requests report changes in.
+ * no_data IN - unused
+ * RET - NULL
+ */
+extern void *slurmctld_sched_agent(void *no_data);
+
 /*
  * sort_job_queue - sort job_queue in decending priority order
  * IN/OUT job_queue - sorted job queue previously made by build_job_queue()
@@ -47,22 +47,46 @@
 
 #include <errno.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
+/* Lock usage statistics, indexed by read_lock() and write_lock() value
+ * and protected by locks_mutex. A read lock is considered held from the
+ * time its first reader acquires it until its last reader releases it. */
+typedef struct {
+	uint32_t count;
+	uint32_t wait_cnt;
+	uint32_t wait_max;
+	uint64_t wait_total;
+	uint32_t hold_max;
+	uint64_t hold_total;
+	struct timeval hold_start;
+} lock_stats_t;
+
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static slurmctld_lock_flags_t slurmctld_locks;
 static int kill_thread = 0;
+static lock_stats_t lock_stats[ENTITY_COUNT * 3];
+static uint32_t write_epoch = 0;
 
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock);
 static void _wr_rdunlock(lock_datatype_t datatype);
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock);
-static void _wr_wrunlock(lock_datatype_t datatype);
+static void _wr_wrunlock(lock_datatype_t datatype, bool changed);
+static void _unlock_slurmctld(slurmctld_lock_t lock_levels, bool changed);
+static void _stat_acquire(int inx, struct timeval *wait_start,
+			  bool first_holder);
+static void _stat_release(int inx);
 
 /* init_locks - create locks used for slurmctld data structure access
  *	control */
@@ -117,7 +141,7 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
 		if (lock_levels.config == READ_LOCK)
 			_wr_rdunlock(CONFIG_LOCK);
 		else if (lock_levels.config == WRITE_LOCK)
-			_wr_wrunlock(CONFIG_LOCK);
+			_wr_wrunlock(CONFIG_LOCK, false);
 		return -1;
 	}
 
@@ -129,11 +153,11 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
 		if (lock_levels.job == READ_LOCK)
 			_wr_rdunlock(JOB_LOCK);
 		else if (lock_levels.job == WRITE_LOCK)
-			_wr_wrunlock(JOB_LOCK);
+			_wr_wrunlock(JOB_LOCK, false);
 		if (lock_levels.config == READ_LOCK)
 			_wr_rdunlock(CONFIG_LOCK);
 		else if (lock_levels.config == WRITE_LOCK)
-			_wr_wrunlock(CONFIG_LOCK);
+			_wr_wrunlock(CONFIG_LOCK, false);
 		return -1;
 	}
 
@@ -145,15 +169,15 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
 		if (lock_levels.node == READ_LOCK)
 			_wr_rdunlock(NODE_LOCK);
 		else if (lock_levels.node == WRITE_LOCK)
-			_wr_wrunlock(NODE_LOCK);
+			_wr_wrunlock(NODE_LOCK, false);
 		if (lock_levels.job == READ_LOCK)
 			_wr_rdunlock(JOB_LOCK);
 		else if (lock_levels.job == WRITE_LOCK)
-			_wr_wrunlock(JOB_LOCK);
+			_wr_wrunlock(JOB_LOCK, false);
 		if (lock_levels.config == READ_LOCK)
 			_wr_rdunlock(CONFIG_LOCK);
 		else if (lock_levels.config == WRITE_LOCK)
-			_wr_wrunlock(CONFIG_LOCK);
+			_wr_wrunlock(CONFIG_LOCK, false);
 		return -1;
 	}
 
@@ -163,43 +187,77 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
 /* unlock_slurmctld - Issue the required unlock requests in a well
  *	defined order */
 extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
+{
+	_unlock_slurmctld(lock_levels, true);
+}
+
+/* unlock_slurmctld_unchanged - equivalent to unlock_slurmctld() for a
+ *	caller which took write locks only to modify transient state that it
+ *	has since restored (e.g. part_filter_set/clear). The write epoch is
+ *	not advanced, so state snapshots remain valid. */
+extern void unlock_slurmctld_unchanged(slurmctld_lock_t lock_levels)
+{
+	_unlock_slurmctld(lock_levels, false);
+}
+
+static void _unlock_slurmctld(slurmctld_lock_t lock_levels, bool changed)
 {
 	if (lock_levels.partition == READ_LOCK)
 		_wr_rdunlock(PART_LOCK);
 	else if (lock_levels.partition == WRITE_LOCK)
-		_wr_wrunlock(PART_LOCK);
+		_wr_wrunlock(PART_LOCK, changed);
 
 	if (lock_levels.node == READ_LOCK)
 		_wr_rdunlock(NODE_LOCK);
 	else if (lock_levels.node == WRITE_LOCK)
-		_wr_wrunlock(NODE_LOCK);
+		_wr_wrunlock(NODE_LOCK, changed);
 
 	if (lock_levels.job == READ_LOCK)
 		_wr_rdunlock(JOB_LOCK);
 	else if (lock_levels.job == WRITE_LOCK)
-		_wr_wrunlock(JOB_LOCK);
+		_wr_wrunlock(JOB_LOCK, changed);
 
 	if (lock_levels.config == READ_LOCK)
 		_wr_rdunlock(CONFIG_LOCK);
 	else if (lock_levels.config == WRITE_LOCK)
-		_wr_wrunlock(CONFIG_LOCK);
+		_wr_wrunlock(CONFIG_LOCK, changed);
+}
+
+/* get_write_epoch - Return a counter advanced whenever a write lock on any
+ *	slurmctld data structure is released. If the value read while holding
+ *	locks matches a later value, no writer has run in between. */
+extern uint32_t get_write_epoch(void)
+{
+	uint32_t epoch;
+
+	slurm_mutex_lock(&locks_mutex);
+	epoch = write_epoch;
+	slurm_mutex_unlock(&locks_mutex);
+	return epoch;
 }
 
 /* _wr_rdlock - Issue a read lock on the specified data type */
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 {
 	bool success = true;
+	struct timeval wait_start;
 
+	wait_start.tv_sec = 0;
 	slurm_mutex_lock(&locks_mutex);
 	while (1) {
 		if ((slurmctld_locks.entity[write_wait_lock(datatype)] == 0) &&
 		    (slurmctld_locks.entity[write_lock(datatype)] == 0)) {
+			_stat_acquire(read_lock(datatype), &wait_start,
+				      (slurmctld_locks.entity[
+					       read_lock(datatype)] == 0));
 			slurmctld_locks.entity[read_lock(datatype)]++;
 			break;
 		} else if (!wait_lock) {
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
+			if (wait_start.tv_sec == 0)
+				gettimeofday(&wait_start, NULL);
 			pthread_cond_wait(&locks_cond, &locks_mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
@@ -213,7 +271,8 @@ static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 static void _wr_rdunlock(lock_datatype_t datatype)
 {
 	slurm_mutex_lock(&locks_mutex);
-	slurmctld_locks.entity[read_lock(datatype)]--;
+	if (--slurmctld_locks.entity[read_lock(datatype)] == 0)
+		_stat_release(read_lock(datatype));
 	pthread_cond_broadcast(&locks_cond);
 	slurm_mutex_unlock(&locks_mutex);
 }
@@ -222,7 +281,9 @@ static void _wr_rdunlock(lock_datatype_t datatype)
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 {
 	bool success = true;
+	struct timeval wait_start;
 
+	wait_start.tv_sec = 0;
 	slurm_mutex_lock(&locks_mutex);
 	slurmctld_locks.entity[write_wait_lock(datatype)]++;
 
@@ -231,12 +292,15 @@ static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 		    (slurmctld_locks.entity[write_lock(datatype)] == 0)) {
 			slurmctld_locks.entity[write_lock(datatype)]++;
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
+			_stat_acquire(write_lock(datatype), &wait_start, true);
 			break;
 		} else if (!wait_lock) {
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
+			if (wait_start.tv_sec == 0)
+				gettimeofday(&wait_start, NULL);
 			pthread_cond_wait(&locks_cond, &locks_mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
@@ -246,15 +310,111 @@ static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 	return success;
 }
 
-/* _wr_wrunlock - Issue a write unlock on the specified data type */
-static void _wr_wrunlock(lock_datatype_t datatype)
+/* _wr_wrunlock - Issue a write unlock on the specified data type
+ * IN changed - set if the data may have been modified under the lock */
+static void _wr_wrunlock(lock_datatype_t datatype, bool changed)
 {
 	slurm_mutex_lock(&locks_mutex);
 	slurmctld_locks.entity[write_lock(datatype)]--;
+	if (changed)
+		write_epoch++;
+	_stat_release(write_lock(datatype));
 	pthread_cond_broadcast(&locks_cond);
 	slurm_mutex_unlock(&locks_mutex);
 }
 
+/* _stat_acquire - record acquisition of a lock, locks_mutex must be held
+ * IN inx - read_lock() or write_lock() index of the lock
+ * IN wait_start - time the caller started waiting, tv_sec of zero if the
+ *	lock was available immediately
+ * IN first_holder - set if the lock was not already held */
+static void _stat_acquire(int inx, struct timeval *wait_start,
+			  bool first_holder)
+{
+	lock_stats_t *stats = &lock_stats[inx];
+	struct timeval now;
+	long delta_t;
+
+	stats->count++;
+	if (!first_holder && (wait_start->tv_sec == 0))
+		return;
+
+	gettimeofday(&now, NULL);
+	if (first_holder)
+		stats->hold_start = now;
+	if (wait_start->tv_sec) {
+		delta_t = diff_tv(wait_start, &now);
+		stats->wait_cnt++;
+		stats->wait_total += delta_t;
+		if (delta_t > stats->wait_max)
+			stats->wait_max = delta_t;
+	}
+}
+
+/* _stat_release - record release of a lock by its last holder,
+ *	locks_mutex must be held */
+static void _stat_release(int inx)
+{
+	lock_stats_t *stats = &lock_stats[inx];
+	struct timeval now;
+	long delta_t;
+
+	if (stats->hold_start.tv_sec == 0)	/* statistics were reset */
+		return;
+	gettimeofday(&now, NULL);
+	delta_t = diff_tv(&stats->hold_start, &now);
+	stats->hold_start.tv_sec = 0;
+	stats->hold_total += delta_t;
+	if (delta_t > stats->hold_max)
+		stats->hold_max = delta_t;
+}
+
+/* get_lock_stats - report lock usage statistics
+ * OUT stats - the lock_* fields are filled in, the arrays must be freed
+ *	using slurm_free_stats_response_members() */
+extern void get_lock_stats(stats_info_response_msg_t *stats)
+{
+	static char *lock_names[ENTITY_COUNT] =
+		{ "config", "job", "node", "partition" };
+	lock_stats_t *lock_ptr;
+	int i, j, inx, cnt = ENTITY_COUNT * 2;
+
+	stats->lock_cnt	       = cnt;
+	stats->lock_name       = xmalloc(sizeof(char *) * (cnt + 1));
+	stats->lock_count      = xmalloc(sizeof(uint32_t) * cnt);
+	stats->lock_wait_cnt   = xmalloc(sizeof(uint32_t) * cnt);
+	stats->lock_wait_max   = xmalloc(sizeof(uint32_t) * cnt);
+	stats->lock_wait_total = xmalloc(sizeof(uint64_t) * cnt);
+	stats->lock_hold_max   = xmalloc(sizeof(uint32_t) * cnt);
+	stats->lock_hold_total = xmalloc(sizeof(uint64_t) * cnt);
+
+	slurm_mutex_lock(&locks_mutex);
+	for (i = 0, j = 0; i < ENTITY_COUNT; i++) {
+		for (inx = read_lock(i); inx <= write_lock(i); inx++, j++) {
+			lock_ptr = &lock_stats[inx];
+			stats->lock_name[j] = xstrdup_printf("%s_%s",
+				lock_names[i],
+				(inx == read_lock(i)) ? "read" : "write");
+			stats->lock_count[j]	  = lock_ptr->count;
+			stats->lock_wait_cnt[j]	  = lock_ptr->wait_cnt;
+			stats->lock_wait_max[j]	  = lock_ptr->wait_max;
+			stats->lock_wait_total[j] = lock_ptr->wait_total;
+			stats->lock_hold_max[j]	  = lock_ptr->hold_max;
+			stats->lock_hold_total[j] = lock_ptr->hold_total;
+		}
+	}
+	slurm_mutex_unlock(&locks_mutex);
+}
+
+/* reset_lock_stats - clear lock usage statistics. Locks currently held
+ *	are not included in the new hold time totals. */
+extern void reset_lock_stats(void)
+{
+	slurm_mutex_lock(&locks_mutex);
+	memset(lock_stats, 0, sizeof(lock_stats));
+	slurm_mutex_unlock(&locks_mutex);
+}
+
 /* get_lock_values - Get the current value of all locks
  * OUT lock_flags - a copy of the current lock values */
 void get_lock_values(slurmctld_lock_flags_t * lock_flags)
@@ -87,6 +87,8 @@
 #ifndef _SLURMCTLD_LOCKS_H
 #define _SLURMCTLD_LOCKS_H
 
+#include "slurm/slurm.h"
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -129,6 +131,14 @@ typedef struct {
  * OUT lock_flags - a copy of the current lock values */
 extern void get_lock_values (slurmctld_lock_flags_t *lock_flags);
 
+/* get_lock_stats - report lock usage statistics
+ * OUT stats - the lock_* fields are filled in, the arrays must be freed
+ *	using slurm_free_stats_response_members() */
+extern void get_lock_stats (stats_info_response_msg_t *stats);
+
+/* reset_lock_stats - clear lock usage statistics */
+extern void reset_lock_stats (void);
+
 /* init_locks - create locks used for slurmctld data structure access
  *	control */
 extern void init_locks ( void );
@@ -147,6 +157,15 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels);
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
+/* unlock_slurmctld_unchanged - equivalent to unlock_slurmctld() for a
+ *	caller which took write locks only to modify transient state that it
+ *	has since restored. The write epoch is not advanced. */
+extern void unlock_slurmctld_unchanged (slurmctld_lock_t lock_levels);
+
+/* get_write_epoch - Return a counter advanced whenever a write lock on any
+ *	slurmctld data structure is released */
+extern uint32_t get_write_epoch (void);
+
 /* un/lock semaphore used for saving state of slurmctld */
 inline extern void lock_state_files ( void );
 inline extern void unlock_state_files ( void );
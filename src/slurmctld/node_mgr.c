@@ -67,6 +67,7 @@
 #include "src/common/slurm_accounting_storage.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/ping_nodes.h"
 #include "src/slurmctld/proc_req.h"
@@ -92,6 +93,12 @@ bitstr_t *power_node_bitmap = NULL;	/* bitmap of powered down nodes */
 bitstr_t *share_node_bitmap = NULL;  	/* bitmap of sharable nodes */
 bitstr_t *up_node_bitmap    = NULL;  	/* bitmap of non-down nodes */
 
+/* Set while a batch of node registrations is validated, see
+ * node_reg_batch_begin() */
+static bool      reg_batch = false;
+static bool      reg_batch_prio = false;	/* reset_job_priority() due */
+static bitstr_t *reg_batch_avail = NULL;	/* avail_node_bitmap at start */
+
 static void 	_dump_node_state (struct node_record *dump_node_ptr,
 				  Buf buffer);
 static front_end_record_t * _front_end_reg(
@@ -99,6 +106,7 @@ static front_end_record_t * _front_end_reg(
 static void 	_make_node_down(struct node_record *node_ptr,
 				time_t event_time);
 static bool	_node_is_hidden(struct node_record *node_ptr);
+static void	_reg_reset_job_priority(void);
 static int	_open_node_state_file(char **state_file);
 static void 	_pack_node (struct node_record *dump_node_ptr, Buf buffer,
 			    uint16_t protocol_version);
@@ -1494,10 +1502,12 @@ static bool _valid_node_state_change(uint16_t old, uint16_t new)
  * validate_node_specs - validate the node's specifications as valid,
  *	if not set state to down, in any case update last_response
  * IN reg_msg - node registration message
+ * IN protocol_version - slurm protocol version of the slurmd
  * RET 0 if no error, ENOENT if no such node, EINVAL if values too low
  * NOTE: READ lock_slurmctld config before entry
  */
-extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg)
+extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg,
+			       uint16_t protocol_version)
 {
 	int error_code, i, node_inx;
 	struct config_record *config_ptr;
@@ -1512,6 +1522,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg)
 	if (node_ptr == NULL)
 		return ENOENT;
 	node_inx = node_ptr - node_record_table_ptr;
+	node_ptr->protocol_version = protocol_version;
 
 	config_ptr = node_ptr->config_ptr;
 	error_code = SLURM_SUCCESS;
@@ -1640,7 +1651,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg)
 
 	if (IS_NODE_NO_RESPOND(node_ptr)) {
 		last_node_update = time (NULL);
-		reset_job_priority();
+		_reg_reset_job_priority();
 		node_ptr->node_state &= (~NODE_STATE_NO_RESPOND);
 		node_ptr->node_state &= (~NODE_STATE_POWER_UP);
 	}
@@ -1662,7 +1673,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg)
 	} else {
 		if (IS_NODE_UNKNOWN(node_ptr)) {
 			last_node_update = now;
-			reset_job_priority();
+			_reg_reset_job_priority();
 			debug("validate_node_specs: node %s registered with "
 			      "%u jobs",
 			      reg_msg->node_name,reg_msg->job_count);
@@ -1699,7 +1710,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg)
 			}
 			info("node %s returned to service",
 			     reg_msg->node_name);
-			reset_job_priority();
+			_reg_reset_job_priority();
 			trigger_node_up(node_ptr);
 			if (!IS_NODE_DRAIN(node_ptr)
 			    && !IS_NODE_FAIL(node_ptr)) {
@@ -2081,7 +2092,7 @@ extern int validate_nodes_via_front_end(
 
 	if (update_node_state) {
 		last_node_update = time (NULL);
-		reset_job_priority();
+		_reg_reset_job_priority();
 	}
 	return error_code;
 }
@@ -2106,6 +2117,53 @@ static void _sync_bitmaps(struct node_record *node_ptr, int job_count)
 		bit_set   (up_node_bitmap, node_inx);
 }
 
+/* A node returned to service, reset the priority of held jobs now or
+ * once at the end of the batch of registrations being validated */
+static void _reg_reset_job_priority(void)
+{
+	if (reg_batch)
+		reg_batch_prio = true;
+	else
+		reset_job_priority();
+}
+
+/*
+ * node_reg_batch_begin - start validating a batch of node registrations.
+ *	Work which only needs doing once however many nodes register, resetting
+ *	job priorities and testing pending jobs against the nodes which became
+ *	available, is deferred to node_reg_batch_end()
+ * NOTE: WRITE lock_slurmctld jobs and nodes before entry
+ */
+extern void node_reg_batch_begin(void)
+{
+	reg_batch = true;
+	reg_batch_prio = false;
+	FREE_NULL_BITMAP(reg_batch_avail);
+	reg_batch_avail = bit_copy(avail_node_bitmap);
+}
+
+/*
+ * node_reg_batch_end - complete the work deferred by node_reg_batch_begin()
+ * NOTE: WRITE lock_slurmctld jobs and nodes before entry
+ */
+extern void node_reg_batch_end(void)
+{
+	reg_batch = false;
+	if (reg_batch_prio) {
+		reg_batch_prio = false;
+		reset_job_priority();
+	}
+	if (reg_batch_avail == NULL)
+		return;
+
+	/* Only partitions containing newly available nodes need testing */
+	bit_not(reg_batch_avail);
+	bit_and(reg_batch_avail, avail_node_bitmap);
+	if (bit_set_count(reg_batch_avail))
+		queue_job_scheduler_nodes(reg_batch_avail);
+	FREE_NULL_BITMAP(reg_batch_avail);
+}
+
 #ifdef HAVE_FRONT_END
 static void _node_did_resp(front_end_record_t *node_ptr)
 {
@@ -2227,6 +2285,41 @@ void node_did_resp (char *name)
 	debug2("node_did_resp %s",name);
 }
 
+/*
+ * node_heartbeat - record that the specified nodes sent a heartbeat, as if
+ *	they responded to a ping. Nodes in UNKNOWN state must register first.
+ * IN node_list - names of the nodes
+ * RET count of nodes updated
+ */
+extern int node_heartbeat (char *node_list)
+{
+#ifdef HAVE_FRONT_END
+	front_end_record_t *node_ptr;
+#else
+	struct node_record *node_ptr;
+#endif
+	hostlist_t hl;
+	char *name;
+	int node_cnt = 0;
+
+	if (!node_list || !(hl = hostlist_create(node_list)))
+		return 0;
+	while ((name = hostlist_shift(hl))) {
+#ifdef HAVE_FRONT_END
+		node_ptr = find_front_end_record(name);
+#else
+		node_ptr = find_node_record(name);
+#endif
+		if (node_ptr && !IS_NODE_UNKNOWN(node_ptr)) {
+			_node_did_resp(node_ptr);
+			node_cnt++;
+		}
+		free(name);
+	}
+	hostlist_destroy(hl);
+	return node_cnt;
+}
+
 /*
  * node_not_resp - record that the specified node is not responding
  * IN name - name of the node
@@ -70,6 +70,7 @@
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/node_scheduler.h"
@@ -1148,6 +1149,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 		part_ptr = find_part_record(job_ptr->partition);
 		xassert(part_ptr);
 		job_ptr->part_ptr = part_ptr;
+		job_index_update(job_ptr);
 		error("partition pointer reset for job %u, part %s",
 		      job_ptr->job_id, job_ptr->partition);
 	}
@@ -1205,6 +1207,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 		}
 		job_ptr->state_reason = fail_reason;
 		job_ptr->priority = 1;	/* sys hold, move to end of queue */
+		job_index_update(job_ptr);
 		return ESLURM_REQUESTED_PART_CONFIG_UNAVAILABLE;
 	}
 
@@ -1272,8 +1275,10 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 			       job_ptr->job_id);
 			job_ptr->state_reason = WAIT_PART_NODE_LIMIT;
 			xfree(job_ptr->state_desc);
-			if (job_ptr->priority != 0)  /* Move to end of queue */
+			if (job_ptr->priority != 0) { /* Move to end of queue */
 				job_ptr->priority = 1;
+				job_index_update(job_ptr);
+			}
 			last_job_update = now;
 		} else if (error_code == ESLURM_NODE_NOT_AVAIL) {
 			/* Required nodes are down or drained */
@@ -1281,8 +1286,10 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 			       job_ptr->job_id);
 			job_ptr->state_reason = WAIT_NODE_NOT_AVAIL;
 			xfree(job_ptr->state_desc);
-			if (job_ptr->priority != 0)  /* Move to end of queue */
+			if (job_ptr->priority != 0) { /* Move to end of queue */
 				job_ptr->priority = 1;
+				job_index_update(job_ptr);
+			}
 			last_job_update = now;
 		} else if (error_code == ESLURM_RESERVATION_NOT_USABLE) {
 			job_ptr->state_reason = WAIT_RESERVATION;
@@ -1357,6 +1364,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	configuring = IS_JOB_CONFIGURING(job_ptr);
 
 	job_ptr->job_state = JOB_RUNNING;
+	job_index_update(job_ptr);
 	if (configuring
 	    || bit_overlap(job_ptr->node_bitmap, power_node_bitmap))
 		job_ptr->job_state |= JOB_CONFIGURING;
@@ -63,6 +63,7 @@
 #include "src/common/xstring.h"
 
 #include "src/slurmctld/groups.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/sched_plugin.h"
@@ -810,6 +811,7 @@ static void _list_delete_part(void *part_entry)
 	int i, j, k;
 
 	part_ptr = (struct part_record *) part_entry;
+	job_index_part_delete(part_ptr);
 	node_ptr = &node_record_table_ptr[0];
 	for (i = 0; i < node_record_count; i++, node_ptr++) {
 		for (j=0; j<node_ptr->part_cnt; j++) {
@@ -875,6 +877,27 @@ extern void part_filter_set(uid_t uid)
 	list_iterator_destroy(part_iterator);
 }
 
+/* part_filter_shared - Return true if no partition is hidden or restricted
+ * to specific groups, so that the partitions visible to every user are the
+ * same and part_filter_set() has no effect */
+extern bool part_filter_shared(void)
+{
+	struct part_record *part_ptr;
+	ListIterator part_iterator;
+	bool shared = true;
+
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		if ((part_ptr->flags & PART_FLAG_HIDDEN) ||
+		    part_ptr->allow_groups) {
+			shared = false;
+			break;
+		}
+	}
+	list_iterator_destroy(part_iterator);
+	return shared;
+}
+
 /* part_filter_clear - Clear the partition's hidden flag based upon a user's
  * group access. This must follow a call to part_filter_set() */
 extern void part_filter_clear(void)
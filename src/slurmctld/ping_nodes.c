@@ -279,6 +279,7 @@ void ping_nodes (void)
 			continue;
 		}
 
+		/* Also skips nodes heard from by node_heartbeat() */
 		if ((!IS_NODE_NO_RESPOND(node_ptr)) &&
 		    (node_ptr->last_response >= still_live_time))
 			continue;
@@ -74,15 +74,20 @@
 
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_delta.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
+#include "src/slurmctld/reg_queue.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_class.h"
+#include "src/slurmctld/rpc_pool.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_snapshot.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 #include "src/plugins/select/bluegene/bg_enums.h"
@@ -93,6 +98,35 @@ static int 	    _launch_batch_step(job_desc_msg_t *job_desc_msg,
 				       uid_t uid, uint32_t *step_id);
 static int          _make_step_cred(struct step_record *step_rec,
 				    slurm_cred_t **slurm_cred);
+static void         _fill_stats_info(stats_info_response_msg_t *stats);
+static void         _record_rpc_stats(uint16_t msg_type, uid_t uid,
+				      long delta_t);
+static void         _reset_stats_info(void);
+
+static time_t       stats_reset_time = (time_t) 0;
+
+/* Processing time statistics by RPC type and by user,
+ * protected by rpc_stats_lock */
+#define RPC_USER_HASH_SIZE	256
+typedef struct rpc_type_stats {
+	uint16_t msg_type;
+	uint32_t count;
+	uint32_t time_max;
+	uint64_t time_total;
+	uint32_t hist[STATS_RPC_HIST_CNT];
+} rpc_type_stats_t;
+typedef struct rpc_user_stats {
+	uint32_t uid;
+	uint32_t count;
+	uint64_t time_total;
+	struct rpc_user_stats *next;
+} rpc_user_stats_t;
+static pthread_mutex_t   rpc_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static rpc_type_stats_t *rpc_type_stats = NULL;
+static int               rpc_type_cnt = 0;
+static int               rpc_type_size = 0;
+static rpc_user_stats_t *rpc_user_hash[RPC_USER_HASH_SIZE];
+static uint32_t          rpc_user_cnt = 0;
 
 inline static void  _slurm_rpc_accounting_first_reg(slurm_msg_t *msg);
 inline static void  _slurm_rpc_accounting_register_ctld(slurm_msg_t *msg);
@@ -107,9 +141,11 @@ inline static void  _slurm_rpc_complete_batch_script(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_conf(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_front_end(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_jobs(slurm_msg_t * msg);
+inline static void  _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_job_single(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_nodes(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_partitions(slurm_msg_t * msg);
+inline static void  _slurm_rpc_dump_stats(slurm_msg_t * msg);
 inline static void  _slurm_rpc_end_time(slurm_msg_t * msg);
 inline static void  _slurm_rpc_epilog_complete(slurm_msg_t * msg);
 inline static void  _slurm_rpc_get_shares(slurm_msg_t *msg);
@@ -122,6 +158,7 @@ inline static void  _slurm_rpc_job_step_kill(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_step_create(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_step_get_info(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_will_run(slurm_msg_t * msg);
+inline static void  _slurm_rpc_node_heartbeat(slurm_msg_t * msg);
 inline static void  _slurm_rpc_node_registration(slurm_msg_t * msg);
 inline static void  _slurm_rpc_block_info(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_alloc_info(slurm_msg_t * msg);
@@ -165,14 +202,67 @@ inline static void  _update_cred_key(void);
  */
 void slurmctld_req (slurm_msg_t * msg)
 {
-	/* Just to validate the cred */
-	(void) g_slurm_auth_get_uid(msg->auth_cred, NULL);
+	rpc_class_t rpc_class;
+	uid_t uid;
+	int rc;
+
+	/* Validate the cred, the uid is needed for admission control */
+	if (slurmctld_req_auth(msg, &uid) != SLURM_SUCCESS)
+		return;
+
+	/* Delay or reject the RPC before it can take any slurmctld locks */
+	rc = rpc_class_admit(msg->msg_type, uid, &rpc_class);
+	if (rc != SLURM_SUCCESS) {
+		slurmctld_req_reject(msg, uid, rc);
+		return;
+	}
+	slurmctld_req_admitted(msg, uid);
+	rpc_class_release(rpc_class);
+}
+
+/*
+ * slurmctld_req_auth - validate the credential of an RPC request
+ * IN msg - the request message
+ * OUT uid - user issuing the request
+ * RET SLURM_SUCCESS or an error if the request must be dropped
+ */
+extern int slurmctld_req_auth(slurm_msg_t *msg, uid_t *uid)
+{
+	*uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 	if (g_slurm_auth_errno(msg->auth_cred) != SLURM_SUCCESS) {
 		error("Bad authentication: %s",
 		      g_slurm_auth_errstr(g_slurm_auth_errno(msg->auth_cred)));
-		return;
+		return SLURM_ERROR;
 	}
+	return SLURM_SUCCESS;
+}
 
+/*
+ * slurmctld_req_reject - reply to an RPC request refused admission
+ * IN/OUT msg - the request message, data associated with the message is freed
+ * IN uid - user issuing the request
+ * IN rc - reason for the rejection
+ */
+extern void slurmctld_req_reject(slurm_msg_t *msg, uid_t uid, int rc)
+{
+	debug("slurmctld_req: rejecting RPC msg_type=%u from uid=%d: %s",
+	      msg->msg_type, uid, slurm_strerror(rc));
+	slurm_send_rc_msg(msg, rc);
+	slurm_free_msg_data(msg->msg_type, msg->data);
+	msg->data = NULL;
+}
+
+/*
+ * slurmctld_req_admitted - process an RPC request once admitted under the
+ *	limits of its class, see rpc_class.h
+ * IN/OUT msg - the request message, data associated with the message is freed
+ * IN uid - user issuing the request
+ */
+extern void slurmctld_req_admitted(slurm_msg_t *msg, uid_t uid)
+{
+	struct timeval tv1, tv2;
+
+	gettimeofday(&tv1, NULL);
 	switch (msg->msg_type) {
 	case REQUEST_RESOURCE_ALLOCATION:
 		_slurm_rpc_allocate_resources(msg);
@@ -246,6 +336,10 @@ void slurmctld_req (slurm_msg_t * msg)
 		_slurm_rpc_node_registration(msg);
 		slurm_free_node_registration_status_msg(msg->data);
 		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		_slurm_rpc_node_heartbeat(msg);
+		slurm_free_node_heartbeat_msg(msg->data);
+		break;
 	case REQUEST_JOB_ALLOCATION_INFO:
 		_slurm_rpc_job_alloc_info(msg);
 		slurm_free_job_alloc_info_msg(msg->data);
@@ -424,11 +518,22 @@ void slurmctld_req (slurm_msg_t * msg)
 		_slurm_rpc_dump_spank(msg);
 		slurm_free_spank_env_request_msg(msg->data);
 		break;
+	case REQUEST_STATS_INFO:
+		_slurm_rpc_dump_stats(msg);
+		slurm_free_stats_info_request_msg(msg->data);
+		break;
+	case REQUEST_JOB_INFO_DELTA:
+		_slurm_rpc_dump_jobs_delta(msg);
+		slurm_free_job_info_delta_request_msg(msg->data);
+		break;
 	default:
 		error("invalid RPC msg_type=%d", msg->msg_type);
 		slurm_send_rc_msg(msg, EINVAL);
 		break;
 	}
+	gettimeofday(&tv2, NULL);
+
+	_record_rpc_stats(msg->msg_type, uid, diff_tv(&tv1, &tv2));
 }
 
 /*
@@ -506,6 +611,7 @@ void _fill_ctld_conf(slurm_ctl_conf_t * conf_ptr)
 		xstrdup(conf->job_credential_public_certificate);
 	conf_ptr->job_file_append     = conf->job_file_append;
 	conf_ptr->job_requeue         = conf->job_requeue;
+	conf_ptr->job_state_journal   = conf->job_state_journal;
 	conf_ptr->job_submit_plugins  = xstrdup(conf->job_submit_plugins);
 
 	conf_ptr->get_env_timeout     = conf->get_env_timeout;
@@ -585,6 +691,7 @@ void _fill_ctld_conf(slurm_ctl_conf_t * conf_ptr)
 	conf_ptr->slurm_user_name     = xstrdup(conf->slurm_user_name);
 	conf_ptr->slurmctld_debug     = conf->slurmctld_debug;
 	conf_ptr->slurmctld_logfile   = xstrdup(conf->slurmctld_logfile);
+	conf_ptr->slurmctld_params    = xstrdup(conf->slurmctld_params);
 	conf_ptr->slurmctld_pidfile   = xstrdup(conf->slurmctld_pidfile);
 	conf_ptr->slurmctld_port      = conf->slurmctld_port;
 	conf_ptr->slurmctld_port_count = conf->slurmctld_port_count;
@@ -911,51 +1018,139 @@ static void _slurm_rpc_dump_conf(slurm_msg_t * msg)
 	}
 }
 
+/* Return true if the job information packed for this request would be the
+ * same for every user. Config and partition read locks must be held. */
+static bool _job_info_shared(uint16_t show_flags)
+{
+	if (slurmctld_conf.private_data & PRIVATE_DATA_JOBS)
+		return false;
+	if (show_flags & SHOW_DETAIL)	/* batch script shown to owner */
+		return false;
+	if ((show_flags & SHOW_ALL) == 0)
+		return part_filter_shared();
+	return true;
+}
+
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
 static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
 	char *dump;
 	int dump_size;
+	uint32_t epoch;
+	time_t pack_time;
+	state_snapshot_t *snap;
 	slurm_msg_t response_msg;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
-	/* Locks: Read config job, write node (for hiding) */
+	/* Locks: Read config job, write partition (for hiding) */
 	slurmctld_lock_t job_read_lock = {
 		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_INFO from uid=%d", uid);
-	lock_slurmctld(job_read_lock);
-
-	if ((job_info_request_msg->last_update - 1) >= last_job_update) {
-		unlock_slurmctld(job_read_lock);
-		debug3("_slurm_rpc_dump_jobs, no change");
-		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
-	} else {
+	/* If nothing changed since an identical response was packed for
+	 * this user (or for everyone), reply from it without taking locks.
+	 * Filtered responses are never kept. */
+	if (job_info_request_msg->filter)
+		snap = NULL;
+	else
+		snap = snapshot_acquire(SNAPSHOT_JOB,
+					job_info_request_msg->show_flags,
+					msg->protocol_version, uid);
+	if (snap == NULL) {
+		lock_slurmctld(job_read_lock);
+		if ((job_info_request_msg->last_update - 1) >=
+		    last_job_update) {
+			unlock_slurmctld_unchanged(job_read_lock);
+			debug3("_slurm_rpc_dump_jobs, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
+		epoch = get_write_epoch();
+		pack_time = time(NULL);
 		pack_all_jobs(&dump, &dump_size,
 			      job_info_request_msg->show_flags,
-			      g_slurm_auth_get_uid(msg->auth_cred, NULL),
-			      msg->protocol_version);
-		unlock_slurmctld(job_read_lock);
-		END_TIMER2("_slurm_rpc_dump_jobs");
-/* 		info("_slurm_rpc_dump_jobs, size=%d %s", */
-/* 		     dump_size, TIME_STR); */
+			      uid, msg->protocol_version,
+			      job_info_request_msg->filter);
+		/* With PrivateData=jobs, visibility also depends upon
+		 * account coordinator status, which is not part of the
+		 * state tracked by snapshots */
+		snap = snapshot_publish(SNAPSHOT_JOB,
+					job_info_request_msg->show_flags,
+					msg->protocol_version, uid,
+					dump, dump_size, last_job_update,
+					epoch, pack_time,
+					_job_info_shared(job_info_request_msg->
+							 show_flags),
+					!job_info_request_msg->filter &&
+					!(slurmctld_conf.private_data &
+					  PRIVATE_DATA_JOBS));
+		unlock_slurmctld_unchanged(job_read_lock);
+	} else if ((job_info_request_msg->last_update - 1) >=
+		   snap->last_update) {
+		snapshot_release(snap);
+		debug3("_slurm_rpc_dump_jobs, no change");
+		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+		return;
+	}
+	END_TIMER2("_slurm_rpc_dump_jobs");
+/* 	info("_slurm_rpc_dump_jobs, size=%d %s", */
+/* 	     snap->size, TIME_STR); */
 
-		/* init response_msg structure */
-		slurm_msg_t_init(&response_msg);
-		response_msg.flags = msg->flags;
-		response_msg.protocol_version = msg->protocol_version;
-		response_msg.address = msg->address;
-		response_msg.msg_type = RESPONSE_JOB_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+	/* init response_msg structure */
+	slurm_msg_t_init(&response_msg);
+	response_msg.flags = msg->flags;
+	response_msg.protocol_version = msg->protocol_version;
+	response_msg.address = msg->address;
+	response_msg.msg_type = RESPONSE_JOB_INFO;
+	response_msg.data = snap->data;
+	response_msg.data_size = snap->size;
 
-		/* send message */
-		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	snapshot_release(snap);
+}
+
+/* _slurm_rpc_dump_jobs_delta - process RPC for the state of jobs changed
+ *	since a client's last request */
+static void _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg)
+{
+	DEF_TIMERS;
+	char *dump = NULL;
+	int dump_size = 0, rc;
+	slurm_msg_t response_msg;
+	job_info_delta_request_msg_t *req_msg =
+		(job_info_delta_request_msg_t *) msg->data;
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+
+	START_TIMER;
+	debug3("Processing RPC: REQUEST_JOB_INFO_DELTA from uid=%d "
+	       "seq=%u", uid, req_msg->delta_seq);
+	rc = job_delta_pack(req_msg, uid, msg->protocol_version,
+			    &dump, &dump_size);
+	END_TIMER2("_slurm_rpc_dump_jobs_delta");
+
+	if (rc == SLURM_NO_CHANGE_IN_DATA) {
+		debug3("_slurm_rpc_dump_jobs_delta, no change");
+		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+		return;
 	}
+	debug3("_slurm_rpc_dump_jobs_delta, size=%d %s", dump_size, TIME_STR);
+
+	/* init response_msg structure */
+	slurm_msg_t_init(&response_msg);
+	response_msg.flags = msg->flags;
+	response_msg.protocol_version = msg->protocol_version;
+	response_msg.address = msg->address;
+	response_msg.msg_type = RESPONSE_JOB_INFO_DELTA;
+	response_msg.data = dump;
+	response_msg.data_size = dump_size;
+
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	xfree(dump);
 }
 
 /* _slurm_rpc_dump_job_single - process RPC for one job's state information */
@@ -1054,6 +1249,236 @@ static void  _slurm_rpc_get_priority_factors(slurm_msg_t *msg)
 	debug2("_slurm_rpc_get_priority_factors %s", TIME_STR);
 }
 
+/* _fill_stats_info - gather current slurmctld statistics */
+static void _fill_stats_info(stats_info_response_msg_t *stats)
+{
+	diag_stats_t *diag = &slurmctld_diag_stats;
+	rpc_user_stats_t *user_ptr;
+	int i, j;
+
+	memset(stats, 0, sizeof(stats_info_response_msg_t));
+	stats->req_time = time(NULL);
+	if (stats_reset_time)
+		stats->req_time_start = stats_reset_time;
+	else
+		stats->req_time_start = slurmctld_config.boot_time;
+
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	stats->server_thread_count = slurmctld_config.server_thread_count;
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+	rpc_pool_get_stats(stats);
+	rpc_class_get_stats(stats);
+	get_lock_stats(stats);
+	snapshot_get_stats(stats);
+
+	slurm_mutex_lock(&slurmctld_diag_stats_lock);
+	stats->schedule_cycle_cnt = diag->schedule_cycle_cnt;
+	stats->schedule_cycle_last = diag->schedule_cycle_last;
+	stats->schedule_cycle_max = diag->schedule_cycle_max;
+	stats->schedule_cycle_sum = diag->schedule_cycle_sum;
+	stats->schedule_depth_last = diag->schedule_depth_last;
+	stats->schedule_depth_sum = diag->schedule_depth_sum;
+	stats->schedule_queue_len = diag->schedule_queue_len;
+	stats->schedule_exit_timeout = diag->schedule_exit_timeout;
+	stats->schedule_exit_depth = diag->schedule_exit_depth;
+	stats->jobs_started = diag->jobs_started;
+	stats->bf_cycle_cnt = diag->bf_cycle_cnt;
+	stats->bf_cycle_last = diag->bf_cycle_last;
+	stats->bf_cycle_max = diag->bf_cycle_max;
+	stats->bf_cycle_sum = diag->bf_cycle_sum;
+	stats->bf_when_last_cycle = diag->bf_when_last_cycle;
+	stats->bf_depth_last = diag->bf_depth_last;
+	stats->bf_depth_sum = diag->bf_depth_sum;
+	stats->bf_depth_try_last = diag->bf_depth_try_last;
+	stats->bf_depth_try_sum = diag->bf_depth_try_sum;
+	stats->bf_queue_len = diag->bf_queue_len;
+	stats->bf_jobs_started = diag->bf_jobs_started;
+	stats->bf_start_dropped = diag->bf_start_dropped;
+	stats->bf_exit_table_full = diag->bf_exit_table_full;
+	stats->bf_skip_busy = diag->bf_skip_busy;
+	stats->bf_class_hits = diag->bf_class_hits;
+	stats->bf_class_tests = diag->bf_class_tests;
+	stats->bf_spec_tests = diag->bf_spec_tests;
+	stats->bf_spec_discarded = diag->bf_spec_discarded;
+	slurm_mutex_unlock(&slurmctld_diag_stats_lock);
+
+	slurm_mutex_lock(&rpc_stats_lock);
+	stats->rpc_type_cnt = rpc_type_cnt;
+	if (rpc_type_cnt) {
+		stats->rpc_type_id = xmalloc(sizeof(uint16_t) * rpc_type_cnt);
+		stats->rpc_type_count = xmalloc(sizeof(uint32_t) *
+						rpc_type_cnt);
+		stats->rpc_type_time_max = xmalloc(sizeof(uint32_t) *
+						   rpc_type_cnt);
+		stats->rpc_type_time_total = xmalloc(sizeof(uint64_t) *
+						     rpc_type_cnt);
+		stats->rpc_type_hist = xmalloc(sizeof(uint32_t) *
+					       rpc_type_cnt *
+					       STATS_RPC_HIST_CNT);
+	}
+	for (i = 0; i < rpc_type_cnt; i++) {
+		stats->rpc_type_id[i]	     = rpc_type_stats[i].msg_type;
+		stats->rpc_type_count[i]     = rpc_type_stats[i].count;
+		stats->rpc_type_time_max[i]  = rpc_type_stats[i].time_max;
+		stats->rpc_type_time_total[i] = rpc_type_stats[i].time_total;
+		memcpy(stats->rpc_type_hist + (i * STATS_RPC_HIST_CNT),
+		       rpc_type_stats[i].hist,
+		       sizeof(uint32_t) * STATS_RPC_HIST_CNT);
+	}
+
+	stats->rpc_user_cnt = rpc_user_cnt;
+	if (rpc_user_cnt) {
+		stats->rpc_user_id = xmalloc(sizeof(uint32_t) * rpc_user_cnt);
+		stats->rpc_user_count = xmalloc(sizeof(uint32_t) *
+						rpc_user_cnt);
+		stats->rpc_user_time_total = xmalloc(sizeof(uint64_t) *
+						     rpc_user_cnt);
+	}
+	for (i = 0, j = 0; i < RPC_USER_HASH_SIZE; i++) {
+		for (user_ptr = rpc_user_hash[i]; user_ptr;
+		     user_ptr = user_ptr->next, j++) {
+			stats->rpc_user_id[j]	      = user_ptr->uid;
+			stats->rpc_user_count[j]      = user_ptr->count;
+			stats->rpc_user_time_total[j] = user_ptr->time_total;
+		}
+	}
+	slurm_mutex_unlock(&rpc_stats_lock);
+}
+
+/* _record_rpc_stats - add an RPC's processing time to the statistics
+ * IN msg_type - RPC type
+ * IN uid - user issuing the RPC
+ * IN delta_t - processing time in usec */
+static void _record_rpc_stats(uint16_t msg_type, uid_t uid, long delta_t)
+{
+	rpc_type_stats_t *type_ptr = NULL;
+	rpc_user_stats_t *user_ptr;
+	int i, inx;
+
+	if (delta_t < 0)
+		delta_t = 0;
+
+	slurm_mutex_lock(&rpc_stats_lock);
+	for (i = 0; i < rpc_type_cnt; i++) {
+		if (rpc_type_stats[i].msg_type == msg_type) {
+			type_ptr = &rpc_type_stats[i];
+			break;
+		}
+	}
+	if (!type_ptr) {
+		if (rpc_type_cnt >= rpc_type_size) {
+			rpc_type_size += 32;
+			xrealloc(rpc_type_stats,
+				 sizeof(rpc_type_stats_t) * rpc_type_size);
+		}
+		type_ptr = &rpc_type_stats[rpc_type_cnt++];
+		memset(type_ptr, 0, sizeof(rpc_type_stats_t));
+		type_ptr->msg_type = msg_type;
+	}
+	type_ptr->count++;
+	type_ptr->time_total += delta_t;
+	if (delta_t > type_ptr->time_max)
+		type_ptr->time_max = delta_t;
+	/* Buckets: <1ms, <10ms, <100ms, <1s, <10s, >=10s */
+	for (i = 0, inx = 1000; i < (STATS_RPC_HIST_CNT - 1); i++, inx *= 10) {
+		if (delta_t < inx)
+			break;
+	}
+	type_ptr->hist[i]++;
+
+	inx = uid % RPC_USER_HASH_SIZE;
+	for (user_ptr = rpc_user_hash[inx]; user_ptr;
+	     user_ptr = user_ptr->next) {
+		if (user_ptr->uid == uid)
+			break;
+	}
+	if (!user_ptr) {
+		user_ptr = xmalloc(sizeof(rpc_user_stats_t));
+		user_ptr->uid  = uid;
+		user_ptr->next = rpc_user_hash[inx];
+		rpc_user_hash[inx] = user_ptr;
+		rpc_user_cnt++;
+	}
+	user_ptr->count++;
+	user_ptr->time_total += delta_t;
+	slurm_mutex_unlock(&rpc_stats_lock);
+}
+
+/* _reset_stats_info - clear slurmctld statistics counters */
+static void _reset_stats_info(void)
+{
+	rpc_user_stats_t *user_ptr, *next_ptr;
+	int i;
+
+	stats_reset_time = time(NULL);
+	rpc_pool_reset_stats();
+	rpc_class_reset_stats();
+	reset_lock_stats();
+	snapshot_reset_stats();
+
+	slurm_mutex_lock(&slurmctld_diag_stats_lock);
+	memset(&slurmctld_diag_stats, 0, sizeof(diag_stats_t));
+	slurm_mutex_unlock(&slurmctld_diag_stats_lock);
+
+	slurm_mutex_lock(&rpc_stats_lock);
+	rpc_type_cnt = 0;
+	for (i = 0; i < RPC_USER_HASH_SIZE; i++) {
+		for (user_ptr = rpc_user_hash[i]; user_ptr;
+		     user_ptr = next_ptr) {
+			next_ptr = user_ptr->next;
+			xfree(user_ptr);
+		}
+		rpc_user_hash[i] = NULL;
+	}
+	rpc_user_cnt = 0;
+	slurm_mutex_unlock(&rpc_stats_lock);
+}
+
+/* _slurm_rpc_dump_stats - process RPC for slurmctld statistics or to reset
+ *	them (STAT_COMMAND_RESET, SlurmUser and root only) */
+static void _slurm_rpc_dump_stats(slurm_msg_t * msg)
+{
+	DEF_TIMERS;
+	stats_info_request_msg_t *request_msg;
+	stats_info_response_msg_t stats;
+	slurm_msg_t response_msg;
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+
+	START_TIMER;
+	request_msg = (stats_info_request_msg_t *) msg->data;
+	if (request_msg->command_id == STAT_COMMAND_RESET) {
+		debug2("Processing RPC: REQUEST_STATS_INFO (reset) "
+		       "from uid=%d", uid);
+		if (!validate_super_user(uid)) {
+			error("Security violation, REQUEST_STATS_INFO reset "
+			      "RPC from uid=%d", uid);
+			slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
+			return;
+		}
+		_reset_stats_info();
+		END_TIMER2("_slurm_rpc_dump_stats");
+		info("_slurm_rpc_dump_stats: statistics reset by uid=%d",
+		     uid);
+		slurm_send_rc_msg(msg, SLURM_SUCCESS);
+		return;
+	}
+
+	debug2("Processing RPC: REQUEST_STATS_INFO from uid=%d", uid);
+	_fill_stats_info(&stats);
+	END_TIMER2("_slurm_rpc_dump_stats");
+	debug2("_slurm_rpc_dump_stats %s", TIME_STR);
+
+	slurm_msg_t_init(&response_msg);
+	response_msg.flags = msg->flags;
+	response_msg.protocol_version = msg->protocol_version;
+	response_msg.address  = msg->address;
+	response_msg.msg_type = RESPONSE_STATS_INFO;
+	response_msg.data     = &stats;
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	slurm_free_stats_response_members(&stats);
+}
+
 /* _slurm_rpc_end_time - Process RPC for job end time */
 static void _slurm_rpc_end_time(slurm_msg_t * msg)
 {
@@ -1141,6 +1566,10 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 	DEF_TIMERS;
 	char *dump;
 	int dump_size;
+	uint32_t epoch;
+	time_t pack_time;
+	bool shared;
+	state_snapshot_t *snap;
 	slurm_msg_t response_msg;
 	node_info_request_msg_t *node_req_msg =
 		(node_info_request_msg_t *) msg->data;
@@ -1152,45 +1581,68 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_NODE_INFO from uid=%d", uid);
-	lock_slurmctld(node_write_lock);
+	/* With PrivateData=nodes, responses are only cached per user and
+	 * users denied access never have one */
+	snap = snapshot_acquire(SNAPSHOT_NODE, node_req_msg->show_flags,
+				msg->protocol_version, uid);
+	if (snap == NULL) {
+		lock_slurmctld(node_write_lock);
 
-	if ((slurmctld_conf.private_data & PRIVATE_DATA_NODES) &&
-	    (!validate_operator(uid))) {
-		unlock_slurmctld(node_write_lock);
-		error("Security violation, REQUEST_NODE_INFO RPC from uid=%d",
-		      uid);
-		slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
-		return;
-	}
+		if ((slurmctld_conf.private_data & PRIVATE_DATA_NODES) &&
+		    (!validate_operator(uid))) {
+			unlock_slurmctld_unchanged(node_write_lock);
+			error("Security violation, REQUEST_NODE_INFO RPC "
+			      "from uid=%d", uid);
+			slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
+			return;
+		}
 
-	select_g_select_nodeinfo_set_all(node_req_msg->last_update - 1);
+		/* Only refreshes the select plugin's view of allocated
+		 * resources, which changes with job or node state */
+		select_g_select_nodeinfo_set_all(node_req_msg->last_update - 1);
 
-	if ((node_req_msg->last_update - 1) >= last_node_update) {
-		unlock_slurmctld(node_write_lock);
-		debug3("_slurm_rpc_dump_nodes, no change");
-		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
-	} else {
+		if ((node_req_msg->last_update - 1) >= last_node_update) {
+			unlock_slurmctld_unchanged(node_write_lock);
+			debug3("_slurm_rpc_dump_nodes, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
 
+		epoch = get_write_epoch();
+		pack_time = time(NULL);
 		pack_all_node(&dump, &dump_size, node_req_msg->show_flags,
 			      uid, msg->protocol_version);
-		unlock_slurmctld(node_write_lock);
-		END_TIMER2("_slurm_rpc_dump_nodes");
-		debug3("_slurm_rpc_dump_nodes, size=%d %s",
-		       dump_size, TIME_STR);
+		shared = ((slurmctld_conf.private_data & PRIVATE_DATA_NODES)
+			  == 0);
+		if (shared && ((node_req_msg->show_flags & SHOW_ALL) == 0))
+			shared = part_filter_shared();
+		snap = snapshot_publish(SNAPSHOT_NODE,
+					node_req_msg->show_flags,
+					msg->protocol_version, uid,
+					dump, dump_size, last_node_update,
+					epoch, pack_time, shared, true);
+		unlock_slurmctld_unchanged(node_write_lock);
+	} else if ((node_req_msg->last_update - 1) >= snap->last_update) {
+		snapshot_release(snap);
+		debug3("_slurm_rpc_dump_nodes, no change");
+		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+		return;
+	}
+	END_TIMER2("_slurm_rpc_dump_nodes");
+	debug3("_slurm_rpc_dump_nodes, size=%d %s", snap->size, TIME_STR);
 
-		/* init response_msg structure */
-		slurm_msg_t_init(&response_msg);
-		response_msg.flags = msg->flags;
-		response_msg.protocol_version = msg->protocol_version;
-		response_msg.address = msg->address;
-		response_msg.msg_type = RESPONSE_NODE_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+	/* init response_msg structure */
+	slurm_msg_t_init(&response_msg);
+	response_msg.flags = msg->flags;
+	response_msg.protocol_version = msg->protocol_version;
+	response_msg.address = msg->address;
+	response_msg.msg_type = RESPONSE_NODE_INFO;
+	response_msg.data = snap->data;
+	response_msg.data_size = snap->size;
 
-		/* send message */
-		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
-	}
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	snapshot_release(snap);
 }
 
 /* _slurm_rpc_dump_partitions - process RPC for partition state information */
@@ -1199,6 +1651,10 @@ static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 	DEF_TIMERS;
 	char *dump;
 	int dump_size;
+	uint32_t epoch;
+	time_t pack_time;
+	bool shared;
+	state_snapshot_t *snap;
 	slurm_msg_t response_msg;
 	part_info_request_msg_t  *part_req_msg;
 
@@ -1210,39 +1666,63 @@ static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 	START_TIMER;
 	debug2("Processing RPC: REQUEST_PARTITION_INFO uid=%d", uid);
 	part_req_msg = (part_info_request_msg_t  *) msg->data;
-	lock_slurmctld(part_read_lock);
+	/* With PrivateData=partitions, responses are only cached per user
+	 * and users denied access never have one */
+	snap = snapshot_acquire(SNAPSHOT_PART, part_req_msg->show_flags,
+				msg->protocol_version, uid);
+	if (snap == NULL) {
+		lock_slurmctld(part_read_lock);
+
+		if ((slurmctld_conf.private_data & PRIVATE_DATA_PARTITIONS) &&
+		    !validate_operator(uid)) {
+			unlock_slurmctld(part_read_lock);
+			debug2("Security violation, PARTITION_INFO RPC "
+			       "from uid=%d", uid);
+			slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
+			return;
+		} else if ((part_req_msg->last_update - 1) >=
+			   last_part_update) {
+			unlock_slurmctld(part_read_lock);
+			debug2("_slurm_rpc_dump_partitions, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
 
-	if ((slurmctld_conf.private_data & PRIVATE_DATA_PARTITIONS) &&
-	    !validate_operator(uid)) {
-		unlock_slurmctld(part_read_lock);
-		debug2("Security violation, PARTITION_INFO RPC from uid=%d",
-		       uid);
-		slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
-	} else if ((part_req_msg->last_update - 1) >= last_part_update) {
-		unlock_slurmctld(part_read_lock);
-		debug2("_slurm_rpc_dump_partitions, no change");
-		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
-	} else {
+		epoch = get_write_epoch();
+		pack_time = time(NULL);
 		pack_all_part(&dump, &dump_size, part_req_msg->show_flags,
 			      uid, msg->protocol_version);
+		shared = ((slurmctld_conf.private_data &
+			   PRIVATE_DATA_PARTITIONS) == 0);
+		if (shared && ((part_req_msg->show_flags & SHOW_ALL) == 0))
+			shared = part_filter_shared();
+		snap = snapshot_publish(SNAPSHOT_PART,
+					part_req_msg->show_flags,
+					msg->protocol_version, uid,
+					dump, dump_size, last_part_update,
+					epoch, pack_time, shared, true);
 		unlock_slurmctld(part_read_lock);
-		END_TIMER2("_slurm_rpc_dump_partitions");
-		debug2("_slurm_rpc_dump_partitions, size=%d %s",
-		       dump_size, TIME_STR);
+	} else if ((part_req_msg->last_update - 1) >= snap->last_update) {
+		snapshot_release(snap);
+		debug2("_slurm_rpc_dump_partitions, no change");
+		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+		return;
+	}
+	END_TIMER2("_slurm_rpc_dump_partitions");
+	debug2("_slurm_rpc_dump_partitions, size=%d %s", snap->size, TIME_STR);
 
-		/* init response_msg structure */
-		slurm_msg_t_init(&response_msg);
-		response_msg.flags = msg->flags;
-		response_msg.protocol_version = msg->protocol_version;
-		response_msg.address = msg->address;
-		response_msg.msg_type = RESPONSE_PARTITION_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+	/* init response_msg structure */
+	slurm_msg_t_init(&response_msg);
+	response_msg.flags = msg->flags;
+	response_msg.protocol_version = msg->protocol_version;
+	response_msg.address = msg->address;
+	response_msg.msg_type = RESPONSE_PARTITION_INFO;
+	response_msg.data = snap->data;
+	response_msg.data_size = snap->size;
 
-		/* send message */
-		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
-	}
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	snapshot_release(snap);
 }
 
 /* _slurm_rpc_epilog_complete - process RPC noting the completion of
@@ -1257,6 +1737,8 @@ static void  _slurm_rpc_epilog_complete(slurm_msg_t * msg)
 	epilog_complete_msg_t *epilog_msg =
 		(epilog_complete_msg_t *) msg->data;
 	bool run_scheduler = false;
+	struct job_record *job_ptr;
+	bitstr_t *node_bitmap = NULL;
 
 	START_TIMER;
 	debug2("Processing RPC: MESSAGE_EPILOG_COMPLETE uid=%d", uid);
@@ -1269,8 +1751,18 @@ static void  _slurm_rpc_epilog_complete(slurm_msg_t * msg)
 	}
 
 	if (job_epilog_complete(epilog_msg->job_id, epilog_msg->node_name,
-				epilog_msg->return_code))
+				epilog_msg->return_code)) {
+		/* Only partitions containing the job's nodes need testing */
+		job_ptr = find_job_record(epilog_msg->job_id);
+		if (job_ptr && job_ptr->nodes &&
+		    (node_name2bitmap(job_ptr->nodes, false, &node_bitmap) ==
+		     SLURM_SUCCESS))
+			queue_job_scheduler_nodes(node_bitmap);
+		else
+			queue_job_scheduler(0);
+		FREE_NULL_BITMAP(node_bitmap);
 		run_scheduler = true;
+	}
 	unlock_slurmctld(job_write_lock);
 	END_TIMER2("_slurm_rpc_epilog_complete");
 
@@ -1285,7 +1777,6 @@ static void  _slurm_rpc_epilog_complete(slurm_msg_t * msg)
 
 	/* Functions below provide their own locking */
 	if (run_scheduler) {
-		(void) schedule(0);
 		schedule_node_save();
 		schedule_job_save();
 	}
@@ -1726,7 +2217,7 @@ static void _slurm_rpc_job_step_get_info(slurm_msg_t * msg)
 		error_code = pack_ctld_job_step_info_response_msg(
 			request->job_id, request->step_id,
 			uid, request->show_flags, buffer,
-			msg->protocol_version);
+			msg->protocol_version, request->filter);
 		unlock_slurmctld(job_read_lock);
 		END_TIMER2("_slurm_rpc_job_step_get_info");
 		if (error_code) {
@@ -1833,6 +2324,36 @@ static void _slurm_rpc_job_will_run(slurm_msg_t * msg)
 	}
 }
 
+/* _slurm_rpc_node_heartbeat - process RPC from slurmd reporting the
+ *	liveness of a subtree of nodes (SlurmctldParameters=slurmd_heartbeat) */
+static void _slurm_rpc_node_heartbeat(slurm_msg_t * msg)
+{
+	DEF_TIMERS;
+	/* Locks: Read config, write node */
+	slurmctld_lock_t node_write_lock = {
+		READ_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+	node_heartbeat_msg_t *hb_msg = (node_heartbeat_msg_t *) msg->data;
+	int node_cnt;
+
+	START_TIMER;
+	debug2("Processing RPC: MESSAGE_NODE_HEARTBEAT uid=%d", uid);
+	if (!validate_slurm_user(uid)) {
+		error("Security violation, NODE_HEARTBEAT RPC from uid=%d",
+		      uid);
+		slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+		return;
+	}
+
+	lock_slurmctld(node_write_lock);
+	node_cnt = node_heartbeat(hb_msg->node_list);
+	unlock_slurmctld(node_write_lock);
+	END_TIMER2("_slurm_rpc_node_heartbeat");
+	debug2("_slurm_rpc_node_heartbeat for %d nodes %s", node_cnt,
+	       TIME_STR);
+	slurm_send_rc_msg(msg, SLURM_SUCCESS);
+}
+
 /* _slurm_rpc_node_registration - process RPC to determine if a node's
  *	actual configuration satisfies the configured specification */
 static void _slurm_rpc_node_registration(slurm_msg_t * msg)
@@ -1867,12 +2388,17 @@ static void _slurm_rpc_node_registration(slurm_msg_t * msg)
 			      "set DebugFlags=NO_CONF_HASH in your slurm.conf.",
 			      node_reg_stat_msg->node_name);
 		}
+		if (reg_queue_add(msg)) {
+			/* Validated and replied to with its batch */
+			return;
+		}
 		lock_slurmctld(job_write_lock);
 #ifdef HAVE_FRONT_END		/* Operates only on front-end */
 		error_code = validate_nodes_via_front_end(node_reg_stat_msg);
 #else
 		validate_jobs_on_node(node_reg_stat_msg);
-		error_code = validate_node_specs(node_reg_stat_msg);
+		error_code = validate_node_specs(node_reg_stat_msg,
+						 msg->protocol_version);
 #endif
 		unlock_slurmctld(job_write_lock);
 		END_TIMER2("_slurm_rpc_node_registration");
@@ -2193,6 +2719,9 @@ static void _slurm_rpc_reconfigure_controller(slurm_msg_t * msg)
 		assoc_mgr_set_missing_uids();
 		start_power_mgr(&slurmctld_config.thread_id_power);
 		trigger_reconfig();
+		rpc_class_reconfig();
+		agent_reconfig();
+		reg_queue_reconfig();
 	}
 	END_TIMER2("_slurm_rpc_reconfigure_controller");
 
@@ -2206,7 +2735,7 @@ static void _slurm_rpc_reconfigure_controller(slurm_msg_t * msg)
 		     TIME_STR);
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
 		priority_g_reconfig();          /* notify priority plugin too */
-		schedule(0);			/* has its own locks */
+		queue_job_scheduler(0);
 		save_all_state();
 	}
 }
@@ -2605,6 +3134,8 @@ static void _slurm_rpc_submit_batch_job(slurm_msg_t * msg)
 		error_code = job_allocate(job_desc_msg,
 					  job_desc_msg->immediate,
 					  false, NULL, 0, uid, &job_ptr);
+		if (job_ptr && IS_JOB_PENDING(job_ptr))
+			queue_job_scheduler_part(job_ptr);
 		unlock_slurmctld(job_write_lock);
 		END_TIMER2("_slurm_rpc_submit_batch_job");
 	}
@@ -2629,7 +3160,6 @@ static void _slurm_rpc_submit_batch_job(slurm_msg_t * msg)
 		response_msg.msg_type = RESPONSE_SUBMIT_BATCH_JOB;
 		response_msg.data = &submit_msg;
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		schedule(0);		/* has own locks */
 		schedule_job_save();	/* has own locks */
 		schedule_node_save();	/* has own locks */
 	}
@@ -2667,7 +3197,7 @@ static void _slurm_rpc_update_job(slurm_msg_t * msg)
 		       job_desc_msg->job_id, uid, TIME_STR);
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
 		/* Below functions provide their own locking */
-		schedule(0);
+		queue_job_scheduler(0);
 		schedule_job_save();
 		schedule_node_save();
 	}
@@ -2812,8 +3342,7 @@ static void _slurm_rpc_update_node(slurm_msg_t * msg)
 	}
 
 	/* Below functions provide their own locks */
-	if (schedule(0))
-		schedule_job_save();
+	queue_job_scheduler(0);
 	schedule_node_save();
 	trigger_reconfig();
 }
@@ -2865,10 +3394,7 @@ static void _slurm_rpc_update_partition(slurm_msg_t * msg)
 
 		/* NOTE: These functions provide their own locks */
 		schedule_part_save();
-		if (schedule(0)) {
-			schedule_job_save();
-			schedule_node_save();
-		}
+		queue_job_scheduler(0);
 	}
 }
 
@@ -2911,7 +3437,7 @@ static void _slurm_rpc_delete_partition(slurm_msg_t * msg)
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
 
 		/* NOTE: These functions provide their own locks */
-		schedule(0);
+		queue_job_scheduler(0);
 		save_all_state();
 
 	}
@@ -2970,11 +3496,7 @@ static void _slurm_rpc_resv_create(slurm_msg_t * msg)
 		response_msg.data     = &resv_resp_msg;
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
 
-		/* NOTE: These functions provide their own locks */
-		if (schedule(0)) {
-			schedule_job_save();
-			schedule_node_save();
-		}
+		queue_job_scheduler(0);
 	}
 }
 
@@ -3016,11 +3538,7 @@ static void _slurm_rpc_resv_update(slurm_msg_t * msg)
 		       resv_desc_ptr->name, TIME_STR);
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
 
-		/* NOTE: These functions provide their own locks */
-		if (schedule(0)) {
-			schedule_job_save();
-			schedule_node_save();
-		}
+		queue_job_scheduler(0);
 	}
 }
 
@@ -3063,11 +3581,7 @@ static void _slurm_rpc_resv_delete(slurm_msg_t * msg)
 		     resv_desc_ptr->name, TIME_STR);
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
 
-		/* NOTE: These functions provide their own locks */
-		if (schedule(0)) {
-			schedule_job_save();
-			schedule_node_save();
-		}
+		queue_job_scheduler(0);
 
 	}
 }
@@ -3304,7 +3818,7 @@ inline static void _slurm_rpc_suspend(slurm_msg_t * msg)
 		     sus_ptr->job_id, TIME_STR);
 		/* Functions below provide their own locking */
 		if (sus_ptr->op == SUSPEND_JOB)
-			(void) schedule(0);
+			queue_job_scheduler(0);
 		schedule_job_save();
 	}
 }
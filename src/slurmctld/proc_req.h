@@ -49,6 +49,30 @@
  */
 void slurmctld_req (slurm_msg_t * msg);
 
+/*
+ * slurmctld_req_auth - validate the credential of an RPC request
+ * IN msg - the request message
+ * OUT uid - user issuing the request
+ * RET SLURM_SUCCESS or an error if the request must be dropped
+ */
+extern int slurmctld_req_auth(slurm_msg_t *msg, uid_t *uid);
+
+/*
+ * slurmctld_req_reject - reply to an RPC request refused admission
+ * IN/OUT msg - the request message, data associated with the message is freed
+ * IN uid - user issuing the request
+ * IN rc - reason for the rejection
+ */
+extern void slurmctld_req_reject(slurm_msg_t *msg, uid_t uid, int rc);
+
+/*
+ * slurmctld_req_admitted - process an RPC request once admitted under the
+ *	limits of its class, see rpc_class.h
+ * IN/OUT msg - the request message, data associated with the message is freed
+ * IN uid - user issuing the request
+ */
+extern void slurmctld_req_admitted(slurm_msg_t *msg, uid_t uid);
+
 /*
  * slurm_drain_nodes - process a request to drain a list of nodes,
  *	no-op for nodes already drained or draining
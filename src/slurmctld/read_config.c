@@ -75,6 +75,7 @@
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -95,6 +96,7 @@ static int  _build_bitmaps(void);
 static void _build_bitmaps_pre_select(void);
 static void _gres_reconfig(bool reconfig);
 static int  _init_all_slurm_conf(void);
+static void _phase_time(char **report, struct timeval *tv_last, char *phase);
 static int  _preserve_select_type_param(slurm_ctl_conf_t * ctl_conf_ptr,
 					uint16_t old_select_type_p);
 static int  _preserve_plugins(slurm_ctl_conf_t * ctl_conf_ptr,
@@ -732,9 +734,12 @@ int read_slurm_conf(int recover, bool reconfig)
 	char *state_save_dir      = xstrdup(slurmctld_conf.state_save_location);
 	char *mpi_params;
 	uint16_t old_select_type_p = slurmctld_conf.select_type_param;
+	struct timeval tv_phase;
+	char *phase_report = NULL;
 
 	/* initialization */
 	START_TIMER;
+	tv_phase = tv1;
 
 	if (reconfig) {
 		/* in order to re-use job state information,
@@ -813,6 +818,7 @@ int read_slurm_conf(int recover, bool reconfig)
 	rehash_node();
 	rehash_jobs();
 	set_slurmd_addr();
+	_phase_time(&phase_report, &tv_phase, "config");
 
 	if (reconfig) {		/* Preserve state from memory */
 		if (old_node_table_ptr) {
@@ -835,16 +841,23 @@ int read_slurm_conf(int recover, bool reconfig)
 		reset_first_job_id();
 		(void) slurm_sched_reconfig();
 	} else if (recover == 1) {	/* Load job & node state files */
+		load_job_state_prefetch();
 		(void) load_all_node_state(true);
 		(void) load_all_front_end_state(true);
+		_phase_time(&phase_report, &tv_phase, "node_state");
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		_phase_time(&phase_report, &tv_phase, "job_state");
 	} else if (recover > 1) {	/* Load node, part & job state files */
+		load_job_state_prefetch();
 		(void) load_all_node_state(false);
 		(void) load_all_front_end_state(false);
+		_phase_time(&phase_report, &tv_phase, "node_state");
 		(void) load_all_part_state();
+		_phase_time(&phase_report, &tv_phase, "part_state");
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		_phase_time(&phase_report, &tv_phase, "job_state");
 	}
 
 	sync_front_end_state();
@@ -860,7 +873,9 @@ int read_slurm_conf(int recover, bool reconfig)
 	}
 	xfree(state_save_dir);
 	_gres_reconfig(reconfig);
+	_phase_time(&phase_report, &tv_phase, "select_init");
 	reset_job_bitmaps();		/* must follow select_g_job_init() */
+	_phase_time(&phase_report, &tv_phase, "job_bitmaps");
 
 	(void) _sync_nodes_to_jobs();
 	(void) sync_job_files();
@@ -884,6 +899,7 @@ int read_slurm_conf(int recover, bool reconfig)
 	_validate_node_proc_count();
 #endif
 	(void) _sync_nodes_to_comp_job();/* must follow select_g_node_init() */
+	_phase_time(&phase_report, &tv_phase, "sync");
 	load_part_uid_allow_list(1);
 
 	if (reconfig) {
@@ -895,6 +911,7 @@ int read_slurm_conf(int recover, bool reconfig)
 			(void) slurm_sched_reconfig();
 		}
 	}
+	_phase_time(&phase_report, &tv_phase, "resv_state");
 
 	/* sort config_list by weight for scheduling */
 	list_sort(config_list, &list_compare_config);
@@ -933,9 +950,29 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	slurmctld_conf.last_update = time(NULL);
 	END_TIMER2("read_slurm_conf");
+	_phase_time(&phase_report, &tv_phase, "plugins");
+	if (!reconfig && recover)
+		info("read_slurm_conf: phase times (usec) %s, total %s",
+		     phase_report, TIME_STR);
+	else
+		debug("read_slurm_conf: phase times (usec) %s, total %s",
+		      phase_report, TIME_STR);
+	xfree(phase_report);
 	return error_code;
 }
 
+/* Add the time since *tv_last to the report of read_slurm_conf() phases
+ * and set *tv_last to the current time */
+static void _phase_time(char **report, struct timeval *tv_last, char *phase)
+{
+	struct timeval tv_now;
+
+	gettimeofday(&tv_now, NULL);
+	xstrfmtcat(*report, "%s%s=%ld", (*report ? " " : ""), phase,
+		   diff_tv(tv_last, &tv_now));
+	*tv_last = tv_now;
+}
+
 static void _gres_reconfig(bool reconfig)
 {
 	struct node_record *node_ptr;
@@ -1013,6 +1050,7 @@ static int _restore_node_state(int recover,
 		}
 
 		node_ptr->last_response = old_node_ptr->last_response;
+		node_ptr->protocol_version = old_node_ptr->protocol_version;
 		if (old_node_ptr->port != node_ptr->config_ptr->cpus) {
 			rc = ESLURM_NEED_RESTART;
 			error("Configured cpu count change on %s (%u to %u)",
@@ -1525,6 +1563,7 @@ static int _sync_nodes_to_active_job(struct job_record *job_ptr)
 			info("Killing job %u on DOWN node %s",
 			     job_ptr->job_id, node_ptr->name);
 			job_ptr->job_state = JOB_NODE_FAIL | JOB_COMPLETING;
+			job_index_update(job_ptr);
 			build_cg_bitmap(job_ptr);
 			job_ptr->end_time = MIN(job_ptr->end_time, now);
 			job_ptr->exit_code = MAX(job_ptr->exit_code, 1);
@@ -0,0 +1,294 @@
+/*****************************************************************************\
+ *  reg_queue.c - process node registration RPCs in batches
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/reg_queue.h"
+#include "src/slurmctld/slurmctld.h"
+
+typedef struct reg_rec {
+	slurm_msg_t msg;		/* connection to reply on */
+	slurm_node_registration_status_msg_t *reg_msg;
+	int rc;
+	struct reg_rec *next;
+} reg_rec_t;
+
+static bool     reg_enabled = false;
+static uint32_t batch_max   = DEFAULT_REG_BATCH_MAX;
+static uint32_t batch_wait  = DEFAULT_REG_BATCH_WAIT;	/* msec */
+
+/* Registrations waiting to be validated, protected by reg_lock */
+static pthread_mutex_t reg_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  reg_cond = PTHREAD_COND_INITIALIZER;
+static reg_rec_t *reg_head = NULL;
+static reg_rec_t *reg_tail = NULL;
+static uint32_t   reg_cnt  = 0;
+static bool       reg_running = false;
+
+static void  _process_batch(reg_rec_t *batch, uint32_t cnt);
+static void *_reg_worker(void *no_data);
+
+/*
+ * reg_queue_reconfig - load the reg_batch options from SlurmctldParameters
+ *	(reg_batch, reg_batch_max=#, reg_batch_wait=#)
+ */
+extern void reg_queue_reconfig(void)
+{
+	char *ctld_params, *tmp_ptr;
+	bool enable = false;
+	uint32_t max = DEFAULT_REG_BATCH_MAX, wait = DEFAULT_REG_BATCH_WAIT;
+	int i;
+
+	ctld_params = slurm_get_slurmctld_params();
+	tmp_ptr = ctld_params;
+	while (tmp_ptr && (tmp_ptr = strstr(tmp_ptr, "reg_batch"))) {
+		/* Skip "reg_batch_max=#" and "reg_batch_wait=#" */
+		if ((tmp_ptr[9] == '\0') || (tmp_ptr[9] == ',')) {
+			enable = true;
+			break;
+		}
+		tmp_ptr += 9;
+	}
+	if (ctld_params &&
+	    (tmp_ptr = strstr(ctld_params, "reg_batch_max="))) {
+		i = atoi(tmp_ptr + 14);
+		if (i < 1)
+			error("Invalid SlurmctldParameters reg_batch_max: %d", i);
+		else
+			max = i;
+	}
+	if (ctld_params &&
+	    (tmp_ptr = strstr(ctld_params, "reg_batch_wait="))) {
+		i = atoi(tmp_ptr + 15);
+		if (i < 0)
+			error("Invalid SlurmctldParameters reg_batch_wait: %d",
+			      i);
+		else
+			wait = i;
+	}
+	xfree(ctld_params);
+
+	slurm_mutex_lock(&reg_lock);
+	if (enable != reg_enabled) {
+		info("reg_queue: batched node registration %s",
+		     enable ? "enabled" : "disabled");
+	}
+	reg_enabled = enable;
+	batch_max   = max;
+	batch_wait  = wait;
+	slurm_mutex_unlock(&reg_lock);
+}
+
+/*
+ * reg_queue_add - queue a MESSAGE_NODE_REGISTRATION_STATUS RPC to be
+ *	validated with other registrations under one acquisition of the
+ *	slurmctld locks. The reply is sent once its batch has been processed.
+ * IN/OUT msg - the request, if queued its data and connection are taken
+ *	over: msg->data is set to NULL and msg->conn_fd to -1
+ * RET true if queued, false if reg_batch is not configured and the RPC
+ *	should be processed by the caller
+ */
+extern bool reg_queue_add(slurm_msg_t *msg)
+{
+	pthread_attr_t thread_attr;
+	pthread_t thread_id;
+	reg_rec_t *rec;
+
+	slurm_mutex_lock(&reg_lock);
+	if (!reg_enabled || slurmctld_config.shutdown_time) {
+		slurm_mutex_unlock(&reg_lock);
+		return false;
+	}
+	if (!reg_running) {
+		slurm_attr_init(&thread_attr);
+		if (pthread_attr_setdetachstate(&thread_attr,
+						PTHREAD_CREATE_DETACHED))
+			error("pthread_attr_setdetachstate %m");
+		if (pthread_create(&thread_id, &thread_attr, _reg_worker,
+				   NULL)) {
+			error("reg_queue: pthread_create: %m");
+			slurm_attr_destroy(&thread_attr);
+			slurm_mutex_unlock(&reg_lock);
+			return false;
+		}
+		slurm_attr_destroy(&thread_attr);
+		reg_running = true;
+	}
+
+	rec = xmalloc(sizeof(reg_rec_t));
+	slurm_msg_t_init(&rec->msg);
+	rec->msg.msg_type = msg->msg_type;
+	rec->msg.protocol_version = msg->protocol_version;
+	rec->msg.flags     = msg->flags;
+	rec->msg.address   = msg->address;
+	rec->msg.orig_addr = msg->orig_addr;
+	rec->msg.conn_fd   = msg->conn_fd;
+	rec->reg_msg = (slurm_node_registration_status_msg_t *) msg->data;
+	msg->data    = NULL;
+	msg->conn_fd = -1;
+
+	if (reg_tail)
+		reg_tail->next = rec;
+	else
+		reg_head = rec;
+	reg_tail = rec;
+	reg_cnt++;
+	pthread_cond_signal(&reg_cond);
+	slurm_mutex_unlock(&reg_lock);
+
+	return true;
+}
+
+/*
+ * Validate a batch of registrations under one acquisition of the slurmctld
+ * locks, then reply to each node and release the batch
+ */
+static void _process_batch(reg_rec_t *batch, uint32_t cnt)
+{
+	DEF_TIMERS;
+	/* Locks: Read config, write job, write node */
+	slurmctld_lock_t job_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
+	reg_rec_t *rec;
+
+	START_TIMER;
+	lock_slurmctld(job_write_lock);
+	node_reg_batch_begin();
+	for (rec = batch; rec; rec = rec->next) {
+#ifdef HAVE_FRONT_END		/* Operates only on front-end */
+		rec->rc = validate_nodes_via_front_end(rec->reg_msg);
+#else
+		validate_jobs_on_node(rec->reg_msg);
+		rec->rc = validate_node_specs(rec->reg_msg,
+					      rec->msg.protocol_version);
+#endif
+	}
+	node_reg_batch_end();
+	unlock_slurmctld(job_write_lock);
+	END_TIMER2("reg_queue batch");
+	debug2("reg_queue: validated %u node registrations %s",
+	       cnt, TIME_STR);
+
+	while ((rec = batch)) {
+		batch = rec->next;
+		if (rec->rc) {
+			error("_slurm_rpc_node_registration node=%s: %s",
+			      rec->reg_msg->node_name,
+			      slurm_strerror(rec->rc));
+		}
+		slurm_send_rc_msg(&rec->msg, rec->rc);
+		if (slurm_close_accepted_conn(rec->msg.conn_fd) < 0)
+			error("close(%d): %m", rec->msg.conn_fd);
+		slurm_free_node_registration_status_msg(rec->reg_msg);
+		xfree(rec);
+	}
+}
+
+/*
+ * Run as a detached pthread to drain the registration queue. Once a
+ * registration arrives, wait up to reg_batch_wait msec for others to join
+ * it so that a storm of registrations is validated in a few batches.
+ */
+static void *_reg_worker(void *no_data)
+{
+	struct timeval now;
+	struct timespec ts;
+	reg_rec_t *batch, *rec;
+	uint32_t cnt, max;
+
+	while (1) {
+		slurm_mutex_lock(&reg_lock);
+		while ((reg_cnt == 0) && !slurmctld_config.shutdown_time) {
+			ts.tv_sec  = time(NULL) + 1;
+			ts.tv_nsec = 0;
+			pthread_cond_timedwait(&reg_cond, &reg_lock, &ts);
+		}
+		if (reg_cnt == 0) {
+			reg_running = false;
+			slurm_mutex_unlock(&reg_lock);
+			break;
+		}
+		if ((reg_cnt < batch_max) && batch_wait &&
+		    !slurmctld_config.shutdown_time) {
+			gettimeofday(&now, NULL);
+			ts.tv_sec  = now.tv_sec + (batch_wait / 1000);
+			ts.tv_nsec = (now.tv_usec * 1000) +
+				     ((batch_wait % 1000) * 1000000);
+			if (ts.tv_nsec >= 1000000000) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000;
+			}
+			while ((reg_cnt < batch_max) &&
+			       (pthread_cond_timedwait(&reg_cond, &reg_lock,
+						       &ts) != ETIMEDOUT))
+				;
+		}
+
+		batch = rec = reg_head;
+		max = batch_max;
+		for (cnt = 1; (cnt < max) && rec->next; cnt++)
+			rec = rec->next;
+		reg_head = rec->next;
+		rec->next = NULL;
+		if (reg_head == NULL)
+			reg_tail = NULL;
+		reg_cnt -= cnt;
+		slurm_mutex_unlock(&reg_lock);
+
+		_process_batch(batch, cnt);
+	}
+
+	return NULL;
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************\
+ *  reg_queue.h - process node registration RPCs in batches
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#ifndef _HAVE_REG_QUEUE_H
+#define _HAVE_REG_QUEUE_H
+
+#include "src/slurmctld/slurmctld.h"
+
+/* Default values for the SlurmctldParameters reg_batch options */
+#define DEFAULT_REG_BATCH_MAX	256
+#define DEFAULT_REG_BATCH_WAIT	50
+
+/*
+ * reg_queue_reconfig - load the reg_batch options from SlurmctldParameters
+ *	(reg_batch, reg_batch_max=#, reg_batch_wait=#)
+ */
+extern void reg_queue_reconfig(void);
+
+/*
+ * reg_queue_add - queue a MESSAGE_NODE_REGISTRATION_STATUS RPC to be
+ *	validated with other registrations under one acquisition of the
+ *	slurmctld locks. The reply is sent once its batch has been processed.
+ * IN/OUT msg - the request, if queued its data and connection are taken
+ *	over: msg->data is set to NULL and msg->conn_fd to -1
+ * RET true if queued, false if reg_batch is not configured and the RPC
+ *	should be processed by the caller
+ */
+extern bool reg_queue_add(slurm_msg_t *msg);
+
+#endif	/* !_HAVE_REG_QUEUE_H */
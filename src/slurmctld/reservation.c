@@ -70,6 +70,7 @@
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+#include "src/slurmctld/job_index.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
@@ -1726,6 +1727,7 @@ static void _clear_job_resv(slurmctld_resv_t *resv_ptr)
 		job_ptr->resv_id = 0;
 		job_ptr->resv_ptr = NULL;
 		xfree(job_ptr->resv_name);
+		job_index_update(job_ptr);
 	}
 	list_iterator_destroy(job_iterator);
 }
@@ -2050,6 +2052,7 @@ static void _validate_all_reservations(void)
 			       job_ptr->job_id, job_ptr->resv_name);
 			job_ptr->resv_id = 0;
 			xfree(job_ptr->resv_name);
+			job_index_update(job_ptr);
 		}
 	}
 	list_iterator_destroy(iter);
@@ -2279,6 +2282,7 @@ extern int validate_job_resv(struct job_record *job_ptr)
 		job_ptr->resv_id    = 0;
 		job_ptr->resv_flags = 0;
 		job_ptr->resv_ptr   = NULL;
+		job_index_update(job_ptr);
 		return SLURM_SUCCESS;
 	}
 
@@ -2298,6 +2302,7 @@ extern int validate_job_resv(struct job_record *job_ptr)
 		job_ptr->resv_id    = resv_ptr->resv_id;
 		job_ptr->resv_flags = resv_ptr->flags;
 		job_ptr->resv_ptr   = resv_ptr;
+		job_index_update(job_ptr);
 	}
 	return rc;
 }
@@ -2860,6 +2865,7 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 			/* reservation ended earlier */
 			*when = resv_ptr->end_time;
 			job_ptr->priority = 0;	/* administrative hold */
+			job_index_update(job_ptr);
 			return ESLURM_RESERVATION_INVALID;
 		}
 		if (job_ptr->details->req_node_bitmap &&
@@ -0,0 +1,493 @@
+/*****************************************************************************\
+ *  rpc_class.c - RPC admission control by request class
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/rpc_class.h"
+#include "src/slurmctld/slurmctld.h"
+
+/* Size of each class's hash table of per-user request counters */
+#define USER_HASH_SIZE	64
+
+/* Seconds without RPCs after which a user's request counter is freed */
+#define USER_IDLE_TIME	300
+
+typedef struct rpc_user {
+	uid_t uid;
+	time_t window;			/* second being counted */
+	uint32_t count;			/* RPCs during that second */
+	struct rpc_user *next;
+} rpc_user_t;
+
+typedef struct rpc_class_rec {
+	char *name;
+	uint32_t max_active;		/* concurrent RPCs, 0 if unlimited */
+	uint32_t max_waiting;		/* RPCs waiting for admission */
+	uint32_t user_rate;		/* RPCs per second per user,
+					 * 0 if unlimited */
+	uint32_t active;
+	uint32_t waiting;
+	pthread_cond_t cond;
+	rpc_user_t *user_hash[USER_HASH_SIZE];
+	time_t user_purge;		/* time of last _user_purge() */
+
+	/* Statistics */
+	uint32_t admit_cnt;
+	uint32_t delay_cnt;
+	uint32_t busy_cnt;
+	uint32_t rate_cnt;
+	uint64_t wait_total;		/* usec */
+} rpc_class_rec_t;
+
+/* All class records are protected by class_lock */
+static pthread_mutex_t class_lock = PTHREAD_MUTEX_INITIALIZER;
+static rpc_class_rec_t class_rec[RPC_CLASS_COUNT] = {
+	{ .name = "daemon", .cond = PTHREAD_COND_INITIALIZER },
+	{ .name = "submit", .cond = PTHREAD_COND_INITIALIZER },
+	{ .name = "query",  .cond = PTHREAD_COND_INITIALIZER },
+};
+static int max_wait = 5;	/* seconds to wait for admission */
+
+/* rpc_class_of - identify the admission class of an RPC type */
+extern rpc_class_t rpc_class_of(slurm_msg_type_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_BUILD_INFO:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_JOB_INFO_SINGLE:
+	case REQUEST_SHARE_INFO:
+	case REQUEST_PRIORITY_FACTORS:
+	case REQUEST_JOB_END_TIME:
+	case REQUEST_FRONT_END_INFO:
+	case REQUEST_NODE_INFO:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_BLOCK_INFO:
+	case REQUEST_TOPO_INFO:
+	case REQUEST_TRIGGER_GET:
+	case REQUEST_JOB_READY:
+	case REQUEST_STATS_INFO:
+		return RPC_CLASS_QUERY;
+	case REQUEST_RESOURCE_ALLOCATION:
+	case REQUEST_SUBMIT_BATCH_JOB:
+	case REQUEST_JOB_WILL_RUN:
+	case REQUEST_UPDATE_JOB:
+	case REQUEST_CANCEL_JOB_STEP:
+	case REQUEST_JOB_STEP_CREATE:
+	case REQUEST_JOB_ALLOCATION_INFO:
+	case REQUEST_JOB_ALLOCATION_INFO_LITE:
+	case REQUEST_JOB_SBCAST_CRED:
+	case REQUEST_STEP_LAYOUT:
+	case REQUEST_UPDATE_JOB_STEP:
+	case REQUEST_SUSPEND:
+	case REQUEST_JOB_REQUEUE:
+	case REQUEST_CHECKPOINT:
+	case REQUEST_JOB_NOTIFY:
+	case REQUEST_TRIGGER_SET:
+	case REQUEST_TRIGGER_CLEAR:
+	case REQUEST_TRIGGER_PULL:
+		return RPC_CLASS_SUBMIT;
+	default:
+		/* Completion, registration and administrative RPCs */
+		return RPC_CLASS_DAEMON;
+	}
+}
+
+/* Return the value of SlurmctldParameters option "rpc_<class>_<opt>=#",
+ * or zero if not set */
+static uint32_t _get_class_param(char *ctld_params, char *class_name,
+				 char *opt)
+{
+	char *key = NULL, *tmp_ptr;
+	int i = 0;
+
+	if (!ctld_params)
+		return 0;
+	xstrfmtcat(key, "rpc_%s_%s=", class_name, opt);
+	if ((tmp_ptr = strstr(ctld_params, key))) {
+		i = atoi(tmp_ptr + strlen(key));
+		if (i < 0) {
+			error("Invalid SlurmctldParameters %s%d", key, i);
+			i = 0;
+		}
+	}
+	xfree(key);
+	return (uint32_t) i;
+}
+
+/*
+ * rpc_class_reconfig - load the per-class limits from SlurmctldParameters
+ *	(rpc_<class>_threads=#, rpc_<class>_queue=#, rpc_<class>_rate=#
+ *	where <class> is "submit" or "query")
+ */
+extern void rpc_class_reconfig(void)
+{
+	rpc_class_rec_t *rec;
+	char *ctld_params = slurm_get_slurmctld_params();
+	int i;
+
+	slurm_mutex_lock(&class_lock);
+	max_wait = MAX(slurm_get_msg_timeout() / 2, 1);
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		rec = &class_rec[i];
+		if (i == RPC_CLASS_DAEMON)	/* never limited */
+			continue;
+		rec->max_active  = _get_class_param(ctld_params, rec->name,
+						    "threads");
+		rec->max_waiting = _get_class_param(ctld_params, rec->name,
+						    "queue");
+		rec->user_rate   = _get_class_param(ctld_params, rec->name,
+						    "rate");
+		if (rec->max_active || rec->user_rate) {
+			info("rpc_class %s: threads=%u queue=%u rate=%u",
+			     rec->name, rec->max_active, rec->max_waiting,
+			     rec->user_rate);
+		}
+		/* Wake waiters in case the limit was raised */
+		pthread_cond_broadcast(&rec->cond);
+	}
+	slurm_mutex_unlock(&class_lock);
+	xfree(ctld_params);
+}
+
+/* Free the request counters of users idle since before idle_time.
+ * class_lock must be held. */
+static void _user_purge(rpc_class_rec_t *rec, time_t idle_time)
+{
+	rpc_user_t **user_pptr, *user;
+	int i;
+
+	for (i = 0; i < USER_HASH_SIZE; i++) {
+		user_pptr = &rec->user_hash[i];
+		while ((user = *user_pptr)) {
+			if (user->window < idle_time) {
+				*user_pptr = user->next;
+				xfree(user);
+			} else
+				user_pptr = &user->next;
+		}
+	}
+}
+
+/* Count an RPC against the user's rate for this second.
+ * RET true if the user's rate limit is exceeded.
+ * class_lock must be held. */
+static bool _user_rate_exceeded(rpc_class_rec_t *rec, uid_t uid, time_t now)
+{
+	rpc_user_t *user;
+	int inx = uid % USER_HASH_SIZE;
+
+	if (difftime(now, rec->user_purge) >= USER_IDLE_TIME) {
+		_user_purge(rec, now - USER_IDLE_TIME);
+		rec->user_purge = now;
+	}
+	for (user = rec->user_hash[inx]; user; user = user->next) {
+		if (user->uid == uid)
+			break;
+	}
+	if (!user) {
+		user = xmalloc(sizeof(rpc_user_t));
+		user->uid  = uid;
+		user->next = rec->user_hash[inx];
+		rec->user_hash[inx] = user;
+	}
+	if (user->window != now) {
+		user->window = now;
+		user->count  = 0;
+	}
+	if (user->count >= rec->user_rate)
+		return true;
+	user->count++;
+	return false;
+}
+
+/*
+ * rpc_class_admit - wait until an RPC may be processed under the limits of
+ *	its class, not counted as a server thread meanwhile. Used when RPCs
+ *	are serviced by a pthread per connection. Must be called before taking
+ *	any slurmctld locks.
+ * IN msg_type - RPC type
+ * IN uid - user issuing the RPC
+ * OUT rpc_class - class of the RPC, pass to rpc_class_release()
+ * RET SLURM_SUCCESS, ESLURM_RPC_BUSY or ESLURM_RPC_RATE_LIMIT. If not
+ *	SLURM_SUCCESS, the RPC must be rejected and rpc_class_release()
+ *	not called.
+ */
+extern int rpc_class_admit(slurm_msg_type_t msg_type, uid_t uid,
+			   rpc_class_t *rpc_class)
+{
+	rpc_class_rec_t *rec;
+	struct timeval tv1, tv2;
+	struct timespec deadline;
+	int rc = SLURM_SUCCESS;
+
+	*rpc_class = rpc_class_of(msg_type);
+	rec = &class_rec[*rpc_class];
+
+	slurm_mutex_lock(&class_lock);
+	if (validate_slurm_user(uid))
+		goto admit;
+
+	if (rec->user_rate &&
+	    _user_rate_exceeded(rec, uid, time(NULL))) {
+		rec->rate_cnt++;
+		rc = ESLURM_RPC_RATE_LIMIT;
+		goto fini;
+	}
+
+	if (rec->max_active && (rec->active >= rec->max_active)) {
+		if (rec->waiting >= rec->max_waiting) {
+			rec->busy_cnt++;
+			rc = ESLURM_RPC_BUSY;
+			goto fini;
+		}
+		rec->delay_cnt++;
+		rec->waiting++;
+		/* Waiting RPCs must not keep the acceptor from starting
+		 * those of other classes */
+		server_thread_decr();
+		gettimeofday(&tv1, NULL);
+		deadline.tv_sec  = tv1.tv_sec + max_wait;
+		deadline.tv_nsec = tv1.tv_usec * 1000;
+		while (rec->max_active && (rec->active >= rec->max_active) &&
+		       !slurmctld_config.shutdown_time) {
+			if (pthread_cond_timedwait(&rec->cond, &class_lock,
+						   &deadline) == ETIMEDOUT)
+				break;
+		}
+		server_thread_incr();
+		rec->waiting--;
+		gettimeofday(&tv2, NULL);
+		rec->wait_total += diff_tv(&tv1, &tv2);
+		if (rec->max_active && (rec->active >= rec->max_active)) {
+			rec->busy_cnt++;
+			rc = ESLURM_RPC_BUSY;
+			goto fini;
+		}
+	}
+
+admit:	rec->active++;
+	rec->admit_cnt++;
+fini:	slurm_mutex_unlock(&class_lock);
+	return rc;
+}
+
+/*
+ * rpc_class_try_admit - admit an RPC under the limits of its class without
+ *	waiting, as the RPC worker pool does. Must be called before taking any
+ *	slurmctld locks.
+ * IN msg_type - RPC type
+ * IN uid - user issuing the RPC
+ * OUT rpc_class - class of the RPC
+ * RET SLURM_SUCCESS if admitted, pass rpc_class to rpc_class_release()
+ *	once done; EAGAIN if it must wait in the queue of its class, pass
+ *	rpc_class to rpc_class_dequeue() once removed from it; otherwise
+ *	ESLURM_RPC_BUSY or ESLURM_RPC_RATE_LIMIT and the RPC must be rejected
+ */
+extern int rpc_class_try_admit(slurm_msg_type_t msg_type, uid_t uid,
+			       rpc_class_t *rpc_class)
+{
+	rpc_class_rec_t *rec;
+	int rc = SLURM_SUCCESS;
+
+	*rpc_class = rpc_class_of(msg_type);
+	rec = &class_rec[*rpc_class];
+
+	slurm_mutex_lock(&class_lock);
+	if (validate_slurm_user(uid))
+		goto admit;
+
+	if (rec->user_rate &&
+	    _user_rate_exceeded(rec, uid, time(NULL))) {
+		rec->rate_cnt++;
+		rc = ESLURM_RPC_RATE_LIMIT;
+		goto fini;
+	}
+
+	if (rec->max_active && (rec->active >= rec->max_active)) {
+		if (rec->waiting >= rec->max_waiting) {
+			rec->busy_cnt++;
+			rc = ESLURM_RPC_BUSY;
+		} else {
+			rec->delay_cnt++;
+			rec->waiting++;
+			rc = EAGAIN;
+		}
+		goto fini;
+	}
+
+admit:	rec->active++;
+	rec->admit_cnt++;
+fini:	slurm_mutex_unlock(&class_lock);
+	return rc;
+}
+
+/*
+ * rpc_class_dequeue - note that an RPC left waiting by rpc_class_try_admit()
+ *	was removed from the queue of its class to take the place of one which
+ *	completed, or at shutdown
+ * IN rpc_class - class of the RPC
+ * IN wait_usec - time it waited
+ * RET SLURM_SUCCESS or ESLURM_RPC_BUSY if it waited longer than half of
+ *	MessageTimeout, in which case it must be rejected
+ */
+extern int rpc_class_dequeue(rpc_class_t rpc_class, long wait_usec)
+{
+	rpc_class_rec_t *rec = &class_rec[rpc_class];
+	int rc = SLURM_SUCCESS;
+
+	slurm_mutex_lock(&class_lock);
+	if (rec->waiting)
+		rec->waiting--;
+	if (wait_usec > 0)
+		rec->wait_total += wait_usec;
+	if ((wait_usec > (max_wait * 1000000L)) ||
+	    slurmctld_config.shutdown_time) {
+		rec->busy_cnt++;
+		rc = ESLURM_RPC_BUSY;
+	} else
+		rec->admit_cnt++;
+	slurm_mutex_unlock(&class_lock);
+	return rc;
+}
+
+/* rpc_class_release - note completion of an RPC admitted by
+ *	rpc_class_admit() or rpc_class_try_admit() */
+extern void rpc_class_release(rpc_class_t rpc_class)
+{
+	rpc_class_rec_t *rec = &class_rec[rpc_class];
+
+	slurm_mutex_lock(&class_lock);
+	if (rec->active)
+		rec->active--;
+	else
+		error("rpc_class_release: %s active count underflow",
+		      rec->name);
+	if (rec->waiting)
+		pthread_cond_signal(&rec->cond);
+	slurm_mutex_unlock(&class_lock);
+}
+
+/*
+ * rpc_class_get_stats - report admission statistics by class
+ * OUT stats - the rpc_class_* fields are filled in, the arrays must be
+ *	freed using slurm_free_stats_response_members()
+ */
+extern void rpc_class_get_stats(stats_info_response_msg_t *stats)
+{
+	rpc_class_rec_t *rec;
+	int i;
+
+	stats->rpc_class_cnt = RPC_CLASS_COUNT;
+	stats->rpc_class_name = xmalloc(sizeof(char *) *
+					(RPC_CLASS_COUNT + 1));
+	stats->rpc_class_active     = xmalloc(sizeof(uint32_t) *
+					      RPC_CLASS_COUNT);
+	stats->rpc_class_waiting    = xmalloc(sizeof(uint32_t) *
+					      RPC_CLASS_COUNT);
+	stats->rpc_class_admit_cnt  = xmalloc(sizeof(uint32_t) *
+					      RPC_CLASS_COUNT);
+	stats->rpc_class_delay_cnt  = xmalloc(sizeof(uint32_t) *
+					      RPC_CLASS_COUNT);
+	stats->rpc_class_busy_cnt   = xmalloc(sizeof(uint32_t) *
+					      RPC_CLASS_COUNT);
+	stats->rpc_class_rate_cnt   = xmalloc(sizeof(uint32_t) *
+					      RPC_CLASS_COUNT);
+	stats->rpc_class_wait_total = xmalloc(sizeof(uint64_t) *
+					      RPC_CLASS_COUNT);
+
+	slurm_mutex_lock(&class_lock);
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		rec = &class_rec[i];
+		stats->rpc_class_name[i]       = xstrdup(rec->name);
+		stats->rpc_class_active[i]     = rec->active;
+		stats->rpc_class_waiting[i]    = rec->waiting;
+		stats->rpc_class_admit_cnt[i]  = rec->admit_cnt;
+		stats->rpc_class_delay_cnt[i]  = rec->delay_cnt;
+		stats->rpc_class_busy_cnt[i]   = rec->busy_cnt;
+		stats->rpc_class_rate_cnt[i]   = rec->rate_cnt;
+		stats->rpc_class_wait_total[i] = rec->wait_total;
+	}
+	slurm_mutex_unlock(&class_lock);
+}
+
+/* rpc_class_fini - free the per-user request counters */
+extern void rpc_class_fini(void)
+{
+	int i;
+
+	slurm_mutex_lock(&class_lock);
+	for (i = 0; i < RPC_CLASS_COUNT; i++)
+		_user_purge(&class_rec[i], time(NULL) + 1);	/* all */
+	slurm_mutex_unlock(&class_lock);
+}
+
+/* rpc_class_reset_stats - clear the admission statistics counters */
+extern void rpc_class_reset_stats(void)
+{
+	rpc_class_rec_t *rec;
+	int i;
+
+	slurm_mutex_lock(&class_lock);
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		rec = &class_rec[i];
+		rec->admit_cnt  = 0;
+		rec->delay_cnt  = 0;
+		rec->busy_cnt   = 0;
+		rec->rate_cnt   = 0;
+		rec->wait_total = 0;
+	}
+	slurm_mutex_unlock(&class_lock);
+}
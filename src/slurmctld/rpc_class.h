@@ -0,0 +1,119 @@
+/*****************************************************************************\
+ *  rpc_class.h - RPC admission control by request class
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_RPC_CLASS_H
+#define _HAVE_RPC_CLASS_H
+
+#include "src/slurmctld/slurmctld.h"
+
+/* RPC admission classes. Requests from slurmd, slurmstepd and
+ * administrators are never delayed, so that a flood of user queries can
+ * not starve the RPCs that release resources. */
+typedef enum {
+	RPC_CLASS_DAEMON,	/* node and daemon state changes */
+	RPC_CLASS_SUBMIT,	/* user job submission and job control */
+	RPC_CLASS_QUERY,	/* read-only state queries */
+	RPC_CLASS_COUNT		/* count of classes, must be last */
+} rpc_class_t;
+
+/* rpc_class_of - identify the admission class of an RPC type */
+extern rpc_class_t rpc_class_of(slurm_msg_type_t msg_type);
+
+/*
+ * rpc_class_reconfig - load the per-class limits from SlurmctldParameters
+ *	(rpc_<class>_threads=#, rpc_<class>_queue=#, rpc_<class>_rate=#
+ *	where <class> is "submit" or "query")
+ */
+extern void rpc_class_reconfig(void);
+
+/*
+ * rpc_class_admit - wait until an RPC may be processed under the limits of
+ *	its class, not counted as a server thread meanwhile. Used when RPCs
+ *	are serviced by a pthread per connection. Must be called before taking
+ *	any slurmctld locks.
+ * IN msg_type - RPC type
+ * IN uid - user issuing the RPC
+ * OUT rpc_class - class of the RPC, pass to rpc_class_release()
+ * RET SLURM_SUCCESS, ESLURM_RPC_BUSY or ESLURM_RPC_RATE_LIMIT. If not
+ *	SLURM_SUCCESS, the RPC must be rejected and rpc_class_release()
+ *	not called.
+ */
+extern int rpc_class_admit(slurm_msg_type_t msg_type, uid_t uid,
+			   rpc_class_t *rpc_class);
+
+/*
+ * rpc_class_try_admit - admit an RPC under the limits of its class without
+ *	waiting, as the RPC worker pool does. Must be called before taking any
+ *	slurmctld locks.
+ * IN msg_type - RPC type
+ * IN uid - user issuing the RPC
+ * OUT rpc_class - class of the RPC
+ * RET SLURM_SUCCESS if admitted, pass rpc_class to rpc_class_release()
+ *	once done; EAGAIN if it must wait in the queue of its class, pass
+ *	rpc_class to rpc_class_dequeue() once removed from it; otherwise
+ *	ESLURM_RPC_BUSY or ESLURM_RPC_RATE_LIMIT and the RPC must be rejected
+ */
+extern int rpc_class_try_admit(slurm_msg_type_t msg_type, uid_t uid,
+			       rpc_class_t *rpc_class);
+
+/*
+ * rpc_class_dequeue - note that an RPC left waiting by rpc_class_try_admit()
+ *	was removed from the queue of its class to take the place of one which
+ *	completed, or at shutdown
+ * IN rpc_class - class of the RPC
+ * IN wait_usec - time it waited
+ * RET SLURM_SUCCESS or ESLURM_RPC_BUSY if it waited longer than half of
+ *	MessageTimeout, in which case it must be rejected
+ */
+extern int rpc_class_dequeue(rpc_class_t rpc_class, long wait_usec);
+
+/* rpc_class_release - note completion of an RPC admitted by
+ *	rpc_class_admit() or rpc_class_try_admit() */
+extern void rpc_class_release(rpc_class_t rpc_class);
+
+/* rpc_class_fini - free the per-user request counters */
+extern void rpc_class_fini(void);
+
+/*
+ * rpc_class_get_stats - report admission statistics by class
+ * OUT stats - the rpc_class_* fields are filled in, the arrays must be
+ *	freed using slurm_free_stats_response_members()
+ */
+extern void rpc_class_get_stats(stats_info_response_msg_t *stats);
+
+/* rpc_class_reset_stats - clear the admission statistics counters */
+extern void rpc_class_reset_stats(void);
+
+#endif	/* !_HAVE_RPC_CLASS_H */
@@ -0,0 +1,635 @@
+/*****************************************************************************\
+ *  rpc_pool.c - event driven RPC acceptor with a fixed pool of worker
+ *	threads servicing a bounded request queue
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/proc_req.h"
+#include "src/slurmctld/rpc_class.h"
+#include "src/slurmctld/rpc_pool.h"
+#include "src/slurmctld/slurmctld.h"
+
+/* Maximum events reported by one epoll_wait() call */
+#define MAX_POLL_EVENTS	64
+
+/* Seconds between checks for connections which never sent a message */
+#define IDLE_CHECK_INTERVAL	5
+
+typedef struct rpc_conn {
+	slurm_fd_t fd;
+	bool listen;			/* listening socket, not a connection */
+	time_t accept_time;		/* time connection accepted */
+	struct timeval queue_time;	/* time connection queued */
+	struct rpc_conn *prev;		/* connections waiting for data */
+	struct rpc_conn *next;
+} rpc_conn_t;
+
+typedef struct rpc_wait {
+	slurm_msg_t *msg;
+	uid_t uid;
+	struct timeval queue_time;	/* time RPC queued in its class */
+	struct rpc_wait *next;
+} rpc_wait_t;
+
+static uint32_t pool_threads = DEFAULT_RPC_POOL_THREADS;
+static uint32_t queue_size   = DEFAULT_RPC_QUEUE_DEPTH;
+
+/* Circular queue of connections with data ready to be read,
+ * protected by queue_lock */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  queue_cond = PTHREAD_COND_INITIALIZER;
+static rpc_conn_t **queue = NULL;
+static uint32_t queue_head = 0;
+static uint32_t queue_cnt  = 0;
+static bool     pool_running = false;
+static uint32_t pool_busy  = 0;
+
+/* Statistics, protected by queue_lock */
+static uint32_t stat_depth_max = 0;
+static uint32_t stat_queue_cnt = 0;
+static uint32_t stat_full_cnt  = 0;	/* connections closed, queue full */
+static uint64_t stat_wait_total = 0;
+static uint32_t stat_wait_max  = 0;
+
+/* RPCs waiting for admission, by class, protected by class_queue_lock.
+ * An RPC only waits while another of its class is active, which starts
+ * it upon completion, so waiting RPCs hold no worker thread. Daemon RPCs
+ * are never limited and so never wait here. */
+static pthread_mutex_t class_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static rpc_wait_t *class_head[RPC_CLASS_COUNT];
+static rpc_wait_t *class_tail[RPC_CLASS_COUNT];
+
+static void  _close_conn(rpc_conn_t *conn);
+static void  _enqueue(rpc_conn_t *conn);
+static void *_rpc_worker(void *no_data);
+
+/*
+ * rpc_pool_configured - parse SlurmctldParameters for the rpc_pool options
+ * RET true if RPCs should be serviced by the worker pool rather than by a
+ *	pthread created for each connection
+ */
+extern bool rpc_pool_configured(void)
+{
+	char *ctld_params, *tmp_ptr;
+	bool use_pool = false;
+	int i;
+
+	pool_threads = DEFAULT_RPC_POOL_THREADS;
+	queue_size   = DEFAULT_RPC_QUEUE_DEPTH;
+
+	ctld_params = slurm_get_slurmctld_params();
+	tmp_ptr = ctld_params;
+	while (tmp_ptr && (tmp_ptr = strstr(tmp_ptr, "rpc_pool"))) {
+		/* Skip "rpc_pool_threads=#" */
+		if ((tmp_ptr[8] == '\0') || (tmp_ptr[8] == ',')) {
+			use_pool = true;
+			break;
+		}
+		tmp_ptr += 8;
+	}
+	if (ctld_params &&
+	    (tmp_ptr = strstr(ctld_params, "rpc_pool_threads="))) {
+		i = atoi(tmp_ptr + 17);
+		if (i < 1)
+			error("Invalid SlurmctldParameters rpc_pool_threads: %d",
+			      i);
+		else
+			pool_threads = i;
+	}
+	if (ctld_params &&
+	    (tmp_ptr = strstr(ctld_params, "rpc_queue_depth="))) {
+		i = atoi(tmp_ptr + 16);
+		if (i < 1)
+			error("Invalid SlurmctldParameters rpc_queue_depth: %d",
+			      i);
+		else
+			queue_size = i;
+	}
+	xfree(ctld_params);
+
+	return use_pool;
+}
+
+/* Add a connection with data available to the queue. If the queue is
+ * full the connection is closed unread rather than stalling the acceptor,
+ * which must keep accepting the RPCs of slurmd. The connection
+ * is counted as a server thread until serviced so that backfill and
+ * REQUEST_CONTROL see the load. */
+static void _enqueue(rpc_conn_t *conn)
+{
+	slurm_mutex_lock(&queue_lock);
+	if (queue_cnt >= queue_size) {
+		stat_full_cnt++;
+		slurm_mutex_unlock(&queue_lock);
+		debug("rpc_pool: queue full, closing connection %d", conn->fd);
+		_close_conn(conn);
+		return;
+	}
+
+	gettimeofday(&conn->queue_time, NULL);
+	queue[(queue_head + queue_cnt) % queue_size] = conn;
+	queue_cnt++;
+	stat_queue_cnt++;
+	if (queue_cnt > stat_depth_max)
+		stat_depth_max = queue_cnt;
+
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	slurmctld_config.server_thread_count++;
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+	pthread_cond_signal(&queue_cond);
+	slurm_mutex_unlock(&queue_lock);
+}
+
+static void _close_conn(rpc_conn_t *conn)
+{
+	if ((conn->fd >= 0) && (slurm_close_accepted_conn(conn->fd) < 0))
+		error("close(%d): %m", conn->fd);
+	xfree(conn);
+}
+
+/* Done with an RPC, close its connection unless slurmctld_req_admitted()
+ * kept it open to reply later */
+static void _msg_done(slurm_msg_t *msg)
+{
+	if ((msg->conn_fd >= 0) &&
+	    (slurm_close_accepted_conn(msg->conn_fd) < 0))
+		error("close(%d): %m", msg->conn_fd);
+	slurm_free_msg(msg);
+	server_thread_decr();
+}
+
+/* Remove the first RPC waiting in a class's queue.
+ * class_queue_lock must be held. */
+static rpc_wait_t *_class_dequeue(rpc_class_t rpc_class)
+{
+	rpc_wait_t *wait = class_head[rpc_class];
+
+	if (wait) {
+		class_head[rpc_class] = wait->next;
+		if (!class_head[rpc_class])
+			class_tail[rpc_class] = NULL;
+	}
+	return wait;
+}
+
+/* Process an admitted RPC, then those waiting in the queue of its class,
+ * each taking the place of the one before it */
+static void _run_class(rpc_class_t rpc_class, slurm_msg_t *msg, uid_t uid)
+{
+	rpc_wait_t *wait;
+	struct timeval now;
+	long wait_usec;
+
+	while (msg) {
+		slurmctld_req_admitted(msg, uid);
+		_msg_done(msg);
+		msg = NULL;
+
+		while (!msg) {
+			slurm_mutex_lock(&class_queue_lock);
+			if (!(wait = _class_dequeue(rpc_class))) {
+				rpc_class_release(rpc_class);
+				slurm_mutex_unlock(&class_queue_lock);
+				break;
+			}
+			slurm_mutex_unlock(&class_queue_lock);
+
+			server_thread_incr();
+			msg = wait->msg;
+			uid = wait->uid;
+			gettimeofday(&now, NULL);
+			wait_usec = diff_tv(&wait->queue_time, &now);
+			xfree(wait);
+			if (rpc_class_dequeue(rpc_class, wait_usec) !=
+			    SLURM_SUCCESS) {
+				slurmctld_req_reject(msg, uid, ESLURM_RPC_BUSY);
+				_msg_done(msg);
+				msg = NULL;
+			}
+		}
+	}
+}
+
+/* Read and authenticate the RPC on a connection, then process it or leave
+ * it in the queue of its class. The connection was counted as a server
+ * thread by _enqueue(). */
+static void _service_conn(slurm_fd_t fd)
+{
+	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
+	rpc_class_t rpc_class;
+	rpc_wait_t *wait;
+	uid_t uid;
+	int rc;
+
+	slurm_msg_t_init(msg);
+	if (slurm_receive_msg(fd, msg, 0) != 0) {
+		error("slurm_receive_msg: %m");
+		slurm_close_accepted_conn(fd);
+		msg->conn_fd = -1;
+		_msg_done(msg);
+		return;
+	}
+	if (errno != SLURM_SUCCESS) {
+		if (errno == SLURM_PROTOCOL_VERSION_ERROR)
+			slurm_send_rc_msg(msg, SLURM_PROTOCOL_VERSION_ERROR);
+		else
+			info("rpc_pool: slurm_receive_msg %m");
+		_msg_done(msg);
+		return;
+	}
+	if (slurmctld_req_auth(msg, &uid) != SLURM_SUCCESS) {
+		_msg_done(msg);
+		return;
+	}
+
+	/* Hold class_queue_lock from admission to queueing so the active
+	 * RPC which must start this one can not miss it */
+	slurm_mutex_lock(&class_queue_lock);
+	rc = rpc_class_try_admit(msg->msg_type, uid, &rpc_class);
+	if (rc == EAGAIN) {
+		wait = xmalloc(sizeof(rpc_wait_t));
+		wait->msg = msg;
+		wait->uid = uid;
+		gettimeofday(&wait->queue_time, NULL);
+		if (class_tail[rpc_class])
+			class_tail[rpc_class]->next = wait;
+		else
+			class_head[rpc_class] = wait;
+		class_tail[rpc_class] = wait;
+		slurm_mutex_unlock(&class_queue_lock);
+		server_thread_decr();
+		return;
+	}
+	slurm_mutex_unlock(&class_queue_lock);
+
+	if (rc != SLURM_SUCCESS) {
+		slurmctld_req_reject(msg, uid, rc);
+		_msg_done(msg);
+		return;
+	}
+	_run_class(rpc_class, msg, uid);
+}
+
+/* Reject RPCs still waiting in the class queues at shutdown */
+static void _class_queue_purge(void)
+{
+	rpc_wait_t *wait;
+	int i;
+
+	slurm_mutex_lock(&class_queue_lock);
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		while ((wait = _class_dequeue(i))) {
+			server_thread_incr();
+			(void) rpc_class_dequeue(i, 0);
+			slurmctld_req_reject(wait->msg, wait->uid,
+					     ESLURM_RPC_BUSY);
+			_msg_done(wait->msg);
+			xfree(wait);
+		}
+	}
+	slurm_mutex_unlock(&class_queue_lock);
+}
+
+/* Worker thread, service queued connections until shutdown and the
+ * queue is empty */
+static void *_rpc_worker(void *no_data)
+{
+	rpc_conn_t *conn;
+	struct timeval now;
+	long wait_usec;
+	slurm_fd_t fd;
+
+	while (1) {
+		slurm_mutex_lock(&queue_lock);
+		while ((queue_cnt == 0) && pool_running)
+			pthread_cond_wait(&queue_cond, &queue_lock);
+		if (queue_cnt == 0) {
+			slurm_mutex_unlock(&queue_lock);
+			break;
+		}
+		conn = queue[queue_head];
+		queue_head = (queue_head + 1) % queue_size;
+		queue_cnt--;
+		pool_busy++;
+
+		gettimeofday(&now, NULL);
+		wait_usec = diff_tv(&conn->queue_time, &now);
+		if (wait_usec > 0) {
+			stat_wait_total += wait_usec;
+			if (wait_usec > stat_wait_max)
+				stat_wait_max = wait_usec;
+		}
+		slurm_mutex_unlock(&queue_lock);
+
+		fd = conn->fd;
+		xfree(conn);
+		_service_conn(fd);
+
+		slurm_mutex_lock(&queue_lock);
+		pool_busy--;
+		slurm_mutex_unlock(&queue_lock);
+	}
+
+	return NULL;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Doubly linked list of accepted connections waiting for data */
+static rpc_conn_t *idle_head = NULL;
+
+static void _idle_add(rpc_conn_t *conn)
+{
+	conn->prev = NULL;
+	conn->next = idle_head;
+	if (idle_head)
+		idle_head->prev = conn;
+	idle_head = conn;
+}
+
+static void _idle_remove(rpc_conn_t *conn)
+{
+	if (conn->prev)
+		conn->prev->next = conn->next;
+	else
+		idle_head = conn->next;
+	if (conn->next)
+		conn->next->prev = conn->prev;
+	conn->prev = conn->next = NULL;
+}
+
+/* Close connections which have not sent a message within MessageTimeout */
+static void _idle_purge(int epoll_fd, time_t now, int msg_timeout)
+{
+	rpc_conn_t *conn, *next_conn;
+
+	for (conn = idle_head; conn; conn = next_conn) {
+		next_conn = conn->next;
+		if (difftime(now, conn->accept_time) <= msg_timeout)
+			continue;
+		debug("rpc_pool: closing idle connection %d", conn->fd);
+		(void) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+		_idle_remove(conn);
+		_close_conn(conn);
+	}
+}
+
+/* Accept connections and wait for their data using epoll, then queue
+ * the connection for a worker thread. A worker is not occupied by a
+ * client until its request can be read. */
+static void _accept_loop(slurm_fd_t *sockfd, int nports)
+{
+	struct epoll_event ev, events[MAX_POLL_EVENTS];
+	rpc_conn_t *listen_conn, *conn;
+	slurm_addr_t cli_addr;
+	slurm_fd_t newsockfd;
+	time_t now, last_purge = time(NULL);
+	int epoll_fd, i, n;
+	int msg_timeout = slurm_get_msg_timeout();
+
+	if ((epoll_fd = epoll_create(nports + 1)) < 0)
+		fatal("epoll_create: %m");
+	listen_conn = xmalloc(sizeof(rpc_conn_t) * nports);
+	for (i = 0; i < nports; i++) {
+		listen_conn[i].fd = sockfd[i];
+		listen_conn[i].listen = true;
+		memset(&ev, 0, sizeof(struct epoll_event));
+		ev.events = EPOLLIN;
+		ev.data.ptr = &listen_conn[i];
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sockfd[i], &ev) < 0)
+			fatal("epoll_ctl: %m");
+	}
+
+	while (!slurmctld_config.shutdown_time) {
+		n = epoll_wait(epoll_fd, events, MAX_POLL_EVENTS,
+			       IDLE_CHECK_INTERVAL * 1000);
+		if (n < 0) {
+			if (errno != EINTR)
+				error("rpc_pool: epoll_wait: %m");
+			continue;
+		}
+		for (i = 0; i < n; i++) {
+			conn = (rpc_conn_t *) events[i].data.ptr;
+			if (!conn->listen) {
+				/* Request data (or hangup) is available */
+				(void) epoll_ctl(epoll_fd, EPOLL_CTL_DEL,
+						 conn->fd, NULL);
+				_idle_remove(conn);
+				_enqueue(conn);
+				continue;
+			}
+			newsockfd = slurm_accept_msg_conn(conn->fd, &cli_addr);
+			if (newsockfd == SLURM_SOCKET_ERROR) {
+				if (errno != EINTR)
+					error("slurm_accept_msg_conn: %m");
+				continue;
+			}
+			conn = xmalloc(sizeof(rpc_conn_t));
+			conn->fd = newsockfd;
+			conn->accept_time = time(NULL);
+			memset(&ev, 0, sizeof(struct epoll_event));
+			ev.events = EPOLLIN;
+			ev.data.ptr = conn;
+			if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, newsockfd,
+				      &ev) < 0) {
+				/* Let a worker wait for the data instead */
+				error("rpc_pool: epoll_ctl: %m");
+				_enqueue(conn);
+				continue;
+			}
+			_idle_add(conn);
+		}
+
+		now = time(NULL);
+		if (difftime(now, last_purge) >= IDLE_CHECK_INTERVAL) {
+			_idle_purge(epoll_fd, now, msg_timeout);
+			last_purge = now;
+		}
+	}
+
+	while ((conn = idle_head)) {
+		_idle_remove(conn);
+		_close_conn(conn);
+	}
+	close(epoll_fd);
+	xfree(listen_conn);
+}
+#else
+/* No epoll support, accept connections with select() and queue them
+ * immediately. The worker will wait for the request data. */
+static void _accept_loop(slurm_fd_t *sockfd, int nports)
+{
+	slurm_addr_t cli_addr;
+	slurm_fd_t newsockfd;
+	rpc_conn_t *conn;
+	fd_set rfds;
+	int i, max_fd;
+
+	while (!slurmctld_config.shutdown_time) {
+		max_fd = -1;
+		FD_ZERO(&rfds);
+		for (i = 0; i < nports; i++) {
+			FD_SET(sockfd[i], &rfds);
+			max_fd = MAX(sockfd[i], max_fd);
+		}
+		if (select(max_fd+1, &rfds, NULL, NULL, NULL) == -1) {
+			if (errno != EINTR)
+				error("slurm_accept_msg_conn select: %m");
+			continue;
+		}
+		for (i = 0; i < nports; i++) {
+			if (!FD_ISSET(sockfd[i], &rfds))
+				continue;
+			newsockfd = slurm_accept_msg_conn(sockfd[i],
+							  &cli_addr);
+			if (newsockfd == SLURM_SOCKET_ERROR) {
+				if (errno != EINTR)
+					error("slurm_accept_msg_conn: %m");
+				continue;
+			}
+			conn = xmalloc(sizeof(rpc_conn_t));
+			conn->fd = newsockfd;
+			conn->accept_time = time(NULL);
+			_enqueue(conn);
+		}
+	}
+}
+#endif
+
+/*
+ * rpc_pool_run - accept and queue connections on the supplied listening
+ *	sockets, servicing them with a fixed pool of worker threads. RPCs
+ *	which must wait for admission under the limits of their class (see
+ *	rpc_class.h) are queued by class without holding a worker thread.
+ *	Runs until slurmctld_config.shutdown_time is set.
+ * IN sockfd - listening sockets
+ * IN nports - count of listening sockets
+ */
+extern void rpc_pool_run(slurm_fd_t *sockfd, int nports)
+{
+	pthread_attr_t thread_attr;
+	pthread_t *worker_id;
+	int i;
+
+	slurm_mutex_lock(&queue_lock);
+	queue = xmalloc(sizeof(rpc_conn_t *) * queue_size);
+	queue_head = 0;
+	queue_cnt = 0;
+	pool_running = true;
+	slurm_mutex_unlock(&queue_lock);
+
+	info("rpc_pool: %u worker threads, queue depth %u",
+	     pool_threads, queue_size);
+	worker_id = xmalloc(sizeof(pthread_t) * pool_threads);
+	slurm_attr_init(&thread_attr);
+	for (i = 0; i < pool_threads; i++) {
+		while (pthread_create(&worker_id[i], &thread_attr,
+				      _rpc_worker, NULL)) {
+			error("pthread_create error %m");
+			sleep(1);
+		}
+	}
+	slurm_attr_destroy(&thread_attr);
+
+	_accept_loop(sockfd, nports);
+
+	/* Let the workers drain the queue, then exit */
+	slurm_mutex_lock(&queue_lock);
+	pool_running = false;
+	pthread_cond_broadcast(&queue_cond);
+	slurm_mutex_unlock(&queue_lock);
+	for (i = 0; i < pool_threads; i++)
+		pthread_join(worker_id[i], NULL);
+	xfree(worker_id);
+	_class_queue_purge();
+
+	slurm_mutex_lock(&queue_lock);
+	xfree(queue);
+	slurm_mutex_unlock(&queue_lock);
+}
+
+/*
+ * rpc_pool_get_stats - report RPC pool and queue statistics
+ * OUT stats - the rpc_* fields are filled in
+ */
+extern void rpc_pool_get_stats(stats_info_response_msg_t *stats)
+{
+	slurm_mutex_lock(&queue_lock);
+	stats->rpc_pool		   = pool_running ? 1 : 0;
+	stats->rpc_pool_threads	   = pool_running ? pool_threads : 0;
+	stats->rpc_pool_busy	   = pool_busy;
+	stats->rpc_queue_size	   = pool_running ? queue_size : 0;
+	stats->rpc_queue_depth	   = queue_cnt;
+	stats->rpc_queue_depth_max = stat_depth_max;
+	stats->rpc_queue_cnt	   = stat_queue_cnt;
+	stats->rpc_queue_full_cnt  = stat_full_cnt;
+	stats->rpc_queue_wait_total = stat_wait_total;
+	stats->rpc_queue_wait_max  = stat_wait_max;
+	slurm_mutex_unlock(&queue_lock);
+}
+
+/* rpc_pool_reset_stats - clear the RPC queue statistics counters */
+extern void rpc_pool_reset_stats(void)
+{
+	slurm_mutex_lock(&queue_lock);
+	stat_depth_max  = queue_cnt;
+	stat_queue_cnt  = 0;
+	stat_full_cnt   = 0;
+	stat_wait_total = 0;
+	stat_wait_max   = 0;
+	slurm_mutex_unlock(&queue_lock);
+}
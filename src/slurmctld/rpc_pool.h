@@ -0,0 +1,73 @@
+/*****************************************************************************\
+ *  rpc_pool.h - event driven RPC acceptor with a fixed pool of worker
+ *	threads servicing a bounded request queue
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_RPC_POOL_H
+#define _HAVE_RPC_POOL_H
+
+#include "src/slurmctld/slurmctld.h"
+
+/* Default values for the SlurmctldParameters rpc_pool options */
+#define DEFAULT_RPC_POOL_THREADS	32
+#define DEFAULT_RPC_QUEUE_DEPTH		1024
+
+/*
+ * rpc_pool_configured - parse SlurmctldParameters for the rpc_pool options
+ * RET true if RPCs should be serviced by the worker pool rather than by a
+ *	pthread created for each connection
+ */
+extern bool rpc_pool_configured(void);
+
+/*
+ * rpc_pool_run - accept and queue connections on the supplied listening
+ *	sockets, servicing them with a fixed pool of worker threads. RPCs
+ *	which must wait for admission under the limits of their class (see
+ *	rpc_class.h) are queued by class without holding a worker thread.
+ *	Runs until slurmctld_config.shutdown_time is set.
+ * IN sockfd - listening sockets
+ * IN nports - count of listening sockets
+ */
+extern void rpc_pool_run(slurm_fd_t *sockfd, int nports);
+
+/*
+ * rpc_pool_get_stats - report RPC pool and queue statistics
+ * OUT stats - the rpc_* fields are filled in
+ */
+extern void rpc_pool_get_stats(stats_info_response_msg_t *stats);
+
+/* rpc_pool_reset_stats - clear the RPC queue statistics counters */
+extern void rpc_pool_reset_stats(void);
+
+#endif	/* !_HAVE_RPC_POOL_H */
@@ -156,6 +156,7 @@ typedef struct slurmctld_config {
 	pthread_mutex_t thread_count_lock;
 	pthread_t thread_id_main;
 	pthread_t thread_id_save;
+	pthread_t thread_id_sched;
 	pthread_t thread_id_sig;
 	pthread_t thread_id_power;
 	pthread_t thread_id_rpc;
@@ -163,6 +164,7 @@ typedef struct slurmctld_config {
 	int thread_count_lock;
 	int thread_id_main;
 	int thread_id_save;
+	int thread_id_sched;
 	int thread_id_sig;
 	int thread_id_power;
 	int thread_id_rpc;
@@ -170,6 +172,44 @@ typedef struct slurmctld_config {
 } slurmctld_config_t;
 
 extern slurmctld_config_t slurmctld_config;
+
+/* Scheduler cycle statistics, updated by schedule() and the sched/backfill
+ * plugin, reported by REQUEST_STATS_INFO. Protected by
+ * slurmctld_diag_stats_lock. Times are in microseconds. */
+typedef struct diag_stats {
+	uint32_t schedule_cycle_cnt;	/* schedule() cycles run */
+	uint32_t schedule_cycle_last;	/* time of last cycle */
+	uint32_t schedule_cycle_max;	/* longest cycle */
+	uint64_t schedule_cycle_sum;	/* time of all cycles */
+	uint32_t schedule_depth_last;	/* jobs considered, last cycle */
+	uint64_t schedule_depth_sum;	/* jobs considered, all cycles */
+	uint32_t schedule_queue_len;	/* job queue length, last cycle */
+	uint32_t schedule_exit_timeout;	/* cycles ended by time limit */
+	uint32_t schedule_exit_depth;	/* cycles ended by depth limit */
+	uint32_t jobs_started;		/* jobs started by schedule() */
+
+	uint32_t bf_cycle_cnt;		/* backfill cycles run */
+	uint32_t bf_cycle_last;		/* time of last cycle */
+	uint32_t bf_cycle_max;		/* longest cycle */
+	uint64_t bf_cycle_sum;		/* time of all cycles */
+	time_t   bf_when_last_cycle;	/* end of last cycle */
+	uint32_t bf_depth_last;		/* jobs considered, last cycle */
+	uint64_t bf_depth_sum;		/* jobs considered, all cycles */
+	uint32_t bf_depth_try_last;	/* jobs tested, last cycle */
+	uint64_t bf_depth_try_sum;	/* jobs tested, all cycles */
+	uint32_t bf_queue_len;		/* job queue length, last cycle */
+	uint32_t bf_jobs_started;	/* jobs started by backfill */
+	uint32_t bf_start_dropped;	/* planned starts failing validation */
+	uint32_t bf_exit_table_full;	/* cycles ended, max_job_bf reached */
+	uint32_t bf_skip_busy;		/* cycles skipped, many pending RPCs */
+	uint32_t bf_class_hits;		/* jobs answered from their class */
+	uint32_t bf_class_tests;	/* jobs looked up in a class */
+	uint32_t bf_spec_tests;		/* jobs tested speculatively */
+	uint32_t bf_spec_discarded;	/* speculative tests invalidated */
+} diag_stats_t;
+
+extern diag_stats_t slurmctld_diag_stats;
+extern pthread_mutex_t slurmctld_diag_stats_lock;
 extern int   bg_recover;		/* state recovery mode */
 extern char *slurmctld_cluster_name;	/* name of cluster */
 extern void *acct_db_conn;
@@ -255,6 +295,8 @@ struct part_record {
 	uint32_t default_time;	/* minutes, NO_VAL or INFINITE */
 	uint16_t flags;		/* see PART_FLAG_* in slurm.h */
 	uint32_t grace_time;	/* default preempt grace time in seconds */
+	struct job_part_link *job_links; /* jobs using or queued in the
+				 * partition, see job_index.c */
 	uint32_t magic;		/* magic cookie to test data integrity */
 	uint32_t max_nodes;	/* per job or INFINITE */
 	uint32_t max_nodes_orig;/* unscaled value (c-nodes on BlueGene) */
@@ -271,6 +313,7 @@ struct part_record {
 				 * jobs (DON'T PACK) */
 	uint16_t preempt_mode;	/* See PREEMPT_MODE_* in slurm/slurm.h */
 	uint16_t priority;	/* scheduling priority for jobs */
+	int sched_domain;	/* scratch space for schedule() (DON'T PACK) */
 	uint16_t state_up;	/* See PARTITION_* states in slurm.h */
 	uint32_t total_nodes;	/* total number of nodes in the partition */
 	uint32_t total_cpus;	/* total number of cpus in the partition */
@@ -460,6 +503,8 @@ struct job_record {
 	char *gres;			/* generic resources */
 	List gres_list;			/* generic resource allocation detail */
 	uint32_t group_id;		/* group submitted under */
+	struct job_index_rec *index_rec; /* user, partition and state
+					 * index entries, see job_index.c */
 	uint32_t job_id;		/* job ID */
 	struct job_record *job_next;	/* next entry with same hash index */
 	uint16_t job_state;	        /* state of the job */
@@ -968,6 +1013,16 @@ extern void job_fini (void);
  */
 extern int job_fail(uint32_t job_id);
 
+/*
+ * job_filter_match - test if a job matches a job information filter
+ * IN job_ptr - job to test
+ * IN filter - filter from a job or job step information request, may be
+ *	NULL to match all jobs
+ * RET true if the job should be reported
+ */
+extern bool job_filter_match(struct job_record *job_ptr,
+			     job_info_filter_t *filter);
+
 /*
  * determine if job is ready to execute per the node select plugin
  * IN job_id - job to test
@@ -1242,6 +1297,13 @@ extern int load_all_job_state ( void );
  */
 extern int load_all_node_state ( bool state_only );
 
+/*
+ * load_job_state_prefetch - start reading the job state file in the
+ *	background, so that the read overlaps the recovery of node and
+ *	partition state. load_all_job_state() uses the data read.
+ */
+extern void load_job_state_prefetch(void);
+
 /*
  * load_last_job_id - load only the last job ID from state save file.
  * RET 0 or error code
@@ -1305,6 +1367,14 @@ extern void node_fini (void);
  * IN name - name of the node */
 extern void node_did_resp (char *name);
 
+/*
+ * node_heartbeat - record that the specified nodes sent a heartbeat, as if
+ *	they responded to a ping. Nodes in UNKNOWN state must register first.
+ * IN node_list - names of the nodes
+ * RET count of nodes updated
+ */
+extern int node_heartbeat (char *node_list);
+
 /*
  * node_not_resp - record that the specified node is not responding
  * IN name - name of the node
@@ -1316,6 +1386,20 @@ extern void node_not_resp (char *name, time_t msg_time);
  * and log that the node is not responding using a hostlist expression */
 extern void node_no_resp_msg(void);
 
+/*
+ * node_reg_batch_begin - start validating a batch of node registrations.
+ *	Resetting job priorities and testing pending jobs against the nodes
+ *	which became available is deferred to node_reg_batch_end()
+ * NOTE: WRITE lock_slurmctld jobs and nodes before entry
+ */
+extern void node_reg_batch_begin(void);
+
+/*
+ * node_reg_batch_end - complete the work deferred by node_reg_batch_begin()
+ * NOTE: WRITE lock_slurmctld jobs and nodes before entry
+ */
+extern void node_reg_batch_end(void);
+
 /*
  * pack_all_jobs - dump all job information for all jobs in
  *	machine independent form (for network transmission)
@@ -1324,6 +1408,7 @@ extern void node_no_resp_msg(void);
  * IN show_flags - job filtering options
  * IN uid - uid of user making request (for partition filtering)
  * IN protocol_version - slurm protocol version of client
+ * IN filter - jobs to pack, NULL for all jobs
  * global: job_list - global list of job records
  * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
  * NOTE: change _unpack_job_desc_msg() in common/slurm_protocol_pack.c
@@ -1331,7 +1416,8 @@ extern void node_no_resp_msg(void);
  */
 extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid,
-			  uint16_t protocol_version);
+			  uint16_t protocol_version,
+			  job_info_filter_t *filter);
 
 /*
  * pack_all_node - dump all configuration and node information for all nodes
@@ -1358,12 +1444,14 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
  * IN show_flags - job step filtering options
  * OUT buffer - location to store data, pointers automatically advanced
  * IN protocol_version - slurm protocol version of client
+ * IN filter - jobs whose steps are packed, NULL for all jobs
  * RET - 0 or error code
  * NOTE: MUST free_buf buffer
  */
 extern int pack_ctld_job_step_info_response_msg(
 	uint32_t job_id, uint32_t step_id, uid_t uid,
-	uint16_t show_flags, Buf buffer, uint16_t protocol_version);
+	uint16_t show_flags, Buf buffer, uint16_t protocol_version,
+	job_info_filter_t *filter);
 
 /*
  * pack_all_part - dump all partition information for all partitions in
@@ -1432,6 +1520,11 @@ extern void part_filter_clear(void);
  * group access. This must be followed by a call to part_filter_clear() */
 extern void part_filter_set(uid_t uid);
 
+/* part_filter_shared - Return true if no partition is hidden or restricted
+ * to specific groups, so that the partitions visible to every user are the
+ * same and part_filter_set() has no effect */
+extern bool part_filter_shared(void);
+
 /* part_fini - free all memory associated with partition records */
 extern void part_fini (void);
 
@@ -1453,7 +1546,8 @@ extern bool partition_in_use(char *part_name);
 void purge_old_job(void);
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create the job hash table if needed. The table resizes
+ *	itself as jobs are added, so a changed MaxJobCount needs no rebuild.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void);
@@ -1509,6 +1603,14 @@ extern int send_jobs_to_accounting();
  */
 extern int send_nodes_to_accounting(time_t event_time);
 
+/* server_thread_decr - stop counting an RPC as a server thread, while it
+ *	waits for admission or once done */
+extern void server_thread_decr(void);
+
+/* server_thread_incr - count an RPC as a server thread again, even if
+ *	above MAX_SERVER_THREADS */
+extern void server_thread_incr(void);
+
 /*
  * set_node_down - make the specified node's state DOWN if possible
  *	(not in a DRAIN state), kill jobs as needed
@@ -1724,10 +1826,12 @@ extern void validate_jobs_on_node(slurm_node_registration_status_msg_t *reg_msg)
  * validate_node_specs - validate the node's specifications as valid,
  *	if not set state to down, in any case update last_response
  * IN reg_msg - node registration message
+ * IN protocol_version - slurm protocol version of the slurmd
  * RET 0 if no error, ENOENT if no such node, EINVAL if values too low
  * NOTE: READ lock_slurmctld config before entry
  */
-extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg);
+extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg,
+			       uint16_t protocol_version);
 
 /*
  * validate_nodes_via_front_end - validate all nodes on a cluster as having
@@ -0,0 +1,317 @@
+/*****************************************************************************\
+ *  state_snapshot.c - shared, read-only packed job, node and partition
+ *	information for serving query RPCs without slurmctld locks
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Query RPCs normally pack their response while holding slurmctld read
+ * locks, which blocks writers (job submission, completion, node state
+ * changes) for the duration. After a response has been packed, it is kept
+ * here and identical requests are answered from it without taking any
+ * slurmctld lock and without re-packing, as long as it is current.
+ *
+ * A snapshot is current while either
+ * - no slurmctld write lock has been released since it was packed, or
+ * - the last_*_update times of the state it was packed from are unchanged
+ *   and earlier than the second in which it was packed (a change in that
+ *   same second could otherwise go unnoticed).
+ *
+ * Snapshots are keyed by response type, show_flags, protocol version and
+ * visibility: responses whose content does not depend upon the requesting
+ * user (no PrivateData, no hidden or group restricted partitions, etc.)
+ * are shared by everyone, others are kept per user ID.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <string.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/state_snapshot.h"
+
+/* Snapshots kept per response type */
+#define SNAPSHOT_SLOTS	16
+
+static pthread_mutex_t snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+static state_snapshot_t *snapshots[SNAPSHOT_TYPE_COUNT][SNAPSHOT_SLOTS];
+static uint32_t hit_cnt[SNAPSHOT_TYPE_COUNT];
+static uint32_t miss_cnt[SNAPSHOT_TYPE_COUNT];
+
+/* Update times of the state a response type is packed from. Read without
+ * locks, a change is at worst noticed on the next request. */
+static void _get_stamps(snapshot_type_t type, time_t *stamps)
+{
+	switch (type) {
+	case SNAPSHOT_JOB:
+		stamps[0] = last_job_update;
+		stamps[1] = last_part_update;	/* hidden partitions */
+		break;
+	case SNAPSHOT_NODE:
+	case SNAPSHOT_PART:
+		stamps[0] = last_node_update;
+		stamps[1] = last_part_update;
+		break;
+	default:
+		stamps[0] = stamps[1] = (time_t) 0;
+		break;
+	}
+}
+
+/* Test if a snapshot still matches slurmctld state */
+static bool _is_current(state_snapshot_t *snap, uint32_t epoch,
+			time_t *stamps)
+{
+	if (snap->write_epoch == epoch)
+		return true;
+	if ((snap->stamps[0] != stamps[0]) || (snap->stamps[1] != stamps[1]))
+		return false;
+	if ((stamps[0] >= snap->pack_time) || (stamps[1] >= snap->pack_time))
+		return false;
+	return true;
+}
+
+/* Drop a reference, snapshot_lock must be held */
+static void _unref(state_snapshot_t *snap)
+{
+	if (--snap->ref_cnt)
+		return;
+	xfree(snap->data);
+	xfree(snap);
+}
+
+/*
+ * snapshot_acquire - find a current snapshot for a query
+ * IN type - information requested
+ * IN show_flags - request's show_flags
+ * IN protocol_version - protocol version of the client
+ * IN uid - user making the request
+ * RET a snapshot packed since the last change to the relevant slurmctld
+ *	state, or NULL. No slurmctld locks are needed.
+ *	Release with snapshot_release().
+ */
+extern state_snapshot_t *snapshot_acquire(snapshot_type_t type,
+					  uint16_t show_flags,
+					  uint16_t protocol_version,
+					  uid_t uid)
+{
+	state_snapshot_t *snap, *found = NULL;
+	uint32_t epoch = get_write_epoch();
+	time_t stamps[2];
+	int i;
+
+	xassert(type < SNAPSHOT_TYPE_COUNT);
+	_get_stamps(type, stamps);
+	slurm_mutex_lock(&snapshot_lock);
+	for (i = 0; i < SNAPSHOT_SLOTS; i++) {
+		snap = snapshots[type][i];
+		if ((snap == NULL) ||
+		    (snap->show_flags != show_flags) ||
+		    (snap->protocol_version != protocol_version) ||
+		    (!snap->shared && (snap->uid != uid)) ||
+		    !_is_current(snap, epoch, stamps))
+			continue;
+		snap->ref_cnt++;
+		snap->last_used = time(NULL);
+		found = snap;
+		break;
+	}
+	if (found)
+		hit_cnt[type]++;
+	else
+		miss_cnt[type]++;
+	slurm_mutex_unlock(&snapshot_lock);
+
+	return found;
+}
+
+/*
+ * snapshot_publish - wrap a newly packed response and make it available
+ *	to snapshot_acquire()
+ * IN type - information packed
+ * IN show_flags - request's show_flags
+ * IN protocol_version - protocol version of the client
+ * IN uid - user making the request
+ * IN data - packed message body, ownership passes to the snapshot
+ * IN size - bytes in data
+ * IN last_update - last_job/node/part_update at packing time
+ * IN write_epoch - get_write_epoch() value read after taking the locks
+ *	used for packing
+ * IN pack_time - time packing started
+ * IN shared - set if the content does not depend upon the requesting user
+ * IN cache - set if the response may be kept at all
+ * NOTE: Call with the locks used for packing still held
+ * RET the snapshot, release with snapshot_release()
+ */
+extern state_snapshot_t *snapshot_publish(snapshot_type_t type,
+					  uint16_t show_flags,
+					  uint16_t protocol_version,
+					  uid_t uid, char *data, int size,
+					  time_t last_update,
+					  uint32_t write_epoch,
+					  time_t pack_time,
+					  bool shared, bool cache)
+{
+	state_snapshot_t *snap, *old, *victim = NULL;
+	uint32_t epoch;
+	time_t stamps[2];
+	int i, slot = -1;
+
+	xassert(type < SNAPSHOT_TYPE_COUNT);
+	snap = xmalloc(sizeof(state_snapshot_t));
+	snap->data             = data;
+	snap->size             = size;
+	snap->last_update      = last_update;
+	snap->pack_time        = pack_time;
+	snap->last_used        = pack_time;
+	snap->show_flags       = show_flags;
+	snap->protocol_version = protocol_version;
+	snap->uid              = uid;
+	snap->write_epoch      = write_epoch;
+	snap->shared           = shared;
+	snap->ref_cnt          = 1;
+	_get_stamps(type, snap->stamps);
+	if (!cache)
+		return snap;
+
+	epoch = get_write_epoch();
+	_get_stamps(type, stamps);
+	slurm_mutex_lock(&snapshot_lock);
+	/* Replace the snapshot with the same key, else an empty or stale
+	 * slot, else the least recently used snapshot */
+	for (i = 0; i < SNAPSHOT_SLOTS; i++) {
+		old = snapshots[type][i];
+		if (old == NULL) {
+			if (slot == -1)
+				slot = i;
+			continue;
+		}
+		if ((old->show_flags == show_flags) &&
+		    (old->protocol_version == protocol_version) &&
+		    (old->shared == shared) &&
+		    (shared || (old->uid == uid))) {
+			slot = i;
+			break;
+		}
+		if (slot != -1)
+			continue;
+		if (!_is_current(old, epoch, stamps))
+			slot = i;
+		else if (!victim || (old->last_used < victim->last_used))
+			victim = old;
+	}
+	if (slot == -1) {
+		for (slot = 0; snapshots[type][slot] != victim; slot++)
+			;
+	}
+	old = snapshots[type][slot];
+	if (old)
+		_unref(old);
+	snap->ref_cnt++;
+	snapshots[type][slot] = snap;
+	slurm_mutex_unlock(&snapshot_lock);
+
+	return snap;
+}
+
+/* snapshot_release - release a snapshot reference */
+extern void snapshot_release(state_snapshot_t *snap)
+{
+	if (snap == NULL)
+		return;
+	slurm_mutex_lock(&snapshot_lock);
+	_unref(snap);
+	slurm_mutex_unlock(&snapshot_lock);
+}
+
+/*
+ * snapshot_get_stats - report snapshot cache hits and misses
+ * OUT stats - the *_cache_* fields are filled in
+ */
+extern void snapshot_get_stats(stats_info_response_msg_t *stats)
+{
+	int i, j;
+
+	slurm_mutex_lock(&snapshot_lock);
+	stats->job_cache_hits    = hit_cnt[SNAPSHOT_JOB];
+	stats->job_cache_misses  = miss_cnt[SNAPSHOT_JOB];
+	stats->node_cache_hits   = hit_cnt[SNAPSHOT_NODE];
+	stats->node_cache_misses = miss_cnt[SNAPSHOT_NODE];
+	stats->part_cache_hits   = hit_cnt[SNAPSHOT_PART];
+	stats->part_cache_misses = miss_cnt[SNAPSHOT_PART];
+	stats->cache_entries = 0;
+	for (i = 0; i < SNAPSHOT_TYPE_COUNT; i++) {
+		for (j = 0; j < SNAPSHOT_SLOTS; j++) {
+			if (snapshots[i][j])
+				stats->cache_entries++;
+		}
+	}
+	slurm_mutex_unlock(&snapshot_lock);
+}
+
+/* snapshot_reset_stats - clear snapshot cache hit and miss counters */
+extern void snapshot_reset_stats(void)
+{
+	slurm_mutex_lock(&snapshot_lock);
+	memset(hit_cnt, 0, sizeof(hit_cnt));
+	memset(miss_cnt, 0, sizeof(miss_cnt));
+	slurm_mutex_unlock(&snapshot_lock);
+}
+
+/* snapshot_fini - free all published snapshots (memory leak testing) */
+extern void snapshot_fini(void)
+{
+	int i, j;
+
+	slurm_mutex_lock(&snapshot_lock);
+	for (i = 0; i < SNAPSHOT_TYPE_COUNT; i++) {
+		for (j = 0; j < SNAPSHOT_SLOTS; j++) {
+			if (snapshots[i][j] == NULL)
+				continue;
+			_unref(snapshots[i][j]);
+			snapshots[i][j] = NULL;
+		}
+	}
+	slurm_mutex_unlock(&snapshot_lock);
+}
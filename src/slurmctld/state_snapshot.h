@@ -0,0 +1,123 @@
+/*****************************************************************************\
+ *  state_snapshot.h - shared, read-only packed job, node and partition
+ *	information for serving query RPCs without slurmctld locks
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_STATE_SNAPSHOT_H
+#define _HAVE_STATE_SNAPSHOT_H
+
+#include "src/slurmctld/slurmctld.h"
+
+typedef enum {
+	SNAPSHOT_JOB,		/* RESPONSE_JOB_INFO body */
+	SNAPSHOT_NODE,		/* RESPONSE_NODE_INFO body */
+	SNAPSHOT_PART,		/* RESPONSE_PARTITION_INFO body */
+	SNAPSHOT_TYPE_COUNT	/* count of types, must be last */
+} snapshot_type_t;
+
+/* A packed response. Once published it is never modified, only freed
+ * when its last reference is released. */
+typedef struct state_snapshot {
+	char *data;		/* packed message body */
+	int size;		/* bytes in data */
+	time_t last_update;	/* last_job/node/part_update when packed */
+	time_t pack_time;	/* when packing started */
+	time_t last_used;	/* last time returned by snapshot_acquire() */
+	time_t stamps[2];	/* update times of the state packed */
+	uint16_t show_flags;
+	uint16_t protocol_version;
+	uid_t uid;		/* requesting user, if not shared */
+	uint32_t write_epoch;	/* get_write_epoch() when packed */
+	bool shared;		/* same for every user */
+	uint32_t ref_cnt;	/* protected by the snapshot mutex */
+} state_snapshot_t;
+
+/*
+ * snapshot_acquire - find a current snapshot for a query
+ * IN type - information requested
+ * IN show_flags - request's show_flags
+ * IN protocol_version - protocol version of the client
+ * IN uid - user making the request
+ * RET a snapshot packed since the last change to the relevant slurmctld
+ *	state, or NULL. No slurmctld locks are needed.
+ *	Release with snapshot_release().
+ */
+extern state_snapshot_t *snapshot_acquire(snapshot_type_t type,
+					  uint16_t show_flags,
+					  uint16_t protocol_version,
+					  uid_t uid);
+
+/*
+ * snapshot_publish - wrap a newly packed response and make it available
+ *	to snapshot_acquire()
+ * IN type - information packed
+ * IN show_flags - request's show_flags
+ * IN protocol_version - protocol version of the client
+ * IN uid - user making the request
+ * IN data - packed message body, ownership passes to the snapshot
+ * IN size - bytes in data
+ * IN last_update - last_job/node/part_update at packing time
+ * IN write_epoch - get_write_epoch() value read after taking the locks
+ *	used for packing
+ * IN pack_time - time packing started
+ * IN shared - set if the content does not depend upon the requesting user
+ * IN cache - set if the response may be kept at all
+ * NOTE: Call with the locks used for packing still held
+ * RET the snapshot, release with snapshot_release()
+ */
+extern state_snapshot_t *snapshot_publish(snapshot_type_t type,
+					  uint16_t show_flags,
+					  uint16_t protocol_version,
+					  uid_t uid, char *data, int size,
+					  time_t last_update,
+					  uint32_t write_epoch,
+					  time_t pack_time,
+					  bool shared, bool cache);
+
+/* snapshot_release - release a snapshot reference */
+extern void snapshot_release(state_snapshot_t *snap);
+
+/*
+ * snapshot_get_stats - report snapshot cache hits and misses
+ * OUT stats - the *_cache_* fields are filled in
+ */
+extern void snapshot_get_stats(stats_info_response_msg_t *stats);
+
+/* snapshot_reset_stats - clear snapshot cache hit and miss counters */
+extern void snapshot_reset_stats(void);
+
+/* snapshot_fini - free all published snapshots (memory leak testing) */
+extern void snapshot_fini(void);
+
+#endif /* !_HAVE_STATE_SNAPSHOT_H */
@@ -2159,12 +2159,14 @@ static void _pack_ctld_job_step_info(struct step_record *step_ptr, Buf buffer,
  * IN uid - user issuing request
  * IN show_flags - job step filtering options
  * OUT buffer - location to store data, pointers automatically advanced
+ * IN filter - jobs whose steps are packed, NULL for all jobs
  * RET - 0 or error code
  * NOTE: MUST free_buf buffer
  */
 extern int pack_ctld_job_step_info_response_msg(
 	uint32_t job_id, uint32_t step_id, uid_t uid,
-	uint16_t show_flags, Buf buffer, uint16_t protocol_version)
+	uint16_t show_flags, Buf buffer, uint16_t protocol_version,
+	job_info_filter_t *filter)
 {
 	ListIterator job_iterator;
 	ListIterator step_iterator;
@@ -2198,6 +2200,10 @@ extern int pack_ctld_job_step_info_response_msg(
 
 		valid_job = 1;
 
+		/* A filter matching no job is not an error */
+		if (!job_filter_match(job_ptr, filter))
+			continue;
+
 		step_iterator = list_iterator_create(job_ptr->step_list);
 		while ((step_ptr = list_next(step_iterator))) {
 			if ((step_id != NO_VAL)
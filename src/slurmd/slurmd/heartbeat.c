@@ -0,0 +1,325 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/heartbeat.c - periodic liveness message of slurmd,
+ *	aggregated along a tree of the nodes
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * With SlurmctldParameters=slurmd_heartbeat, every slurmd periodically sends
+ * a MESSAGE_NODE_HEARTBEAT naming itself and the nodes below it in a tree of
+ * all nodes of slurm.conf, laid out as the reverse tree used for step
+ * completion. Heartbeat periods are aligned on the clock and each level of
+ * the tree sends HEARTBEAT_LEVEL_DELAY seconds after the level below it, so
+ * that slurmctld receives the liveness of the whole tree from its root in one
+ * message. A node whose parent does not respond sends to slurmctld directly.
+ * slurmctld only pings nodes not heard from recently, see ping_nodes().
+ */
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/common/hostlist.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmd/slurmd/heartbeat.h"
+#include "src/slurmd/slurmd/reverse_tree_math.h"
+#include "src/slurmd/slurmd/slurmd.h"
+
+/* Seconds between the heartbeats of two levels of the tree */
+#define HEARTBEAT_LEVEL_DELAY	1
+/* Minimum seconds between heartbeats */
+#define HEARTBEAT_MIN_INTERVAL	5
+/* Seconds between checks of SlurmdTimeout if it is zero */
+#define HEARTBEAT_IDLE_INTERVAL	60
+
+static pthread_mutex_t hb_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  hb_cond  = PTHREAD_COND_INITIALIZER;
+static pthread_t hb_thread = (pthread_t) 0;
+static bool hb_running  = false;
+static bool hb_shutdown = false;
+static bool hb_reconfig = true;
+static hostlist_t child_hl = NULL;	/* nodes reported by children */
+
+/* Position of this node in the heartbeat tree, used only by the heartbeat
+ * thread */
+static char *parent_name = NULL;	/* malloc'd, NULL to send to slurmctld */
+static int tree_depth = 0, tree_max_depth = 0;
+
+/* Compute the position of this node in the tree of all nodes */
+static void _setup_tree(void)
+{
+	slurm_conf_node_t **ptr_array;
+	hostset_t hs = NULL;
+	int count, i, rank, parent, children;
+
+	if (parent_name) {
+		free(parent_name);
+		parent_name = NULL;
+	}
+	tree_depth = 0;
+	tree_max_depth = 0;
+
+	(void) slurm_conf_lock();
+	count = slurm_conf_nodename_array(&ptr_array);
+	for (i = 0; i < count; i++) {
+		if (!hs)
+			hs = hostset_create(ptr_array[i]->nodenames);
+		else
+			hostset_insert(hs, ptr_array[i]->nodenames);
+	}
+	slurm_conf_unlock();
+	if (!hs)
+		return;
+
+	rank = hostset_find(hs, conf->node_name);
+	if (rank >= 0) {
+		reverse_tree_info(rank, hostset_count(hs), REVERSE_TREE_WIDTH,
+				  &parent, &children, &tree_depth,
+				  &tree_max_depth);
+		if (parent >= 0)
+			parent_name = hostset_nth(hs, parent);
+	} else
+		error("heartbeat: node %s not found in slurm.conf",
+		      conf->node_name);
+	hostset_destroy(hs);
+	debug("heartbeat: parent %s, depth %d of %d",
+	      parent_name ? parent_name : "slurmctld", tree_depth,
+	      tree_max_depth);
+}
+
+/* Seconds between heartbeats, 0 if SlurmdTimeout is zero and slurmctld
+ * does not check that nodes respond */
+static int _heartbeat_interval(void)
+{
+	slurm_ctl_conf_t *cf;
+	uint16_t slurmd_timeout;
+
+	cf = slurm_conf_lock();
+	slurmd_timeout = cf->slurmd_timeout;
+	slurm_conf_unlock();
+
+	if (slurmd_timeout == 0)
+		return 0;
+	return MAX(slurmd_timeout / 6, HEARTBEAT_MIN_INTERVAL);
+}
+
+/* Send the heartbeat of this node and of those reported by its children.
+ * Called with hb_mutex locked, which is released while sending. */
+static void _send_heartbeat(void)
+{
+	hostlist_t hl = child_hl;
+	node_heartbeat_msg_t msg;
+	slurm_msg_t req;
+	int rc = SLURM_ERROR;
+
+	child_hl = NULL;
+	slurm_mutex_unlock(&hb_mutex);
+
+	if (!hl)
+		hl = hostlist_create(NULL);
+	hostlist_push_host(hl, conf->node_name);
+	hostlist_uniq(hl);
+	msg.node_list = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+
+	slurm_msg_t_init(&req);
+	req.msg_type = MESSAGE_NODE_HEARTBEAT;
+	req.data     = &msg;
+
+	if (parent_name &&
+	    (slurm_conf_get_addr(parent_name, &req.address) == SLURM_SUCCESS)
+	    && (slurm_send_recv_rc_msg_only_one(&req, &rc, 0) == 0) &&
+	    (rc == SLURM_SUCCESS)) {
+		debug3("heartbeat: sent %s to %s", msg.node_list, parent_name);
+	} else {
+		if (parent_name) {
+			debug("heartbeat: parent %s not responding, sending "
+			      "to slurmctld", parent_name);
+		}
+		if ((slurm_send_recv_controller_rc_msg(&req, &rc) < 0) ||
+		    (rc != SLURM_SUCCESS))
+			debug("heartbeat: unable to send to slurmctld: %m");
+	}
+	xfree(msg.node_list);
+
+	slurm_mutex_lock(&hb_mutex);
+}
+
+static void *_heartbeat_agent(void *arg)
+{
+	struct timespec ts = {0, 0};
+	time_t now, next;
+	int interval, level_delay;
+
+	slurm_mutex_lock(&hb_mutex);
+	while (!hb_shutdown) {
+		if (hb_reconfig) {
+			hb_reconfig = false;
+			slurm_mutex_unlock(&hb_mutex);
+			_setup_tree();
+			slurm_mutex_lock(&hb_mutex);
+		}
+
+		interval = _heartbeat_interval();
+		now = time(NULL);
+		if (interval == 0) {
+			next = now + HEARTBEAT_IDLE_INTERVAL;
+		} else {
+			/* Leaves send at the start of the period, each
+			 * level above them one delay later */
+			level_delay = (tree_max_depth - tree_depth) *
+				      HEARTBEAT_LEVEL_DELAY;
+			level_delay = MIN(level_delay, interval - 1);
+			next = now - (now % interval) + level_delay;
+			if (next <= now)
+				next += interval;
+		}
+		ts.tv_sec = next;
+		while (!hb_shutdown && !hb_reconfig && (time(NULL) < next))
+			pthread_cond_timedwait(&hb_cond, &hb_mutex, &ts);
+		if (hb_shutdown || hb_reconfig || (interval == 0))
+			continue;
+
+		_send_heartbeat();
+	}
+	slurm_mutex_unlock(&hb_mutex);
+
+	return NULL;
+}
+
+/*
+ * heartbeat_init - if SlurmctldParameters includes slurmd_heartbeat, start
+ *	a thread sending the liveness of this node and of the nodes below it
+ *	in the heartbeat tree every SlurmdTimeout/6 seconds
+ */
+extern void heartbeat_init(void)
+{
+	char *ctld_params = slurm_get_slurmctld_params();
+	pthread_attr_t attr;
+	bool enabled = false;
+
+	if (ctld_params && strstr(ctld_params, "slurmd_heartbeat"))
+		enabled = true;
+	xfree(ctld_params);
+#ifdef HAVE_FRONT_END
+	/* One slurmd pretends to be all nodes, it responds to pings */
+	enabled = false;
+#endif
+	if (!enabled)
+		return;
+
+	slurm_mutex_lock(&hb_mutex);
+	hb_shutdown = false;
+	hb_reconfig = true;
+	slurm_attr_init(&attr);
+	if (pthread_create(&hb_thread, &attr, _heartbeat_agent, NULL))
+		error("heartbeat: pthread_create: %m");
+	else
+		hb_running = true;
+	slurm_attr_destroy(&attr);
+	slurm_mutex_unlock(&hb_mutex);
+}
+
+/* heartbeat_fini - stop the heartbeat thread */
+extern void heartbeat_fini(void)
+{
+	slurm_mutex_lock(&hb_mutex);
+	if (!hb_running) {
+		slurm_mutex_unlock(&hb_mutex);
+		return;
+	}
+	hb_shutdown = true;
+	pthread_cond_broadcast(&hb_cond);
+	slurm_mutex_unlock(&hb_mutex);
+
+	pthread_join(hb_thread, NULL);
+
+	slurm_mutex_lock(&hb_mutex);
+	hb_running = false;
+	if (child_hl) {
+		hostlist_destroy(child_hl);
+		child_hl = NULL;
+	}
+	if (parent_name) {
+		free(parent_name);
+		parent_name = NULL;
+	}
+	slurm_mutex_unlock(&hb_mutex);
+}
+
+/* heartbeat_reconfig - recompute the position of this node in the heartbeat
+ *	tree, call after reading a new slurm.conf */
+extern void heartbeat_reconfig(void)
+{
+	slurm_mutex_lock(&hb_mutex);
+	hb_reconfig = true;
+	pthread_cond_broadcast(&hb_cond);
+	slurm_mutex_unlock(&hb_mutex);
+}
+
+/*
+ * heartbeat_add - record the nodes reported alive by a child of this node,
+ *	they are included in the next heartbeat sent
+ * IN node_list - names of the nodes
+ * RET SLURM_SUCCESS, or SLURM_ERROR if heartbeats are not enabled here and
+ *	the child should send to slurmctld
+ */
+extern int heartbeat_add(char *node_list)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (!node_list || !node_list[0])
+		return SLURM_SUCCESS;
+
+	slurm_mutex_lock(&hb_mutex);
+	if (!hb_running || hb_shutdown)
+		rc = SLURM_ERROR;
+	else if (child_hl)
+		hostlist_push(child_hl, node_list);
+	else
+		child_hl = hostlist_create(node_list);
+	slurm_mutex_unlock(&hb_mutex);
+
+	return rc;
+}
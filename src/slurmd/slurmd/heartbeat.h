@@ -0,0 +1,63 @@
+/*****************************************************************************\
+ *  src/slurmd/slurmd/heartbeat.h - periodic liveness message of slurmd,
+ *	aggregated along a tree of the nodes
+ *****************************************************************************
+ *  Copyright (C) 2011 SchedMD LLC <http://www.schedmd.com>.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HEARTBEAT_H
+#define _HEARTBEAT_H
+
+/*
+ * heartbeat_init - if SlurmctldParameters includes slurmd_heartbeat, start
+ *	a thread sending the liveness of this node and of the nodes below it
+ *	in the heartbeat tree every SlurmdTimeout/6 seconds
+ */
+extern void heartbeat_init(void);
+
+/* heartbeat_fini - stop the heartbeat thread */
+extern void heartbeat_fini(void);
+
+/* heartbeat_reconfig - recompute the position of this node in the heartbeat
+ *	tree, call after reading a new slurm.conf */
+extern void heartbeat_reconfig(void);
+
+/*
+ * heartbeat_add - record the nodes reported alive by a child of this node,
+ *	they are included in the next heartbeat sent
+ * IN node_list - names of the nodes
+ * RET SLURM_SUCCESS, or SLURM_ERROR if heartbeats are not enabled here and
+ *	the child should send to slurmctld
+ */
+extern int heartbeat_add(char *node_list);
+
+#endif /* !_HEARTBEAT_H */
@@ -80,6 +80,7 @@
 #include "src/common/xmalloc.h"
 
 #include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/heartbeat.h"
 #include "src/slurmd/slurmd/reverse_tree_math.h"
 #include "src/slurmd/slurmd/xcpu.h"
 
@@ -145,6 +146,8 @@ static void _rpc_reattach_tasks(slurm_msg_t *);
 static void _rpc_signal_job(slurm_msg_t *);
 static void _rpc_suspend_job(slurm_msg_t *);
 static void _rpc_terminate_job(slurm_msg_t *);
+static void _rpc_multi_msg(slurm_msg_t *);
+static void _rpc_node_heartbeat(slurm_msg_t *);
 static void _rpc_update_time(slurm_msg_t *);
 static void _rpc_shutdown(slurm_msg_t *msg);
 static void _rpc_reconfig(slurm_msg_t *msg);
@@ -299,6 +302,17 @@ slurmd_req(slurm_msg_t *msg)
 		_rpc_terminate_job(msg);
 		slurm_free_kill_job_msg(msg->data);
 		break;
+	case REQUEST_MULTI_MSG:
+		debug2("Processing RPC: REQUEST_MULTI_MSG");
+		last_slurmctld_msg = time(NULL);
+		_rpc_multi_msg(msg);
+		slurm_free_multi_msg(msg->data);
+		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		debug3("Processing RPC: MESSAGE_NODE_HEARTBEAT");
+		_rpc_node_heartbeat(msg);
+		slurm_free_node_heartbeat_msg(msg->data);
+		break;
 	case REQUEST_UPDATE_JOB_TIME:
 		_rpc_update_time(msg);
 		last_slurmctld_msg = time(NULL);
@@ -3472,6 +3486,135 @@ _rpc_terminate_job(slurm_msg_t *msg)
 	_epilog_complete(req->job_id, rc);
 }
 
+/* Liveness of nodes below this one in the heartbeat tree, sent on with the
+ * heartbeat of this node */
+static void
+_rpc_node_heartbeat(slurm_msg_t *msg)
+{
+	node_heartbeat_msg_t *req = msg->data;
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+
+	if (!_slurm_authorized_user(uid)) {
+		error("Security violation: node_heartbeat req from uid %d",
+		      uid);
+		slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+		return;
+	}
+	slurm_send_rc_msg(msg, heartbeat_add(req->node_list));
+}
+
+/* Process one RPC of a REQUEST_MULTI_MSG as if received on its own
+ * connection, the socket of which is one end of a socket pair */
+static void *
+_multi_msg_part(void *arg)
+{
+	slurm_msg_t *msg = (slurm_msg_t *) arg;
+
+	slurmd_req(msg);	/* frees msg->data */
+	if ((msg->conn_fd >= 0) && (close(msg->conn_fd) < 0))
+		error("_multi_msg_part: close(%d): %m", msg->conn_fd);
+	xfree(msg);
+	return NULL;
+}
+
+/*
+ * Several RPCs sent by slurmctld to this node in one message, typically job
+ * termination or signal requests queued at the same time. Each RPC is
+ * processed in its own thread since they may run for a long time after
+ * replying. Their replies are collected and returned in one
+ * RESPONSE_MULTI_MSG, then wait for the threads since they share the
+ * credential of this message.
+ */
+static void
+_rpc_multi_msg(slurm_msg_t *msg)
+{
+	multi_msg_t *req = msg->data;
+	multi_rc_msg_t rc_msg;
+	slurm_msg_t resp_msg, reply_msg, *sub_msg;
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+	pthread_attr_t attr;
+	pthread_t *thread_id;
+	int *reply_fd, sock[2];
+	uint32_t i;
+
+	if (!_slurm_authorized_user(uid)) {
+		error("Security violation: multi_msg req from uid %d", uid);
+		slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+		return;
+	}
+
+	rc_msg.rc_cnt   = list_count(req->msg_list);
+	rc_msg.rc_array = xmalloc(sizeof(uint32_t) * rc_msg.rc_cnt);
+	thread_id = xmalloc(sizeof(pthread_t) * rc_msg.rc_cnt);
+	reply_fd  = xmalloc(sizeof(int) * rc_msg.rc_cnt);
+
+	slurm_attr_init(&attr);
+	for (i = 0; (sub_msg = list_pop(req->msg_list)); i++) {
+		reply_fd[i] = -1;
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sock) < 0) {
+			error("_rpc_multi_msg: socketpair: %m");
+			rc_msg.rc_array[i] = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
+			slurm_destroy_multi_msg_entry(sub_msg);
+			continue;
+		}
+		fd_set_close_on_exec(sock[0]);
+		fd_set_close_on_exec(sock[1]);
+		sub_msg->conn_fd   = sock[0];
+		sub_msg->auth_cred = msg->auth_cred;
+		sub_msg->address   = msg->address;
+		sub_msg->orig_addr = msg->orig_addr;
+		sub_msg->flags     = msg->flags;
+		if (pthread_create(&thread_id[i], &attr, _multi_msg_part,
+				   (void *) sub_msg)) {
+			error("_rpc_multi_msg: pthread_create: %m");
+			rc_msg.rc_array[i] = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
+			(void) close(sock[0]);
+			(void) close(sock[1]);
+			slurm_destroy_multi_msg_entry(sub_msg);
+			continue;
+		}
+		reply_fd[i] = sock[1];
+	}
+	slurm_attr_destroy(&attr);
+
+	for (i = 0; i < rc_msg.rc_cnt; i++) {
+		if (reply_fd[i] < 0)
+			continue;
+		slurm_msg_t_init(&reply_msg);
+		if (slurm_receive_msg(reply_fd[i], &reply_msg, 0) == 0) {
+			rc_msg.rc_array[i] = slurm_get_return_code(
+				reply_msg.msg_type, reply_msg.data);
+			slurm_free_msg_data(reply_msg.msg_type, reply_msg.data);
+			(void) g_slurm_auth_destroy(reply_msg.auth_cred);
+		} else
+			rc_msg.rc_array[i] = SLURM_COMMUNICATIONS_RECEIVE_ERROR;
+		(void) close(reply_fd[i]);
+	}
+
+	slurm_msg_t_init(&resp_msg);
+	resp_msg.protocol_version = msg->protocol_version;
+	resp_msg.address  = msg->address;
+	resp_msg.msg_type = RESPONSE_MULTI_MSG;
+	resp_msg.data     = &rc_msg;
+	resp_msg.flags    = msg->flags;
+	resp_msg.forward  = msg->forward;
+	resp_msg.forward_struct = msg->forward_struct;
+	resp_msg.ret_list = msg->ret_list;
+	resp_msg.orig_addr = msg->orig_addr;
+	slurm_send_node_msg(msg->conn_fd, &resp_msg);
+	if (slurm_close_accepted_conn(msg->conn_fd) < 0)
+		error("_rpc_multi_msg: close(%d): %m", msg->conn_fd);
+	msg->conn_fd = -1;
+
+	for (i = 0; i < rc_msg.rc_cnt; i++) {
+		if (reply_fd[i] >= 0)
+			pthread_join(thread_id[i], NULL);
+	}
+	xfree(rc_msg.rc_array);
+	xfree(thread_id);
+	xfree(reply_fd);
+}
+
 /* On a parallel job, every slurmd may send the EPILOG_COMPLETE
  * message to the slurmctld at the same time, resulting in lost
  * messages. We add a delay here to spead out the message traffic
@@ -91,6 +91,7 @@
 #include "src/common/xsignal.h"
 
 #include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/heartbeat.h"
 #include "src/slurmd/slurmd/req.h"
 #include "src/slurmd/slurmd/get_mach_stat.h"
 #include "src/slurmd/common/proctrack.h"
@@ -316,7 +317,9 @@ main (int argc, char *argv[])
 	slurm_conf_install_fork_handlers();
 
 	_spawn_registration_engine();
+	heartbeat_init();
 	_msg_engine();
+	heartbeat_fini();
 
 	/*
 	 * Close fd here, otherwise we'll deadlock since create_pidfile()
@@ -874,6 +877,7 @@ _reconfigure(void)
 	 */
 	slurm_topo_build_config();
 	_set_topo_info();
+	heartbeat_reconfig();
 
 	_print_conf();
 
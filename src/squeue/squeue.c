@@ -67,6 +67,8 @@ static void _print_date( void );
 static int  _multi_cluster(List clusters);
 static int  _print_job ( bool clear_old );
 static int  _print_job_steps( bool clear_old );
+static bool _build_filter(job_info_filter_t *filter, bool steps);
+static void _free_filter(job_info_filter_t *filter);
 
 int
 main (int argc, char *argv[])
@@ -171,6 +173,8 @@ _print_job ( bool clear_old )
 	int error_code;
 	uint16_t show_flags = 0;
 	uint32_t job_id = 0;
+	job_info_filter_t filter;
+	bool filtered;
 
 	if (params.all_flag || (params.job_list && list_count(params.job_list)))
 		show_flags |= SHOW_ALL;
@@ -188,7 +192,22 @@ _print_job ( bool clear_old )
 		list_iterator_destroy(iterator);
 	}
 
-	if (old_job_ptr) {
+	/* Have slurmctld skip jobs which would not be printed, squeue
+	 * still filters the response in case slurmctld is older */
+	filtered = _build_filter(&filter, false);
+
+	if (params.iterate && !job_id && !filtered) {
+		/* Only jobs changed since the last iteration are sent */
+		if (clear_old && old_job_ptr) {
+			slurm_free_job_info_msg(old_job_ptr);
+			old_job_ptr = NULL;
+		}
+		error_code = slurm_load_jobs_delta(&old_job_ptr, show_flags);
+		if (error_code && old_job_ptr &&
+		    (slurm_get_errno() == SLURM_NO_CHANGE_IN_DATA))
+			error_code = SLURM_SUCCESS;
+		new_job_ptr = old_job_ptr;
+	} else if (old_job_ptr) {
 		if (clear_old)
 			old_job_ptr->last_update = 0;
 		if (job_id) {
@@ -196,9 +215,10 @@ _print_job ( bool clear_old )
 				&new_job_ptr, job_id,
 				show_flags);
 		} else {
-			error_code = slurm_load_jobs(
+			error_code = slurm_load_jobs_filtered(
 				old_job_ptr->last_update,
-				&new_job_ptr, show_flags);
+				&new_job_ptr, show_flags,
+				filtered ? &filter : NULL);
 		}
 		if (error_code ==  SLURM_SUCCESS)
 			slurm_free_job_info_msg( old_job_ptr );
@@ -209,9 +229,12 @@ _print_job ( bool clear_old )
 	} else if (job_id) {
 		error_code = slurm_load_job(&new_job_ptr, job_id, show_flags);
 	} else {
-		error_code = slurm_load_jobs((time_t) NULL, &new_job_ptr,
-					     show_flags);
+		error_code = slurm_load_jobs_filtered((time_t) NULL,
+						      &new_job_ptr, show_flags,
+						      filtered ? &filter :
+						      NULL);
 	}
+	_free_filter(&filter);
 
 	if (error_code) {
 		slurm_perror ("slurm_load_jobs error");
@@ -250,17 +273,21 @@ _print_job_steps( bool clear_old )
 	static job_step_info_response_msg_t * old_step_ptr = NULL;
 	static job_step_info_response_msg_t  * new_step_ptr;
 	uint16_t show_flags = 0;
+	job_info_filter_t filter;
 
 	if (params.all_flag)
 		show_flags |= SHOW_ALL;
 
+	(void) _build_filter(&filter, true);
+
 	if (old_step_ptr) {
 		if (clear_old)
 			old_step_ptr->last_update = 0;
 		/* Use a last_update time of 0 so that we can get an updated
 		 * run_time for jobs rather than just its start_time */
-		error_code = slurm_get_job_steps((time_t) 0, NO_VAL, NO_VAL,
-						 &new_step_ptr, show_flags);
+		error_code = slurm_get_job_steps_filtered(
+			(time_t) 0, NO_VAL, NO_VAL, &new_step_ptr,
+			show_flags, &filter);
 		if (error_code ==  SLURM_SUCCESS)
 			slurm_free_job_step_info_response_msg( old_step_ptr );
 		else if (slurm_get_errno () == SLURM_NO_CHANGE_IN_DATA) {
@@ -269,8 +296,10 @@ _print_job_steps( bool clear_old )
 		}
 	}
 	else
-		error_code = slurm_get_job_steps((time_t) 0, NO_VAL, NO_VAL,
-						 &new_step_ptr, show_flags);
+		error_code = slurm_get_job_steps_filtered(
+			(time_t) 0, NO_VAL, NO_VAL, &new_step_ptr,
+			show_flags, &filter);
+	_free_filter(&filter);
 	if (error_code) {
 		slurm_perror ("slurm_get_job_steps error");
 		return SLURM_ERROR;
@@ -294,6 +323,106 @@ _print_job_steps( bool clear_old )
 }
 
 
+/*
+ * _build_filter - set a job information filter from the command line
+ * OUT filter - the filter, strings point into params, free the arrays
+ *	with _free_filter()
+ * IN steps - set if filtering job steps, which are only selected by job
+ *	ID, partition and user
+ * RET true if any job selection option was given, otherwise the filter
+ *	is empty and should not be sent
+ */
+static bool
+_build_filter(job_info_filter_t *filter, bool steps)
+{
+	ListIterator iterator;
+	uint32_t *id_ptr;
+	uint16_t *state_ptr;
+	char *name;
+	squeue_job_step_t *step_ptr;
+	bool filtered = false;
+
+	memset(filter, 0, sizeof(job_info_filter_t));
+
+	if (params.job_list && list_count(params.job_list)) {
+		filter->job_ids = xmalloc(sizeof(uint32_t) *
+					  list_count(params.job_list));
+		iterator = list_iterator_create(params.job_list);
+		while ((id_ptr = list_next(iterator)))
+			filter->job_ids[filter->job_id_cnt++] = *id_ptr;
+		list_iterator_destroy(iterator);
+		filtered = true;
+	} else if (steps && params.step_list && list_count(params.step_list)) {
+		filter->job_ids = xmalloc(sizeof(uint32_t) *
+					  list_count(params.step_list));
+		iterator = list_iterator_create(params.step_list);
+		while ((step_ptr = list_next(iterator)))
+			filter->job_ids[filter->job_id_cnt++] =
+				step_ptr->job_id;
+		list_iterator_destroy(iterator);
+		filtered = true;
+	}
+
+	if (params.part_list && list_count(params.part_list)) {
+		filter->partitions = xmalloc(sizeof(char *) *
+					     list_count(params.part_list));
+		iterator = list_iterator_create(params.part_list);
+		while ((name = list_next(iterator)))
+			filter->partitions[filter->partition_cnt++] = name;
+		list_iterator_destroy(iterator);
+		filtered = true;
+	}
+
+	if (params.user_list && list_count(params.user_list)) {
+		filter->user_ids = xmalloc(sizeof(uint32_t) *
+					   list_count(params.user_list));
+		iterator = list_iterator_create(params.user_list);
+		while ((id_ptr = list_next(iterator)))
+			filter->user_ids[filter->user_cnt++] = *id_ptr;
+		list_iterator_destroy(iterator);
+		filtered = true;
+	}
+
+	if (steps)
+		return filtered;
+
+	if (params.account_list && list_count(params.account_list)) {
+		filter->accounts = xmalloc(sizeof(char *) *
+					   list_count(params.account_list));
+		iterator = list_iterator_create(params.account_list);
+		while ((name = list_next(iterator)))
+			filter->accounts[filter->account_cnt++] = name;
+		list_iterator_destroy(iterator);
+		filtered = true;
+	}
+
+	if (params.state_list && list_count(params.state_list)) {
+		filter->states = xmalloc(sizeof(uint16_t) *
+					 list_count(params.state_list));
+		iterator = list_iterator_create(params.state_list);
+		while ((state_ptr = list_next(iterator)))
+			filter->states[filter->state_cnt++] = *state_ptr;
+		list_iterator_destroy(iterator);
+		filtered = true;
+	}
+	/* The default states of _filter_job() in print.c are not sent, so
+	 * that a plain squeue can be answered from slurmctld's shared
+	 * response cache */
+
+	return filtered;
+}
+
+/* _free_filter - free the arrays set by _build_filter() */
+static void
+_free_filter(job_info_filter_t *filter)
+{
+	xfree(filter->accounts);
+	xfree(filter->job_ids);
+	xfree(filter->partitions);
+	xfree(filter->states);
+	xfree(filter->user_ids);
+}
+
 static void
 _print_date( void )
 {
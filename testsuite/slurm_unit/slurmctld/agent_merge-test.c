@@ -0,0 +1,262 @@
+/* Test of the merging of agent RPCs queued for the same nodes,
+ * src/slurmctld/agent_merge.c, as agent_queue_request() and agent_retry()
+ * use it.
+ *
+ * Usage: agent_merge-test
+ *
+ * _queue() and _issue() follow agent_queue_request() and the first loop of
+ * agent_retry(), which issues the first request never tried unless one
+ * queued before it is still held. With a merge delay, as when agent_engine
+ * is configured, a burst of signal RPCs to the same nodes must be issued as
+ * a few REQUEST_MULTI_MSG once the delay has passed. Without one, each
+ * request is issued as soon as queued and none can be merged. RPCs to other
+ * nodes, with another retry flag or queued behind another RPC for the nodes
+ * must not be merged, and the job IDs of all RPCs must be issued in the
+ * expected order.
+ */
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "src/common/hostlist.h"
+#include "src/common/list.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/agent_merge.h"
+
+#define RPC_CNT		100
+#define MERGE_DELAY	200	/* msec */
+
+static List retry_list;
+static int issued_rpc_cnt, issued_msg_cnt;
+static uint32_t issued_job_id[RPC_CNT];
+
+static void _fail(char *test, char *msg)
+{
+	printf("FAIL: %s: %s\n", test, msg);
+	exit(1);
+}
+
+static void _free_agent_arg(agent_arg_t *agent_arg_ptr)
+{
+	hostlist_destroy(agent_arg_ptr->hostlist);
+	if (agent_arg_ptr->msg_type == REQUEST_MULTI_MSG)
+		slurm_free_multi_msg(agent_arg_ptr->msg_args);
+	else
+		slurm_free_kill_tasks_msg(agent_arg_ptr->msg_args);
+	xfree(agent_arg_ptr);
+}
+
+static void _list_delete_retry(void *retry_entry)
+{
+	queued_request_t *queued_req_ptr = (queued_request_t *) retry_entry;
+
+	_free_agent_arg(queued_req_ptr->agent_arg_ptr);
+	xfree(queued_req_ptr->node_list);
+	xfree(queued_req_ptr);
+}
+
+static void _reset(void)
+{
+	if (retry_list)
+		list_destroy(retry_list);
+	retry_list = list_create(_list_delete_retry);
+	issued_rpc_cnt = 0;
+	issued_msg_cnt = 0;
+}
+
+static agent_arg_t *_signal_arg(char *nodes, uint32_t job_id, uint16_t retry)
+{
+	kill_tasks_msg_t *kill_tasks_msg = xmalloc(sizeof(kill_tasks_msg_t));
+	agent_arg_t *agent_arg_ptr = xmalloc(sizeof(agent_arg_t));
+
+	kill_tasks_msg->job_id      = job_id;
+	kill_tasks_msg->job_step_id = NO_VAL;
+	kill_tasks_msg->signal      = 9;
+
+	agent_arg_ptr->hostlist   = hostlist_create(nodes);
+	agent_arg_ptr->node_count = hostlist_count(agent_arg_ptr->hostlist);
+	agent_arg_ptr->retry      = retry;
+	agent_arg_ptr->msg_type   = REQUEST_SIGNAL_TASKS;
+	agent_arg_ptr->msg_args   = kill_tasks_msg;
+	return agent_arg_ptr;
+}
+
+/* As agent_queue_request(), where merge_delay is only set with
+ * agent_engine. An RPC which is not mergeable stands for any other type,
+ * such as a batch job launch. */
+static void _queue(agent_arg_t *agent_arg_ptr, bool mergeable,
+		   uint32_t merge_delay)
+{
+	queued_request_t *queued_req_ptr;
+	char *node_list = NULL;
+
+	if (mergeable)
+		node_list = hostlist_ranged_string_xmalloc(
+				agent_arg_ptr->hostlist);
+	if (node_list &&
+	    agent_merge_request(retry_list, agent_arg_ptr, node_list)) {
+		xfree(node_list);
+		return;
+	}
+	queued_req_ptr = xmalloc(sizeof(queued_request_t));
+	queued_req_ptr->agent_arg_ptr = agent_arg_ptr;
+	queued_req_ptr->node_list     = node_list;
+	if (node_list)
+		agent_merge_hold(queued_req_ptr, merge_delay);
+	list_append(retry_list, queued_req_ptr);
+}
+
+static void _record_job_id(char *test, kill_tasks_msg_t *kill_tasks_msg)
+{
+	if (issued_msg_cnt >= RPC_CNT)
+		_fail(test, "too many messages issued");
+	issued_job_id[issued_msg_cnt++] = kill_tasks_msg->job_id;
+}
+
+/* As the first loop of agent_retry(), RET false if nothing issued */
+static bool _issue(char *test)
+{
+	queued_request_t *queued_req_ptr;
+	agent_arg_t *agent_arg_ptr;
+	multi_msg_t *multi_msg;
+	slurm_msg_t *sub_msg;
+	ListIterator iter;
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	iter = list_iterator_create(retry_list);
+	while ((queued_req_ptr = (queued_request_t *) list_next(iter))) {
+		if (agent_merge_held(queued_req_ptr, &now)) {
+			queued_req_ptr = NULL;
+			break;
+		}
+		if (queued_req_ptr->last_attempt == 0) {
+			list_remove(iter);
+			break;
+		}
+	}
+	list_iterator_destroy(iter);
+	if (!queued_req_ptr)
+		return false;
+
+	issued_rpc_cnt++;
+	agent_arg_ptr = queued_req_ptr->agent_arg_ptr;
+	if (agent_arg_ptr->msg_type == REQUEST_MULTI_MSG) {
+		multi_msg = agent_arg_ptr->msg_args;
+		if (list_count(multi_msg->msg_list) > MAX_MULTI_MSG_CNT)
+			_fail(test, "REQUEST_MULTI_MSG too large");
+		iter = list_iterator_create(multi_msg->msg_list);
+		while ((sub_msg = (slurm_msg_t *) list_next(iter))) {
+			if (sub_msg->msg_type != REQUEST_SIGNAL_TASKS)
+				_fail(test, "bad sub message type");
+			_record_job_id(test, sub_msg->data);
+		}
+		list_iterator_destroy(iter);
+	} else
+		_record_job_id(test, agent_arg_ptr->msg_args);
+	_list_delete_retry(queued_req_ptr);
+	return true;
+}
+
+static void _check_order(char *test, uint32_t *job_id, int job_cnt)
+{
+	int i;
+
+	if (issued_msg_cnt != job_cnt)
+		_fail(test, "wrong count of messages issued");
+	for (i = 0; i < job_cnt; i++) {
+		if (issued_job_id[i] != job_id[i])
+			_fail(test, "messages issued out of order");
+	}
+}
+
+/* A burst of RPCs to the same nodes with the merge delay of agent_engine */
+static void _test_burst(void)
+{
+	char *test = "burst";
+	uint32_t job_id[RPC_CNT];
+	int i, req_cnt = (RPC_CNT + MAX_MULTI_MSG_CNT - 1) / MAX_MULTI_MSG_CNT;
+
+	_reset();
+	for (i = 0; i < RPC_CNT; i++) {
+		job_id[i] = i + 1;
+		_queue(_signal_arg("n[1-4]", job_id[i], 0), true, MERGE_DELAY);
+		/* agent_queue_request() calls agent_retry() */
+		if (_issue(test))
+			_fail(test, "request issued while held");
+	}
+	if (list_count(retry_list) != req_cnt)
+		_fail(test, "RPCs not merged while held");
+
+	usleep((MERGE_DELAY + 50) * 1000);
+	while (_issue(test))
+		;
+	if (list_count(retry_list) != 0)
+		_fail(test, "requests left queued after the delay");
+	if (issued_rpc_cnt != req_cnt)
+		_fail(test, "wrong count of RPCs issued");
+	_check_order(test, job_id, RPC_CNT);
+}
+
+/* The same burst without a merge delay, as with a pthread per agent: each
+ * request is issued as soon as queued, so none are merged */
+static void _test_no_delay(void)
+{
+	char *test = "no_delay";
+	uint32_t job_id[RPC_CNT];
+	int i;
+
+	_reset();
+	for (i = 0; i < RPC_CNT; i++) {
+		job_id[i] = i + 1;
+		_queue(_signal_arg("n[1-4]", job_id[i], 0), true, 0);
+		if (!_issue(test))
+			_fail(test, "request not issued");
+	}
+	if (issued_rpc_cnt != RPC_CNT)
+		_fail(test, "wrong count of RPCs issued");
+	_check_order(test, job_id, RPC_CNT);
+}
+
+/* RPCs which must not be merged, and nothing issued ahead of a held
+ * request */
+static void _test_no_merge(void)
+{
+	char *test = "no_merge";
+	uint32_t job_id[] = { 1, 3, 2, 4, 5, 6, 7 };
+
+	_reset();
+	_queue(_signal_arg("n[1-4]", 1, 0), true,  MERGE_DELAY);
+	_queue(_signal_arg("n[5-8]", 2, 0), true,  MERGE_DELAY);
+	_queue(_signal_arg("n[1-4]", 3, 0), true,  MERGE_DELAY); /* merged */
+	_queue(_signal_arg("n3",     4, 0), false, MERGE_DELAY);
+	_queue(_signal_arg("n[1-4]", 5, 0), true,  MERGE_DELAY); /* after 4 */
+	_queue(_signal_arg("n[5-8]", 6, 1), true,  MERGE_DELAY); /* retry */
+	_queue(_signal_arg("n[1-2]", 7, 0), true,  MERGE_DELAY); /* nodes */
+	if (_issue(test))
+		_fail(test, "request issued while held");
+	if (list_count(retry_list) != 6)
+		_fail(test, "wrong count of requests queued");
+
+	usleep((MERGE_DELAY + 50) * 1000);
+	while (_issue(test))
+		;
+	if (issued_rpc_cnt != 6)
+		_fail(test, "wrong count of RPCs issued");
+	_check_order(test, job_id, sizeof(job_id) / sizeof(job_id[0]));
+}
+
+int main(int argc, char *argv[])
+{
+	_test_burst();
+	_test_no_delay();
+	_test_no_merge();
+	list_destroy(retry_list);
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,225 @@
+/* Microbenchmark of slurmctld's find_job_record() lookup table,
+ * src/slurmctld/job_hash.c, against the chained hash table it replaced.
+ *
+ * Usage: job_hash-bench [lookups]
+ *
+ * For 10k, 100k and 1M jobs, build each table in turn, purge and resubmit
+ * a quarter of the jobs (leaving the gaps in the job ID sequence a long
+ * running slurmctld has), then time lookups of existing jobs in random
+ * order and of job IDs which are not in the table. random() is reseeded
+ * so that both tables hold the same jobs and see the same lookups. The
+ * old chained table is sized to the job count, as it was from MaxJobCount,
+ * and the new one is created with the job count as its size hint.
+ */
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/job_hash.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define LOOKUP_CNT	10000000
+
+static struct job_record **chain_hash = NULL;
+static uint32_t chain_size = 0;
+
+static void _chain_add(struct job_record *job_ptr)
+{
+	uint32_t inx = job_ptr->job_id % chain_size;
+
+	job_ptr->job_next = chain_hash[inx];
+	chain_hash[inx] = job_ptr;
+}
+
+static struct job_record *_chain_find(uint32_t job_id)
+{
+	struct job_record *job_ptr;
+
+	job_ptr = chain_hash[job_id % chain_size];
+	while (job_ptr) {
+		if (job_ptr->job_id == job_id)
+			return job_ptr;
+		job_ptr = job_ptr->job_next;
+	}
+	return NULL;
+}
+
+static struct job_record *_chain_remove(uint32_t job_id)
+{
+	struct job_record **job_pptr, *job_ptr;
+
+	job_pptr = &chain_hash[job_id % chain_size];
+	while ((job_ptr = *job_pptr)) {
+		if (job_ptr->job_id == job_id) {
+			*job_pptr = job_ptr->job_next;
+			return job_ptr;
+		}
+		job_pptr = &job_ptr->job_next;
+	}
+	return NULL;
+}
+
+static double _usec(struct timeval *tv1, struct timeval *tv2)
+{
+	return (tv2->tv_sec - tv1->tv_sec) * 1e6 +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
+
+/*
+ * Time one table, chained set for the old one
+ * OUT add, hit, miss - ns per add, successful and failed lookup
+ */
+static void _bench_table(bool chained, struct job_record **jobs,
+			 uint32_t job_cnt, uint32_t *keys, uint32_t lookup_cnt,
+			 double *add, double *hit, double *miss)
+{
+	struct job_record *job_ptr;
+	uint32_t i, j, next_id = 1, found = 0;
+	struct timeval tv1, tv2;
+
+	srandom(job_cnt);
+	if (chained) {
+		chain_size = job_cnt;
+		chain_hash = xmalloc(sizeof(struct job_record *) * chain_size);
+	} else
+		job_hash_init(job_cnt);
+
+	for (i = 0; i < job_cnt; i++)
+		jobs[i]->job_id = next_id++;
+	gettimeofday(&tv1, NULL);
+	for (i = 0; i < job_cnt; i++) {
+		if (chained)
+			_chain_add(jobs[i]);
+		else
+			job_hash_add(jobs[i]->job_id, jobs[i]);
+	}
+	gettimeofday(&tv2, NULL);
+	*add = _usec(&tv1, &tv2) * 1000 / job_cnt;
+
+	/* Purge a random quarter of the jobs and submit new ones */
+	for (i = 0; i < job_cnt / 4; i++) {
+		j = random() % job_cnt;
+		if (chained)
+			job_ptr = _chain_remove(jobs[j]->job_id);
+		else
+			job_ptr = job_hash_remove(jobs[j]->job_id);
+		if (job_ptr != jobs[j]) {
+			printf("FAILURE: job %u not found for removal\n",
+			       jobs[j]->job_id);
+			exit(1);
+		}
+		jobs[j]->job_id = next_id++;
+		if (chained)
+			_chain_add(jobs[j]);
+		else
+			job_hash_add(jobs[j]->job_id, jobs[j]);
+	}
+
+	/* Callers of find_job_record() go on to read the record, so do
+	 * that too rather than only timing the table */
+	for (i = 0; i < lookup_cnt; i++)
+		keys[i] = jobs[random() % job_cnt]->job_id;
+	gettimeofday(&tv1, NULL);
+	for (i = 0; i < lookup_cnt; i++) {
+		if (chained)
+			job_ptr = _chain_find(keys[i]);
+		else
+			job_ptr = job_hash_find(keys[i]);
+		found += (job_ptr && (job_ptr->job_id == keys[i]));
+	}
+	gettimeofday(&tv2, NULL);
+	*hit = _usec(&tv1, &tv2) * 1000 / lookup_cnt;
+	if (found != lookup_cnt) {
+		printf("FAILURE: %u of %u jobs not found\n",
+		       lookup_cnt - found, lookup_cnt);
+		exit(1);
+	}
+
+	for (i = 0; i < lookup_cnt; i++)
+		keys[i] = next_id + (random() % job_cnt);
+	found = 0;
+	gettimeofday(&tv1, NULL);
+	for (i = 0; i < lookup_cnt; i++) {
+		if (chained)
+			found += (_chain_find(keys[i]) != NULL);
+		else
+			found += (job_hash_find(keys[i]) != NULL);
+	}
+	gettimeofday(&tv2, NULL);
+	*miss = _usec(&tv1, &tv2) * 1000 / lookup_cnt;
+	if (found != 0) {
+		printf("FAILURE: found %u jobs which do not exist\n", found);
+		exit(1);
+	}
+
+	if (chained)
+		xfree(chain_hash);
+	else
+		job_hash_fini();
+}
+
+static void _bench(uint32_t job_cnt, uint32_t lookup_cnt)
+{
+	struct job_record **jobs;
+	uint32_t *keys;
+	uint32_t i, run;
+	double add, hit, miss;
+	double chain_add, chain_hit, chain_miss;
+	double hash_add, hash_hit, hash_miss;
+
+	jobs = xmalloc(sizeof(struct job_record *) * job_cnt);
+	keys = xmalloc(sizeof(uint32_t) * lookup_cnt);
+	for (i = 0; i < job_cnt; i++)
+		jobs[i] = xmalloc(sizeof(struct job_record));
+
+	/* Whichever table runs first pays for bringing the records into
+	 * memory, so time each one twice, alternating, and keep the best */
+	chain_add = chain_hit = chain_miss = 1e9;
+	hash_add  = hash_hit  = hash_miss  = 1e9;
+	for (run = 0; run < 2; run++) {
+		_bench_table(true, jobs, job_cnt, keys, lookup_cnt,
+			     &add, &hit, &miss);
+		chain_add  = MIN(chain_add, add);
+		chain_hit  = MIN(chain_hit, hit);
+		chain_miss = MIN(chain_miss, miss);
+		_bench_table(false, jobs, job_cnt, keys, lookup_cnt,
+			     &add, &hit, &miss);
+		hash_add  = MIN(hash_add, add);
+		hash_hit  = MIN(hash_hit, hit);
+		hash_miss = MIN(hash_miss, miss);
+	}
+
+	printf("%8u jobs  add: old %5.1f ns  new %5.1f ns  "
+	       "hit: old %5.1f ns  new %5.1f ns  "
+	       "miss: old %5.1f ns  new %5.1f ns\n", job_cnt,
+	       chain_add, hash_add, chain_hit, hash_hit,
+	       chain_miss, hash_miss);
+
+	for (i = 0; i < job_cnt; i++)
+		xfree(jobs[i]);
+	xfree(jobs);
+	xfree(keys);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t lookup_cnt = LOOKUP_CNT;
+
+	if (argc > 1)
+		lookup_cnt = strtoul(argv[1], NULL, 10);
+	if (lookup_cnt == 0) {
+		printf("Usage: %s [lookups]\n", argv[0]);
+		exit(1);
+	}
+
+	_bench(10000, lookup_cnt);
+	_bench(100000, lookup_cnt);
+	_bench(1000000, lookup_cnt);
+	exit(0);
+}
@@ -0,0 +1,360 @@
+/* Randomized test of the backfill scheduler's node availability timeline,
+ * src/plugins/sched/backfill/node_space.c, against a reference model.
+ *
+ * Usage: node_space-test [seed_count]
+ *
+ * For each seed, build a timeline of a few nodes and a model holding the
+ * free CPUs and memory of every node in every second, then apply random
+ * reservations to both, some of them of a job's actual allocation
+ * (node_space_req_t's job_resrcs). After each one, random node_space_avail(),
+ * node_space_overlap() and node_space_conflict() calls and the slice count
+ * are compared with the model, before and after node_space_settle(). The
+ * seed and call are printed on the first mismatch.
+ */
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/plugins/sched/backfill/node_space.h"
+
+#define SEED_CNT	200
+#define OP_CNT		100
+#define QUERY_CNT	20
+#define MAX_NODES	12
+#define BEGIN_TIME	1000
+#define MAX_SECS	200
+
+static int node_cnt, secs;
+static bool track_mem;
+static uint32_t cpus[MAX_NODES], mem[MAX_NODES];
+static bitstr_t *space_bitmap;
+/* free CPUs and memory of each node in each second, and the seconds at
+ * which a slice begins */
+static int32_t model_cpus[MAX_SECS][MAX_NODES];
+static int32_t model_mem[MAX_SECS][MAX_NODES];
+static bool model_cut[MAX_SECS];
+
+static int _rand(int lo, int hi)
+{
+	return lo + (random() % (hi - lo + 1));
+}
+
+static void _fail(unsigned int seed, char *call)
+{
+	printf("FAIL: seed %u: %s\n", seed, call);
+	exit(1);
+}
+
+static bitstr_t *_rand_bitmap(int percent)
+{
+	bitstr_t *bitmap = bit_alloc(node_cnt);
+	int i;
+
+	for (i = 0; i < node_cnt; i++) {
+		if (_rand(1, 100) <= percent)
+			bit_set(bitmap, i);
+	}
+	return bitmap;
+}
+
+static void _rand_req(node_space_req_t *req)
+{
+	memset(req, 0, sizeof(node_space_req_t));
+	req->whole_node = (_rand(1, 4) == 1);
+	req->cpus = _rand(1, 16);
+	req->mem_per_cpu = _rand(0, 1) ? _rand(1, 300) : 0;
+	req->mem_per_node = _rand(0, 1) ? _rand(1, 1000) : 0;
+}
+
+/* Set half of the reservations and conflict tests to use an allocation */
+static void _rand_resrcs(node_space_req_t *req, job_resources_t *job_resrcs)
+{
+	int i;
+
+	memset(job_resrcs, 0, sizeof(job_resources_t));
+	if (_rand(0, 1))
+		return;
+	job_resrcs->node_bitmap = _rand_bitmap(50);
+	job_resrcs->nhosts = bit_set_count(job_resrcs->node_bitmap);
+	job_resrcs->cpus = xmalloc(sizeof(uint16_t) * node_cnt);
+	job_resrcs->memory_allocated = xmalloc(sizeof(uint32_t) * node_cnt);
+	for (i = 0; i < job_resrcs->nhosts; i++) {
+		job_resrcs->cpus[i] = _rand(1, 16);
+		job_resrcs->memory_allocated[i] = _rand(0, 2000);
+	}
+	req->job_resrcs = job_resrcs;
+}
+
+static void _free_resrcs(job_resources_t *job_resrcs)
+{
+	FREE_NULL_BITMAP(job_resrcs->node_bitmap);
+	xfree(job_resrcs->cpus);
+	xfree(job_resrcs->memory_allocated);
+}
+
+/* The CPUs and memory a job uses of a node, as node_space.c sets them
+ * RET false if the node is not in the job's allocation */
+static bool _model_need(node_space_req_t *req, int inx, int32_t *need_cpus,
+			int32_t *need_mem)
+{
+	job_resources_t *job_resrcs = req->job_resrcs;
+	int i, j = 0;
+
+	if (job_resrcs) {
+		if (!bit_test(job_resrcs->node_bitmap, inx))
+			return false;
+		for (i = 0; i < inx; i++) {
+			if (bit_test(job_resrcs->node_bitmap, i))
+				j++;
+		}
+		*need_cpus = job_resrcs->cpus[j];
+		*need_mem = job_resrcs->memory_allocated[j];
+		return true;
+	}
+	if (req->whole_node) {
+		*need_cpus = cpus[inx];
+		*need_mem = track_mem ? mem[inx] : 0;
+		return true;
+	}
+	*need_cpus = MIN(req->cpus, cpus[inx]);
+	*need_mem = req->mem_per_cpu * (*need_cpus) + req->mem_per_node;
+	return true;
+}
+
+static bool _model_fits(int sec, node_space_req_t *req, int inx)
+{
+	int32_t need_cpus, need_mem;
+
+	if (!_model_need(req, inx, &need_cpus, &need_mem))
+		return true;
+	if (model_cpus[sec][inx] < need_cpus)
+		return false;
+	if (track_mem && (model_mem[sec][inx] < need_mem))
+		return false;
+	return true;
+}
+
+/* Return the first second of the slice containing a second */
+static int _model_slice(int sec)
+{
+	while (!model_cut[sec])
+		sec--;
+	return sec;
+}
+
+static void _model_reserve(node_space_req_t *req, bitstr_t *use_bitmap,
+			   int start, int end)
+{
+	int32_t need_cpus, need_mem;
+	int i, t;
+
+	model_cut[start] = true;
+	if (end < secs)
+		model_cut[end] = true;
+	for (i = 0; i < node_cnt; i++) {
+		if (!bit_test(use_bitmap, i) ||
+		    !_model_need(req, i, &need_cpus, &need_mem))
+			continue;
+		for (t = start; t < end; t++) {
+			model_cpus[t][i] -= need_cpus;
+			model_mem[t][i] -= need_mem;
+		}
+	}
+}
+
+static void _test_avail(node_space_t *space, unsigned int seed)
+{
+	node_space_req_t req;
+	bitstr_t *bitmap, *model_bitmap;
+	time_t when, model_when = 0;
+	int start, end, first, i, t;
+	char call[128];
+
+	_rand_req(&req);
+	start = _rand(-2, secs + 2);
+	end = start + _rand(0, secs / 2);
+	bitmap = _rand_bitmap(80);
+	model_bitmap = bit_copy(bitmap);
+	when = node_space_avail(space, BEGIN_TIME + start, BEGIN_TIME + end,
+				&req, bitmap);
+
+	bit_and(model_bitmap, space_bitmap);
+	if ((start >= 0) && (start < secs)) {
+		first = _model_slice(start);
+		for (t = first; (t < secs) && (_model_slice(t) <= end); t++) {
+			for (i = 0; i < node_cnt; i++) {
+				if (!_model_fits(t, &req, i))
+					bit_clear(model_bitmap, i);
+			}
+		}
+		for (t = start + 1; (t < secs) && !model_cut[t]; t++)
+			;
+		if (t < secs)
+			model_when = BEGIN_TIME + t;
+	}
+	snprintf(call, sizeof(call), "node_space_avail(%d, %d)", start, end);
+	if ((when != model_when) || !bit_equal(bitmap, model_bitmap))
+		_fail(seed, call);
+	FREE_NULL_BITMAP(bitmap);
+	FREE_NULL_BITMAP(model_bitmap);
+}
+
+static void _test_overlap(node_space_t *space, unsigned int seed)
+{
+	node_space_req_t req;
+	bitstr_t *bitmap;
+	bool overlap, model_overlap = false;
+	int start, end, i, t;
+	char call[128];
+
+	_rand_req(&req);
+	start = _rand(-2, secs + 2);
+	end = start + _rand(0, secs / 2);
+	bitmap = _rand_bitmap(30);
+	overlap = node_space_overlap(space, &req, bitmap, BEGIN_TIME + start,
+				     BEGIN_TIME + end);
+
+	if ((start >= 0) && (start < secs)) {
+		for (t = _model_slice(start);
+		     (t < secs) && (_model_slice(t) < end); t++) {
+			for (i = 0; i < node_cnt; i++) {
+				if (bit_test(bitmap, i) &&
+				    !_model_fits(t, &req, i))
+					model_overlap = true;
+			}
+		}
+	}
+	snprintf(call, sizeof(call), "node_space_overlap(%d, %d)",
+		 start, end);
+	if (overlap != model_overlap)
+		_fail(seed, call);
+	FREE_NULL_BITMAP(bitmap);
+}
+
+static void _test_conflict(node_space_t *space, unsigned int seed)
+{
+	node_space_req_t req;
+	job_resources_t job_resrcs;
+	bitstr_t *bitmap;
+	time_t when, model_when = 0;
+	int after, before, i, t;
+	char call[128];
+
+	_rand_req(&req);
+	_rand_resrcs(&req, &job_resrcs);
+	after = _rand(-2, secs + 2);
+	before = after + _rand(0, secs);
+	bitmap = _rand_bitmap(30);
+	when = node_space_conflict(space, &req, bitmap, BEGIN_TIME + after,
+				   BEGIN_TIME + before);
+
+	for (t = MAX(after + 1, 0); (t < secs) && (t < before) &&
+		     (model_when == 0); t++) {
+		if (!model_cut[t])
+			continue;
+		for (i = 0; i < node_cnt; i++) {
+			if (bit_test(bitmap, i) && !_model_fits(t, &req, i))
+				model_when = BEGIN_TIME + t;
+		}
+	}
+	snprintf(call, sizeof(call), "node_space_conflict(%d, %d)",
+		 after, before);
+	if (when != model_when)
+		_fail(seed, call);
+	FREE_NULL_BITMAP(bitmap);
+	_free_resrcs(&job_resrcs);
+}
+
+static void _test_queries(node_space_t *space, unsigned int seed)
+{
+	int i, t, slice_cnt = 0;
+
+	for (t = 0; t < secs; t++) {
+		if (model_cut[t])
+			slice_cnt++;
+	}
+	if (node_space_count(space) != slice_cnt)
+		_fail(seed, "node_space_count()");
+	for (i = 0; i < QUERY_CNT; i++) {
+		switch (_rand(0, 2)) {
+		case 0:
+			_test_avail(space, seed);
+			break;
+		case 1:
+			_test_overlap(space, seed);
+			break;
+		default:
+			_test_conflict(space, seed);
+			break;
+		}
+	}
+}
+
+static void _test_seed(unsigned int seed)
+{
+	node_space_t *space;
+	node_space_req_t req;
+	job_resources_t job_resrcs;
+	bitstr_t *use_bitmap;
+	int i, t, op, start, end;
+
+	srandom(seed);
+	node_cnt = _rand(1, MAX_NODES);
+	secs = _rand(1, MAX_SECS);
+	track_mem = (_rand(0, 1) == 1);
+	for (i = 0; i < node_cnt; i++) {
+		cpus[i] = _rand(1, 16);
+		mem[i] = _rand(100, 4000);
+	}
+	space_bitmap = _rand_bitmap(90);
+	memset(model_cut, 0, sizeof(model_cut));
+	model_cut[0] = true;
+	for (t = 0; t < secs; t++) {
+		for (i = 0; i < node_cnt; i++) {
+			model_cpus[t][i] = cpus[i];
+			model_mem[t][i] = mem[i];
+		}
+	}
+	space = node_space_create(BEGIN_TIME, BEGIN_TIME + secs, space_bitmap,
+				  node_cnt, cpus, track_mem ? mem : NULL);
+
+	for (op = 0; op < OP_CNT; op++) {
+		_rand_req(&req);
+		_rand_resrcs(&req, &job_resrcs);
+		start = _rand(0, secs - 1);
+		end = _rand(start + 1, secs);
+		use_bitmap = _rand_bitmap(30);
+		node_space_reserve(space, &req, use_bitmap, BEGIN_TIME + start,
+				   BEGIN_TIME + end);
+		_model_reserve(&req, use_bitmap, start, end);
+		FREE_NULL_BITMAP(use_bitmap);
+		_free_resrcs(&job_resrcs);
+
+		_test_queries(space, seed);
+		if (_rand(0, 3) == 0) {
+			node_space_settle(space);
+			_test_queries(space, seed);
+		}
+	}
+	node_space_destroy(space);
+	FREE_NULL_BITMAP(space_bitmap);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int seed, seed_cnt = SEED_CNT;
+
+	if (argc > 1)
+		seed_cnt = atoi(argv[1]);
+	for (seed = 1; seed <= seed_cnt; seed++)
+		_test_seed(seed);
+	printf("PASS: %u seeds\n", seed_cnt);
+	return 0;
+}